@@ -0,0 +1,1333 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file cascade.c
+ *
+ * \brief Cascade common trees finder
+ *
+ * This file contains a common trees finder for circuits that are chains of
+ * stages (ladders, cascaded two-ports and so on) linked together through single
+ * nodes and the ground. The circuit is split at those nodes, the common trees
+ * of each stage are found once for every way its boundary rows can be shared
+ * with the neighbouring stages, then stages are chained together multiplying
+ * their polynomials, as it happens with chain (ABCD) matrices. So, the work
+ * depends on the size of the stages and of the result rather than on the size
+ * of the whole search tree.
+ *
+ * Signs come from a block Laplace expansion of the incident matrices of both
+ * the graphs. The additional %edge of the block is expanded first (its nodes
+ * are dropped from the rows), then the rows are sorted along the chain so that
+ * boundary rows never move and only the ground row, shared by all the stages,
+ * does. Whatever is left is a sign common to all the terms.
+ */
+
+#include "common.h"
+#include "list.h"
+#include "circuit.h"
+#include "expr.h"
+#include "ctree.h"
+#include "cascade.h"
+#include "nest.h"
+
+/**
+ * \brief Number of chain states
+ *
+ * A state tells which stage owns the boundary row of each graph and if the
+ * ground row of each graph has been already owned.
+ */
+#define CS_STATES 16
+
+/**
+ * \brief Boundary row of a graph owned by the following stage
+ */
+#define CS_OWN(g) (1 << (g))
+
+/**
+ * \brief Ground row of a graph owned by a previous stage
+ */
+#define CS_TAKEN(g) (4 << (g))
+
+/**
+ * \brief Incidence graph of the circuit
+ *
+ * Vertices are nodes first and edges then; each %edge is linked to the nodes
+ * that are rows of the incident matrices, for both the graphs.
+ */
+struct cgraph
+{
+  int vnum;  /**< Number of vertices */
+  int* head;  /**< First link of each vertex (-1 if none) */
+  int* next;  /**< Next link */
+  int* link;  /**< Linked vertex */
+  int* lab;  /**< Visit stamps */
+  int* dist;  /**< Distances from the source of the last visit */
+  int* queue;  /**< Visit queue */
+  int stamp;  /**< Actual visit stamp */
+};
+
+/**
+ * \brief Common trees enumeration status of a stage
+ */
+struct cenum
+{
+  cstat_t* cs;  /**< Cascade status */
+  const int* edge;  /**< Edges of the stage (increasing order) */
+  int ecnt;  /**< Number of edges of the stage */
+  int m;  /**< Number of rows (each graph) */
+  int* loc[2];  /**< Local row of each node, zero for the ground (each graph) */
+  int* cc[2];  /**< Common components (each graph) */
+  char* intree;  /**< Edge is into the tree */
+  int* tree;  /**< Edges into the tree */
+  int cnt;  /**< Number of edges into the tree */
+  int* ids;  /**< Symbols support array */
+  int* head;  /**< Tree adjacency: first link of each row */
+  int* next;  /**< Tree adjacency: next link */
+  int* link;  /**< Tree adjacency: linked row and column (pairs) */
+  int* queue;  /**< Breadth-first search queue */
+  int* col;  /**< Column of the parent %edge of each row */
+  char* seen;  /**< Visited rows */
+  cpoly_t* poly;  /**< Resulting polynomial */
+};
+
+/**
+ * \brief Polynomial constructor
+ *
+ * \internal
+ * \return newly allocated empty polynomial
+ */
+cpoly_t*
+cp_new ()
+{
+  cpoly_t* cp;
+  int iter;
+  cp = XMALLOC(cpoly_t, 1);
+  cp->size = 16;
+  cp->cnt = 0;
+  cp->mono = XMALLOC(struct cmono, cp->size);
+  cp->ssize = 32;
+  cp->slot = XMALLOC(int, cp->ssize);
+  for(iter = 0; iter < cp->ssize; ++iter)
+    cp->slot[iter] = -1;
+  cp->psize = 64;
+  cp->pcnt = 0;
+  cp->pool = XMALLOC(int, cp->psize);
+  return cp;
+}
+
+/**
+ * \brief Polynomial destructor
+ *
+ * \internal
+ * \param cp polynomial
+ */
+void
+cp_del (cpoly_t* cp)
+{
+  if(cp != NULL) {
+    XFREE(cp->mono);
+    XFREE(cp->slot);
+    XFREE(cp->pool);
+    XFREE(cp);
+  }
+}
+
+/**
+ * \brief Lookup slot of a monomial
+ *
+ * \internal
+ * \param cp polynomial
+ * \param key monomial key
+ * \param degree monomial degree
+ * \param ids symbols of the monomial
+ * \param n number of symbols
+ * \return index of the matching slot or of the free one to be used
+ */
+static int
+cp_slot (const cpoly_t* cp, const unsigned long long key, const int degree, const int* ids, const int n)
+{
+  const struct cmono* mptr;
+  int idx;
+  idx = (int) ((key ^ ((unsigned long long) degree * 0x9e3779b97f4a7c15ULL)) & (unsigned long long) (cp->ssize - 1));
+  while(cp->slot[idx] >= 0) {
+    mptr = &(cp->mono[cp->slot[idx]]);
+    if((mptr->key == key) && (mptr->degree == degree) && (mptr->etoken == n) &&
+       ((n == 0) || (!memcmp(cp->pool + mptr->off, ids, n * sizeof(int)))))
+      break;
+    idx = (idx + 1) & (cp->ssize - 1);
+  }
+  return idx;
+}
+
+/**
+ * \brief Adds a term to a polynomial
+ *
+ * \internal
+ * \param cp polynomial
+ * \param key term key
+ * \param degree term degree
+ * \param ids symbols of the term (sorted)
+ * \param n number of symbols
+ * \param vpart numerical part of the term
+ */
+void
+cp_add (cpoly_t* cp, const unsigned long long key, const int degree, const int* ids, const int n, const double vpart)
+{
+  struct cmono* mptr;
+  int idx;
+  int iter;
+  idx = cp_slot(cp, key, degree, ids, n);
+  if(cp->slot[idx] >= 0) cp->mono[cp->slot[idx]].vpart += vpart;
+  else {
+    if(cp->cnt == cp->size) {
+      cp->size *= 2;
+      cp->mono = XREALLOC(struct cmono, cp->mono, cp->size);
+    }
+    if(cp->pcnt + n > cp->psize) {
+      while(cp->pcnt + n > cp->psize)
+	cp->psize *= 2;
+      cp->pool = XREALLOC(int, cp->pool, cp->psize);
+    }
+    mptr = &(cp->mono[cp->cnt]);
+    mptr->key = key;
+    mptr->degree = degree;
+    mptr->etoken = n;
+    mptr->off = cp->pcnt;
+    mptr->vpart = vpart;
+    for(iter = 0; iter < n; ++iter)
+      cp->pool[cp->pcnt++] = ids[iter];
+    cp->slot[idx] = cp->cnt++;
+    if(2 * cp->cnt > cp->ssize) {
+      XFREE(cp->slot);
+      cp->ssize *= 2;
+      cp->slot = XMALLOC(int, cp->ssize);
+      for(iter = 0; iter < cp->ssize; ++iter)
+	cp->slot[iter] = -1;
+      for(iter = 0; iter < cp->cnt; ++iter) {
+	mptr = &(cp->mono[iter]);
+	cp->slot[cp_slot(cp, mptr->key, mptr->degree, cp->pool + mptr->off, mptr->etoken)] = iter;
+      }
+    }
+  }
+}
+
+/**
+ * \brief Multiplies two polynomials
+ *
+ * \internal
+ * Stages have no edges in common, so that symbols of the two factors are
+ * simply merged together.
+ *
+ * \param dest polynomial the product is added to
+ * \param first first factor
+ * \param second second factor
+ * \param sign sign of the product
+ * \param ids symbols support array
+ */
+void
+cp_mul (cpoly_t* dest, const cpoly_t* first, const cpoly_t* second, const int sign, int* ids)
+{
+  const struct cmono* fptr;
+  const struct cmono* sptr;
+  int fiter;
+  int siter;
+  int fpos;
+  int spos;
+  int n;
+  for(fiter = 0; fiter < first->cnt; ++fiter) {
+    fptr = &(first->mono[fiter]);
+    for(siter = 0; siter < second->cnt; ++siter) {
+      sptr = &(second->mono[siter]);
+      fpos = spos = n = 0;
+      while((fpos < fptr->etoken) || (spos < sptr->etoken)) {
+	if((spos == sptr->etoken) || ((fpos < fptr->etoken) && (first->pool[fptr->off + fpos] < second->pool[sptr->off + spos])))
+	  ids[n++] = first->pool[fptr->off + fpos++];
+	else ids[n++] = second->pool[sptr->off + spos++];
+      }
+      cp_add(dest, fptr->key ^ sptr->key, fptr->degree + sptr->degree, ids, n, sign * fptr->vpart * sptr->vpart);
+    }
+  }
+}
+
+/**
+ * \brief Compares monomials by chain order
+ *
+ * \internal
+ * Decreasing degree first, then creation order.
+ *
+ * \param a first monomial
+ * \param b second monomial
+ * \return comparison result, as required by qsort
+ */
+static int
+cp_compare (const void* a, const void* b)
+{
+  const struct cmono* ma;
+  const struct cmono* mb;
+  ma = *((const struct cmono* const*) a);
+  mb = *((const struct cmono* const*) b);
+  if(ma->degree != mb->degree) return (ma->degree > mb->degree) ? -1 : 1;
+  return (ma > mb) - (ma < mb);
+}
+
+/**
+ * \brief Compares symbols
+ *
+ * \internal
+ * \param a first symbol
+ * \param b second symbol
+ * \return comparison result, as required by qsort
+ */
+static int
+cp_symcmp (const void* a, const void* b)
+{
+  return strcmp(*((char* const*) a), *((char* const*) b));
+}
+
+/**
+ * \brief Builds the chain of a polynomial
+ *
+ * \internal
+ * Terms are sorted by decreasing degree and symbols of each term are sorted
+ * too, as \e to_expr function does.
+ *
+ * \param crep %circuit reference
+ * \param cp polynomial
+ * \param sign sign of all the terms
+ * \return the resulting chain
+ */
+expr_t*
+cp_chain (const circ_t* crep, const cpoly_t* cp, const int sign)
+{
+  const struct cmono** order;
+  char** names;
+  expr_t* chain;
+  expr_t* eslice;
+  expr_t** eiter;
+  int iter;
+  int sym;
+  order = XMALLOC(const struct cmono*, cp->cnt + 1);
+  names = XMALLOC(char*, crep->ednum + 1);
+  for(iter = 0; iter < cp->cnt; ++iter)
+    order[iter] = &(cp->mono[iter]);
+  qsort(order, cp->cnt, sizeof(const struct cmono*), cp_compare);
+  chain = NULL;
+  eiter = &chain;
+  for(iter = 0; iter < cp->cnt; ++iter) {
+    eslice = expr_new();
+    eslice->vpart = sign * order[iter]->vpart;
+    eslice->degree = order[iter]->degree;
+    eslice->etoken = order[iter]->etoken;
+    for(sym = 0; sym < order[iter]->etoken; ++sym)
+      names[sym] = crep->edge[cp->pool[order[iter]->off + sym]].name;
+    qsort(names, order[iter]->etoken, sizeof(char*), cp_symcmp);
+    for(sym = order[iter]->etoken - 1; sym >= 0; --sym)
+      eslice->epart = list_add(list_new((void*) xstrdup(names[sym])), eslice->epart);
+    *eiter = eslice;
+    eiter = &((*eiter)->next);
+  }
+  XFREE(names);
+  XFREE(order);
+  return chain;
+}
+
+/**
+ * \brief Visit of the incidence graph
+ *
+ * \internal
+ * Breadth-first visit that doesn't cross neither \a skip nor blocked vertices.
+ * Visited vertices are stamped with a new stamp.
+ *
+ * \param cg incidence graph
+ * \param src source vertex
+ * \param skip vertex not to be crossed (-1 if none)
+ * \param block vertices not to be crossed (NULL if none)
+ * \param nnum number of nodes (node vertices come first)
+ * \return the farthest node vertex from \a src
+ */
+static int
+cg_visit (struct cgraph* cg, const int src, const int skip, const char* block, const int nnum)
+{
+  int first;
+  int last;
+  int cur;
+  int far;
+  int iter;
+  int dest;
+  ++(cg->stamp);
+  first = 0;
+  last = 1;
+  far = src;
+  cg->queue[0] = src;
+  cg->lab[src] = cg->stamp;
+  cg->dist[src] = 0;
+  while(first < last) {
+    cur = cg->queue[first++];
+    if(cur < nnum) far = cur;
+    for(iter = cg->head[cur]; iter != -1; iter = cg->next[iter]) {
+      dest = cg->link[iter];
+      if((cg->lab[dest] != cg->stamp) && (dest != skip) && ((block == NULL) || (!block[dest]))) {
+	cg->lab[dest] = cg->stamp;
+	cg->dist[dest] = cg->dist[cur] + 1;
+	cg->queue[last++] = dest;
+      }
+    }
+  }
+  return far;
+}
+
+/**
+ * \brief Node is a row of the incident matrix of a graph
+ *
+ * \internal
+ * \param cs cascade status
+ * \param g zero for the current graph, one for the voltage graph
+ * \param node node of interest
+ * \return a positive value if \a node is a row other than the ground row
+ */
+static int
+cs_isrow (const cstat_t* cs, const int g, const int node)
+{
+  return (node >= 0) && (node != cs->crep->basenode) && (!cs->drop[g][node]);
+}
+
+/**
+ * \brief Splits a connected piece of the circuit into a chain of stages
+ *
+ * \internal
+ * The farthest nodes of the piece are its ends, nodes that separate them are
+ * the boundary nodes. Once they're removed, each region lies between two
+ * consecutive boundary nodes (or hangs from a single one) and it joins the
+ * related stage.
+ *
+ * \param cs cascade status
+ * \param cg incidence graph
+ * \param comp component of each vertex
+ * \param label component of interest
+ * \param cuts boundary nodes support array
+ * \return number of stages of the piece
+ */
+static int
+cs_piece (cstat_t* cs, struct cgraph* cg, const int* comp, const int label, int* cuts)
+{
+  const int nnum = cs->crep->nnum;
+  int* dend;
+  int* region;
+  int iter;
+  int vert;
+  int start;
+  int end;
+  int ncut;
+  int tmp;
+  int lo;
+  int hi;
+  int adj;
+  int stage;
+  int bad;
+  dend = XMALLOC(int, cg->vnum);
+  region = XMALLOC(int, cg->vnum);
+  for(start = 0; comp[start] != label; ++start);
+  start = cg_visit(cg, start, -1, NULL, nnum);
+  end = cg_visit(cg, start, -1, NULL, nnum);
+  for(iter = 0; iter < cg->vnum; ++iter)
+    dend[iter] = cg->dist[iter];
+  // boundary nodes, sorted by distance from the first end
+  ncut = 0;
+  for(iter = 0; iter < nnum; ++iter)
+    if((comp[iter] == label) && (iter != start) && (iter != end)) {
+      cg_visit(cg, start, iter, NULL, nnum);
+      if(cg->lab[end] != cg->stamp) {
+	for(tmp = ncut++; (tmp > 0) && (dend[cuts[tmp - 1]] > dend[iter]); --tmp)
+	  cuts[tmp] = cuts[tmp - 1];
+	cuts[tmp] = iter;
+      }
+    }
+  for(iter = 0; iter < ncut; ++iter) {
+    cs->iscut[cuts[iter]] = 1;
+    dend[cuts[iter]] = iter;
+  }
+  // regions between boundary nodes
+  bad = 0;
+  for(iter = 0; iter < cg->vnum; ++iter)
+    region[iter] = -1;
+  for(iter = 0; (iter < cg->vnum) && (!bad); ++iter)
+    if((comp[iter] == label) && (region[iter] < 0) && ((iter >= nnum) || (!cs->iscut[iter]))) {
+      cg_visit(cg, iter, -1, cs->iscut, nnum);
+      lo = ncut;
+      hi = -1;
+      for(vert = 0; vert < cg->vnum; ++vert)
+	if(cg->lab[vert] == cg->stamp)
+	  for(tmp = cg->head[vert]; tmp != -1; tmp = cg->next[tmp]) {
+	    adj = cg->link[tmp];
+	    if((adj < nnum) && cs->iscut[adj]) {
+	      if(dend[adj] < lo) lo = dend[adj];
+	      if(dend[adj] > hi) hi = dend[adj];
+	    }
+	  }
+      if(cg->lab[start] == cg->stamp) stage = 0;
+      else if(cg->lab[end] == cg->stamp) stage = ncut;
+      else if((hi >= 0) && (hi - lo <= 1)) stage = hi;
+      else stage = -1;
+      if(((cg->lab[start] == cg->stamp) && (hi > 0)) || ((cg->lab[end] == cg->stamp) && (lo < ncut - 1)) || (stage < 0))
+	bad = 1;
+      for(vert = 0; vert < cg->vnum; ++vert)
+	if(cg->lab[vert] == cg->stamp)
+	  region[vert] = stage;
+    }
+  if(bad) {
+    // not a chain, the piece is a single stage
+    for(iter = 0; iter < ncut; ++iter)
+      cs->iscut[cuts[iter]] = 0;
+    for(iter = 0; iter < cg->vnum; ++iter)
+      region[iter] = 0;
+    ncut = 0;
+  }
+  for(iter = 0; iter < cg->vnum; ++iter)
+    if(comp[iter] == label) {
+      if(iter < nnum) cs->nstage[iter] = cs->scnt + region[iter];
+      else cs->estage[iter - nnum] = cs->scnt + region[iter];
+    }
+  for(iter = 0; iter < ncut; ++iter)
+    cs->cut[cs->scnt + iter] = cuts[iter];
+  cs->cut[cs->scnt + ncut] = -1;
+  XFREE(region);
+  XFREE(dend);
+  return ncut + 1;
+}
+
+/**
+ * \brief Splits the circuit into a chain of stages
+ *
+ * \internal
+ * Nodes and edges are linked into an incidence graph (dropped rows and the
+ * ground row are left out); each connected piece of it is split on its own and
+ * pieces follow one another without boundary nodes.
+ *
+ * \param cs cascade status
+ * \return zero if some row can't be reached by any %edge (there are no common
+ *   trees at all), a positive value otherwise
+ */
+static int
+cs_split (cstat_t* cs)
+{
+  const circ_t* crep;
+  const edge_t* eptr;
+  struct cgraph cg;
+  int* comp;
+  int* cuts;
+  int rows[4];
+  int nrow;
+  int lcnt;
+  int label;
+  int iter;
+  int node;
+  int g;
+  int k;
+  int ret;
+  crep = cs->crep;
+  cg.vnum = crep->nnum + crep->ednum;
+  cg.head = XMALLOC(int, cg.vnum);
+  cg.next = XMALLOC(int, 8 * crep->ednum + 1);
+  cg.link = XMALLOC(int, 8 * crep->ednum + 1);
+  cg.lab = XMALLOC(int, cg.vnum);
+  cg.dist = XMALLOC(int, cg.vnum);
+  cg.queue = XMALLOC(int, cg.vnum);
+  cg.stamp = 0;
+  comp = XMALLOC(int, cg.vnum);
+  cuts = XMALLOC(int, crep->nnum);
+  for(iter = 0; iter < cg.vnum; ++iter) {
+    cg.head[iter] = -1;
+    cg.lab[iter] = 0;
+    comp[iter] = -1;
+  }
+  lcnt = 0;
+  for(iter = 0; iter < crep->ednum; ++iter)
+    if(cs->estage[iter] >= 0) {
+      eptr = &(crep->edge[iter]);
+      nrow = 0;
+      for(g = 0; g < 2; ++g)
+	for(k = 0; k < 2; ++k) {
+	  node = (g ? eptr->gvref[k] : eptr->giref[k])->node;
+	  if(cs_isrow(cs, g, node)) {
+	    rows[nrow] = node;
+	    for(label = 0; rows[label] != node; ++label);
+	    if(label == nrow) ++nrow;
+	  }
+	}
+      for(k = 0; k < nrow; ++k) {
+	cg.link[lcnt] = crep->nnum + iter;
+	cg.next[lcnt] = cg.head[rows[k]];
+	cg.head[rows[k]] = lcnt++;
+	cg.link[lcnt] = rows[k];
+	cg.next[lcnt] = cg.head[crep->nnum + iter];
+	cg.head[crep->nnum + iter] = lcnt++;
+      }
+      // edges without rows belong to the first stage
+      cs->estage[iter] = 0;
+    }
+  for(iter = 0; iter < crep->nnum; ++iter)
+    cs->nstage[iter] = 0;
+  for(iter = 0; iter < cg.vnum; ++iter)
+    cs->iscut[iter] = 0;
+  label = 0;
+  for(iter = 0; iter < cg.vnum; ++iter)
+    if((cg.head[iter] != -1) && (comp[iter] < 0)) {
+      cg_visit(&cg, iter, -1, NULL, crep->nnum);
+      for(node = 0; node < cg.vnum; ++node)
+	if(cg.lab[node] == cg.stamp)
+	  comp[node] = label;
+      ++label;
+    }
+  cs->scnt = 0;
+  cs->cut[0] = -1;
+  for(iter = 0; iter < label; ++iter)
+    cs->scnt += cs_piece(cs, &cg, comp, iter, cuts);
+  if(cs->scnt == 0) cs->scnt = 1;
+  // private rows of the stages
+  ret = 1;
+  for(g = 0; g < 2; ++g) {
+    for(iter = 0; iter <= cs->scnt; ++iter)
+      cs->roff[g][iter] = 0;
+    for(node = 0; node < crep->nnum; ++node)
+      if(cs_isrow(cs, g, node)) {
+	if(cg.head[node] == -1) ret = 0;
+	else if(!cs->iscut[node]) ++(cs->roff[g][cs->nstage[node] + 1]);
+      }
+    for(iter = 0; iter < cs->scnt; ++iter)
+      cs->roff[g][iter + 1] += cs->roff[g][iter];
+    for(iter = 0; iter < cs->scnt; ++iter)
+      cuts[iter] = cs->roff[g][iter];
+    for(node = 0; node < crep->nnum; ++node)
+      if(cs_isrow(cs, g, node) && (cg.head[node] != -1) && (!cs->iscut[node]))
+	cs->row[g][cuts[cs->nstage[node]]++] = node;
+  }
+  XFREE(cuts);
+  XFREE(comp);
+  XFREE(cg.queue);
+  XFREE(cg.dist);
+  XFREE(cg.lab);
+  XFREE(cg.link);
+  XFREE(cg.next);
+  XFREE(cg.head);
+  return ret;
+}
+
+/**
+ * \brief Boundary node following a stage is a row of a graph
+ *
+ * \internal
+ * \param cs cascade status
+ * \param g zero for the current graph, one for the voltage graph
+ * \param stage stage of interest
+ * \return a positive value if the boundary node is a row
+ */
+static int
+cs_cutrow (const cstat_t* cs, const int g, const int stage)
+{
+  return (stage >= 0) && (stage < cs->scnt - 1) && cs_isrow(cs, g, cs->cut[stage]);
+}
+
+/**
+ * \brief Determinant of the incident matrix of a tree
+ *
+ * \internal
+ * Only one permutation gives a non null product into the expansion of the
+ * determinant: the one that maps each row onto the parent %edge of the related
+ * node, the ground being the root. So, the determinant is the product of the
+ * orientations of those edges, times the sign of the permutation.
+ *
+ * \param ce enumeration status
+ * \param g zero for the current graph, one for the voltage graph
+ * \return determinant of the matrix (zero if the edges are not a tree)
+ */
+static int
+ce_det (struct cenum* ce, const int g)
+{
+  const circ_t* crep;
+  tn_t* const* ref;
+  int iter;
+  int first;
+  int last;
+  int cur;
+  int na;
+  int nb;
+  int det;
+  int cycles;
+  crep = ce->cs->crep;
+  for(iter = 0; iter <= ce->m; ++iter) {
+    ce->head[iter] = -1;
+    ce->seen[iter] = 0;
+  }
+  for(iter = 0; iter < ce->m; ++iter) {
+    ref = g ? crep->edge[ce->tree[iter]].gvref : crep->edge[ce->tree[iter]].giref;
+    na = ce->loc[g][ref[0]->node];
+    nb = ce->loc[g][ref[1]->node];
+    ce->link[4 * iter] = nb;
+    ce->link[4 * iter + 1] = iter;
+    ce->next[2 * iter] = ce->head[na];
+    ce->head[na] = 2 * iter;
+    ce->link[4 * iter + 2] = na;
+    ce->link[4 * iter + 3] = iter;
+    ce->next[2 * iter + 1] = ce->head[nb];
+    ce->head[nb] = 2 * iter + 1;
+  }
+  det = 1;
+  first = 0;
+  last = 1;
+  ce->queue[0] = 0;
+  ce->seen[0] = 1;
+  while(first < last) {
+    cur = ce->queue[first++];
+    for(iter = ce->head[cur]; iter != -1; iter = ce->next[iter]) {
+      na = ce->link[2 * iter];
+      if(!ce->seen[na]) {
+	ce->seen[na] = 1;
+	ce->col[na - 1] = ce->link[2 * iter + 1];
+	ref = g ? crep->edge[ce->tree[ce->col[na - 1]]].gvref : crep->edge[ce->tree[ce->col[na - 1]]].giref;
+	if(ce->loc[g][ref[1]->node] != na) det = -det;
+	ce->queue[last++] = na;
+      }
+    }
+  }
+  if(last != ce->m + 1) det = 0;
+  else {
+    cycles = 0;
+    for(iter = 0; iter < ce->m; ++iter)
+      ce->seen[iter] = 0;
+    for(iter = 0; iter < ce->m; ++iter)
+      if(!ce->seen[iter]) {
+	++cycles;
+	for(cur = iter; !ce->seen[cur]; cur = ce->col[cur])
+	  ce->seen[cur] = 1;
+      }
+    if((ce->m - cycles) % 2) det = -det;
+  }
+  return det;
+}
+
+/**
+ * \brief Enumeration status constructor
+ *
+ * \internal
+ * Rows are given in order for both the graphs, any other node collapses into
+ * the ground.
+ *
+ * \param cs cascade status
+ * \param edge edges of the stage
+ * \param ecnt number of edges of the stage
+ * \param rows rows of both the graphs
+ * \param m number of rows (each graph)
+ * \return newly allocated enumeration status
+ */
+static struct cenum*
+ce_new (cstat_t* cs, const int* edge, const int ecnt, int* const* rows, const int m)
+{
+  struct cenum* ce;
+  int iter;
+  int g;
+  ce = XMALLOC(struct cenum, 1);
+  ce->cs = cs;
+  ce->edge = edge;
+  ce->ecnt = ecnt;
+  ce->m = m;
+  for(g = 0; g < 2; ++g) {
+    ce->loc[g] = XMALLOC(int, cs->crep->nnum);
+    for(iter = 0; iter < cs->crep->nnum; ++iter)
+      ce->loc[g][iter] = 0;
+    for(iter = 0; iter < m; ++iter)
+      ce->loc[g][rows[g][iter]] = iter + 1;
+    ce->cc[g] = XMALLOC(int, 2 * (m + 1));
+    for(iter = 0; iter <= m; ++iter) {
+      ce->cc[g][2 * iter] = iter;
+      ce->cc[g][2 * iter + 1] = -1;
+    }
+  }
+  ce->intree = XMALLOC(char, cs->crep->ednum);
+  for(iter = 0; iter < cs->crep->ednum; ++iter)
+    ce->intree[iter] = 0;
+  ce->tree = XMALLOC(int, m + 1);
+  ce->cnt = 0;
+  ce->ids = XMALLOC(int, ecnt + 1);
+  ce->head = XMALLOC(int, m + 1);
+  ce->next = XMALLOC(int, 2 * m + 1);
+  ce->link = XMALLOC(int, 4 * m + 1);
+  ce->queue = XMALLOC(int, m + 1);
+  ce->col = XMALLOC(int, m + 1);
+  ce->seen = XMALLOC(char, m + 1);
+  ce->poly = cp_new();
+  return ce;
+}
+
+/**
+ * \brief Enumeration status destructor
+ *
+ * \internal
+ * The polynomial isn't destroyed, it's given back instead.
+ *
+ * \param ce enumeration status
+ * \return the polynomial of the enumeration
+ */
+static cpoly_t*
+ce_del (struct cenum* ce)
+{
+  cpoly_t* cp;
+  cp = ce->poly;
+  XFREE(ce->seen);
+  XFREE(ce->col);
+  XFREE(ce->queue);
+  XFREE(ce->link);
+  XFREE(ce->next);
+  XFREE(ce->head);
+  XFREE(ce->ids);
+  XFREE(ce->tree);
+  XFREE(ce->intree);
+  XFREE(ce->cc[1]);
+  XFREE(ce->cc[0]);
+  XFREE(ce->loc[1]);
+  XFREE(ce->loc[0]);
+  XFREE(ce);
+  return cp;
+}
+
+/**
+ * \brief Adds the term of the actual tree to the polynomial
+ *
+ * \internal
+ * \param ce enumeration status
+ */
+static void
+ce_burn (struct cenum* ce)
+{
+  const edge_t* eptr;
+  unsigned long long key;
+  double vpart;
+  int degree;
+  int sign;
+  int iter;
+  int in;
+  int n;
+  key = 0;
+  vpart = 1.;
+  degree = 0;
+  n = 0;
+  for(iter = 0; iter < ce->ecnt; ++iter) {
+    eptr = &(ce->cs->crep->edge[ce->edge[iter]]);
+    in = ce->intree[ce->edge[iter]];
+    if((in && (eptr->type == Y)) || ((!in) && (eptr->type == Z))) {
+      degree += eptr->degree;
+      if(!eptr->sym) vpart *= eptr->value;
+      else if(eptr->name) {
+	ce->ids[n++] = ce->edge[iter];
+	key ^= ce->cs->ekey[ce->edge[iter]];
+      }
+    }
+  }
+  sign = ce_det(ce, 0) * ce_det(ce, 1);
+  if(sign) cp_add(ce->poly, key, degree, ce->ids, n, sign * vpart);
+}
+
+/**
+ * \brief Common trees of a stage
+ *
+ * \internal
+ * Each %edge is pushed into the tree, if it results in no loop in any of the
+ * graphs, and it's left out then, if it isn't a forced one.
+ *
+ * \param ce enumeration status
+ * \param pos actual %edge
+ */
+static void
+ce_visit (struct cenum* ce, const int pos)
+{
+  const edge_t* eptr;
+  int iter;
+  int ti;
+  int hi;
+  int tv;
+  int hv;
+  if(ce->cnt == ce->m) {
+    for(iter = pos; iter < ce->ecnt; ++iter)
+      if(ce->cs->forced[ce->edge[iter]]) return;
+    ce_burn(ce);
+  } else if(ce->ecnt - pos >= ce->m - ce->cnt) {
+    eptr = &(ce->cs->crep->edge[ce->edge[pos]]);
+    ti = ce->loc[0][eptr->giref[0]->node];
+    hi = ce->loc[0][eptr->giref[1]->node];
+    tv = ce->loc[1][eptr->gvref[0]->node];
+    hv = ce->loc[1][eptr->gvref[1]->node];
+    if((!testloop(ce->cc[0], ti, hi)) && (!testloop(ce->cc[1], tv, hv))) {
+      ctrlplus(ce->cc[0], ti, hi, ce->m + 1);
+      ctrlplus(ce->cc[1], tv, hv, ce->m + 1);
+      ce->intree[ce->edge[pos]] = 1;
+      ce->tree[ce->cnt++] = ce->edge[pos];
+      ce_visit(ce, pos + 1);
+      --(ce->cnt);
+      ce->intree[ce->edge[pos]] = 0;
+      ctrlminus(ce->cc[1], tv, hv, ce->m + 1);
+      ctrlminus(ce->cc[0], ti, hi, ce->m + 1);
+    }
+    if(!ce->cs->forced[ce->edge[pos]]) ce_visit(ce, pos + 1);
+  }
+}
+
+/**
+ * \brief Determinant of the incident matrix of a tree
+ *
+ * \internal
+ * Same as \e ce_det function, but the tree is given by the end-points of its
+ * edges (tail and head, in pairs) and the rows by the local row of each node.
+ *
+ * \param ends end-points of the edges
+ * \param cnt number of edges
+ * \param loc local row of each node, zero for the ground
+ * \param m number of rows
+ * \return determinant of the matrix (zero if the edges are not a tree)
+ */
+static int
+cs_tdet (const int* ends, const int cnt, const int* loc, const int m)
+{
+  int* col;
+  int* queue;
+  char* seen;
+  int first;
+  int last;
+  int cur;
+  int iter;
+  int other;
+  int det;
+  int cycles;
+  col = XMALLOC(int, m + 1);
+  queue = XMALLOC(int, m + 1);
+  seen = XMALLOC(char, m + 1);
+  for(iter = 0; iter <= m; ++iter)
+    seen[iter] = 0;
+  det = (cnt == m) ? 1 : 0;
+  first = 0;
+  last = 1;
+  queue[0] = 0;
+  seen[0] = 1;
+  while(det && (first < last)) {
+    cur = queue[first++];
+    for(iter = 0; iter < cnt; ++iter)
+      if((loc[ends[2 * iter]] == cur) || (loc[ends[2 * iter + 1]] == cur)) {
+	other = (loc[ends[2 * iter]] == cur) ? loc[ends[2 * iter + 1]] : loc[ends[2 * iter]];
+	if(!seen[other]) {
+	  seen[other] = 1;
+	  col[other - 1] = iter;
+	  if(loc[ends[2 * iter + 1]] != other) det = -det;
+	  queue[last++] = other;
+	}
+      }
+  }
+  if(last != m + 1) det = 0;
+  else {
+    cycles = 0;
+    for(iter = 0; iter < m; ++iter)
+      seen[iter] = 0;
+    for(iter = 0; iter < m; ++iter)
+      if(!seen[iter]) {
+	++cycles;
+	for(cur = iter; !seen[cur]; cur = col[cur])
+	  seen[cur] = 1;
+      }
+    if((m - cycles) % 2) det = -det;
+  }
+  XFREE(seen);
+  XFREE(queue);
+  XFREE(col);
+  return det;
+}
+
+/**
+ * \brief Sign common to all the terms
+ *
+ * Terms are signed as if the rows were all the nodes but those of the
+ * additional %edge, in the given order. Expanding the whole incident matrix
+ * (the ground row being dropped) along the column of the additional %edge, it
+ * turns out that they differ for a sign that doesn't depend on the tree, but
+ * only on the rows and on the additional %edge. So, any tree will do, even if
+ * it isn't a common tree of the %circuit: a star centered on the tail of the
+ * additional %edge is used, for each graph.
+ *
+ * \param cs cascade status
+ * \param order rows the terms are signed with (both the graphs)
+ * \param m number of rows (each graph)
+ * \return the sign to be applied to all the terms
+ */
+int
+cs_sign (cstat_t* cs, int* const* order, const int m)
+{
+  const circ_t* crep;
+  tn_t* const* ref;
+  int* ends;
+  int* loc;
+  int cnt;
+  int iter;
+  int sign;
+  int g;
+  crep = cs->crep;
+  ends = XMALLOC(int, 2 * crep->nnum);
+  loc = XMALLOC(int, crep->nnum);
+  sign = 1;
+  for(g = 0; g < 2; ++g) {
+    ref = g ? cs->ref->gvref : cs->ref->giref;
+    cnt = 0;
+    for(iter = 0; iter < crep->nnum; ++iter)
+      if((iter != ref[0]->node) && (iter != ref[1]->node)) {
+	ends[2 * cnt] = ref[0]->node;
+	ends[2 * cnt + 1] = iter;
+	++cnt;
+      }
+    for(iter = 0; iter < crep->nnum; ++iter)
+      loc[iter] = 0;
+    for(iter = 0; iter < m; ++iter)
+      loc[order[g][iter]] = iter + 1;
+    sign *= cs_tdet(ends, cnt, loc, m);
+    // the whole incident matrix, with the additional %edge as last column
+    ends[2 * cnt] = ref[0]->node;
+    ends[2 * cnt + 1] = ref[1]->node;
+    for(cnt = iter = 0; iter < crep->nnum; ++iter)
+      loc[iter] = (iter != crep->basenode) ? ++cnt : 0;
+    sign *= cs_tdet(ends, cnt, loc, cnt);
+  }
+  XFREE(loc);
+  XFREE(ends);
+  return sign;
+}
+
+/**
+ * \brief Cascade status constructor
+ *
+ * \param crep %circuit reference
+ * \param ref additional %edge of the block
+ * \param other additional %edge of the other block (NULL if none)
+ * \return newly allocated cascade status
+ */
+cstat_t*
+cs_new (const circ_t* crep, const edge_t* ref, const edge_t* other)
+{
+  cstat_t* cs;
+  list_t* fiter;
+  int iter;
+  int g;
+  cs = XMALLOC(cstat_t, 1);
+  cs->crep = crep;
+  cs->ref = ref;
+  cs->forced = XMALLOC(char, crep->ednum);
+  cs->ekey = XMALLOC(unsigned long long, crep->ednum);
+  cs->estage = XMALLOC(int, crep->ednum);
+  cs->nstage = XMALLOC(int, crep->nnum);
+  cs->iscut = XMALLOC(char, crep->nnum + crep->ednum);
+  cs->cut = XMALLOC(int, crep->nnum + crep->ednum + 1);
+  for(iter = 0; iter < crep->ednum; ++iter) {
+    // splitmix64
+    cs->ekey[iter] = 0x9e3779b97f4a7c15ULL * (iter + 2);
+    cs->ekey[iter] = (cs->ekey[iter] ^ (cs->ekey[iter] >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    cs->ekey[iter] = (cs->ekey[iter] ^ (cs->ekey[iter] >> 27)) * 0x94d049bb133111ebULL;
+    cs->ekey[iter] ^= cs->ekey[iter] >> 31;
+    cs->forced[iter] = 0;
+    cs->estage[iter] = 0;
+  }
+  cs->estage[edge_number(crep, ref)] = -1;
+  if(other != NULL) cs->estage[edge_number(crep, other)] = -1;
+  for(fiter = crep->flist; fiter != NULL; fiter = list_next(fiter))
+    cs->forced[edge_number(crep, list_data(edge_t, fiter))] = 1;
+  for(g = 0; g < 2; ++g) {
+    cs->drop[g] = XMALLOC(char, crep->nnum);
+    for(iter = 0; iter < crep->nnum; ++iter)
+      cs->drop[g][iter] = 0;
+    cs->drop[g][(g ? ref->gvref : ref->giref)[0]->node] = 1;
+    cs->drop[g][(g ? ref->gvref : ref->giref)[1]->node] = 1;
+    cs->ground[g] = !cs->drop[g][crep->basenode];
+    cs->row[g] = XMALLOC(int, crep->nnum);
+    cs->roff[g] = XMALLOC(int, crep->nnum + crep->ednum + 2);
+  }
+  return cs;
+}
+
+/**
+ * \brief Cascade status destructor
+ *
+ * \param cs cascade status
+ */
+void
+cs_del (cstat_t* cs)
+{
+  int g;
+  for(g = 0; g < 2; ++g) {
+    XFREE(cs->roff[g]);
+    XFREE(cs->row[g]);
+    XFREE(cs->drop[g]);
+  }
+  XFREE(cs->cut);
+  XFREE(cs->iscut);
+  XFREE(cs->nstage);
+  XFREE(cs->estage);
+  XFREE(cs->ekey);
+  XFREE(cs->forced);
+  XFREE(cs);
+}
+
+/**
+ * \brief Common trees of a set of edges
+ *
+ * Rows are given in order for both the graphs, any other node collapses into
+ * the ground. Each term comes with the product of the determinants of the
+ * related square submatrices, columns sorted as the edges are.
+ *
+ * \param cs cascade status
+ * \param edge edges (increasing order)
+ * \param ecnt number of edges
+ * \param rows rows of both the graphs
+ * \param m number of rows (each graph)
+ * \return the resulting polynomial
+ */
+cpoly_t*
+cs_enum (cstat_t* cs, const int* edge, const int ecnt, int* const* rows, const int m)
+{
+  struct cenum* ce;
+  ce = ce_new(cs, edge, ecnt, rows, m);
+  ce_visit(ce, 0);
+  return ce_del(ce);
+}
+
+/**
+ * \brief A chain state can follow another one across a stage
+ *
+ * \internal
+ * \param cs cascade status
+ * \param stage stage of interest
+ * \param in state before the stage
+ * \param out state after the stage
+ * \return a positive value if the transition is allowed, zero otherwise
+ */
+static int
+cs_valid (const cstat_t* cs, const int stage, const int in, const int out)
+{
+  int g;
+  int ret;
+  ret = 1;
+  for(g = 0; g < 2; ++g) {
+    if((out & CS_TAKEN(g)) && (!cs->ground[g])) ret = 0;
+    if((in & CS_TAKEN(g)) && (!(out & CS_TAKEN(g)))) ret = 0;
+    if((stage == cs->scnt - 1) && cs->ground[g] && (!(out & CS_TAKEN(g)))) ret = 0;
+    if((out & CS_OWN(g)) && (!cs_cutrow(cs, g, stage))) ret = 0;
+  }
+  return ret;
+}
+
+/**
+ * \brief Rows of a stage
+ *
+ * \internal
+ * Ground row first (if the stage owns it), then the boundary row before the
+ * stage, the private rows and the boundary row after the stage (if they're
+ * owned by the stage), that is the order rows have along the chain.
+ *
+ * \param cs cascade status
+ * \param g zero for the current graph, one for the voltage graph
+ * \param stage stage of interest
+ * \param in state before the stage
+ * \param out state after the stage
+ * \param rows pointer to be used to store the rows
+ * \return number of rows
+ */
+static int
+cs_rows (const cstat_t* cs, const int g, const int stage, const int in, const int out, int* rows)
+{
+  int cnt;
+  int iter;
+  cnt = 0;
+  if((out & CS_TAKEN(g)) && (!(in & CS_TAKEN(g))))
+    rows[cnt++] = cs->crep->basenode;
+  if(cs_cutrow(cs, g, stage - 1) && (in & CS_OWN(g)))
+    rows[cnt++] = cs->cut[stage - 1];
+  for(iter = cs->roff[g][stage]; iter < cs->roff[g][stage + 1]; ++iter)
+    rows[cnt++] = cs->row[g][iter];
+  if(cs_cutrow(cs, g, stage) && (!(out & CS_OWN(g))))
+    rows[cnt++] = cs->cut[stage];
+  return cnt;
+}
+
+/**
+ * \brief Cascade solver of a block
+ *
+ * \internal
+ * Chain states are walked stage by stage: the polynomial of each state is
+ * multiplied by the polynomials of the stage for each allowed transition. The
+ * ground row moves ahead of the rows of the previous stages once owned, so
+ * that its sign depends on how many they are.
+ * <br> When nested expressions are asked for, polynomials of the stages become
+ * definitions and states become sums of their products, nothing is expanded.
+ *
+ * \param crep %circuit reference
+ * \param ref additional %edge of the block
+ * \param other additional %edge of the other block
+ * \param chain pointer to be used to store the %list
+ */
+static void
+cs_block (const circ_t* crep, const edge_t* ref, const edge_t* other, list_t** chain)
+{
+  cstat_t* cs;
+  cpoly_t* pre[CS_STATES];
+  cpoly_t* post[CS_STATES];
+  cpoly_t* stp[4 * CS_STATES];
+  int npre[CS_STATES];
+  int npost[CS_STATES];
+  int sid[4 * CS_STATES];
+  int* rows[2];
+  int* edge;
+  int* ids;
+  int before[2];
+  int ecnt;
+  int stage;
+  int in;
+  int out;
+  int idx;
+  int iter;
+  int sign;
+  int g;
+  int m;
+  cs = cs_new(crep, ref, other);
+  for(g = 0; g < 2; ++g) {
+    rows[g] = XMALLOC(int, crep->nnum);
+    before[g] = 0;
+  }
+  edge = XMALLOC(int, crep->ednum);
+  ids = XMALLOC(int, crep->ednum);
+  for(iter = 0; iter < CS_STATES; ++iter) {
+    pre[iter] = NULL;
+    npre[iter] = NEST_NONE;
+  }
+  if(cs_split(cs)) {
+    pre[0] = cp_new();
+    cp_add(pre[0], 0, 0, NULL, 0, 1.);
+    npre[0] = NEST_ONE;
+  }
+  for(stage = 0; stage < cs->scnt; ++stage) {
+    ecnt = 0;
+    for(iter = 0; iter < crep->ednum; ++iter)
+      if(cs->estage[iter] == stage)
+	edge[ecnt++] = iter;
+    for(iter = 0; iter < CS_STATES; ++iter) {
+      post[iter] = NULL;
+      npost[iter] = NEST_NONE;
+    }
+    for(iter = 0; iter < 4 * CS_STATES; ++iter) {
+      stp[iter] = NULL;
+      sid[iter] = NEST_NONE;
+    }
+    for(in = 0; in < CS_STATES; ++in)
+      if(pre[in] != NULL)
+	for(out = 0; out < CS_STATES; ++out)
+	  if(cs_valid(cs, stage, in, out)) {
+	    m = cs_rows(cs, 0, stage, in, out, rows[0]);
+	    if(m != cs_rows(cs, 1, stage, in, out, rows[1])) continue;
+	    // polynomials of the stage depend on owned rows only
+	    idx = (in & 3) | ((out & 3) << 2);
+	    sign = 1;
+	    for(g = 0; g < 2; ++g)
+	      if((out & CS_TAKEN(g)) && (!(in & CS_TAKEN(g)))) {
+		idx |= 16 << g;
+		if((before[g] - ((cs_cutrow(cs, g, stage - 1) && (in & CS_OWN(g))) ? 1 : 0)) % 2)
+		  sign = -sign;
+	      }
+	    if(stp[idx] == NULL) {
+	      stp[idx] = cs_enum(cs, edge, ecnt, rows, m);
+	      if((env.nest != NULL) && (stp[idx]->cnt > 0))
+		sid[idx] = nest_leaf(env.nest, cp_chain(crep, stp[idx], 1));
+	    }
+	    if(stp[idx]->cnt > 0) {
+	      if(post[out] == NULL) post[out] = cp_new();
+	      // nested expressions refer to the stage, instead of expanding it
+	      if(env.nest != NULL) {
+		if(npost[out] == NEST_NONE) npost[out] = nest_sum(env.nest);
+		nest_add(env.nest, npost[out], sign, npre[in], sid[idx]);
+	      } else cp_mul(post[out], pre[in], stp[idx], sign, ids);
+	    }
+	  }
+    for(iter = 0; iter < 4 * CS_STATES; ++iter)
+      cp_del(stp[iter]);
+    for(iter = 0; iter < CS_STATES; ++iter) {
+      cp_del(pre[iter]);
+      pre[iter] = post[iter];
+      npre[iter] = npost[iter];
+    }
+    for(g = 0; g < 2; ++g)
+      before[g] += (cs->roff[g][stage + 1] - cs->roff[g][stage]) + (cs_cutrow(cs, g, stage) ? 1 : 0);
+  }
+  idx = (cs->ground[0] ? CS_TAKEN(0) : 0) | (cs->ground[1] ? CS_TAKEN(1) : 0);
+  // rows along the chain
+  for(g = 0; g < 2; ++g) {
+    m = 0;
+    if(cs->ground[g]) rows[g][m++] = crep->basenode;
+    for(stage = 0; stage < cs->scnt; ++stage) {
+      for(iter = cs->roff[g][stage]; iter < cs->roff[g][stage + 1]; ++iter)
+	rows[g][m++] = cs->row[g][iter];
+      if(cs_cutrow(cs, g, stage)) rows[g][m++] = cs->cut[stage];
+    }
+  }
+  if((pre[idx] != NULL) && (env.nest != NULL)) {
+    iter = nest_sum(env.nest);
+    nest_add(env.nest, iter, cs_sign(cs, rows, m), npre[idx], NEST_ONE);
+    env.nest->root[(ref == crep->gref) ? 0 : 1] = iter;
+  } else if(pre[idx] != NULL)
+    *chain = (list_t*) cp_chain(crep, pre[idx], cs_sign(cs, rows, m));
+  for(iter = 0; iter < CS_STATES; ++iter)
+    cp_del(pre[iter]);
+  XFREE(ids);
+  XFREE(edge);
+  for(g = 0; g < 2; ++g)
+    XFREE(rows[g]);
+  cs_del(cs);
+}
+
+/**
+ * \brief Cascade common trees finder
+ *
+ * Cascade finder entry point: both the blocks are split into stages and
+ * solved on their own (the yref block and the gref block).
+ *
+ * \param crep %circuit reference
+ * \param yrefchain pointer to be used to store the first %list
+ * \param grefchain pointer to be used to store the second %list
+ * \result zero if some error occurs, a positive value otherwise
+ */
+int
+cascade (const circ_t* crep, list_t** yrefchain, list_t** grefchain)
+{
+  int ret;
+  if(crep != NULL) {
+    ret = 1;
+    if(crep->yref != NULL) cs_block(crep, crep->yref, crep->gref, yrefchain);
+    if(crep->gref != NULL) cs_block(crep, crep->gref, crep->yref, grefchain);
+  } else {
+    warning("Null pointer!");
+    ret = 0;
+  }
+  return ret;
+}
@@ -0,0 +1,139 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file cascade.h
+ *
+ * \brief Cascade support
+ *
+ * This file contains the polynomials and the status used by the cascade
+ * finder, together with the prototypes of the functions that manage them, so
+ * that other finders that split the circuit into pieces can solve and join
+ * them the same way.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef CASCADE_H
+#define CASCADE_H 1
+
+#include "common.h"
+#include "circuit.h"
+#include "expr.h"
+
+/**
+ * \brief Monomial of a polynomial
+ */
+struct cmono
+{
+  unsigned long long key;  /**< Monomial key (xor of the keys of the symbols) */
+  int degree;  /**< Degree of the monomial */
+  int etoken;  /**< Number of symbols */
+  int off;  /**< First symbol into the symbols pool */
+  double vpart;  /**< Numerical part */
+};
+
+/**
+ * \brief Polynomial of a piece of the circuit
+ *
+ * Monomials are kept in creation order and hashed by key, degree and symbols.
+ */
+struct cpoly
+{
+  struct cmono* mono;  /**< Monomials */
+  int cnt;  /**< Number of monomials */
+  int size;  /**< Allocated monomials */
+  int* slot;  /**< Hash table of the monomials (open addressing) */
+  int ssize;  /**< Hash table size (power of two) */
+  int* pool;  /**< Symbols pool (edges, sorted monomial by monomial) */
+  int pcnt;  /**< Used pool entries */
+  int psize;  /**< Pool size */
+};
+
+/**
+ * \brief Simpler %struct %cpoly definition
+ */
+typedef
+struct cpoly
+cpoly_t;
+
+/**
+ * \brief Cascade status
+ */
+struct cstat
+{
+  const circ_t* crep;  /**< Circuit representation reference */
+  const edge_t* ref;  /**< Additional %edge of the block */
+  char* drop[2];  /**< Nodes dropped from the rows of each graph */
+  int ground[2];  /**< Ground row is shared by all the stages (each graph) */
+  char* forced;  /**< Edges that must be into the tree */
+  unsigned long long* ekey;  /**< Key of each %edge */
+  int* estage;  /**< Stage of each %edge (-1 if the %edge is not used) */
+  int* nstage;  /**< Stage of each node */
+  char* iscut;  /**< Node is a boundary node */
+  int scnt;  /**< Number of stages */
+  int* cut;  /**< Boundary node following each stage (-1 if none) */
+  int* row[2];  /**< Private rows of the stages (each graph) */
+  int* roff[2];  /**< First private row of each stage (each graph) */
+};
+
+/**
+ * \brief Simpler %struct %cstat definition
+ */
+typedef
+struct cstat
+cstat_t;
+
+extern cpoly_t*
+cp_new ();
+
+extern void
+cp_del (cpoly_t*);
+
+extern void
+cp_add (cpoly_t*, const unsigned long long, const int, const int*, const int, const double);
+
+extern void
+cp_mul (cpoly_t*, const cpoly_t*, const cpoly_t*, const int, int*);
+
+extern expr_t*
+cp_chain (const circ_t*, const cpoly_t*, const int);
+
+extern cstat_t*
+cs_new (const circ_t*, const edge_t*, const edge_t*);
+
+extern void
+cs_del (cstat_t*);
+
+extern cpoly_t*
+cs_enum (cstat_t*, const int*, const int, int* const*, const int);
+
+extern int
+cs_sign (cstat_t*, int* const*, const int);
+
+#endif /* CASCADE_H */
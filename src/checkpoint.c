@@ -0,0 +1,512 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file checkpoint.c
+ *
+ * \brief Checkpoint and resume functions
+ *
+ * The status of grimbleby's finder is small: the position of the scan, the
+ * edges pushed into the tree, the state of the machine and the terms found so
+ * far (common components of both the graphs are rebuilt from the edges). It
+ * is periodically written to "<file>.ckp", together with the denominator when
+ * the numerator is under way, so that a long run can be resumed later on.
+ * SIGINT and SIGTERM stop the finder as soon as possible: a last checkpoint is
+ * written and the terms found so far are splashed as partial results. So it
+ * goes when the finder runs out of its budget (wall time, peak memory or
+ * number of common trees), together with the explored fraction of the search
+ * space.
+ */
+
+#include <signal.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "common.h"
+#include "list.h"
+#include "circuit.h"
+#include "expr.h"
+#include "checkpoint.h"
+
+/**
+ * \brief Checkpoint file magic
+ */
+#define CKP_MAGIC "SPCNGCK1"
+
+/**
+ * \brief Checkpoint status
+ *
+ * \internal
+ * Data loaded from the checkpoint file are kept here until the finder asks
+ * for them, block by block.
+ */
+static struct
+{
+  char* name;  /**< Checkpoint file name (NULL means off) */
+  list_t** done;  /**< Denominator, complete once the numerator is under way */
+  time_t next;  /**< Time of the next periodic checkpoint */
+  double start;  /**< Time the finder started (seconds) */
+  const char* reason;  /**< Why the finder has been stopped */
+  double trees[2];  /**< Common trees found, block by block */
+  double cover[2];  /**< Explored fraction of the search space, block by block */
+  int loaded;  /**< Some status has been loaded from file */
+  int block;  /**< Loaded block (0 for denominator, 1 for numerator) */
+  int pos;  /**< Loaded scan position */
+  int cnt;  /**< Loaded number of edges into the tree */
+  int flag;  /**< Loaded state of the machine */
+  node_t* nodes;  /**< Loaded edges into the tree */
+  double dtrees;  /**< Loaded common trees of the denominator */
+  double etrees;  /**< Loaded common trees of the block */
+  expr_t* dchain;  /**< Loaded denominator (numerator block only) */
+  expr_t* echain;  /**< Loaded terms of the block */
+} ckp;
+
+/**
+ * \brief Signal received
+ *
+ * \internal
+ * Set by the handler, tested by the finder.
+ */
+static volatile sig_atomic_t ckpsig = 0;
+
+/**
+ * \brief Signal handler
+ *
+ * \internal
+ * It asks the finder to stop; a second signal gets the default behaviour.
+ *
+ * \param sig received signal
+ */
+static void
+ckp_handler (int sig)
+{
+  ckpsig = 1;
+  signal(sig, SIG_DFL);
+}
+
+/**
+ * \brief Wall clock
+ *
+ * \internal
+ *
+ * \return actual time (seconds)
+ */
+static double
+ckp_clock ()
+{
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec / 1e6;
+}
+
+/**
+ * \brief It stops the finder
+ *
+ * \internal
+ *
+ * \param reason why the finder is stopped
+ */
+static void
+ckp_stop (const char* reason)
+{
+  ckp.reason = reason;
+  ckpsig = 1;
+}
+
+/**
+ * \brief Circuit fingerprint
+ *
+ * \internal
+ * A checkpoint can be resumed only against the same circuit, degree range,
+ * symbol constraints and symmetry option: edges (type, name, value and nodes)
+ * are hashed together with them (FNV-1a).
+ *
+ * \param crep circuit representation reference
+ * \return fingerprint of the circuit
+ */
+static unsigned long
+ckp_print (const circ_t* crep)
+{
+  unsigned long hash;
+  unsigned char* byte;
+  char** name;
+  int data[8];
+  double value;
+  int iter;
+  size_t pos;
+  hash = 2166136261UL;
+  data[0] = crep->nnum;
+  data[1] = crep->ednum;
+  data[2] = crep->efnum;
+  data[3] = env.degmin;
+  data[4] = env.degmax;
+  for(pos = 0, byte = (unsigned char*) data; pos < 5 * sizeof(int); ++pos)
+    hash = ((hash ^ byte[pos]) * 16777619UL) & 0xffffffffUL;
+  for(iter = 0; iter < crep->ednum; ++iter) {
+    data[0] = crep->edge[iter].type;
+    data[1] = crep->edge[iter].degree;
+    data[2] = crep->edge[iter].sym;
+    data[3] = crep->edge[iter].giref[0]->node;
+    data[4] = crep->edge[iter].giref[1]->node;
+    data[5] = crep->edge[iter].gvref[0]->node;
+    data[6] = crep->edge[iter].gvref[1]->node;
+    data[7] = 0;
+    for(pos = 0, byte = (unsigned char*) data; pos < 8 * sizeof(int); ++pos)
+      hash = ((hash ^ byte[pos]) * 16777619UL) & 0xffffffffUL;
+    value = crep->edge[iter].value;
+    for(pos = 0, byte = (unsigned char*) &value; pos < sizeof(double); ++pos)
+      hash = ((hash ^ byte[pos]) * 16777619UL) & 0xffffffffUL;
+    if(crep->edge[iter].name)
+      for(byte = (unsigned char*) crep->edge[iter].name; *byte; ++byte)
+	hash = ((hash ^ *byte) * 16777619UL) & 0xffffffffUL;
+  }
+  for(name = env.with; (name != NULL) && (*name != NULL); ++name)
+    for(byte = (unsigned char*) *name; *byte; ++byte)
+      hash = ((hash ^ *byte) * 16777619UL) & 0xffffffffUL;
+  hash = ((hash ^ '-') * 16777619UL) & 0xffffffffUL;
+  for(name = env.without; (name != NULL) && (*name != NULL); ++name)
+    for(byte = (unsigned char*) *name; *byte; ++byte)
+      hash = ((hash ^ *byte) * 16777619UL) & 0xffffffffUL;
+  // terms found so far depend on symmetries
+  if(SYMMETRY())
+    hash = ((hash ^ '~') * 16777619UL) & 0xffffffffUL;
+  return hash;
+}
+
+/**
+ * \brief It drops loaded data
+ *
+ * \internal
+ */
+static void
+ckp_drop ()
+{
+  free_expr(ckp.dchain);
+  free_expr(ckp.echain);
+  XFREE(ckp.nodes);
+  ckp.dchain = NULL;
+  ckp.echain = NULL;
+  ckp.loaded = 0;
+}
+
+/**
+ * \brief It loads the checkpoint file
+ *
+ * \internal
+ * Checkpoints of other circuits and damaged files are refused.
+ *
+ * \param crep circuit representation reference
+ * \return zero if nothing can be resumed, a positive value otherwise
+ */
+static int
+ckp_load (const circ_t* crep)
+{
+  FILE* fref;
+  char magic[sizeof(CKP_MAGIC)];
+  unsigned long print;
+  int rerr;
+  rerr = 0;
+  if((fref = fopen(ckp.name, "rb")) == NULL) {
+    warning("No checkpoint to be resumed, starting from scratch");
+    return 0;
+  }
+  if((fread(magic, sizeof(char), sizeof(CKP_MAGIC), fref) != sizeof(CKP_MAGIC)) ||
+     (memcmp(magic, CKP_MAGIC, sizeof(CKP_MAGIC)) != 0) ||
+     (fread(&print, sizeof(print), 1, fref) != 1) ||
+     (print != ckp_print(crep)) ||
+     (fread(&(ckp.block), sizeof(ckp.block), 1, fref) != 1) ||
+     (fread(&(ckp.pos), sizeof(ckp.pos), 1, fref) != 1) ||
+     (fread(&(ckp.cnt), sizeof(ckp.cnt), 1, fref) != 1) ||
+     (fread(&(ckp.flag), sizeof(ckp.flag), 1, fref) != 1) ||
+     (fread(&(ckp.dtrees), sizeof(ckp.dtrees), 1, fref) != 1) ||
+     (fread(&(ckp.etrees), sizeof(ckp.etrees), 1, fref) != 1) ||
+     (ckp.cnt < 1 + crep->efnum) || (ckp.cnt > crep->nnum - 1) ||
+     (ckp.pos < -1) || (ckp.pos > crep->ednum))
+    rerr = 1;
+  else {
+    ckp.nodes = XMALLOC(node_t, ckp.cnt);
+    if(fread(ckp.nodes, sizeof(node_t), ckp.cnt, fref) != (size_t) ckp.cnt)
+      rerr = 1;
+    else {
+      ckp.dchain = expr_from_file(fref);
+      ckp.echain = expr_from_file(fref);
+    }
+  }
+  fclose(fref);
+  if(rerr) {
+    warning("Checkpoint does not match the circuit, starting from scratch");
+    ckp_drop();
+  } else ckp.loaded = 1;
+  return ckp.loaded;
+}
+
+/**
+ * \brief It enables checkpoints for a circuit
+ *
+ * Checkpoints are written to (and resumed from) "<ifile>.ckp".
+ *
+ * \param ifile input file (which is where circuit is stored)
+ */
+void
+ckp_open (const char* ifile)
+{
+  int length;
+  length = strlen(ifile);
+  ckp.name = XMALLOC(char, length + 4 + 1);
+  strcpy(ckp.name, ifile);
+  strcat(ckp.name, ".ckp");
+}
+
+/**
+ * \brief It disables checkpoints
+ *
+ * Once a finder has run to the end, its checkpoint file is stale, so that it
+ * is removed.
+ */
+void
+ckp_close ()
+{
+  if(ckp.name != NULL) {
+    if((ckp.done != NULL) && (!ckpsig)) remove(ckp.name);
+    XFREE(ckp.name);
+  }
+}
+
+/**
+ * \brief It prepares a finder to be checkpointed
+ *
+ * Signal handlers are installed and, if asked for, the checkpoint is loaded.
+ *
+ * \param crep circuit representation reference
+ * \param done where the finder stores the denominator
+ */
+void
+ckp_start (const circ_t* crep, list_t** done)
+{
+  if(ckp.name != NULL) {
+    ckp.done = done;
+    ckp.start = ckp_clock();
+    ckp.next = time(NULL) + env.checkpoint;
+    ckp.reason = "interrupted";
+    if(RESUME()) ckp_load(crep);
+    signal(SIGINT, ckp_handler);
+    signal(SIGTERM, ckp_handler);
+  }
+}
+
+/**
+ * \brief It releases a finder
+ *
+ * Default signal handlers are restored.
+ */
+void
+ckp_end ()
+{
+  if(ckp.name != NULL) {
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    ckp_drop();
+  }
+}
+
+/**
+ * \brief It restores the status of a block
+ *
+ * When the checkpoint belongs to the numerator, the denominator is complete
+ * and it is given back as it is, together with the final state.
+ *
+ * \param block actual block (0 for denominator, 1 for numerator)
+ * \param pos scan position
+ * \param cnt number of edges into the tree
+ * \param nodes edges into the tree
+ * \param flag state of the machine
+ * \param out final state of the machine
+ * \param elist terms of the block
+ * \param trees common trees of the block
+ * \return zero if nothing has been restored, a positive value otherwise
+ */
+int
+ckp_resume (const int block, int* pos, int* cnt, node_t* nodes, int* flag, const int out, expr_t** elist, double* trees)
+{
+  int iter;
+  int ret;
+  ret = 0;
+  if(ckp.loaded) {
+    if(ckp.block > block) {
+      *elist = ckp.dchain;
+      ckp.dchain = NULL;
+      *trees = ckp.dtrees;
+      *flag = out;
+      ret = 1;
+    } else if(ckp.block == block) {
+      for(iter = 0; iter < ckp.cnt; ++iter)
+	nodes[iter] = ckp.nodes[iter];
+      *pos = ckp.pos;
+      *cnt = ckp.cnt;
+      *flag = ckp.flag;
+      *elist = ckp.echain;
+      ckp.echain = NULL;
+      *trees = ckp.etrees;
+      ret = 1;
+    }
+  }
+  return ret;
+}
+
+/**
+ * \brief Checkpoint test
+ *
+ * Budgets are tested too: the finder is stopped as soon as one of them is
+ * exhausted, so that a final checkpoint is due.
+ *
+ * \param trees common trees found so far by the actual block
+ * \return a positive value if a checkpoint is due (periodic or final), zero
+ *   otherwise
+ */
+int
+ckp_due (const double trees)
+{
+  struct rusage usage;
+  if(ckp.name == NULL) return 0;
+  if(!ckpsig) {
+    if((env.maxtime > 0) && (ckp_clock() - ckp.start >= env.maxtime))
+      ckp_stop("time budget exhausted");
+    else if((env.maxterms > 0) && (ckp.trees[0] + trees >= env.maxterms))
+      ckp_stop("common trees budget exhausted");
+    else if((env.maxmem > 0) && (getrusage(RUSAGE_SELF, &usage) == 0) &&
+	    (usage.ru_maxrss >= 1024L * env.maxmem))
+      ckp_stop("memory budget exhausted");
+  }
+  return ckpsig || ((env.checkpoint > 0) && (time(NULL) >= ckp.next));
+}
+
+/**
+ * \brief Stop request test
+ *
+ * \return a positive value if the finder has been asked to stop, zero
+ *   otherwise
+ */
+int
+ckp_stopped ()
+{
+  return ckpsig;
+}
+
+/**
+ * \brief Stop reason
+ *
+ * \return why the finder has been stopped
+ */
+const char*
+ckp_reason ()
+{
+  return ckp.reason;
+}
+
+/**
+ * \brief It records the coverage of a block
+ *
+ * \param block actual block (0 for denominator, 1 for numerator)
+ * \param cover explored fraction of the search space
+ * \param trees common trees found
+ */
+void
+ckp_cover (const int block, const double cover, const double trees)
+{
+  ckp.cover[block] = cover;
+  ckp.trees[block] = trees;
+}
+
+/**
+ * \brief It gets the coverage of a block
+ *
+ * Blocks that have not been started are not covered at all.
+ *
+ * \param block requested block (0 for denominator, 1 for numerator)
+ * \param cover explored fraction of the search space
+ * \param trees common trees found
+ */
+void
+ckp_coverage (const int block, double* cover, double* trees)
+{
+  *cover = ckp.cover[block];
+  *trees = ckp.trees[block];
+}
+
+/**
+ * \brief It writes a checkpoint
+ *
+ * The file is written aside and then renamed, so that a crash while writing
+ * does not destroy the previous checkpoint.
+ *
+ * \param crep circuit representation reference
+ * \param block actual block (0 for denominator, 1 for numerator)
+ * \param pos scan position
+ * \param cnt number of edges into the tree
+ * \param nodes edges into the tree
+ * \param flag state of the machine
+ * \param elist terms of the block
+ * \param trees common trees of the block
+ * \return zero if some error occurs, a positive value otherwise
+ */
+int
+ckp_save (const circ_t* crep, const int block, const int pos, const int cnt, const node_t* nodes, const int flag, const expr_t* elist, const double trees)
+{
+  FILE* fref;
+  char* tmp;
+  unsigned long print;
+  int werr;
+  werr = 0;
+  tmp = XMALLOC(char, strlen(ckp.name) + 1 + 1);
+  strcpy(tmp, ckp.name);
+  strcat(tmp, "~");
+  print = ckp_print(crep);
+  if((fref = fopen(tmp, "wb")) != NULL) {
+    if((fwrite(CKP_MAGIC, sizeof(char), sizeof(CKP_MAGIC), fref) != sizeof(CKP_MAGIC)) ||
+       (fwrite(&print, sizeof(print), 1, fref) != 1) ||
+       (fwrite(&block, sizeof(block), 1, fref) != 1) ||
+       (fwrite(&pos, sizeof(pos), 1, fref) != 1) ||
+       (fwrite(&cnt, sizeof(cnt), 1, fref) != 1) ||
+       (fwrite(&flag, sizeof(flag), 1, fref) != 1) ||
+       (fwrite(&(ckp.trees[0]), sizeof(ckp.trees[0]), 1, fref) != 1) ||
+       (fwrite(&trees, sizeof(trees), 1, fref) != 1) ||
+       (fwrite(nodes, sizeof(node_t), cnt, fref) != (size_t) cnt))
+      werr = 1;
+    if(!werr) werr = expr_to_file((block) ? (expr_t*) *(ckp.done) : NULL, fref);
+    if(!werr) werr = expr_to_file(elist, fref);
+    if(fclose(fref) != 0) werr = 1;
+    if((!werr) && (rename(tmp, ckp.name) != 0)) werr = 1;
+  } else werr = 1;
+  if(werr) {
+    warning("Unable to write checkpoint!");
+    remove(tmp);
+  }
+  XFREE(tmp);
+  ckp.next = time(NULL) + env.checkpoint;
+  return !werr;
+}
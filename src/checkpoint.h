@@ -0,0 +1,90 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file checkpoint.h
+ *
+ * \brief Checkpoint and resume functions prototypes
+ *
+ * This file contains prototypes for the functions that save the status of a
+ * long enumeration to file and restore it later, or stop it when it runs out
+ * of its budget.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H 1
+
+#include "common.h"
+#include "circuit.h"
+#include "list.h"
+#include "expr.h"
+
+/**
+ * \brief Steps between two checks
+ *
+ * Finders test whether a checkpoint is due once every CKP_TICK + 1 steps
+ * (CKP_TICK must be a power of two minus one).
+ */
+#define CKP_TICK 0xfff
+
+extern void
+ckp_open (const char*);
+
+extern void
+ckp_close ();
+
+extern void
+ckp_start (const circ_t*, list_t**);
+
+extern void
+ckp_end ();
+
+extern int
+ckp_resume (const int, int*, int*, node_t*, int*, const int, expr_t**, double*);
+
+extern int
+ckp_due (const double);
+
+extern int
+ckp_stopped ();
+
+extern const char*
+ckp_reason ();
+
+extern void
+ckp_cover (const int, const double, const double);
+
+extern void
+ckp_coverage (const int, double*, double*);
+
+extern int
+ckp_save (const circ_t*, const int, const int, const int, const node_t*, const int, const expr_t*, const double);
+
+#endif /* CHECKPOINT_H */
@@ -100,9 +100,25 @@ circ_del (circ_t* crct)
 static void
 circ_ext (circ_t* crct)
 {
+  list_t* fiter;
+  int* fidx;
+  int yidx;
+  int gidx;
+  int iter;
+  // forced edges and extra components refer to the edges store, that moves
+  fidx = XMALLOC(int, crct->efnum + 1);
+  for(fiter = crct->flist, iter = 0; fiter != NULL; fiter = list_next(fiter), ++iter)
+    fidx[iter] = list_data(edge_t, fiter) - crct->edge;
+  yidx = (crct->yref != NULL) ? crct->yref - crct->edge : -1;
+  gidx = (crct->gref != NULL) ? crct->gref - crct->edge : -1;
   crct->free += (crct->dim) ? crct->dim : STDDIM; 
   crct->dim = (crct->dim) ? crct->dim * 2 : STDDIM;
   crct->edge = XREALLOC(edge_t, crct->edge, crct->dim);
+  for(fiter = crct->flist, iter = 0; fiter != NULL; fiter = list_next(fiter), ++iter)
+    fiter->data = (void*) (crct->edge + fidx[iter]);
+  crct->yref = (yidx >= 0) ? crct->edge + yidx : NULL;
+  crct->gref = (gidx >= 0) ? crct->edge + gidx : NULL;
+  XFREE(fidx);
 }
 
 /**
@@ -397,6 +413,41 @@ setblock (circ_t* crep)
   return flag;
 }
 
+/**
+ * \brief It permits to add the only yref %edge, as a pendant one.
+ *
+ * Circuits built to describe a block (see subckt.h) have no input and output
+ * nodes: the yref %edge joins a node of their own to \a node, into both the
+ * graphs, so that its common trees are those of the circuit as it is, while
+ * gref is left unset.
+ *
+ * \param crep circuit reference
+ * \param node node the yref %edge hangs from
+ * \result zero if some error occurs, a positive value otherwise
+ */
+int
+setyref (circ_t* crep, const node_t node)
+{
+  edge_t* eptr;
+  node_t pend;
+  int flag = 1;
+  if(crep != NULL) {
+    pend = crep->nnum;
+    if((eptr = circ_addedge(crep,pend,node,pend,node)) != NULL) {
+      eptr->name = NULL;
+      eptr->type = YREF;
+      eptr->degree = 0;
+      eptr->value = 1;
+      eptr->sym = 0;
+      crep->yref = eptr;
+    } else {
+      warning("Unable to set yref!");
+      flag = 0;
+    }
+  } else flag = 0;
+  return flag;
+}
+
 /**
  * \brief Entry point that can be used to add simple edges to the circuit;
  *
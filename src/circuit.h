@@ -212,6 +212,9 @@ circ_normalize (circ_t*);
 extern int
 setblock (circ_t*);
 
+extern int
+setyref (circ_t*, const node_t);
+
 extern int
 addsimple (circ_t*, const node_t, const node_t, const node_t, const node_t, const char*, const etype_t, const short int, const double, const int);
 
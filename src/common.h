@@ -87,7 +87,7 @@ extern int errno;
 // Flags (Environment Management)
 
 /** \brief Simply, some flags (only 8 bits) */
-unsigned short int flags;
+extern unsigned short int flags;
 
 /** \brief Used to clear the flags (reset environment) */
 #define CLEAR_FLAGS() \
@@ -141,6 +141,113 @@ unsigned short int flags;
 #define BINARY() \
   ( flags & 0x20 )
 
+/** \brief sets count mode flag */
+#define SET_COUNT() \
+  ( flags |= 0x40 )
+
+/** \brief gets count mode flag */
+#define COUNT() \
+  ( flags & 0x40 )
+
+/** \brief sets resume flag */
+#define SET_RESUME() \
+  ( flags |= 0x80 )
+
+/** \brief gets resume flag */
+#define RESUME() \
+  ( flags & 0x80 )
+
+/** \brief sets symmetry flag */
+#define SET_SYMMETRY() \
+  ( flags |= 0x100 )
+
+/** \brief gets symmetry flag */
+#define SYMMETRY() \
+  ( flags & 0x100 )
+
+/** \brief sets nested flag */
+#define SET_NESTED() \
+  ( flags |= 0x200 )
+
+/** \brief gets nested flag */
+#define NESTED() \
+  ( flags & 0x200 )
+
+/** \brief sets compress flag */
+#define SET_COMPRESS() \
+  ( flags |= 0x400 )
+
+/** \brief gets compress flag */
+#define COMPRESS() \
+  ( flags & 0x400 )
+
+/** \brief sets query flag */
+#define SET_QUERY() \
+  ( flags |= 0x800 )
+
+/** \brief gets query flag */
+#define QUERY() \
+  ( flags & 0x800 )
+
+/** \brief sets archive flag */
+#define SET_ARCHIVE() \
+  ( flags |= 0x1000 )
+
+/** \brief gets archive flag */
+#define ARCHIVE() \
+  ( flags & 0x1000 )
+
+/** \brief sets generate flag */
+#define SET_GENERATE() \
+  ( flags |= 0x2000 )
+
+/** \brief gets generate flag */
+#define GENERATE() \
+  ( flags & 0x2000 )
+
+/** \brief sets hierarchy flag */
+#define SET_HIERARCHY() \
+  ( flags |= 0x4000 )
+
+/** \brief gets hierarchy flag */
+#define HIERARCHY() \
+  ( flags & 0x4000 )
+
+
+// Environment (Tunable Parameters)
+
+/**
+ * \brief Tunable parameters
+ *
+ * Those parameters that don't fit into the flags (like the engine to be used
+ * to find the common trees and its arguments) are collected here.
+ */
+struct env
+{
+  int engine;  /**< Common trees finder (see %enum %engine) */
+  int kbest;  /**< Number of trees per power of s (k-best engine) */
+  int estimate;  /**< Number of samples for the estimator (zero means off) */
+  int checkpoint;  /**< Seconds between two checkpoints (zero means off) */
+  int maxtime;  /**< Wall time budget in seconds (zero means off) */
+  int maxmem;  /**< Peak memory budget in megabytes (zero means off) */
+  int maxterms;  /**< Common trees budget (zero means off) */
+  int degmin;  /**< Lowest power of s to be found */
+  int degmax;  /**< Highest power of s to be found */
+  char** with;  /**< Symbols the terms must contain (NULL terminated) */
+  char** without;  /**< Symbols the terms must not contain (NULL terminated) */
+  struct nest* nest;  /**< Nested expressions, if the finder gives them (NULL otherwise) */
+  int spill;  /**< Terms kept in memory before being spilled (zero means off) */
+  struct spill* spilled;  /**< Spilled terms, if the finder gives them (NULL otherwise) */
+  int pin;  /**< Edge forced into the common trees (negative means none) */
+  double fmin;  /**< Lowest frequency of the sweep (Hz) */
+  double fmax;  /**< Highest frequency of the sweep (Hz) */
+  int fcnt;  /**< Frequencies of the sweep (zero means off) */
+  char* values;  /**< File of the sets of values of the symbols (NULL means the netlist) */
+};
+
+/** \brief Simply, the environment */
+extern struct env env;
+
 
 // Memory management related functions
 
@@ -0,0 +1,584 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file count.c
+ *
+ * \brief Common trees counting
+ *
+ * By Binet-Cauchy formula, the sum over the common trees of the products of
+ * the determinants of both the incident matrices (that is, the signs of the
+ * terms) is the determinant of Ai * W * Av^T, once the edges that are always
+ * into the tree (forced edges and the extra component) are contracted. Each
+ * %edge is weighted with a power of s that follows its contribution to the
+ * degree of the term, so that the determinant is a polynomial whose
+ * coefficients are the signed counts for each power of s. Determinants are
+ * computed modulo two primes, then rebuilt by chinese remainder theorem.
+ *
+ * Counting the common trees regardless of their signs is a hard problem (it
+ * is exact only when both the graphs are the same, like for passive
+ * circuits); the number of spanning trees of each graph (matrix-tree theorem)
+ * is given as an upper bound.
+ */
+
+#include <math.h>
+
+#include "common.h"
+#include "list.h"
+#include "circuit.h"
+#include "count.h"
+
+/**
+ * \brief First prime used for modular determinants
+ */
+#define PRIME1 2147483647ULL
+
+/**
+ * \brief Second prime used for modular determinants
+ */
+#define PRIME2 2147483629ULL
+
+/**
+ * \brief Greatest count exactly rebuilt (a bit under PRIME1 * PRIME2 / 2)
+ */
+#define EXACTMAX 2.0e18
+
+/**
+ * \brief Counting status
+ *
+ * Contracted graphs and support informations for a block (yref or gref).
+ */
+struct cstat
+{
+  int nnum;  /**< Number of nodes */
+  int size;  /**< Size of the contracted matrices (edges to be found) */
+  int sign;  /**< Sign due to the contracted edges */
+  int passive;  /**< Both the contracted graphs are the same */
+  int* row;  /**< Contracted row of each node (both the graphs) */
+  int* uf;  /**< Union-find support arrays (both the graphs) */
+};
+
+/**
+ * \brief Simpler %struct %cstat definition
+ */
+typedef
+struct cstat
+cstat_t;
+
+/**
+ * \brief Union-find lookup with path halving
+ *
+ * \internal
+ * \param uf union-find support array
+ * \param item item of interest
+ * \return representative of \a item
+ */
+static int
+uf_find (int* uf, int item)
+{
+  while(uf[item] != item) {
+    uf[item] = uf[uf[item]];
+    item = uf[item];
+  }
+  return item;
+}
+
+/**
+ * \brief Modular power
+ *
+ * \internal
+ * \param base base
+ * \param exp exponent
+ * \param prime modulus
+ * \return \a base to the \a exp modulo \a prime
+ */
+static unsigned long long
+mod_pow (unsigned long long base, unsigned long long exp, const unsigned long long prime)
+{
+  unsigned long long res;
+  res = 1;
+  base %= prime;
+  while(exp) {
+    if(exp & 1) res = res * base % prime;
+    base = base * base % prime;
+    exp >>= 1;
+  }
+  return res;
+}
+
+/**
+ * \brief Modular determinant
+ *
+ * \internal
+ * Gauss elimination algorithm over the integers modulo a prime; \a matrix is
+ * overwritten.
+ *
+ * \param matrix square matrix (row-major order)
+ * \param dim size of the matrix
+ * \param prime modulus
+ * \return determinant of the matrix modulo \a prime
+ */
+static unsigned long long
+mod_det (unsigned long long* matrix, const int dim, const unsigned long long prime)
+{
+  unsigned long long det;
+  unsigned long long inv;
+  unsigned long long weight;
+  unsigned long long swap;
+  int ofs;
+  int iter;
+  int cnt;
+  det = 1;
+  for(ofs = 0; (ofs < dim) && det; ++ofs) {
+    for(iter = ofs; (iter < dim) && (matrix[iter * dim + ofs] == 0); ++iter);
+    if(iter == dim) det = 0;
+    else {
+      if(iter != ofs) {
+	for(cnt = ofs; cnt < dim; ++cnt) {
+	  swap = matrix[iter * dim + cnt];
+	  matrix[iter * dim + cnt] = matrix[ofs * dim + cnt];
+	  matrix[ofs * dim + cnt] = swap;
+	}
+	det = prime - det;
+      }
+      det = det * matrix[ofs * dim + ofs] % prime;
+      inv = mod_pow(matrix[ofs * dim + ofs], prime - 2, prime);
+      for(iter = ofs + 1; iter < dim; ++iter) {
+	if(matrix[iter * dim + ofs] != 0) {
+	  weight = (prime - matrix[iter * dim + ofs]) * inv % prime;
+	  for(cnt = ofs; cnt < dim; ++cnt)
+	    matrix[iter * dim + cnt] = (matrix[iter * dim + cnt] + weight * matrix[ofs * dim + cnt]) % prime;
+	}
+      }
+    }
+  }
+  return det;
+}
+
+/**
+ * \brief Floating point determinant
+ *
+ * \internal
+ * Gauss elimination algorithm with partial pivoting, used to know the order of
+ * magnitude of counts that don't fit the modular rebuilding; \a matrix is
+ * overwritten.
+ *
+ * \param matrix square matrix (row-major order)
+ * \param dim size of the matrix
+ * \return determinant of the matrix
+ */
+static double
+float_det (double* matrix, const int dim)
+{
+  double det;
+  double weight;
+  double swap;
+  int ofs;
+  int iter;
+  int cnt;
+  int best;
+  det = 1.;
+  for(ofs = 0; (ofs < dim) && (det != 0.); ++ofs) {
+    best = ofs;
+    for(iter = ofs + 1; iter < dim; ++iter)
+      if(fabs(matrix[iter * dim + ofs]) > fabs(matrix[best * dim + ofs])) best = iter;
+    if(matrix[best * dim + ofs] == 0.) det = 0.;
+    else {
+      if(best != ofs) {
+	for(cnt = ofs; cnt < dim; ++cnt) {
+	  swap = matrix[best * dim + cnt];
+	  matrix[best * dim + cnt] = matrix[ofs * dim + cnt];
+	  matrix[ofs * dim + cnt] = swap;
+	}
+	det = -det;
+      }
+      det *= matrix[ofs * dim + ofs];
+      for(iter = ofs + 1; iter < dim; ++iter) {
+	weight = matrix[iter * dim + ofs] / matrix[ofs * dim + ofs];
+	for(cnt = ofs; cnt < dim; ++cnt)
+	  matrix[iter * dim + cnt] -= weight * matrix[ofs * dim + cnt];
+      }
+    }
+  }
+  return det;
+}
+
+/**
+ * \brief Chinese remainder rebuilding
+ *
+ * \internal
+ * \param r1 remainder modulo PRIME1
+ * \param r2 remainder modulo PRIME2
+ * \return the signed value having both the remainders
+ */
+static long long
+crt (const unsigned long long r1, const unsigned long long r2)
+{
+  unsigned long long k;
+  unsigned long long val;
+  k = (r2 + PRIME2 - r1 % PRIME2) % PRIME2 * mod_pow(PRIME1 % PRIME2, PRIME2 - 2, PRIME2) % PRIME2;
+  val = r1 + PRIME1 * k;
+  if(val > (PRIME1 * PRIME2) / 2) return -((long long) (PRIME1 * PRIME2 - val));
+  return (long long) val;
+}
+
+/**
+ * \brief End-points of an %edge into a graph
+ *
+ * \internal
+ * \param edge %edge reference
+ * \param graph zero for the current graph, one for the voltage graph
+ * \param tail tail node (out)
+ * \param head head node (out)
+ */
+static void
+cs_ends (const edge_t* edge, const int graph, int* tail, int* head)
+{
+  *tail = graph ? edge->gvref[0]->node : edge->giref[0]->node;
+  *head = graph ? edge->gvref[1]->node : edge->giref[1]->node;
+}
+
+/**
+ * \brief Tells if an %edge is always into the tree
+ *
+ * \internal
+ * \param crep %circuit reference
+ * \param ref extra component of the block
+ * \param edge %edge identifier
+ * \return a positive value for contracted edges, zero otherwise
+ */
+static int
+cs_base (const circ_t* crep, const edge_t* ref, const int edge)
+{
+  return (crep->edge[edge].type == F) || (&(crep->edge[edge]) == ref);
+}
+
+/**
+ * \brief Tells if an %edge can be part of a tree
+ *
+ * \internal
+ * \param cs counting status
+ * \param edge %edge reference
+ * \return a positive value if \a edge isn't a loop into any graph
+ */
+static int
+cs_usable (const cstat_t* cs, const edge_t* edge)
+{
+  int tail;
+  int head;
+  int ok;
+  cs_ends(edge, 0, &tail, &head);
+  ok = (cs->row[tail] != cs->row[head]);
+  cs_ends(edge, 1, &tail, &head);
+  return ok && (cs->row[cs->nnum + tail] != cs->row[cs->nnum + head]);
+}
+
+/**
+ * \brief Counting status constructor
+ *
+ * \internal
+ * Contracts the edges that are always into the tree and computes the sign
+ * that the contraction introduces: it is the determinant of the incident
+ * matrix of those edges, completed with a column for each contracted node.
+ *
+ * \param crep %circuit reference
+ * \param ref extra component of the block
+ * \return newly allocated counting status, NULL if contracted edges contain a
+ *     loop
+ */
+static cstat_t*
+cstat_new (const circ_t* crep, const edge_t* ref)
+{
+  cstat_t* cs;
+  unsigned long long* mat;
+  int graph;
+  int iter;
+  int edge;
+  int tail;
+  int head;
+  int col;
+  int loop;
+  cs = XMALLOC(cstat_t, 1);
+  cs->nnum = crep->nnum;
+  cs->uf = XMALLOC(int, 2 * crep->nnum);
+  cs->row = XMALLOC(int, 2 * crep->nnum);
+  cs->sign = 1;
+  loop = 0;
+  mat = XMALLOC(unsigned long long, (crep->nnum - 1) * (crep->nnum - 1) + 1);
+  for(graph = 0; graph < 2; ++graph) {
+    for(iter = 0; iter < crep->nnum; ++iter)
+      cs->uf[graph * crep->nnum + iter] = iter;
+    for(iter = 0; iter < (crep->nnum - 1) * (crep->nnum - 1); ++iter)
+      mat[iter] = 0;
+    col = 0;
+    for(edge = 0; edge < crep->ednum; ++edge) {
+      if(cs_base(crep, ref, edge)) {
+	cs_ends(&(crep->edge[edge]), graph, &tail, &head);
+	if(uf_find(cs->uf + graph * crep->nnum, tail) == uf_find(cs->uf + graph * crep->nnum, head)) loop = 1;
+	else cs->uf[graph * crep->nnum + uf_find(cs->uf + graph * crep->nnum, tail)] = uf_find(cs->uf + graph * crep->nnum, head);
+	if((col < crep->nnum - 1) && (tail < crep->nnum - 1)) mat[tail * (crep->nnum - 1) + col] = PRIME1 - 1;
+	if((col < crep->nnum - 1) && (head < crep->nnum - 1)) mat[head * (crep->nnum - 1) + col] = 1;
+	++col;
+      }
+    }
+    // contracted rows, the node with the smallest identifier represents them
+    cs->size = 0;
+    for(iter = 0; iter < crep->nnum; ++iter)
+      cs->row[graph * crep->nnum + iter] = -1;
+    for(iter = 0; iter < crep->nnum - 1; ++iter) {
+      tail = uf_find(cs->uf + graph * crep->nnum, iter);
+      if((tail != uf_find(cs->uf + graph * crep->nnum, crep->nnum - 1)) && (cs->row[graph * crep->nnum + tail] == -1)) {
+	if(col < crep->nnum - 1) mat[iter * (crep->nnum - 1) + col] = 1;
+	++col;
+	cs->row[graph * crep->nnum + tail] = cs->size++;
+      }
+    }
+    for(iter = 0; iter < crep->nnum; ++iter)
+      cs->row[graph * crep->nnum + iter] = cs->row[graph * crep->nnum + uf_find(cs->uf + graph * crep->nnum, iter)];
+    if((!loop) && (col == crep->nnum - 1))
+      cs->sign *= (mod_det(mat, crep->nnum - 1, PRIME1) == 1) ? 1 : -1;
+  }
+  XFREE(mat);
+  if(loop) {
+    XFREE(cs->row);
+    XFREE(cs->uf);
+    XFREE(cs);
+    return NULL;
+  }
+  // both the graphs are the same once contracted
+  cs->passive = 1;
+  for(iter = 0; iter < crep->nnum; ++iter)
+    if(cs->row[iter] != cs->row[crep->nnum + iter]) cs->passive = 0;
+  for(edge = 0; edge < crep->ednum; ++edge) {
+    if(cs_usable(cs, &(crep->edge[edge]))) {
+      cs_ends(&(crep->edge[edge]), 0, &tail, &head);
+      cs_ends(&(crep->edge[edge]), 1, &col, &loop);
+      if((cs->row[tail] != cs->row[crep->nnum + col]) || (cs->row[head] != cs->row[crep->nnum + loop]))
+	cs->passive = 0;
+    }
+  }
+  return cs;
+}
+
+/**
+ * \brief Counting status destructor
+ *
+ * \internal
+ * \param cs counting status
+ */
+static void
+cstat_del (cstat_t* cs)
+{
+  XFREE(cs->row);
+  XFREE(cs->uf);
+  XFREE(cs);
+}
+
+/**
+ * \brief Adds the contribution of an %edge to a matrix
+ *
+ * \internal
+ * It adds \a weight times the outer product of the contracted columns of the
+ * %edge into the graphs \a ga and \a gb.
+ *
+ * \param cs counting status
+ * \param edge %edge reference
+ * \param ga graph of the rows
+ * \param gb graph of the columns
+ * \param weight weight of the %edge
+ * \param prime modulus (zero for floating point matrices)
+ * \param mmat modular matrix
+ * \param fmat floating point matrix
+ */
+static void
+cs_add (const cstat_t* cs, const edge_t* edge, const int ga, const int gb, const unsigned long long weight, const unsigned long long prime, unsigned long long* mmat, double* fmat)
+{
+  int ra[2];
+  int rb[2];
+  int ia;
+  int ib;
+  int tail;
+  int head;
+  cs_ends(edge, ga, &tail, &head);
+  ra[0] = cs->row[ga * cs->nnum + tail];
+  ra[1] = cs->row[ga * cs->nnum + head];
+  cs_ends(edge, gb, &tail, &head);
+  rb[0] = cs->row[gb * cs->nnum + tail];
+  rb[1] = cs->row[gb * cs->nnum + head];
+  if((ra[0] == ra[1]) || (rb[0] == rb[1])) return;
+  for(ia = 0; ia < 2; ++ia)
+    for(ib = 0; ib < 2; ++ib)
+      if((ra[ia] >= 0) && (rb[ib] >= 0)) {
+	if(prime) {
+	  if(ia == ib) mmat[ra[ia] * cs->size + rb[ib]] = (mmat[ra[ia] * cs->size + rb[ib]] + weight) % prime;
+	  else mmat[ra[ia] * cs->size + rb[ib]] = (mmat[ra[ia] * cs->size + rb[ib]] + prime - weight) % prime;
+	} else fmat[ra[ia] * cs->size + rb[ib]] += (ia == ib) ? 1. : -1.;
+      }
+}
+
+/**
+ * \brief Counts the common trees of a block
+ *
+ * \internal
+ * \param crep %circuit reference
+ * \param ref extra component of the block
+ * \param label name of the block
+ * \param fref output stream
+ * \return zero if some error occurs, a positive value otherwise
+ */
+static int
+count_block (const circ_t* crep, const edge_t* ref, const char* label, FILE* fref)
+{
+  cstat_t* cs;
+  unsigned long long* mmat;
+  unsigned long long* vals;
+  unsigned long long* coef;
+  unsigned long long prime;
+  unsigned long long weight;
+  double* fmat;
+  double bound[2];
+  long long signed_count;
+  int* expo;
+  int npoints;
+  int zsum;
+  int shift;
+  int emax;
+  int graph;
+  int point;
+  int edge;
+  int iter;
+  int cnt;
+  int exact;
+  fprintf(fref, "%s:", label);
+  if((ref == NULL) || ((cs = cstat_new(crep, ref)) == NULL)) {
+    fprintf(fref, " 0 common trees\n");
+    return 1;
+  }
+  mmat = XMALLOC(unsigned long long, cs->size * cs->size + 1);
+  fmat = XMALLOC(double, cs->size * cs->size + 1);
+  // matrix-tree theorem: spanning trees of each graph
+  for(graph = 0; graph < 2; ++graph) {
+    for(iter = 0; iter < cs->size * cs->size; ++iter)
+      fmat[iter] = 0.;
+    for(edge = 0; edge < crep->ednum; ++edge)
+      if((!cs_base(crep, ref, edge)) && cs_usable(cs, &(crep->edge[edge])))
+	cs_add(cs, &(crep->edge[edge]), graph, graph, 1, 0, NULL, fmat);
+    bound[graph] = fabs(float_det(fmat, cs->size));
+  }
+  exact = (bound[0] < EXACTMAX) && (bound[1] < EXACTMAX);
+  // exponents: degree of the term is zsum + (sum of the exponents) - size * shift
+  expo = XMALLOC(int, crep->ednum);
+  zsum = 0;
+  shift = 0;
+  emax = 0;
+  for(edge = 0; edge < crep->ednum; ++edge)
+    if((crep->edge[edge].type == Z) && (crep->edge[edge].degree > shift)) shift = crep->edge[edge].degree;
+  for(edge = 0; edge < crep->ednum; ++edge) {
+    expo[edge] = shift;
+    if(crep->edge[edge].type == Y) expo[edge] += crep->edge[edge].degree;
+    else if(crep->edge[edge].type == Z) {
+      expo[edge] -= crep->edge[edge].degree;
+      zsum += crep->edge[edge].degree;
+    }
+    if(expo[edge] > emax) emax = expo[edge];
+  }
+  npoints = cs->size * emax + 1;
+  vals = XMALLOC(unsigned long long, 2 * npoints);
+  coef = XMALLOC(unsigned long long, 2 * npoints);
+  for(cnt = 0; cnt < 2; ++cnt) {
+    prime = cnt ? PRIME2 : PRIME1;
+    for(point = 0; point < npoints; ++point) {
+      for(iter = 0; iter < cs->size * cs->size; ++iter)
+	mmat[iter] = 0;
+      for(edge = 0; edge < crep->ednum; ++edge)
+	if((!cs_base(crep, ref, edge)) && cs_usable(cs, &(crep->edge[edge]))) {
+	  weight = mod_pow(point, expo[edge], prime);
+	  cs_add(cs, &(crep->edge[edge]), 0, 1, weight, prime, mmat, NULL);
+	}
+      vals[cnt * npoints + point] = mod_det(mmat, cs->size, prime);
+      if(cs->sign < 0) vals[cnt * npoints + point] = (prime - vals[cnt * npoints + point]) % prime;
+    }
+    // Newton's divided differences ...
+    for(iter = 1; iter < npoints; ++iter)
+      for(point = npoints - 1; point >= iter; --point) {
+	weight = (vals[cnt * npoints + point] + prime - vals[cnt * npoints + point - 1]) % prime;
+	vals[cnt * npoints + point] = weight * mod_pow(iter, prime - 2, prime) % prime;
+      }
+    // ... to monomial coefficients (Horner's scheme on the Newton form)
+    for(iter = 0; iter < npoints; ++iter)
+      coef[cnt * npoints + iter] = 0;
+    for(point = npoints - 1; point >= 0; --point) {
+      for(iter = npoints - 1; iter > 0; --iter)
+	coef[cnt * npoints + iter] = (coef[cnt * npoints + iter - 1] + prime - (unsigned long long) point * coef[cnt * npoints + iter] % prime) % prime;
+      coef[cnt * npoints] = (prime - (unsigned long long) point * coef[cnt * npoints] % prime) % prime;
+      coef[cnt * npoints] = (coef[cnt * npoints] + vals[cnt * npoints + point]) % prime;
+    }
+  }
+  signed_count = 0;
+  for(iter = 0; iter < npoints; ++iter)
+    signed_count += crt(coef[iter], coef[npoints + iter]);
+  if(exact) {
+    fprintf(fref, " %lld common trees (signed)", signed_count);
+    if(cs->passive) fprintf(fref, ", exact\n");
+    else fprintf(fref, ", at most %.0f\n", (bound[0] < bound[1]) ? bound[0] : bound[1]);
+    for(iter = npoints - 1; iter >= 0; --iter)
+      if(crt(coef[iter], coef[npoints + iter]))
+	fprintf(fref, "  s^%d: %lld\n", zsum + iter - cs->size * shift, crt(coef[iter], coef[npoints + iter]));
+  } else
+    fprintf(fref, " too many common trees to be counted exactly, at most %.3e\n", (bound[0] < bound[1]) ? bound[0] : bound[1]);
+  XFREE(coef);
+  XFREE(vals);
+  XFREE(expo);
+  XFREE(fmat);
+  XFREE(mmat);
+  cstat_del(cs);
+  return 1;
+}
+
+/**
+ * \brief Common trees counting function
+ *
+ * It counts the common trees of both the numerator (gref) and the denominator
+ * (yref) without enumerating them, for each power of s.
+ *
+ * \param crep %circuit reference
+ * \param fref output stream
+ * \return zero if some error occurs, a positive value otherwise
+ */
+int
+circ_count (const circ_t* crep, FILE* fref)
+{
+  int ret;
+  if(crep != NULL) {
+    ret = count_block(crep, crep->gref, "Numerator", fref);
+    if(ret) ret = count_block(crep, crep->yref, "Denominator", fref);
+  } else {
+    warning("Null pointer!");
+    ret = 0;
+  }
+  return ret;
+}
@@ -0,0 +1,49 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file count.h
+ *
+ * \brief Common trees counting function prototype
+ *
+ * This file contains the prototype of the function that counts the common
+ * trees of a circuit without enumerating them.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef COUNT_H
+#define COUNT_H 1
+
+#include "common.h"
+#include "circuit.h"
+
+extern int
+circ_count (const circ_t*, FILE*);
+
+#endif /* COUNT_H */
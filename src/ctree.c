@@ -0,0 +1,1036 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file ctree.c
+ *
+ * \brief Common trees support functions
+ *
+ * This file contains the functions shared by all the common trees finders:
+ * partial trees management (connected components tracking and loop test),
+ * common tree to expression token conversion and the driver that sets up the
+ * yref and gref blocks before to invoke the engine specific finder.
+ */
+
+#include <limits.h>
+
+#include "common.h"
+#include "list.h"
+#include "circuit.h"
+#include "expr.h"
+#include "ctree.h"
+
+/**
+ * \brief Gaussian elimination algorithm
+ *
+ * \internal
+ * This is a support function used to reduce incident matrices. It is based on
+ * the Gauss elimination algorithm that permits to write a given <i>m*n</i>
+ * matrix M as a <i>n*n</i> diagonal matrix D. This function is an ad-hoc
+ * function, that means it is designed to be more efficient (of course, it is
+ * also less generic), like a specific per-problem function.
+ *
+ * \param matrix matrix to be reduced.
+ * \param row number of rows (number of nodes into the tree)
+ * \param col number of columns (number of edges of the tree, that is the number
+ *     of nodes minus one)
+ * \return determinant of the matrix
+ */
+static int
+to_diagonal_matrix (int* matrix, const int row, const int col)
+{
+  int det;
+  int iter;
+  int cnt;
+  int swap;
+  int ofs;
+  int weight;
+  ofs = 0;
+  det = 1;
+  for(ofs = 0; ofs < col; ++ofs) {
+    for(iter = ofs; iter < row; ++iter) {
+      if(matrix[iter * col + ofs] != 0) {
+	if(iter != ofs) {
+	  for(cnt = ofs; cnt < col; ++cnt) {
+	    swap = matrix[iter * col + cnt];
+	    matrix[iter * col + cnt] = matrix[ofs * col + cnt];
+	    matrix[ofs * col + cnt] = swap;
+	  }
+	  det *= -1;
+	}
+	for(iter = ofs + 1; iter < row; ++iter) {
+	  if(matrix[iter * col + ofs] != 0) {
+	    weight = -1 * matrix[ofs * col + ofs] / matrix[iter * col + ofs];
+	    for(cnt = ofs; cnt < col; ++cnt)
+	      matrix[iter * col + cnt] += matrix[ofs * col + cnt] * weight;
+	  }
+	}
+	iter = row;
+      }
+    }
+  }
+  for(iter = 0; iter < col; ++iter)
+    det *= matrix[iter * col + iter];
+  return det;
+}
+
+/**
+ * \brief Adds an %edge to the current partial tree
+ *
+ * \internal
+ * It is used to add an %edge to the current partial tree in a correct manner;
+ * the added %edge isn't surely a valid %edge for that tree but only a potential
+ * one.
+ *
+ * \param cc actual common components
+ * \param nt tail node of the %edge
+ * \param nh head node of the %edge
+ * \param nnum number of nodes
+ */
+void
+ctrlplus (int* cc, const node_t nt, const node_t nh, const int nnum)
+{
+  int root;
+  int iter;
+  int tmp;
+  int mem;
+  root = cc[2 * nh];
+  for(iter = 0; iter < nnum; ++iter)
+    if(cc[2 * iter] == root)
+      cc[2 * iter] = cc[2 * nt];
+  iter = cc[2 * nh + 1];
+  mem = nh;
+  if(iter != -1)
+    while(mem != root) {
+      tmp = cc[2 * iter + 1];
+      cc[2 * iter + 1] = mem;
+      mem = iter;
+      iter = tmp;
+    }
+  cc[2 * nh + 1] = nt;
+}
+
+/**
+ * \brief Deletes an %edge from the current partial tree
+ *
+ * \internal
+ * It is used to delete an %edge from the current partial tree in a correct
+ * manner; the %edge must have been added by a previous call to \e ctrlplus.
+ *
+ * \param cc actual common components
+ * \param nt tail node of the %edge
+ * \param nh head node of the %edge
+ * \param nnum number of nodes
+ */
+void
+ctrlminus (int* cc, node_t nt, node_t nh, const int nnum)
+{
+  int tmp;
+  int iter;
+  int flag = 1;
+  if(cc[2 * nh + 1] != nt) {
+    tmp = nt;
+    nt = nh;
+    nh = tmp;
+  }
+  cc[2 * nh + 1] = -1;
+  cc[2 * nh] = nh;
+  while(flag) {
+    flag = 0;
+    for(iter = 0; iter < nnum; ++iter) {
+      if((iter != nh)&&(cc[2 * iter + 1] != -1)) {
+        if((cc[ 2 * iter] != nh)&&(cc[2 * cc[2 * iter + 1]] == nh)) {
+          cc[2 * iter] = nh;
+          flag = 1;
+        }
+      }
+    }
+  }
+}
+
+/**
+ * \brief Test for loop
+ *
+ * \internal
+ * This test whether adding an %edge to the partial common tree results in a
+ * loop or not; a loop situation is something to avoid.
+ *
+ * \param cc actual common components
+ * \param nh head node of the %edge
+ * \param nt tail node of the %edge
+ * \result zero whether adding the %edge results in a loop, a positive value
+ *   otherwise
+ */
+int
+testloop (const int* cc, const int nh, const int nt)
+{
+  return (cc[2*nh] == cc[2*nt]) ? 1 : 0;
+}
+
+/**
+ * \brief Sign of a common tree
+ *
+ * \internal
+ * This function gives the product of the determinants of the reduced incidence
+ * matrices of both the graphs, restricted to the edges of the tree (that is,
+ * the sign of its term).
+ *
+ * \param crep circuit representation reference
+ * \param nodes nodes into the tree
+ * \param mask pre-allocated %mask support array
+ * \param maskmark step marker, nothing more
+ * \param giimat current graph pre-allocated matrix
+ * \param gvimat voltage pre-allocated graph matrix
+ * \result sign of the tree
+ */
+double
+to_sign (const circ_t* crep, const node_t* nodes, int* mask, int maskmark, int* giimat, int* gvimat)
+{
+  int iter;
+  int offset;
+  double sign;
+  for(iter = 0; iter < crep->ednum; ++iter)
+    mask[iter] = 0;
+  for(iter = 0; iter < (crep->nnum * (crep->nnum - 1)); ++iter) {
+    giimat[iter] = 0;
+    gvimat[iter] = 0;
+  }
+  offset = 0;
+  for(iter = 0; iter < crep->nnum - 1; ++iter)
+    mask[nodes[iter]] = maskmark;
+  for(iter = 0; iter < crep->ednum; ++iter)
+    if(mask[iter] == maskmark) {
+      giimat[(crep->nnum - 1) * crep->edge[iter].giref[0]->node + offset] = -1;
+      giimat[(crep->nnum - 1) * crep->edge[iter].giref[1]->node + offset] = 1;
+      gvimat[(crep->nnum - 1) * crep->edge[iter].gvref[0]->node + offset] = -1;
+      gvimat[(crep->nnum - 1) * crep->edge[iter].gvref[1]->node + offset] = 1;
+      ++offset;
+    }
+  sign = to_diagonal_matrix(giimat, crep->nnum, (crep->nnum - 1));
+  sign *= to_diagonal_matrix(gvimat, crep->nnum, (crep->nnum - 1));
+  return sign;
+}
+
+/**
+ * \brief List-of-nodes-to-expression-token converter
+ *
+ * \internal
+ * This function adds a token to the expression and returns the head of a new
+ * tight and sorted expression
+ *
+ * \param crep circuit representation reference
+ * \param nodes nodes into the tree
+ * \param mask pre-allocated %mask support array
+ * \param maskmark step marker, nothing more
+ * \param giimat current graph pre-allocated matrix
+ * \param gvimat voltage pre-allocated graph matrix
+ * \param chain chain of expressions
+ * \result chain of expressions' head
+ */
+expr_t*
+to_expr (const circ_t* crep, const node_t* nodes, int* mask, int maskmark, int* giimat, int* gvimat, expr_t* chain)
+{
+  double sign;
+  sign = to_sign(crep, nodes, mask, maskmark, giimat, gvimat);
+  return to_term(crep, nodes, mask, maskmark, sign, chain);
+}
+
+/**
+ * \brief List-of-nodes-to-expression-token converter, sign given
+ *
+ * \internal
+ * As \e to_expr function does, but the sign of the tree is known in advance
+ * (see \e to_sign function), so that no matrices are involved.
+ *
+ * \param crep circuit representation reference
+ * \param nodes nodes into the tree
+ * \param mask pre-allocated %mask support array
+ * \param maskmark step marker, nothing more
+ * \param sign sign of the tree
+ * \param chain chain of expressions
+ * \result chain of expressions' head
+ */
+expr_t*
+to_term (const circ_t* crep, const node_t* nodes, int* mask, int maskmark, const double sign, expr_t* chain)
+{
+  int iter;
+  int actv;
+  expr_t* eslice;
+  expr_t** eiter;
+  expr_t* elist;
+  list_t** liter;
+  list_t* lhook;
+  void* hook;
+  elist = chain;
+  for(iter = 0; iter < crep->ednum; ++iter)
+    mask[iter] = 0;
+  eslice = expr_new();
+  for(iter = 0; iter < crep->nnum - 1; ++iter)
+    mask[nodes[iter]] = maskmark;
+  for(iter = 0; iter < crep->ednum; ++iter) {
+    if(((mask[iter] == maskmark) && (crep->edge[iter].type == Y)) ||	\
+       ((mask[iter] != maskmark) && (crep->edge[iter].type == Z))) {
+      if(crep->edge[iter].sym) {
+	if(crep->edge[iter].name) {
+	  // ordered insertion
+	  liter = &(eslice->epart);
+	  while((*liter != NULL) && (strcmp(list_data(const char, (*liter)), crep->edge[iter].name) < 0))
+	    liter = &((*liter)->next);
+	  *liter = list_add(list_new((void*) xstrdup(crep->edge[iter].name)), *liter);
+	  // unordered insertion
+	  // eslice->epart = list_add(list_new((void*) xstrdup(crep->edge[iter].name)), eslice->epart);
+	  ++(eslice->etoken);
+	}
+	// sign-handler (generators' direction)
+	// eslice->vpart *= crep->edge[iter].value;
+      } else eslice->vpart *= crep->edge[iter].value;
+      eslice->degree += crep->edge[iter].degree;
+    }
+  }
+  // sign computation
+  eslice->vpart *= sign;
+  // shrink-step
+  eiter = &elist;
+  actv = 0;
+  // find ...
+  while((*eiter != NULL) && (eslice->degree <= (*eiter)->degree) && (!actv)) {
+    if((eslice->degree == (*eiter)->degree) && (eslice->epart != NULL)) {
+      lhook = eslice->epart;
+      liter = &((*eiter)->epart);
+      while(*liter != NULL) {
+	if((lhook == NULL) || (strcmp(list_data(const char, lhook), list_data(const char, (*liter)))))
+	  break;
+	else {
+	  lhook = list_next(lhook);
+	  liter = &((*liter)->next);
+	}
+      }
+      if((*liter == NULL) && (lhook == NULL))
+	actv = !actv;
+    }
+    if(!actv)
+      eiter = &((*eiter)->next);
+  }
+  // ... and shrink ...
+  if(actv) {
+    (*eiter)->vpart += eslice->vpart;
+    while(eslice->epart != NULL) {
+      lhook = eslice->epart;
+      eslice->epart = list_next(lhook);
+      hook = list_data(void, lhook);
+      XFREE(hook);
+      XFREE(lhook);
+    }
+    XFREE(eslice);
+  } else
+    // ... or insert, of course!
+    *eiter = (expr_t*) list_add((list_t*) eslice, (list_t*) *eiter);
+  return elist;
+}
+
+/**
+ * \brief Term accumulator entry
+ *
+ * \internal
+ * Monomials are looked up by their degree, their number of symbols and a
+ * key obtained xoring the keys of the symbolic edges they come from, then
+ * their symbols are compared, so that colliding keys can't merge them.
+ */
+struct tentry
+{
+  unsigned long long key;  /**< Monomial key */
+  int degree;  /**< Degree of the monomial */
+  int etoken;  /**< Number of symbols (negative for free entries) */
+  int seq;  /**< Creation sequence number */
+  int off;  /**< First symbol into the symbols pool */
+  double vpart;  /**< Accumulated numerical part */
+};
+
+/**
+ * \brief Incremental term status
+ *
+ * Status of the term related to the actual partial tree. Decisions are stacked
+ * so that going back and forth between consecutive trees costs only the
+ * decisions that differ, instead of a whole scan of the edges.
+ */
+struct tstate
+{
+  const circ_t* crep;  /**< Circuit representation reference */
+  int depth;  /**< Number of stacked decisions */
+  int degree;  /**< Degree of the actual term */
+  int etoken;  /**< Number of symbols of the actual term */
+  unsigned long long key;  /**< Key of the actual term */
+  unsigned long long* ekey;  /**< Key of each edge */
+  char* intree;  /**< Edge is into the actual tree */
+  double* vstack;  /**< Numerical part of the term, level by level */
+  int* estack;  /**< Edge decided at each level */
+  int* istack;  /**< Decision at each level (edge into the tree or not) */
+  int* head;  /**< Tree adjacency: first link of each node */
+  int* next;  /**< Tree adjacency: next link */
+  int* link;  /**< Tree adjacency: linked node and edge (pairs) */
+  int* queue;  /**< Breadth-first search queue */
+  int* pedge;  /**< Edge towards the parent node (both the graphs) */
+  int* owner;  /**< Node owning an edge as parent edge (voltage graph) */
+  int* seen;  /**< Visited nodes */
+  int stamp;  /**< Actual visit stamp */
+  struct tentry* table;  /**< Accumulated terms (open addressing) */
+  int tsize;  /**< Table size (power of two) */
+  int tcnt;  /**< Number of accumulated terms */
+  int* pool;  /**< Symbols pool (edges) */
+  int psize;  /**< Pool size */
+  int pcnt;  /**< Used pool entries */
+};
+
+/**
+ * \brief Tells if an %edge is a symbol of the term once decided
+ *
+ * \internal
+ * \param edge %edge reference
+ * \param in the %edge is into the tree
+ * \return a positive value if \a edge is part of the term, zero otherwise
+ */
+static int
+ts_part (const edge_t* edge, const int in)
+{
+  return ((in && (edge->type == Y)) || ((!in) && (edge->type == Z)));
+}
+
+/**
+ * \brief Numerical factor of an %edge once decided
+ *
+ * \internal
+ * \param crep %circuit reference
+ * \param edge %edge identifier
+ * \param in the %edge is into the tree
+ * \return the factor to be multiplied into the numerical part of the term
+ */
+double
+ts_factor (const circ_t* crep, const int edge, const int in)
+{
+  if(ts_part(&(crep->edge[edge]), in) && (!crep->edge[edge].sym))
+    return crep->edge[edge].value;
+  return 1.;
+}
+
+/**
+ * \brief Accounts for an %edge into the actual term
+ *
+ * \internal
+ * \param ts term status
+ * \param edge %edge identifier
+ * \param dir one to add the %edge to the term, minus one to remove it
+ */
+static void
+ts_account (tstate_t* ts, const int edge, const int dir)
+{
+  const edge_t* eref;
+  eref = &(ts->crep->edge[edge]);
+  if(ts_part(eref, ts->intree[edge])) {
+    ts->degree += dir * eref->degree;
+    if(eref->sym && eref->name) {
+      ts->key ^= ts->ekey[edge];
+      ts->etoken += dir;
+    }
+  }
+}
+
+/**
+ * \brief Term status constructor
+ *
+ * \internal
+ * Initial status is the empty one: no edges into the tree, that is all the
+ * impedances are part of the term.
+ *
+ * \param crep %circuit reference
+ * \return newly allocated term status
+ */
+tstate_t*
+ts_new (const circ_t* crep)
+{
+  tstate_t* ts;
+  unsigned long long seed;
+  int iter;
+  ts = XMALLOC(tstate_t, 1);
+  ts->crep = crep;
+  ts->depth = 0;
+  ts->degree = 0;
+  ts->etoken = 0;
+  ts->key = 0;
+  ts->ekey = XMALLOC(unsigned long long, crep->ednum);
+  ts->intree = XMALLOC(char, crep->ednum);
+  ts->vstack = XMALLOC(double, crep->ednum + 1);
+  ts->estack = XMALLOC(int, crep->ednum);
+  ts->istack = XMALLOC(int, crep->ednum);
+  ts->vstack[0] = 1.;
+  seed = 0x9e3779b97f4a7c15ULL;
+  for(iter = 0; iter < crep->ednum; ++iter) {
+    // splitmix64
+    seed += 0x9e3779b97f4a7c15ULL;
+    ts->ekey[iter] = seed;
+    ts->ekey[iter] = (ts->ekey[iter] ^ (ts->ekey[iter] >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    ts->ekey[iter] = (ts->ekey[iter] ^ (ts->ekey[iter] >> 27)) * 0x94d049bb133111ebULL;
+    ts->ekey[iter] ^= ts->ekey[iter] >> 31;
+    ts->intree[iter] = 0;
+    ts_account(ts, iter, 1);
+  }
+  ts->head = XMALLOC(int, crep->nnum);
+  ts->next = XMALLOC(int, 2 * crep->nnum);
+  ts->link = XMALLOC(int, 4 * crep->nnum);
+  ts->queue = XMALLOC(int, crep->nnum);
+  ts->pedge = XMALLOC(int, 2 * crep->nnum);
+  ts->owner = XMALLOC(int, crep->ednum);
+  ts->seen = XMALLOC(int, crep->nnum);
+  for(iter = 0; iter < crep->nnum; ++iter)
+    ts->seen[iter] = 0;
+  ts->stamp = 0;
+  ts->tsize = 64;
+  ts->tcnt = 0;
+  ts->table = XMALLOC(struct tentry, ts->tsize);
+  for(iter = 0; iter < ts->tsize; ++iter)
+    ts->table[iter].etoken = -1;
+  ts->psize = 64;
+  ts->pcnt = 0;
+  ts->pool = XMALLOC(int, ts->psize);
+  return ts;
+}
+
+/**
+ * \brief Term status destructor
+ *
+ * \internal
+ * \param ts term status
+ */
+void
+ts_del (tstate_t* ts)
+{
+  XFREE(ts->pool);
+  XFREE(ts->table);
+  XFREE(ts->seen);
+  XFREE(ts->owner);
+  XFREE(ts->pedge);
+  XFREE(ts->queue);
+  XFREE(ts->link);
+  XFREE(ts->next);
+  XFREE(ts->head);
+  XFREE(ts->istack);
+  XFREE(ts->estack);
+  XFREE(ts->vstack);
+  XFREE(ts->intree);
+  XFREE(ts->ekey);
+  XFREE(ts);
+}
+
+/**
+ * \brief Toggles an %edge into the tree
+ *
+ * \internal
+ * \param ts term status
+ * \param edge %edge identifier
+ */
+static void
+ts_toggle (tstate_t* ts, const int edge)
+{
+  ts_account(ts, edge, -1);
+  ts->intree[edge] = !ts->intree[edge];
+  ts_account(ts, edge, 1);
+}
+
+/**
+ * \brief Pushes a decision into the term status
+ *
+ * \internal
+ * \param ts term status
+ * \param edge %edge identifier
+ * \param in the %edge is into the tree
+ */
+void
+ts_push (tstate_t* ts, const int edge, const int in)
+{
+  ts->vstack[ts->depth + 1] = ts->vstack[ts->depth] * ts_factor(ts->crep, edge, in);
+  ts->estack[ts->depth] = edge;
+  ts->istack[ts->depth] = in;
+  ++(ts->depth);
+  if(in) ts_toggle(ts, edge);
+}
+
+/**
+ * \brief Pops the last decision from the term status
+ *
+ * \internal
+ * \param ts term status
+ */
+void
+ts_pop (tstate_t* ts)
+{
+  --(ts->depth);
+  if(ts->istack[ts->depth]) ts_toggle(ts, ts->estack[ts->depth]);
+}
+
+/**
+ * \brief Orients a tree towards the last node
+ *
+ * \internal
+ * The incident matrix of a tree (last row dropped) turns into a triangular one
+ * once rows and columns are sorted by visit order, so that its determinant is
+ * the product of the orientations of the edges towards the parent nodes, up to
+ * the sign of the columns permutation.
+ *
+ * \param ts term status
+ * \param nodes edges into the tree
+ * \param graph zero for the current graph, one for the voltage graph
+ * \return product of the orientations (zero if \a nodes is not a tree)
+ */
+static int
+ts_orient (tstate_t* ts, const node_t* nodes, const int graph)
+{
+  const circ_t* crep;
+  tn_t* const* ref;
+  int* pedge;
+  int iter;
+  int edge;
+  int na;
+  int nb;
+  int first;
+  int last;
+  int cur;
+  int orient;
+  crep = ts->crep;
+  pedge = ts->pedge + graph * crep->nnum;
+  for(iter = 0; iter < crep->nnum; ++iter)
+    ts->head[iter] = -1;
+  for(iter = 0; iter < crep->nnum - 1; ++iter) {
+    edge = nodes[iter];
+    ref = graph ? crep->edge[edge].gvref : crep->edge[edge].giref;
+    na = ref[0]->node;
+    nb = ref[1]->node;
+    ts->link[4 * iter] = nb;
+    ts->link[4 * iter + 1] = edge;
+    ts->next[2 * iter] = ts->head[na];
+    ts->head[na] = 2 * iter;
+    ts->link[4 * iter + 2] = na;
+    ts->link[4 * iter + 3] = edge;
+    ts->next[2 * iter + 1] = ts->head[nb];
+    ts->head[nb] = 2 * iter + 1;
+  }
+  if(ts->stamp == INT_MAX) {
+    for(iter = 0; iter < crep->nnum; ++iter)
+      ts->seen[iter] = 0;
+    ts->stamp = 0;
+  }
+  ++(ts->stamp);
+  orient = 1;
+  first = 0;
+  last = 1;
+  ts->queue[0] = crep->nnum - 1;
+  ts->seen[crep->nnum - 1] = ts->stamp;
+  while(first < last) {
+    cur = ts->queue[first++];
+    for(iter = ts->head[cur]; iter != -1; iter = ts->next[iter]) {
+      na = ts->link[2 * iter];
+      if(ts->seen[na] != ts->stamp) {
+	ts->seen[na] = ts->stamp;
+	edge = ts->link[2 * iter + 1];
+	pedge[na] = edge;
+	ref = graph ? crep->edge[edge].gvref : crep->edge[edge].giref;
+	if(ref[1]->node != na) orient = -orient;
+	ts->queue[last++] = na;
+      }
+    }
+  }
+  return (last == crep->nnum) ? orient : 0;
+}
+
+/**
+ * \brief Sign of a common tree
+ *
+ * \internal
+ * It is the product of the determinants of both the incident matrices, as
+ * computed by \e to_diagonal_matrix function, but it takes linear time. Since
+ * columns are sorted the same way for both the graphs, the signs of the two
+ * columns permutations collapse into the sign of the permutation that maps
+ * each node onto the node owning the same %edge as parent %edge into the
+ * voltage graph.
+ *
+ * \param ts term status
+ * \param nodes edges into the tree
+ * \return sign of the tree (zero if \a nodes is not a tree)
+ */
+static int
+ts_sign (tstate_t* ts, const node_t* nodes)
+{
+  int sign;
+  int iter;
+  int cur;
+  int cycles;
+  sign = ts_orient(ts, nodes, 0) * ts_orient(ts, nodes, 1);
+  if(sign) {
+    for(iter = 0; iter < ts->crep->nnum - 1; ++iter)
+      ts->owner[ts->pedge[ts->crep->nnum + iter]] = iter;
+    // stamp can't overflow, it has been just checked by ts_orient
+    ++(ts->stamp);
+    cycles = 0;
+    for(iter = 0; iter < ts->crep->nnum - 1; ++iter) {
+      if(ts->seen[iter] != ts->stamp) {
+	++cycles;
+	for(cur = iter; ts->seen[cur] != ts->stamp; cur = ts->owner[ts->pedge[cur]])
+	  ts->seen[cur] = ts->stamp;
+      }
+    }
+    if(((ts->crep->nnum - 1) - cycles) % 2) sign = -sign;
+  }
+  return sign;
+}
+
+/**
+ * \brief Tells if an accumulated term is the actual one
+ *
+ * \internal
+ * Both the terms have the same number of symbols, so they're the same one if
+ * the symbols of the accumulated term are all part of the actual term.
+ *
+ * \param ts term status
+ * \param entry accumulated term
+ * \return a positive value if the symbols are the same, zero otherwise
+ */
+static int
+ts_same (const tstate_t* ts, const struct tentry* entry)
+{
+  int iter;
+  int edge;
+  for(iter = 0; iter < entry->etoken; ++iter) {
+    edge = ts->pool[entry->off + iter];
+    if(!ts_part(&(ts->crep->edge[edge]), ts->intree[edge])) return 0;
+  }
+  return 1;
+}
+
+/**
+ * \brief Lookup slot of a term
+ *
+ * \internal
+ * Entries match the actual term when keys, degrees, number of symbols and
+ * symbols are the same; a term without symbols never matches, so that the
+ * slot of a free entry is given.
+ *
+ * \param ts term status
+ * \param key term key
+ * \param degree term degree
+ * \param etoken number of symbols of the term
+ * \return index of the matching entry or of the free one to be used
+ */
+static int
+ts_slot (const tstate_t* ts, const unsigned long long key, const int degree, const int etoken)
+{
+  const struct tentry* table;
+  int idx;
+  table = ts->table;
+  idx = (int) ((key ^ ((unsigned long long) degree * 0x9e3779b97f4a7c15ULL)) & (unsigned long long) (ts->tsize - 1));
+  while((table[idx].etoken >= 0) &&
+	((!etoken) || (table[idx].key != key) || (table[idx].degree != degree) || (table[idx].etoken != etoken) || (!ts_same(ts, &table[idx]))))
+    idx = (idx + 1) & (ts->tsize - 1);
+  return idx;
+}
+
+/**
+ * \brief Accumulates the actual common tree
+ *
+ * \internal
+ * Numerical parts of trees sharing the same monomial are summed, exactly as
+ * \e to_expr function does; also terms without symbols aren't merged, to
+ * give the same results.
+ *
+ * \param ts term status
+ * \param nodes edges into the tree
+ * \param vrest numerical factor of the undecided edges (out of the tree)
+ */
+void
+ts_burn (tstate_t* ts, const node_t* nodes, const double vrest)
+{
+  struct tentry* old;
+  double vpart;
+  int idx;
+  int iter;
+  int osize;
+  vpart = ts->vstack[ts->depth] * vrest * ts_sign(ts, nodes);
+  idx = ts_slot(ts, ts->key, ts->degree, ts->etoken);
+  if(ts->table[idx].etoken >= 0) ts->table[idx].vpart += vpart;
+  else {
+    if(ts->pcnt + ts->etoken > ts->psize) {
+      while(ts->pcnt + ts->etoken > ts->psize)
+	ts->psize *= 2;
+      ts->pool = XREALLOC(int, ts->pool, ts->psize);
+    }
+    ts->table[idx].key = ts->key;
+    ts->table[idx].degree = ts->degree;
+    ts->table[idx].etoken = ts->etoken;
+    ts->table[idx].seq = ts->tcnt++;
+    ts->table[idx].off = ts->pcnt;
+    ts->table[idx].vpart = vpart;
+    for(iter = 0; iter < ts->crep->ednum; ++iter)
+      if(ts->crep->edge[iter].sym && ts->crep->edge[iter].name && ts_part(&(ts->crep->edge[iter]), ts->intree[iter]))
+	ts->pool[ts->pcnt++] = iter;
+    if(2 * ts->tcnt > ts->tsize) {
+      old = ts->table;
+      osize = ts->tsize;
+      ts->tsize *= 2;
+      ts->table = XMALLOC(struct tentry, ts->tsize);
+      for(iter = 0; iter < ts->tsize; ++iter)
+	ts->table[iter].etoken = -1;
+      for(iter = 0; iter < osize; ++iter)
+	if(old[iter].etoken >= 0) {
+	  idx = ts_slot(ts, old[iter].key, old[iter].degree, 0);
+	  ts->table[idx] = old[iter];
+	}
+      XFREE(old);
+    }
+  }
+}
+
+/**
+ * \brief Compares accumulated terms by chain order
+ *
+ * \internal
+ * Decreasing degree first, then creation order.
+ *
+ * \param a first term
+ * \param b second term
+ * \return comparison result, as required by qsort
+ */
+static int
+ts_compare (const void* a, const void* b)
+{
+  const struct tentry* ta;
+  const struct tentry* tb;
+  ta = *((const struct tentry* const*) a);
+  tb = *((const struct tentry* const*) b);
+  if(ta->degree != tb->degree) return (ta->degree > tb->degree) ? -1 : 1;
+  return (ta->seq > tb->seq) - (ta->seq < tb->seq);
+}
+
+/**
+ * \brief Compares symbols
+ *
+ * \internal
+ * \param a first symbol
+ * \param b second symbol
+ * \return comparison result, as required by qsort
+ */
+static int
+ts_symcmp (const void* a, const void* b)
+{
+  return strcmp(*((char* const*) a), *((char* const*) b));
+}
+
+/**
+ * \brief Builds the chain of the accumulated terms
+ *
+ * \internal
+ * The chain is the same that \e to_expr function gives: terms are sorted by
+ * decreasing degree and symbols of each term are sorted too.
+ *
+ * \param ts term status
+ * \param chain chain to be extended (terms are inserted into it)
+ * \return the resulting chain
+ */
+expr_t*
+ts_chain (tstate_t* ts, expr_t* chain)
+{
+  struct tentry** order;
+  char** names;
+  expr_t* eslice;
+  expr_t** eiter;
+  int iter;
+  int cnt;
+  int sym;
+  order = XMALLOC(struct tentry*, ts->tcnt + 1);
+  names = XMALLOC(char*, ts->crep->ednum + 1);
+  cnt = 0;
+  for(iter = 0; iter < ts->tsize; ++iter)
+    if(ts->table[iter].etoken >= 0)
+      order[cnt++] = &(ts->table[iter]);
+  qsort(order, cnt, sizeof(struct tentry*), ts_compare);
+  eiter = &chain;
+  for(iter = 0; iter < cnt; ++iter) {
+    eslice = expr_new();
+    eslice->vpart = order[iter]->vpart;
+    eslice->degree = order[iter]->degree;
+    eslice->etoken = order[iter]->etoken;
+    for(sym = 0; sym < order[iter]->etoken; ++sym)
+      names[sym] = ts->crep->edge[ts->pool[order[iter]->off + sym]].name;
+    qsort(names, order[iter]->etoken, sizeof(char*), ts_symcmp);
+    for(sym = order[iter]->etoken - 1; sym >= 0; --sym)
+      eslice->epart = list_add(list_new((void*) xstrdup(names[sym])), eslice->epart);
+    while((*eiter != NULL) && (eslice->degree <= (*eiter)->degree))
+      eiter = &((*eiter)->next);
+    *eiter = (expr_t*) list_add((list_t*) eslice, (list_t*) *eiter);
+    eiter = &((*eiter)->next);
+  }
+  XFREE(names);
+  XFREE(order);
+  return chain;
+}
+
+/**
+ * \brief Symbol constraints test
+ *
+ * \return a positive value if some symbols are required or forbidden, zero
+ *   otherwise
+ */
+int
+constrained ()
+{
+  return ((env.with != NULL) && (*env.with != NULL)) || ((env.without != NULL) && (*env.without != NULL));
+}
+
+/**
+ * \brief Symbol constraints maker
+ *
+ * Terms that contain a symbol are those whose tree holds its %edge, if it's a Y
+ * %edge, or doesn't hold it, if it's a Z %edge. So, required symbols force
+ * their edges into or out of the tree and forbidden ones do the opposite.
+ * Terms can't contain symbols that don't belong to any Y or Z %edge. The
+ * pinned %edge, if any, is forced into the tree (see %env).
+ *
+ * \param crep circuit representation reference
+ * \param clash set whether an %edge is forced both into and out of the tree
+ *   (or a required symbol is missing)
+ * \result newly allocated array (for each %edge, a positive value if it's
+ *   forced into the tree, a negative value if it's forced out of it, zero
+ *   otherwise)
+ */
+int*
+gfixed (const circ_t* crep, int* clash)
+{
+  int* fixed;
+  int iter;
+  int want;
+  char** name;
+  fixed = XMALLOC(int, crep->ednum);
+  *clash = 0;
+  for(name = env.with; (name != NULL) && (*name != NULL); ++name) {
+    for(iter = 0; iter < crep->ednum; ++iter)
+      if((crep->edge[iter].name != NULL) && (!strcmp(*name, crep->edge[iter].name)) &&
+	 ((crep->edge[iter].type == Y) || (crep->edge[iter].type == Z)))
+	break;
+    if(iter == crep->ednum) *clash = 1;
+  }
+  for(iter = 0; iter < crep->ednum; ++iter) {
+    fixed[iter] = 0;
+    if((crep->edge[iter].name == NULL) ||
+       ((crep->edge[iter].type != Y) && (crep->edge[iter].type != Z)))
+      continue;
+    for(name = env.with; (name != NULL) && (*name != NULL); ++name)
+      if(!strcmp(*name, crep->edge[iter].name)) {
+	want = (crep->edge[iter].type == Y) ? 1 : -1;
+	if(fixed[iter] == -want) *clash = 1;
+	fixed[iter] = want;
+      }
+    for(name = env.without; (name != NULL) && (*name != NULL); ++name)
+      if(!strcmp(*name, crep->edge[iter].name)) {
+	want = (crep->edge[iter].type == Y) ? -1 : 1;
+	if(fixed[iter] == -want) *clash = 1;
+	fixed[iter] = want;
+      }
+  }
+  // pinned edge, whatever its type is
+  if(env.pin >= 0) {
+    if(fixed[env.pin] < 0) *clash = 1;
+    fixed[env.pin] = 1;
+  }
+  return fixed;
+}
+
+/**
+ * \brief Common trees finder driver
+ *
+ * \internal
+ * Engines entry point: support elements are pushed in before to invoke the
+ * \a helper function which really solves common trees problem, once for the
+ * yref block and once for the gref block. Connected components variations are
+ * tracked here.
+ *
+ * \param crep %circuit reference
+ * \param yrefchain pointer to be used to store the first %list
+ * \param grefchain pointer to be used to store the second %list
+ * \param helper engine specific common trees finder
+ * \result zero if some error occurs, a positive value otherwise
+ */
+int
+ct_solve (const circ_t* crep, list_t** yrefchain, list_t** grefchain, ct_helper_t helper)
+{
+  int ret;
+  int* ccgi;
+  int* ccgv;
+  int iter;
+  list_t* fiter;
+  edge_t* etmp;
+  node_t* nodes;
+  if(crep != NULL) {
+    ret = 1;
+    ccgi = XMALLOC(int, 2*crep->nnum);
+    ccgv = XMALLOC(int, 2*crep->nnum);
+    nodes = XMALLOC(node_t, crep->nnum - 1);
+    for(iter = 0; iter < crep->nnum; ++iter) {
+      ccgi[2*iter] = ccgv[2*iter] = iter;
+      ccgi[2*iter + 1] = ccgv[2*iter + 1] = -1;
+    }
+    // forced edges!! :-) ... test loop needed ??
+    iter = -1;
+    fiter = crep->flist;
+    while(fiter) {
+      etmp = list_data(edge_t, fiter);
+      ctrlplus(ccgi, etmp->giref[0]->node, etmp->giref[1]->node, crep->nnum);
+      ctrlplus(ccgv, etmp->gvref[0]->node, etmp->gvref[1]->node, crep->nnum);
+      nodes[++iter] = edge_number(crep, etmp);
+      fiter = list_next(fiter);
+    }
+    ++iter;
+    if(crep->yref != NULL) {
+      ctrlplus(ccgi, crep->yref->giref[0]->node, crep->yref->giref[1]->node, crep->nnum);
+      ctrlplus(ccgv, crep->yref->gvref[0]->node, crep->yref->gvref[1]->node, crep->nnum);
+      nodes[iter] = edge_number(crep, crep->yref);
+      if(ret) ret = (*helper)(crep, yrefchain, ccgi, ccgv, nodes);
+      ctrlminus(ccgi, crep->yref->giref[0]->node, crep->yref->giref[1]->node, crep->nnum);
+      ctrlminus(ccgv, crep->yref->gvref[0]->node, crep->yref->gvref[1]->node, crep->nnum);
+    }
+    if(crep->gref != NULL) {
+      ctrlplus(ccgi, crep->gref->giref[0]->node, crep->gref->giref[1]->node, crep->nnum);
+      ctrlplus(ccgv, crep->gref->gvref[0]->node, crep->gref->gvref[1]->node, crep->nnum);
+      nodes[iter] = edge_number(crep, crep->gref);
+      if(ret) ret = (*helper)(crep, grefchain, ccgi, ccgv, nodes);
+      ctrlminus(ccgi, crep->gref->giref[0]->node, crep->gref->giref[1]->node, crep->nnum);
+      ctrlminus(ccgv, crep->gref->gvref[0]->node, crep->gref->gvref[1]->node, crep->nnum);
+    }
+    XFREE(ccgi);
+    XFREE(ccgv);
+    XFREE(nodes);
+  } else {
+    warning("Null pointer!");
+    ret = 0;
+  }
+  return ret;
+}
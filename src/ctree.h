@@ -0,0 +1,128 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file ctree.h
+ *
+ * \brief Common trees support functions prototypes
+ *
+ * This file contains prototypes for the functions shared by all the common
+ * trees finders (the engines that circ_to_expr can switch between) and for
+ * the engines themselves.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef CTREE_H
+#define CTREE_H 1
+
+#include "common.h"
+#include "circuit.h"
+#include "list.h"
+#include "expr.h"
+
+/**
+ * \brief Engine specific common trees finder
+ *
+ * It receives the circuit, the %list to be filled, the common components of
+ * both the graphs and the tree edges already pushed in by \e ct_solve.
+ */
+typedef
+int (*ct_helper_t) (const circ_t*, list_t**, int*, int*, node_t*);
+
+/**
+ * \brief Incremental term status type
+ */
+typedef
+struct tstate
+tstate_t;
+
+extern void
+ctrlplus (int*, const node_t, const node_t, const int);
+
+extern void
+ctrlminus (int*, node_t, node_t, const int);
+
+extern int
+testloop (const int*, const int, const int);
+
+extern int
+constrained ();
+
+extern int*
+gfixed (const circ_t*, int*);
+
+extern double
+to_sign (const circ_t*, const node_t*, int*, int, int*, int*);
+
+extern expr_t*
+to_expr (const circ_t*, const node_t*, int*, int, int*, int*, expr_t*);
+
+extern expr_t*
+to_term (const circ_t*, const node_t*, int*, int, const double, expr_t*);
+
+extern double
+ts_factor (const circ_t*, const int, const int);
+
+extern tstate_t*
+ts_new (const circ_t*);
+
+extern void
+ts_del (tstate_t*);
+
+extern void
+ts_push (tstate_t*, const int, const int);
+
+extern void
+ts_pop (tstate_t*);
+
+extern void
+ts_burn (tstate_t*, const node_t*, const double);
+
+extern expr_t*
+ts_chain (tstate_t*, expr_t*);
+
+extern int
+ct_solve (const circ_t*, list_t**, list_t**, ct_helper_t);
+
+extern int
+kbest (const circ_t*, list_t**, list_t**);
+
+extern int
+matroid (const circ_t*, list_t**, list_t**);
+
+extern int
+exchange (const circ_t*, list_t**, list_t**);
+
+extern int
+cascade (const circ_t*, list_t**, list_t**);
+
+extern int
+tearing (const circ_t*, list_t**, list_t**);
+
+#endif /* CTREE_H */
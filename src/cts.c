@@ -0,0 +1,698 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file cts.c
+ *
+ * \brief Common trees store
+ *
+ * The common trees of a circuit depend only on its topology, while values and
+ * symbolic flags of the components matter only when the trees are turned into
+ * terms. So, grimbleby's finder can save the trees it finds (their edges and
+ * their signs) into "<file>.cts", and the store engine reads them back in a
+ * single sequential pass and gives the expressions for the actual values, as
+ * long as the topology of the circuit is still the same (see cts.h for the
+ * layout). Trees come out of grimbleby's finder in depth-first order, so that
+ * each one shares a long prefix with the previous one and only the rest is
+ * written; the body is deflated as well, when zlib is available.
+ * <br> The edges of the circuit are saved too, so that a store still serves
+ * when a single component has been added or removed since it was written:
+ * trees of the store are mapped on the edges of the actual circuit, those that
+ * contain a removed edge are dropped and only the trees that contain an added
+ * one are to be searched for.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "common.h"
+#include "circuit.h"
+#include "fdt.h"
+#include "cts.h"
+
+#ifdef HAVE_ZLIB_H
+#include <zlib.h>
+#endif /* HAVE_ZLIB_H */
+
+/**
+ * \brief Size of the buffers (bytes)
+ */
+#define CTS_BUF (1 << 16)
+
+/**
+ * \brief Values saved for each %edge (type, degree and nodes)
+ */
+#define CTS_ROW 6
+
+/**
+ * \brief Store being written or read
+ */
+struct cts
+{
+  FILE* file;  /**< Store file */
+  int size;  /**< Edges into a tree */
+  int ednum;  /**< Number of edges of the circuit */
+  int deflated;  /**< Body deflated by zlib */
+  int block;  /**< Block under way (negative if none) */
+  node_t* prev;  /**< Previous tree of the block */
+  int pcnt;  /**< There is a previous tree */
+  unsigned char* buf;  /**< Body buffer */
+  size_t cnt;  /**< Bytes into the buffer */
+  size_t pos;  /**< Next byte to be read */
+  unsigned long long hash;  /**< Checksum of the body so far */
+  int werr;  /**< Some error occurs writing the store */
+  int eof;  /**< End of the store file */
+  int* map;  /**< Edges of the store into edges of the circuit (-1 if removed) */
+  int added;  /**< Edge added to the circuit (-1 if none) */
+#ifdef HAVE_ZLIB_H
+  z_stream zs;  /**< Deflate (inflate) stream */
+  unsigned char* zbuf;  /**< Deflated buffer */
+#endif /* HAVE_ZLIB_H */
+};
+
+/**
+ * \brief Store status
+ *
+ * \internal
+ */
+static struct
+{
+  char* name;  /**< Store file name (NULL means off) */
+  cts_t* out;  /**< Store being written (NULL if none) */
+} store;
+
+/**
+ * \brief Topology of an %edge
+ *
+ * \internal
+ * Type, degree and nodes of the %edge: names, values and symbolic flags don't
+ * matter.
+ *
+ * \param crep circuit representation reference
+ * \param edge %edge
+ * \param row topology of the %edge (\e CTS_ROW values)
+ */
+static void
+cs_row (const circ_t* crep, const int edge, int* row)
+{
+  row[0] = crep->edge[edge].type;
+  row[1] = crep->edge[edge].degree;
+  row[2] = crep->edge[edge].giref[0]->node;
+  row[3] = crep->edge[edge].giref[1]->node;
+  row[4] = crep->edge[edge].gvref[0]->node;
+  row[5] = crep->edge[edge].gvref[1]->node;
+}
+
+/**
+ * \brief It allocates a store
+ *
+ * \internal
+ *
+ * \param file store file
+ * \param size edges into a tree
+ * \param ednum number of edges of the circuit
+ * \return the store
+ */
+static cts_t*
+cts_new (FILE* file, const int size, const int ednum)
+{
+  cts_t* st;
+  st = XMALLOC(cts_t, 1);
+  st->file = file;
+  st->size = size;
+  st->ednum = ednum;
+  st->deflated = 0;
+  st->block = -1;
+  st->prev = XMALLOC(node_t, size + 1);
+  st->pcnt = 0;
+  st->buf = XMALLOC(unsigned char, CTS_BUF);
+  st->cnt = 0;
+  st->pos = 0;
+  st->hash = FDT_SEED;
+  st->werr = 0;
+  st->eof = 0;
+  st->map = NULL;
+  st->added = -1;
+#ifdef HAVE_ZLIB_H
+  st->zbuf = XMALLOC(unsigned char, CTS_BUF);
+  st->zs.zalloc = Z_NULL;
+  st->zs.zfree = Z_NULL;
+  st->zs.opaque = Z_NULL;
+  st->zs.next_in = Z_NULL;
+  st->zs.avail_in = 0;
+#endif /* HAVE_ZLIB_H */
+  return st;
+}
+
+/**
+ * \brief It writes the buffered body
+ *
+ * \internal
+ *
+ * \param st store
+ * \param finish a positive value at the end of the body, zero otherwise
+ */
+static void
+cs_flush (cts_t* st, const int finish)
+{
+#ifdef HAVE_ZLIB_H
+  size_t cnt;
+  if(st->deflated) {
+    st->zs.next_in = st->buf;
+    st->zs.avail_in = st->cnt;
+    do {
+      st->zs.next_out = st->zbuf;
+      st->zs.avail_out = CTS_BUF;
+      if(deflate(&st->zs, finish ? Z_FINISH : Z_NO_FLUSH) == Z_STREAM_ERROR) st->werr = 1;
+      cnt = CTS_BUF - st->zs.avail_out;
+      if(fwrite(st->zbuf, 1, cnt, st->file) != cnt) st->werr = 1;
+    } while((st->zs.avail_out == 0) && (!st->werr));
+    st->cnt = 0;
+    return;
+  }
+#endif /* HAVE_ZLIB_H */
+  if(fwrite(st->buf, 1, st->cnt, st->file) != st->cnt) st->werr = 1;
+  st->cnt = 0;
+}
+
+/**
+ * \brief It puts a byte into the body
+ *
+ * \internal
+ *
+ * \param st store
+ * \param byte byte to be written
+ */
+static void
+cs_put (cts_t* st, const unsigned char byte)
+{
+  st->hash = fdt_hash(st->hash, &byte, 1);
+  st->buf[st->cnt++] = byte;
+  if(st->cnt == CTS_BUF) cs_flush(st, 0);
+}
+
+/**
+ * \brief It puts a variable-length integer into the body
+ *
+ * \internal
+ * Seven bits a byte, least significant first, high bit set when more bytes
+ * follow.
+ *
+ * \param st store
+ * \param val value
+ */
+static void
+cs_varint (cts_t* st, unsigned long long val)
+{
+  while(val >= 0x80) {
+    cs_put(st, (unsigned char) (val | 0x80));
+    val >>= 7;
+  }
+  cs_put(st, (unsigned char) val);
+}
+
+/**
+ * \brief It reads the next bytes of the body
+ *
+ * \internal
+ *
+ * \param st store
+ */
+static void
+cs_fill (cts_t* st)
+{
+#ifdef HAVE_ZLIB_H
+  int ret;
+#endif /* HAVE_ZLIB_H */
+  st->pos = st->cnt = 0;
+#ifdef HAVE_ZLIB_H
+  if(st->deflated) {
+    while((st->cnt == 0) && (!st->eof)) {
+      if(st->zs.avail_in == 0) {
+	st->zs.next_in = st->zbuf;
+	if((st->zs.avail_in = fread(st->zbuf, 1, CTS_BUF, st->file)) == 0) {
+	  st->eof = 1;
+	  break;
+	}
+      }
+      st->zs.next_out = st->buf;
+      st->zs.avail_out = CTS_BUF;
+      ret = inflate(&st->zs, Z_NO_FLUSH);
+      if((ret != Z_OK) && (ret != Z_STREAM_END) && (ret != Z_BUF_ERROR))
+	fatal("Error loading common trees!");
+      st->cnt = CTS_BUF - st->zs.avail_out;
+      if(ret == Z_STREAM_END) st->eof = 1;
+    }
+    return;
+  }
+#endif /* HAVE_ZLIB_H */
+  st->cnt = fread(st->buf, 1, CTS_BUF, st->file);
+}
+
+/**
+ * \brief It gets a byte of the body
+ *
+ * \internal
+ *
+ * \param st store
+ * \return the byte
+ */
+static unsigned char
+cs_get (cts_t* st)
+{
+  unsigned char byte;
+  if(st->pos == st->cnt) cs_fill(st);
+  if(st->pos == st->cnt) fatal("Error loading common trees!");
+  byte = st->buf[st->pos++];
+  st->hash = fdt_hash(st->hash, &byte, 1);
+  return byte;
+}
+
+/**
+ * \brief It gets a variable-length integer of the body
+ *
+ * \internal
+ *
+ * \param st store
+ * \return the value
+ */
+static unsigned long long
+cs_getvar (cts_t* st)
+{
+  unsigned long long val;
+  unsigned char byte;
+  int shift;
+  val = 0;
+  shift = 0;
+  do {
+    if(shift > 63) fatal("Error loading common trees!");
+    byte = cs_get(st);
+    val |= ((unsigned long long) (byte & 0x7f)) << shift;
+    shift += 7;
+  } while(byte & 0x80);
+  return val;
+}
+
+/**
+ * \brief Edges of the store into edges of the circuit
+ *
+ * \internal
+ * Edges are compared in order: the circuit can have a Z or Y %edge more or
+ * less than the store (a component added or removed), all the others must be
+ * the same. Forced edges and the additional block can't change.
+ *
+ * \param crep circuit representation reference
+ * \param otab topology of the edges of the store (see \e cs_row)
+ * \param onum number of edges of the store
+ * \param added set to the %edge added to the circuit (-1 if none)
+ * \return newly allocated map (-1 for the removed %edge, if any), NULL if the
+ *   store doesn't match the circuit
+ */
+static int*
+cs_diff (const circ_t* crep, const int* otab, const int onum, int* added)
+{
+  int row[CTS_ROW];
+  int* map;
+  int iter;
+  int pos;
+  int skip;
+  map = XMALLOC(int, onum + 1);
+  *added = -1;
+  skip = 0;
+  for(iter = pos = 0; (iter < onum) || (pos < crep->ednum); ) {
+    if((iter < onum) && (pos < crep->ednum)) {
+      cs_row(crep, pos, row);
+      if(!memcmp(row, &otab[CTS_ROW * iter], sizeof(row))) {
+	map[iter++] = pos++;
+	continue;
+      }
+    }
+    if(skip++) break;
+    if(onum > crep->ednum) {
+      if((otab[CTS_ROW * iter] != Y) && (otab[CTS_ROW * iter] != Z)) break;
+      map[iter++] = -1;
+    } else if(onum < crep->ednum) {
+      if((crep->edge[pos].type != Y) && (crep->edge[pos].type != Z)) break;
+      *added = pos++;
+    } else break;
+  }
+  if((iter < onum) || (pos < crep->ednum)) XFREE(map);
+  return map;
+}
+
+/**
+ * \brief It frees a store, closing its file
+ *
+ * Stores being read can be freed before their end.
+ *
+ * \param st store
+ */
+void
+cts_free (cts_t* st)
+{
+  if(st != NULL) {
+#ifdef HAVE_ZLIB_H
+    if(st->deflated) inflateEnd(&st->zs);
+    XFREE(st->zbuf);
+#endif /* HAVE_ZLIB_H */
+    fclose(st->file);
+    XFREE(st->map);
+    XFREE(st->buf);
+    XFREE(st->prev);
+    XFREE(st);
+  }
+}
+
+/**
+ * \brief It sets the name of the store
+ *
+ * \param ifile input file (the store is "<ifile>.cts")
+ */
+void
+cts_open (const char* ifile)
+{
+  int length;
+  length = strlen(ifile);
+  store.name = XMALLOC(char, length + 4 + 1);
+  strcpy(store.name, ifile);
+  strcat(store.name, ".cts");
+}
+
+/**
+ * \brief It forgets the name of the store
+ */
+void
+cts_close ()
+{
+  XFREE(store.name);
+}
+
+/**
+ * \brief It starts writing the store
+ *
+ * \internal
+ * The store is written to "<file>.cts~" and renamed at the end, so that an
+ * incomplete store never replaces a complete one.
+ *
+ * \param crep circuit representation reference
+ */
+void
+cts_start (const circ_t* crep)
+{
+  unsigned char head[CTS_HEAD];
+  unsigned int val[6];
+  int row[CTS_ROW];
+  char* tmp;
+  FILE* file;
+  int iter;
+  int pos;
+  if(store.name == NULL) return;
+  tmp = XMALLOC(char, strlen(store.name) + 1 + 1);
+  strcpy(tmp, store.name);
+  strcat(tmp, "~");
+  file = fopen(tmp, "wb");
+  XFREE(tmp);
+  if(file == NULL) {
+    warning("Unable to write common trees store!");
+    return;
+  }
+  store.out = cts_new(file, crep->nnum - 1, crep->ednum);
+#ifdef HAVE_ZLIB_H
+  store.out->deflated = (deflateInit(&store.out->zs, Z_DEFAULT_COMPRESSION) == Z_OK);
+#endif /* HAVE_ZLIB_H */
+  val[0] = store.out->deflated ? CTS_DEFLATED : 0;
+  val[1] = crep->nnum - 1;
+  val[2] = crep->ednum;
+  val[3] = crep->efnum;
+  val[4] = (crep->yref != NULL) ? 1 + (crep->yref - crep->edge) : 0;
+  val[5] = (crep->gref != NULL) ? 1 + (crep->gref - crep->edge) : 0;
+  memcpy(head, CTS_MAGIC, strlen(CTS_MAGIC));
+  for(pos = 0; pos < 6; ++pos)
+    for(iter = 0; iter < 4; ++iter)
+      head[8 + 4 * pos + iter] = (val[pos] >> (8 * iter)) & 0xff;
+  if(fwrite(head, 1, CTS_HEAD, file) != CTS_HEAD) store.out->werr = 1;
+  // edges of the circuit, degrees as zigzag varints
+  for(pos = 0; pos < crep->ednum; ++pos) {
+    cs_row(crep, pos, row);
+    row[1] = (row[1] >= 0) ? (2 * row[1]) : (-2 * row[1] - 1);
+    for(iter = 0; iter < CTS_ROW; ++iter)
+      cs_varint(store.out, row[iter]);
+  }
+}
+
+/**
+ * \brief It starts a new block of trees
+ *
+ * \param block denominator (0) or numerator (1)
+ */
+void
+cts_block (const int block)
+{
+  if(store.out == NULL) return;
+  if(store.out->block >= 0) cs_varint(store.out, 0);
+  cs_put(store.out, (unsigned char) block);
+  store.out->block = block;
+  store.out->pcnt = 0;
+}
+
+/**
+ * \brief It puts a tree into the store
+ *
+ * \param nodes edges into the tree
+ * \param sign sign of the tree
+ */
+void
+cts_put (const node_t* nodes, const double sign)
+{
+  cts_t* st;
+  long long diff;
+  int prefix;
+  int iter;
+  if((st = store.out) == NULL) return;
+  prefix = 0;
+  if(st->pcnt)
+    while((prefix < st->size) && (st->prev[prefix] == nodes[prefix]))
+      ++prefix;
+  cs_varint(st, 1 + 4 * (unsigned long long) prefix + ((sign != 0) ? (sign < 0) : (2 + (signbit(sign) != 0))));
+  for(iter = prefix; iter < st->size; ++iter) {
+    diff = (long long) nodes[iter] - ((iter > 0) ? nodes[iter - 1] : 0);
+    cs_varint(st, (diff >= 0) ? (2 * diff) : (-2 * diff - 1));
+  }
+  memcpy(st->prev, nodes, st->size * sizeof(node_t));
+  st->pcnt = 1;
+}
+
+/**
+ * \brief It ends writing the store
+ *
+ * \param complete a positive value if all the trees have been found, zero
+ *   otherwise (the store is dropped then)
+ */
+void
+cts_end (const int complete)
+{
+  cts_t* st;
+  unsigned long long hash;
+  char* tmp;
+  int werr;
+  int iter;
+  if((st = store.out) == NULL) return;
+  if(st->block >= 0) cs_varint(st, 0);
+  cs_put(st, 0xff);
+  hash = st->hash;
+  for(iter = 0; iter < 8; ++iter)
+    cs_put(st, (hash >> (8 * iter)) & 0xff);
+  cs_flush(st, 1);
+#ifdef HAVE_ZLIB_H
+  if(st->deflated) deflateEnd(&st->zs);
+  st->deflated = 0;
+#endif /* HAVE_ZLIB_H */
+  werr = st->werr || fflush(st->file);
+  cts_free(st);
+  store.out = NULL;
+  tmp = XMALLOC(char, strlen(store.name) + 1 + 1);
+  strcpy(tmp, store.name);
+  strcat(tmp, "~");
+  if(werr || (!complete) || (rename(tmp, store.name) != 0)) {
+    if(werr) warning("Unable to write common trees store!");
+    remove(tmp);
+  }
+  XFREE(tmp);
+}
+
+/**
+ * \brief It opens the store to be read
+ *
+ * The store serves the actual circuit as well when a single component has
+ * been added or removed since it was written (see \e cts_added).
+ *
+ * \param crep circuit representation reference
+ * \return the store, NULL if it's missing or it doesn't match the circuit
+ */
+cts_t*
+cts_load (const circ_t* crep)
+{
+  unsigned char head[CTS_HEAD];
+  unsigned int val[6];
+  int* otab;
+  cts_t* st;
+  FILE* file;
+  int iter;
+  int pos;
+  if((store.name == NULL) || ((file = fopen(store.name, "rb")) == NULL)) {
+    warning("Unable to read common trees store");
+    return NULL;
+  }
+  if((fread(head, 1, CTS_HEAD, file) != CTS_HEAD) || memcmp(head, CTS_MAGIC, strlen(CTS_MAGIC))) {
+    fclose(file);
+    warning("Unable to read common trees store");
+    return NULL;
+  }
+  for(pos = 0; pos < 6; ++pos)
+    val[pos] = head[8 + 4 * pos] | (head[9 + 4 * pos] << 8) | (head[10 + 4 * pos] << 16) | ((unsigned int) head[11 + 4 * pos] << 24);
+  // a component more or less at most
+  if((val[1] != (unsigned int) (crep->nnum - 1)) || (val[3] != (unsigned int) crep->efnum) ||
+     (val[2] + 1 < (unsigned int) crep->ednum) || (val[2] > (unsigned int) crep->ednum + 1)) {
+    fclose(file);
+    warning("Common trees store doesn't match the circuit");
+    return NULL;
+  }
+#ifndef HAVE_ZLIB_H
+  if(val[0] & CTS_DEFLATED) {
+    fclose(file);
+    warning("Common trees store is deflated, zlib is needed");
+    return NULL;
+  }
+#endif /* HAVE_ZLIB_H */
+  st = cts_new(file, val[1], val[2]);
+#ifdef HAVE_ZLIB_H
+  if(val[0] & CTS_DEFLATED) {
+    if(inflateInit(&st->zs) != Z_OK) fatal("Error loading common trees!");
+    st->deflated = 1;
+  }
+#endif /* HAVE_ZLIB_H */
+  otab = XMALLOC(int, CTS_ROW * st->ednum + 1);
+  for(pos = 0; pos < st->ednum; ++pos)
+    for(iter = 0; iter < CTS_ROW; ++iter)
+      otab[CTS_ROW * pos + iter] = (int) cs_getvar(st);
+  for(pos = 0; pos < st->ednum; ++pos)
+    otab[CTS_ROW * pos + 1] = (otab[CTS_ROW * pos + 1] & 1) ? -(otab[CTS_ROW * pos + 1] >> 1) - 1 : (otab[CTS_ROW * pos + 1] >> 1);
+  st->map = cs_diff(crep, otab, st->ednum, &st->added);
+  XFREE(otab);
+  // additional block in the same place
+  if((st->map == NULL) ||
+     ((val[4] > 0) ? ((val[4] > (unsigned int) st->ednum) || (crep->yref == NULL) || (st->map[val[4] - 1] != crep->yref - crep->edge)) : (crep->yref != NULL)) ||
+     ((val[5] > 0) ? ((val[5] > (unsigned int) st->ednum) || (crep->gref == NULL) || (st->map[val[5] - 1] != crep->gref - crep->edge)) : (crep->gref != NULL))) {
+    cts_free(st);
+    warning("Common trees store doesn't match the circuit");
+    return NULL;
+  }
+  return st;
+}
+
+/**
+ * \brief Edge added to the circuit since the store was written
+ *
+ * Trees that contain it aren't into the store.
+ *
+ * \param st store
+ * \return the %edge, -1 if none
+ */
+int
+cts_added (const cts_t* st)
+{
+  return st->added;
+}
+
+/**
+ * \brief It reads the next tree of the store
+ *
+ * The store is read once, from the first tree to the last one, and its
+ * checksum is tested at the end. Trees are given on the edges of the actual
+ * circuit, those that contain a removed %edge are skipped.
+ *
+ * \param st store
+ * \param block denominator (0) or numerator (1)
+ * \param nodes edges into the tree
+ * \param sign sign of the tree
+ * \return a positive value if there is a tree, zero at the end of the store
+ */
+int
+cts_next (cts_t* st, int* block, node_t* nodes, double* sign)
+{
+  unsigned long long hash;
+  unsigned long long val;
+  unsigned long long sum;
+  long long edge;
+  int byte;
+  int iter;
+  int prefix;
+  int kind;
+  do {
+    while(1) {
+      if(st->block < 0) {
+	byte = cs_get(st);
+	if(byte == 0xff) {
+	  hash = st->hash;
+	  for(sum = 0, iter = 0; iter < 8; ++iter)
+	    sum |= ((unsigned long long) cs_get(st)) << (8 * iter);
+	  if(sum != hash) fatal("Error loading common trees!");
+#ifdef HAVE_ZLIB_H
+	  if(st->deflated) inflateEnd(&st->zs);
+	  st->deflated = 0;
+#endif /* HAVE_ZLIB_H */
+	  return 0;
+	}
+	if(byte > 1) fatal("Error loading common trees!");
+	st->block = byte;
+	st->pcnt = 0;
+      }
+      if((val = cs_getvar(st)) == 0) st->block = -1;
+      else break;
+    }
+    --val;
+    kind = val % 4;
+    prefix = (int) (val / 4);
+    if(((val / 4) > (unsigned long long) st->size) || ((prefix > 0) && (!st->pcnt)))
+      fatal("Error loading common trees!");
+    memcpy(nodes, st->prev, prefix * sizeof(node_t));
+    for(iter = prefix; iter < st->size; ++iter) {
+      val = cs_getvar(st);
+      edge = ((iter > 0) ? nodes[iter - 1] : 0) + ((val & 1) ? -(long long) (val >> 1) - 1 : (long long) (val >> 1));
+      if((edge < 0) || (edge >= st->ednum)) fatal("Error loading common trees!");
+      nodes[iter] = (node_t) edge;
+    }
+    memcpy(st->prev, nodes, st->size * sizeof(node_t));
+    st->pcnt = 1;
+    // edges of the actual circuit, trees with a removed edge dropped
+    for(iter = 0; (iter < st->size) && (st->map[nodes[iter]] >= 0); ++iter)
+      nodes[iter] = (node_t) st->map[nodes[iter]];
+  } while(iter < st->size);
+  *block = st->block;
+  *sign = (kind == 0) ? 1. : ((kind == 1) ? -1. : ((kind == 2) ? 0. : -0.));
+  return 1;
+}
@@ -0,0 +1,119 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file cts.h
+ *
+ * \brief Common trees store
+ *
+ * This file contains the prototypes of the functions that save the common
+ * trees found by grimbleby's finder into "<file>.cts" and read them back, so
+ * that the expressions can be evaluated again for new values of the
+ * components (or new symbolic flags) without a new enumeration.
+ * <br> A store begins with a header:
+ * - magic "SPCNGCT2" (8 bytes)
+ * - flags (4 bytes, see CTS_DEFLATED)
+ * - edges into a tree (4 bytes)
+ * - number of edges of the circuit (4 bytes)
+ * - number of forced edges (4 bytes)
+ * - yref and gref edges, plus one (4 bytes each, zero if missing)
+ *
+ * All the values are little-endian. The body follows, deflated when
+ * CTS_DEFLATED is set. It begins with the edges of the circuit, each one as
+ * varints: type, degree (zigzag) and the four nodes. Then the trees of each
+ * block (a byte, 0 for the denominator and 1 for the numerator), each one a
+ * varint, one plus four times the length of the prefix it shares with the
+ * previous tree of the block, plus one when the sign is negative, two when
+ * it's zero (edges don't make a tree into both the graphs) or three when it's
+ * a negative zero, then the other edges as zigzag varints, each one the
+ * difference from the previous edge; a zero varint ends the block. Blocks can
+ * be repeated. A 0xff byte and the checksum of the body (see \e fdt_hash)
+ * close the store.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef CTS_H
+#define CTS_H 1
+
+#include "common.h"
+#include "circuit.h"
+
+/**
+ * \brief Store magic
+ */
+#define CTS_MAGIC "SPCNGCT2"
+
+/**
+ * \brief Size of the header (bytes)
+ */
+#define CTS_HEAD 32
+
+/**
+ * \brief Body deflated by zlib (flag)
+ */
+#define CTS_DEFLATED 0x01
+
+/**
+ * \brief Store being written or read
+ */
+typedef
+struct cts
+cts_t;
+
+extern void
+cts_open (const char*);
+
+extern void
+cts_close ();
+
+extern void
+cts_start (const circ_t*);
+
+extern void
+cts_block (const int);
+
+extern void
+cts_put (const node_t*, const double);
+
+extern void
+cts_end (const int);
+
+extern cts_t*
+cts_load (const circ_t*);
+
+extern int
+cts_added (const cts_t*);
+
+extern int
+cts_next (cts_t*, int*, node_t*, double*);
+
+extern void
+cts_free (cts_t*);
+
+#endif /* CTS_H */
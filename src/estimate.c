@@ -0,0 +1,426 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file estimate.c
+ *
+ * \brief Search-tree size estimator
+ *
+ * Knuth's estimator: a random path is walked from the root of the search tree
+ * of the finder down to a leaf, choosing each time uniformly among the
+ * children of the actual node. The product of the number of children met
+ * along the path is an unbiased estimate of the number of nodes at that
+ * depth, so that the sum over the path of those products weighted by the
+ * work spent into the nodes estimates the total work. Many paths are averaged.
+ *
+ * Grimbleby's finder (and the k-best one, for which the estimate is an upper
+ * bound) is modeled by its state machine: each state costs one step and each
+ * node scans the edges that follow the last pushed one. Matroid and exchange
+ * finders are modeled by their binary decision tree, where each node costs a
+ * feasibility test. Since every leaf of the latter is a common tree, it is
+ * also used to estimate the number of common trees for all the finders:
+ * random paths into grimbleby's search tree seldom reach one. Time per step
+ * and time per found tree (the "burn") are measured while sampling.
+ *
+ * Cascade and tearing finders solve pieces of the circuit and the store one
+ * reads its trees back, so that none of these search trees is modeled and
+ * they can't be estimated.
+ */
+
+#include <math.h>
+#include <time.h>
+
+#include "common.h"
+#include "list.h"
+#include "circuit.h"
+#include "expr.h"
+#include "ctree.h"
+#include "matroid.h"
+#include "estimate.h"
+
+/**
+ * \brief Partial estimate
+ *
+ * Sums over the sampled paths of a search tree.
+ */
+struct epart
+{
+  double states;  /**< Steps */
+  double sqstates;  /**< Squares of the steps */
+  double trees;  /**< Common trees */
+  double sqtrees;  /**< Squares of the common trees */
+  double links;  /**< Edges pushed into (and popped out of) the tree */
+  double burn;  /**< Time spent to burn the common trees */
+  double executed;  /**< Steps actually executed while sampling */
+  double linked;  /**< Edges actually pushed while sampling */
+  double elapsed;  /**< Seconds spent while sampling, burns excluded */
+  double link;  /**< Seconds needed to push and pop an %edge */
+};
+
+/**
+ * \brief Estimator status
+ *
+ * Since the finders' driver has no room for further arguments, the status of
+ * the estimator is kept here.
+ */
+static struct
+{
+  int samples;  /**< Number of paths for each block */
+  unsigned long long seed;  /**< Pseudo-random generator status */
+  struct epart part[2];  /**< Estimates for each block (zero for the numerator) */
+} estat;
+
+/**
+ * \brief Pseudo-random numbers generator (xorshift64*)
+ *
+ * \internal
+ * A private generator, so that estimates are reproducible.
+ *
+ * \param bound upper bound (excluded)
+ * \return a pseudo-random number between zero and \a bound
+ */
+static int
+est_rand (const int bound)
+{
+  estat.seed ^= estat.seed >> 12;
+  estat.seed ^= estat.seed << 25;
+  estat.seed ^= estat.seed >> 27;
+  return (int) (((estat.seed * 0x2545f4914f6cdd1dULL) >> 33) % (unsigned long long) bound);
+}
+
+/**
+ * \brief Relative standard error of an estimate
+ *
+ * \internal
+ * \param sum sum of the per-path estimates
+ * \param sqsum sum of the squares of the per-path estimates
+ * \return standard error of the mean, as a percentage of the mean
+ */
+static double
+est_error (const double sum, const double sqsum)
+{
+  double mean;
+  double var;
+  if(sum == 0.) return 0.;
+  mean = sum / estat.samples;
+  var = sqsum / estat.samples - mean * mean;
+  return (var > 0.) ? 100. * sqrt(var / estat.samples) / mean : 0.;
+}
+
+/**
+ * \brief Measures the time needed to burn a common tree
+ *
+ * \internal
+ * Sampled trees are burnt into the same chain, so that the shrink-step works
+ * on a chain as long as the number of distinct terms met so far.
+ *
+ * \param crep circuit representation reference
+ * \param nodes edges into the tree
+ * \param ts incremental term status (exchange finder), NULL otherwise
+ * \param elist chain the tree is burnt into (to_expr)
+ * \param base number of edges always into the tree
+ * \return seconds spent
+ */
+static double
+est_burn (const circ_t* crep, node_t* nodes, tstate_t* ts, expr_t** elist, const int base)
+{
+  int* giimat;
+  int* gvimat;
+  int* mask;
+  int iter;
+  clock_t start;
+  giimat = XMALLOC(int, (crep->nnum * (crep->nnum - 1)));
+  gvimat = XMALLOC(int, (crep->nnum * (crep->nnum - 1)));
+  mask = XMALLOC(int, crep->ednum);
+  if(ts != NULL)
+    for(iter = base; iter < crep->nnum - 1; ++iter)
+      ts_push(ts, nodes[iter], 1);
+  start = clock();
+  if(ts != NULL) ts_burn(ts, nodes, 1.);
+  else *elist = to_expr(crep, nodes, mask, 1, giimat, gvimat, *elist);
+  start = clock() - start;
+  if(ts != NULL)
+    for(iter = base; iter < crep->nnum - 1; ++iter)
+      ts_pop(ts);
+  XFREE(mask);
+  XFREE(gvimat);
+  XFREE(giimat);
+  return (double) start / CLOCKS_PER_SEC;
+}
+
+/**
+ * \brief Samples grimbleby's search tree
+ *
+ * \internal
+ * Each node costs a TF and a BF state, plus a SF state and a LF state for
+ * each scanned %edge, plus the SF and EF states that close the scan. Pushing
+ * an %edge into the partial tree (and popping it out) takes linear time
+ * instead, so it is timed apart. Only steps are estimated.
+ *
+ * \param crep circuit representation reference
+ * \param ccgi circuit graph's common components
+ * \param ccgv voltage graph's common components
+ * \param nodes nodes into the tree
+ * \param part partial estimate to be filled
+ */
+static void
+est_grimbleby (const circ_t* crep, int* ccgi, int* ccgv, node_t* nodes, struct epart* part)
+{
+  int sample;
+  int base;
+  int cnt;
+  int pos;
+  int deg;
+  int steps;
+  int* cand;
+  double weight;
+  double sst;
+  clock_t start;
+  base = 1 + crep->efnum;
+  cand = XMALLOC(int, crep->ednum + 1);
+  // push and pop time, measured on the first available edge
+  for(pos = 0; (pos < crep->ednum) && (testloop(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node) ||
+					testloop(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node)); ++pos);
+  if(pos < crep->ednum) {
+    start = clock();
+    for(sample = 0; sample < estat.samples; ++sample) {
+      ctrlplus(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node, crep->nnum);
+      ctrlplus(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node, crep->nnum);
+      ctrlminus(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node, crep->nnum);
+      ctrlminus(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node, crep->nnum);
+    }
+    part->link = (double) (clock() - start) / CLOCKS_PER_SEC / estat.samples;
+  }
+  start = clock();
+  for(sample = 0; sample < estat.samples; ++sample) {
+    weight = 1.;
+    sst = 0.;
+    cnt = base;
+    pos = -1;
+    while(weight > 0.) {
+      steps = 2;
+      deg = 0;
+      for(++pos; (crep->nnum - 1) - cnt <= crep->ednum - pos; ++pos) {
+	steps += 2;
+	if((!testloop(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node)) &&
+	   (!testloop(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node)))
+	  cand[deg++] = pos;
+      }
+      steps += 2;
+      sst += weight * steps;
+      part->executed += steps;
+      part->links += weight * deg;
+      if(deg == 0) weight = 0.;
+      else {
+	pos = cand[est_rand(deg)];
+	weight *= deg;
+	part->linked += 1.;
+	nodes[cnt++] = pos;
+	ctrlplus(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node, crep->nnum);
+	ctrlplus(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node, crep->nnum);
+	if(cnt == crep->nnum - 1) {
+	  sst += weight * 2;
+	  weight = 0.;
+	}
+      }
+    }
+    while(cnt > base) {
+      pos = nodes[--cnt];
+      ctrlminus(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node, crep->nnum);
+      ctrlminus(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node, crep->nnum);
+    }
+    part->states += sst;
+    part->sqstates += sst * sst;
+  }
+  part->elapsed += (double) (clock() - start) / CLOCKS_PER_SEC - part->linked * part->link;
+  XFREE(cand);
+}
+
+/**
+ * \brief Samples the matroid (and exchange) decision tree
+ *
+ * \internal
+ * Each node costs the feasibility tests for both its branches; every leaf is a
+ * common tree, whose burn is timed.
+ *
+ * \param crep circuit representation reference
+ * \param ccgi circuit graph's common components
+ * \param ccgv voltage graph's common components
+ * \param nodes nodes into the tree
+ * \param part partial estimate to be filled
+ */
+static void
+est_matroid (const circ_t* crep, int* ccgi, int* ccgv, node_t* nodes, struct epart* part)
+{
+  int sample;
+  int base;
+  int cnt;
+  int pos;
+  int inc;
+  int exc;
+  double weight;
+  double sst;
+  double spent;
+  clock_t start;
+  clock_t bstart;
+  mstat_t* ms;
+  tstate_t* ts;
+  expr_t* elist;
+  base = 1 + crep->efnum;
+  elist = NULL;
+  ms = mstat_new(crep, ccgi, ccgv);
+  ts = (env.engine == EXCHANGE) ? ts_new(crep) : NULL;
+  spent = 0.;
+  start = clock();
+  if(ms_feasible(ms, 0, -1, (crep->nnum - 1) - base)) {
+    for(sample = 0; sample < estat.samples; ++sample) {
+      weight = 1.;
+      sst = 0.;
+      cnt = base;
+      pos = 0;
+      while((cnt < crep->nnum - 1) && (pos < ms->ncand)) {
+	sst += weight;
+	part->executed += 1.;
+	inc = ms_feasible(ms, pos + 1, ms->cand[pos], (crep->nnum - 1) - cnt - 1);
+	ms->dec[pos] = EXCLUDED;
+	exc = ms_feasible(ms, pos + 1, -1, (crep->nnum - 1) - cnt);
+	if(inc && exc) {
+	  weight *= 2;
+	  if(est_rand(2)) exc = 0;
+	}
+	if(!exc) {
+	  ms->dec[pos] = INCLUDED;
+	  nodes[cnt++] = ms->cand[pos];
+	}
+	++pos;
+      }
+      if(cnt == crep->nnum - 1) {
+	sst += weight;
+	part->trees += weight;
+	part->sqtrees += weight * weight;
+	bstart = clock();
+	part->burn += weight * est_burn(crep, nodes, ts, &elist, base);
+	spent += (double) (clock() - bstart) / CLOCKS_PER_SEC;
+      }
+      while(pos > 0)
+	ms->dec[--pos] = UNDECIDED;
+      part->states += sst;
+      part->sqstates += sst * sst;
+    }
+  }
+  part->elapsed += (double) (clock() - start) / CLOCKS_PER_SEC - spent;
+  free_expr(elist);
+  if(ts != NULL) ts_del(ts);
+  mstat_del(ms);
+}
+
+/**
+ * \brief Estimator entry point for the finders' driver
+ *
+ * \internal
+ * It has the same interface of the finders, so that \e ct_solve function sets
+ * up the blocks as it does for a true run; no chain is produced.
+ *
+ * \param crep circuit representation reference
+ * \param chain %list pointer (set to NULL)
+ * \param ccgi circuit graph's common components
+ * \param ccgv voltage graph's common components
+ * \param nodes nodes into the tree
+ * \result zero if some error occurs, a positive value otherwise
+ */
+static int
+ehelper (const circ_t* crep, list_t** chain, int* ccgi, int* ccgv, node_t* nodes)
+{
+  struct epart steps;
+  struct epart* part;
+  part = &(estat.part[&(crep->edge[nodes[crep->efnum]]) == crep->yref]);
+  *chain = NULL;
+  est_matroid(crep, ccgi, ccgv, nodes, part);
+  if((env.engine != MATROID) && (env.engine != EXCHANGE)) {
+    // grimbleby's steps replace the decision tree ones
+    steps = *part;
+    steps.states = steps.sqstates = steps.executed = steps.elapsed = 0.;
+    steps.links = steps.linked = steps.link = 0.;
+    est_grimbleby(crep, ccgi, ccgv, nodes, &steps);
+    *part = steps;
+  }
+  return 1;
+}
+
+/**
+ * \brief Search-tree size estimator
+ *
+ * It estimates the number of steps, the number of common trees and the time
+ * that the chosen finder would need, for both the numerator (gref) and the
+ * denominator (yref), and prints them together with the relative standard
+ * errors of the estimates. Only grimbleby, kbest, matroid and exchange
+ * finders are modeled.
+ *
+ * \param crep %circuit reference
+ * \param samples number of random paths for each block
+ * \param fref output stream
+ * \return zero if some error occurs, a positive value otherwise
+ */
+int
+circ_estimate (const circ_t* crep, const int samples, FILE* fref)
+{
+  static const char* label[] = { "Numerator", "Denominator" };
+  struct epart* part;
+  list_t* ychain;
+  list_t* gchain;
+  double seconds;
+  double total;
+  int block;
+  int ret;
+  if((env.engine != GRIMBLEBY) && (env.engine != KBEST) && (env.engine != MATROID) && (env.engine != EXCHANGE)) {
+    warning("Only grimbleby, kbest, matroid and exchange engines can be estimated");
+    return 0;
+  }
+  estat.samples = samples;
+  estat.seed = 0x9e3779b97f4a7c15ULL;
+  for(block = 0; block < 2; ++block) {
+    part = &(estat.part[block]);
+    part->states = part->sqstates = part->trees = part->sqtrees = 0.;
+    part->burn = part->executed = part->elapsed = 0.;
+    part->links = part->linked = part->link = 0.;
+  }
+  ret = ct_solve(crep, &ychain, &gchain, ehelper);
+  if(ret) {
+    total = 0.;
+    for(block = 0; block < 2; ++block) {
+      part = &(estat.part[block]);
+      seconds = (part->burn + part->links * part->link) / samples;
+      if(part->executed > 0.) seconds += part->states / samples * part->elapsed / part->executed;
+      total += seconds;
+      fprintf(fref, "%s: about %.3g steps (+/- %.0f%%), %.3g common trees (+/- %.0f%%), %.3g s\n", label[block],
+	      part->states / samples, est_error(part->states, part->sqstates),
+	      part->trees / samples, est_error(part->trees, part->sqtrees), seconds);
+    }
+    fprintf(fref, "Total: about %.3g s (%d samples per block)\n", total, samples);
+  }
+  return ret;
+}
@@ -0,0 +1,49 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file estimate.h
+ *
+ * \brief Search-tree size estimator function prototype
+ *
+ * This file contains the prototype of the function that estimates the work
+ * of the chosen common trees finder before to run it.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef ESTIMATE_H
+#define ESTIMATE_H 1
+
+#include "common.h"
+#include "circuit.h"
+
+extern int
+circ_estimate (const circ_t*, const int, FILE*);
+
+#endif /* ESTIMATE_H */
@@ -0,0 +1,648 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file eval.c
+ *
+ * \brief Compiled evaluator
+ *
+ * Numerator and denominator are turned into a flat program that gives the
+ * coefficients of the powers of s for the values of the symbols, and H(s) is
+ * then evaluated by Horner's rule. Terms are sorted by their symbols, so that
+ * a term shares the longest possible prefix with the previous one: products
+ * live on a stack, as deep as the longest term, and only the symbols beyond
+ * the shared prefix are multiplied in again. The same program can be written
+ * as a C source file, to be built into other tools.
+ * <br> Frequency sweeps evaluate H(jw) a block of frequencies at a time, with
+ * the parts of N and D kept apart (one array each), so that each step of
+ * Horner's rule is a plain loop over the block the compiler can vectorize.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "common.h"
+#include "circuit.h"
+#include "expr.h"
+#include "fdt.h"
+#include "eval.h"
+
+/**
+ * \brief Frequencies evaluated at a time (see \e eval_sweep)
+ */
+#define EVAL_BLOCK 256
+
+/**
+ * \brief Term to be compiled
+ */
+struct eterm
+{
+  const int* sym;  /**< Symbols, sorted */
+  size_t pos;  /**< First symbol into the pool */
+  int cnt;  /**< Number of symbols */
+  int g;  /**< Numerator (0) or denominator (1) */
+  int degree;  /**< Degree of the term */
+  double vpart;  /**< Numeric part of the term */
+};
+
+/**
+ * \brief Symbols met so far
+ */
+struct etable
+{
+  char** name;  /**< Symbols, as they have been met */
+  int cnt;  /**< Number of symbols */
+  int size;  /**< Allocated symbols */
+  int* slot;  /**< Hash table of the symbols (-1 if empty) */
+  int hsize;  /**< Size of the hash table (a power of two) */
+};
+
+/**
+ * \brief It gives the number of a symbol
+ *
+ * \internal
+ * Symbols are numbered as they're met, new ones are copied.
+ *
+ * \param et symbols met so far
+ * \param name symbol
+ * \return the number of the symbol
+ */
+static int
+et_find (struct etable* et, const char* name)
+{
+  unsigned long long hash;
+  int iter;
+  int pos;
+  if(2 * (et->cnt + 1) > et->hsize) {
+    XFREE(et->slot);
+    et->hsize = (et->hsize > 0) ? (2 * et->hsize) : 64;
+    et->slot = XMALLOC(int, et->hsize);
+    for(pos = 0; pos < et->hsize; ++pos)
+      et->slot[pos] = -1;
+    for(iter = 0; iter < et->cnt; ++iter) {
+      hash = fdt_hash(FDT_SEED, (const unsigned char*) et->name[iter], strlen(et->name[iter]));
+      for(pos = hash & (et->hsize - 1); et->slot[pos] >= 0; pos = (pos + 1) & (et->hsize - 1));
+      et->slot[pos] = iter;
+    }
+  }
+  hash = fdt_hash(FDT_SEED, (const unsigned char*) name, strlen(name));
+  for(pos = hash & (et->hsize - 1); et->slot[pos] >= 0; pos = (pos + 1) & (et->hsize - 1))
+    if(!strcmp(et->name[et->slot[pos]], name)) return et->slot[pos];
+  if(et->cnt == et->size) {
+    et->size = (et->size > 0) ? (2 * et->size) : 64;
+    et->name = XREALLOC(char*, et->name, et->size);
+  }
+  et->name[et->cnt] = xstrdup(name);
+  et->slot[pos] = et->cnt;
+  return et->cnt++;
+}
+
+/**
+ * \brief It compares two terms
+ *
+ * \internal
+ * Symbols one at a time (a prefix comes first), then numerator before
+ * denominator and increasing degree.
+ *
+ * \param a first term
+ * \param b second term
+ * \return less than, equal to or greater than zero, as strcmp does
+ */
+static int
+et_compare (const void* a, const void* b)
+{
+  const struct eterm* ta;
+  const struct eterm* tb;
+  int iter;
+  ta = (const struct eterm*) a;
+  tb = (const struct eterm*) b;
+  for(iter = 0; (iter < ta->cnt) && (iter < tb->cnt); ++iter)
+    if(ta->sym[iter] != tb->sym[iter]) return (ta->sym[iter] < tb->sym[iter]) ? -1 : 1;
+  if(ta->cnt != tb->cnt) return (ta->cnt < tb->cnt) ? -1 : 1;
+  if(ta->g != tb->g) return (ta->g < tb->g) ? -1 : 1;
+  if(ta->degree != tb->degree) return (ta->degree < tb->degree) ? -1 : 1;
+  return 0;
+}
+
+/**
+ * \brief It compares two symbols by name
+ *
+ * \internal
+ *
+ * \param a first symbol
+ * \param b second symbol
+ * \return less than, equal to or greater than zero, as strcmp does
+ */
+static int
+et_name (const void* a, const void* b)
+{
+  return strcmp(*((char* const*) a), *((char* const*) b));
+}
+
+/**
+ * \brief It puts a step into a program
+ *
+ * \internal
+ *
+ * \param ev program
+ * \param size allocated steps
+ * \param depth depth into the stack
+ * \param arg symbol or coefficient
+ * \param mul a positive value for a product step, zero for a sum step
+ * \param value numeric part of the term
+ */
+static void
+ev_step (eval_t* ev, int* size, const int depth, const int arg, const int mul, const double value)
+{
+  if(ev->scnt == *size) {
+    *size = (*size > 0) ? (2 * *size) : 1024;
+    ev->step = XREALLOC(struct estep, ev->step, *size);
+  }
+  ev->step[ev->scnt].depth = depth;
+  ev->step[ev->scnt].arg = arg;
+  ev->step[ev->scnt].mul = mul;
+  ev->step[ev->scnt].value = value;
+  ++ev->scnt;
+  if(depth > ev->depth) ev->depth = depth;
+}
+
+/**
+ * \brief It compiles numerator and denominator
+ *
+ * Both the cursors are consumed. Equal terms are summed, truncation markers
+ * don't matter.
+ *
+ * \param num cursor over the numerator
+ * \param den cursor over the denominator
+ * \return the program
+ */
+eval_t*
+eval_compile (struct ecursor* num, struct ecursor* den)
+{
+  struct ecursor* cur[2];
+  struct eterm* term;
+  struct etable et;
+  const struct eterm* prev;
+  const char* name;
+  eval_t* ev;
+  char** sorted;
+  int* pool;
+  int* rank;
+  size_t tcnt;
+  size_t tsize;
+  size_t pcnt;
+  size_t psize;
+  size_t iter;
+  int size;
+  int pos;
+  int tmp;
+  int lcp;
+  int g;
+  cur[0] = num;
+  cur[1] = den;
+  ev = XMALLOC(eval_t, 1);
+  ev->deg[0] = ev->deg[1] = -1;
+  et.name = NULL;
+  et.cnt = et.size = 0;
+  et.slot = NULL;
+  et.hsize = 0;
+  term = NULL;
+  tcnt = tsize = 0;
+  pool = NULL;
+  pcnt = psize = 0;
+  // terms read, symbols numbered as they come
+  for(g = 0; g < 2; ++g)
+    for(; !cur[g]->end; (*(cur[g]->next))(cur[g])) {
+      if(cur[g]->vpart == 0) continue;
+      if(tcnt == tsize) {
+	tsize = (tsize > 0) ? (2 * tsize) : 1024;
+	term = XREALLOC(struct eterm, term, tsize);
+      }
+      term[tcnt].pos = pcnt;
+      term[tcnt].cnt = 0;
+      term[tcnt].g = g;
+      term[tcnt].degree = cur[g]->degree;
+      term[tcnt].vpart = cur[g]->vpart;
+      while((name = (*(cur[g]->symbol))(cur[g])) != NULL) {
+	if(pcnt == psize) {
+	  psize = (psize > 0) ? (2 * psize) : 4096;
+	  pool = XREALLOC(int, pool, psize);
+	}
+	pool[pcnt++] = et_find(&et, name);
+	++term[tcnt].cnt;
+      }
+      if(cur[g]->degree > ev->deg[g]) ev->deg[g] = cur[g]->degree;
+      ++tcnt;
+    }
+  // symbols sorted by name, symbols of each term sorted as well
+  ev->ncnt = et.cnt;
+  ev->name = XMALLOC(char*, et.cnt + 1);
+  sorted = XMALLOC(char*, et.cnt + 1);
+  rank = XMALLOC(int, et.cnt + 1);
+  memcpy(sorted, et.name, et.cnt * sizeof(char*));
+  qsort(sorted, et.cnt, sizeof(char*), et_name);
+  for(pos = 0; pos < et.cnt; ++pos) {
+    ev->name[pos] = sorted[pos];
+    rank[et_find(&et, sorted[pos])] = pos;
+  }
+  for(iter = 0; iter < pcnt; ++iter)
+    pool[iter] = rank[pool[iter]];
+  for(iter = 0; iter < tcnt; ++iter) {
+    term[iter].sym = pool + term[iter].pos;
+    for(pos = 1; pos < term[iter].cnt; ++pos)
+      for(lcp = pos; (lcp > 0) && (pool[term[iter].pos + lcp - 1] > pool[term[iter].pos + lcp]); --lcp) {
+	tmp = pool[term[iter].pos + lcp];
+	pool[term[iter].pos + lcp] = pool[term[iter].pos + lcp - 1];
+	pool[term[iter].pos + lcp - 1] = tmp;
+      }
+  }
+  qsort(term, tcnt, sizeof(struct eterm), et_compare);
+  // coefficients of the numerator first
+  ev->base[0] = 0;
+  ev->base[1] = ev->deg[0] + 1;
+  ev->ccnt = ev->base[1] + ev->deg[1] + 1;
+  // steps, products shared along the prefixes
+  ev->step = NULL;
+  ev->scnt = 0;
+  ev->depth = 0;
+  size = 0;
+  prev = NULL;
+  for(iter = 0; iter < tcnt; prev = &term[iter++]) {
+    if((prev != NULL) && (!et_compare(prev, &term[iter]))) {
+      ev->step[ev->scnt - 1].value += term[iter].vpart;
+      continue;
+    }
+    for(lcp = 0; (prev != NULL) && (lcp < prev->cnt) && (lcp < term[iter].cnt) && (prev->sym[lcp] == term[iter].sym[lcp]); ++lcp);
+    for(pos = lcp; pos < term[iter].cnt; ++pos)
+      ev_step(ev, &size, pos + 1, term[iter].sym[pos], 1, 0.);
+    ev_step(ev, &size, term[iter].cnt, ev->base[term[iter].g] + term[iter].degree, 0, term[iter].vpart);
+  }
+  ev->stack = XMALLOC(double, ev->depth + 1);
+  ev->coef = XMALLOC(double, ev->ccnt + 1);
+  XFREE(rank);
+  XFREE(sorted);
+  XFREE(et.name);
+  XFREE(et.slot);
+  XFREE(pool);
+  XFREE(term);
+  return ev;
+}
+
+/**
+ * \brief It frees a program
+ *
+ * \param ev program
+ */
+void
+eval_del (eval_t* ev)
+{
+  int iter;
+  if(ev != NULL) {
+    for(iter = 0; iter < ev->ncnt; ++iter)
+      XFREE(ev->name[iter]);
+    XFREE(ev->name);
+    XFREE(ev->step);
+    XFREE(ev->stack);
+    XFREE(ev->coef);
+    XFREE(ev);
+  }
+}
+
+/**
+ * \brief It gives the position of a symbol
+ *
+ * \param ev program
+ * \param name symbol
+ * \return the position of the symbol among the values, -1 if it's missing
+ */
+int
+eval_symbol (const eval_t* ev, const char* name)
+{
+  int low;
+  int high;
+  int mid;
+  int ret;
+  low = 0;
+  high = ev->ncnt - 1;
+  while(low <= high) {
+    mid = (low + high) / 2;
+    if((ret = strcmp(ev->name[mid], name)) == 0) return mid;
+    if(ret < 0) low = mid + 1;
+    else high = mid - 1;
+  }
+  return -1;
+}
+
+/**
+ * \brief Values of the symbols given by the circuit
+ *
+ * Each symbol takes the value of the component it names (one, if there is no
+ * such component).
+ *
+ * \param ev program
+ * \param crep circuit representation reference
+ * \return newly allocated values
+ */
+double*
+eval_values (const eval_t* ev, const circ_t* crep)
+{
+  double* values;
+  int iter;
+  int pos;
+  values = XMALLOC(double, ev->ncnt + 1);
+  for(iter = 0; iter < ev->ncnt; ++iter) {
+    values[iter] = 1.;
+    for(pos = 0; pos < crep->ednum; ++pos)
+      if((crep->edge[pos].name != NULL) && (!strcmp(crep->edge[pos].name, ev->name[iter]))) {
+	values[iter] = crep->edge[pos].value;
+	break;
+      }
+  }
+  return values;
+}
+
+/**
+ * \brief It reads a set of values of the symbols
+ *
+ * A set is a line of "NAME=VALUE" pairs, separated by blanks; symbols that
+ * aren't in the line keep their values. Empty lines and lines that begin with
+ * '*' are skipped.
+ *
+ * \param ev program
+ * \param file input file
+ * \param values values of the symbols, updated
+ * \return zero at the end of the file, a positive value otherwise
+ */
+int
+eval_read (const eval_t* ev, FILE* file, double* values)
+{
+  char buf[4 * BUF_SIZE];
+  char msg[4 * BUF_SIZE];
+  double value;
+  char* tok;
+  char* end;
+  int ch;
+  int pos;
+  int len;
+  int first;
+  int skip;
+  int set;
+  set = skip = 0;
+  first = 1;
+  while(1) {
+    // a token at a time, a line is over at the first newline
+    len = 0;
+    while(((ch = getc(file)) == ' ') || (ch == '\t') || (ch == '\r'));
+    while((ch != EOF) && (ch != '\n') && (ch != ' ') && (ch != '\t') && (ch != '\r')) {
+      if(len < 4 * BUF_SIZE - 1) buf[len++] = ch;
+      ch = getc(file);
+    }
+    buf[len] = '\0';
+    if(len > 0) {
+      if(first && (buf[0] == '*')) skip = 1;
+      first = 0;
+      if(!skip) {
+	set = 1;
+	if(((tok = strchr(buf, '=')) == NULL) || (tok == buf)) warning("Wrong value of a symbol");
+	else {
+	  *tok++ = '\0';
+	  if((pos = eval_symbol(ev, buf)) < 0) {
+	    snprintf(msg, 4 * BUF_SIZE, "Unknown symbol: %s", buf);
+	    warning(msg);
+	  } else {
+	    value = strtod(tok, &end);
+	    if((end == tok) || (*end != '\0')) warning("Wrong value of a symbol");
+	    else values[pos] = value;
+	  }
+	}
+      }
+    }
+    if((ch == '\n') || (ch == EOF)) {
+      if(set || (ch == EOF)) return set;
+      skip = 0;
+      first = 1;
+    }
+  }
+}
+
+/**
+ * \brief It gives the coefficients for the values of the symbols
+ *
+ * Coefficients are left into the program (see %struct %eval).
+ *
+ * \param ev program
+ * \param values values of the symbols
+ */
+void
+eval_coeffs (eval_t* ev, const double* values)
+{
+  const struct estep* step;
+  const struct estep* end;
+  double* stack;
+  double* coef;
+  int iter;
+  stack = ev->stack;
+  coef = ev->coef;
+  for(iter = 0; iter < ev->ccnt; ++iter)
+    coef[iter] = 0.;
+  stack[0] = 1.;
+  for(step = ev->step, end = ev->step + ev->scnt; step < end; ++step)
+    if(step->mul) stack[step->depth] = stack[step->depth - 1] * values[step->arg];
+    else coef[step->arg] += step->value * stack[step->depth];
+}
+
+/**
+ * \brief It evaluates H(s) for the last coefficients
+ *
+ * Numerator and denominator by Horner's rule, then their ratio.
+ *
+ * \param ev program
+ * \param sre real part of s
+ * \param sim imaginary part of s
+ * \param hre real part of H(s)
+ * \param him imaginary part of H(s)
+ */
+void
+eval_horner (const eval_t* ev, const double sre, const double sim, double* hre, double* him)
+{
+  const double* coef;
+  double re[2];
+  double im[2];
+  double tmp;
+  double mod;
+  int iter;
+  int g;
+  for(g = 0; g < 2; ++g) {
+    re[g] = im[g] = 0.;
+    coef = ev->coef + ev->base[g];
+    for(iter = ev->deg[g]; iter >= 0; --iter) {
+      tmp = re[g] * sre - im[g] * sim + coef[iter];
+      im[g] = re[g] * sim + im[g] * sre;
+      re[g] = tmp;
+    }
+  }
+  mod = re[1] * re[1] + im[1] * im[1];
+  *hre = (re[0] * re[1] + im[0] * im[1]) / mod;
+  *him = (im[0] * re[1] - re[0] * im[1]) / mod;
+}
+
+/**
+ * \brief It evaluates H(s)
+ *
+ * \param ev program
+ * \param values values of the symbols
+ * \param sre real part of s
+ * \param sim imaginary part of s
+ * \param hre real part of H(s)
+ * \param him imaginary part of H(s)
+ */
+void
+eval_h (eval_t* ev, const double* values, const double sre, const double sim, double* hre, double* him)
+{
+  eval_coeffs(ev, values);
+  eval_horner(ev, sre, sim, hre, him);
+}
+
+/**
+ * \brief Horner's rule over a block of frequencies
+ *
+ * \internal
+ * Since s = jw, a step takes the real part to c - w * im and the imaginary
+ * part to w * re.
+ *
+ * \param coef coefficients
+ * \param degree degree of the polynomial (-1 if empty)
+ * \param omega angular frequencies
+ * \param cnt number of frequencies
+ * \param re real parts
+ * \param im imaginary parts
+ */
+static void
+ev_block (const double* coef, const int degree, const double* omega, const int cnt, double* re, double* im)
+{
+  double tmp;
+  double c;
+  int iter;
+  int pos;
+  for(pos = 0; pos < cnt; ++pos)
+    re[pos] = im[pos] = 0.;
+  for(iter = degree; iter >= 0; --iter) {
+    c = coef[iter];
+    for(pos = 0; pos < cnt; ++pos) {
+      tmp = c - omega[pos] * im[pos];
+      im[pos] = omega[pos] * re[pos];
+      re[pos] = tmp;
+    }
+  }
+}
+
+/**
+ * \brief It evaluates H(jw) over some frequencies
+ *
+ * The last coefficients are used (see \e eval_coeffs).
+ *
+ * \param ev program
+ * \param omega angular frequencies
+ * \param cnt number of frequencies
+ * \param mag magnitude of H(jw) (dB)
+ * \param phase phase of H(jw) (degrees)
+ */
+void
+eval_sweep (const eval_t* ev, const double* omega, const int cnt, double* mag, double* phase)
+{
+  double nre[EVAL_BLOCK];
+  double nim[EVAL_BLOCK];
+  double dre[EVAL_BLOCK];
+  double dim[EVAL_BLOCK];
+  int base;
+  int len;
+  int pos;
+  for(base = 0; base < cnt; base += EVAL_BLOCK) {
+    len = (cnt - base < EVAL_BLOCK) ? (cnt - base) : EVAL_BLOCK;
+    ev_block(ev->coef + ev->base[0], ev->deg[0], omega + base, len, nre, nim);
+    ev_block(ev->coef + ev->base[1], ev->deg[1], omega + base, len, dre, dim);
+    for(pos = 0; pos < len; ++pos) {
+      mag[base + pos] = 10. * log10((nre[pos] * nre[pos] + nim[pos] * nim[pos]) / (dre[pos] * dre[pos] + dim[pos] * dim[pos]));
+      phase[base + pos] = (180. / M_PI) * atan2(nim[pos] * dre[pos] - nre[pos] * dim[pos], nre[pos] * dre[pos] + nim[pos] * dim[pos]);
+    }
+  }
+}
+
+/**
+ * \brief It writes a program as a C source file
+ *
+ * The file defines \e sapecng_coeffs, \e sapecng_horner and \e sapecng_eval,
+ * which work as \e eval_coeffs, \e eval_horner and \e eval_h do, together
+ * with the names of the symbols and, if they're known, their values.
+ *
+ * \param ev program
+ * \param values values of the symbols (NULL if they're unknown)
+ * \param file output file
+ */
+void
+eval_write (const eval_t* ev, const double* values, FILE* file)
+{
+  const struct estep* step;
+  int iter;
+  fprintf(file, "/*\n * H(s) = N(s) / D(s), compiled by sapec-ng\n *\n");
+  fprintf(file, " * Values of the symbols are given in the order of sapecng_symbol, s by\n");
+  fprintf(file, " * its real and imaginary parts. Coefficients follow the powers of s,\n");
+  fprintf(file, " * those of the numerator first.\n */\n\n");
+  fprintf(file, "#define SAPECNG_SYMBOLS %d\n", ev->ncnt);
+  fprintf(file, "#define SAPECNG_COEFFS %d\n", ev->ccnt);
+  fprintf(file, "#define SAPECNG_NUM_DEGREE %d\n", ev->deg[0]);
+  fprintf(file, "#define SAPECNG_DEN %d\n", ev->base[1]);
+  fprintf(file, "#define SAPECNG_DEN_DEGREE %d\n\n", ev->deg[1]);
+  fprintf(file, "const char* const sapecng_symbol[SAPECNG_SYMBOLS + 1] = {\n");
+  for(iter = 0; iter < ev->ncnt; ++iter)
+    fprintf(file, "  \"%s\",\n", ev->name[iter]);
+  fprintf(file, "  0\n};\n\n");
+  if(values != NULL) {
+    fprintf(file, "const double sapecng_value[SAPECNG_SYMBOLS + 1] = {\n");
+    for(iter = 0; iter < ev->ncnt; ++iter)
+      fprintf(file, "  %.17g,\n", values[iter]);
+    fprintf(file, "  0.\n};\n\n");
+  }
+  fprintf(file, "void\nsapecng_coeffs (const double* v, double* c)\n{\n");
+  fprintf(file, "  double p[%d];\n  int i;\n", ev->depth + 1);
+  fprintf(file, "  for(i = 0; i < SAPECNG_COEFFS; ++i)\n    c[i] = 0.;\n  p[0] = 1.;\n");
+  for(step = ev->step; step < ev->step + ev->scnt; ++step)
+    if(step->mul) fprintf(file, "  p[%d] = p[%d] * v[%d];\n", step->depth, step->depth - 1, step->arg);
+    else fprintf(file, "  c[%d] += %.17g * p[%d];\n", step->arg, step->value, step->depth);
+  fprintf(file, "}\n\n");
+  fprintf(file, "void\nsapecng_horner (const double* c, const double sre, const double sim, double* hre, double* him)\n{\n");
+  fprintf(file, "  double nre, nim, dre, dim, tmp, mod;\n  int i;\n  nre = nim = dre = dim = 0.;\n");
+  fprintf(file, "  for(i = SAPECNG_NUM_DEGREE; i >= 0; --i) {\n");
+  fprintf(file, "    tmp = nre * sre - nim * sim + c[i];\n    nim = nre * sim + nim * sre;\n    nre = tmp;\n  }\n");
+  fprintf(file, "  for(i = SAPECNG_DEN_DEGREE; i >= 0; --i) {\n");
+  fprintf(file, "    tmp = dre * sre - dim * sim + c[SAPECNG_DEN + i];\n    dim = dre * sim + dim * sre;\n    dre = tmp;\n  }\n");
+  fprintf(file, "  mod = dre * dre + dim * dim;\n");
+  fprintf(file, "  *hre = (nre * dre + nim * dim) / mod;\n  *him = (nim * dre - nre * dim) / mod;\n}\n\n");
+  fprintf(file, "void\nsapecng_eval (const double* v, const double sre, const double sim, double* hre, double* him)\n{\n");
+  fprintf(file, "  double c[SAPECNG_COEFFS + 1];\n");
+  fprintf(file, "  sapecng_coeffs(v, c);\n  sapecng_horner(c, sre, sim, hre, him);\n}\n");
+}
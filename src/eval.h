@@ -0,0 +1,123 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file eval.h
+ *
+ * \brief Compiled evaluator
+ *
+ * This file contains the program numerator and denominator are compiled into,
+ * so that H(s) = N(s) / D(s) can be evaluated for many values of the symbols
+ * and of s without going through the terms again, together with the
+ * prototypes of the functions that compile it, run it and write it as a C
+ * source file.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef EVAL_H
+#define EVAL_H 1
+
+#include "common.h"
+#include "circuit.h"
+#include "expr.h"
+
+/**
+ * \brief Step of a compiled program
+ *
+ * A product step multiplies the product at the previous depth of the stack by
+ * a symbol and puts the result at its own depth, a sum step adds the numeric
+ * part of a term times the product at its depth to a coefficient.
+ */
+struct estep
+{
+  int depth;  /**< Depth into the stack */
+  int arg;  /**< Symbol (product step) or coefficient (sum step) */
+  int mul;  /**< A positive value for a product step, zero for a sum step */
+  double value;  /**< Numeric part of the term (sum step) */
+};
+
+/**
+ * \brief Compiled numerator and denominator
+ *
+ * Symbols are sorted by name and their values are given in that order. Terms
+ * are sorted by their symbols, so that the products they share are computed
+ * once; coefficients follow the powers of s, those of the numerator first.
+ */
+struct eval
+{
+  char** name;  /**< Symbols */
+  int ncnt;  /**< Number of symbols */
+  int deg[2];  /**< Degree of numerator (0) and denominator (1), -1 if empty */
+  int base[2];  /**< First coefficient of numerator (0) and denominator (1) */
+  int ccnt;  /**< Number of coefficients */
+  struct estep* step;  /**< Program */
+  int scnt;  /**< Number of steps */
+  int depth;  /**< Depth of the stack */
+  double* stack;  /**< Products (private) */
+  double* coef;  /**< Coefficients of the last evaluation */
+};
+
+/**
+ * \brief Simpler %struct %eval definition
+ */
+typedef
+struct eval
+eval_t;
+
+extern eval_t*
+eval_compile (struct ecursor*, struct ecursor*);
+
+extern void
+eval_del (eval_t*);
+
+extern int
+eval_symbol (const eval_t*, const char*);
+
+extern double*
+eval_values (const eval_t*, const circ_t*);
+
+extern int
+eval_read (const eval_t*, FILE*, double*);
+
+extern void
+eval_coeffs (eval_t*, const double*);
+
+extern void
+eval_horner (const eval_t*, const double, const double, double*, double*);
+
+extern void
+eval_h (eval_t*, const double*, const double, const double, double*, double*);
+
+extern void
+eval_sweep (const eval_t*, const double*, const int, double*, double*);
+
+extern void
+eval_write (const eval_t*, const double*, FILE*);
+
+#endif /* EVAL_H */
@@ -0,0 +1,214 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file exchange.c
+ *
+ * \brief Exchange-order common trees finder
+ *
+ * This finder walks the same decision tree as the matroid one, but branches
+ * are visited in revolving-door order: the exclusion branch first and the
+ * inclusion branch then, in reverse order, and so on recursively. Were all
+ * the subsets of candidates feasible, consecutive trees would differ for a
+ * single swap (an %edge out, another one in). Common trees are the common
+ * bases of two matroids, that have no such an order in general, but skipped
+ * branches only merge few swaps together.
+ *
+ * Terms aren't rebuilt from scratch for each tree: decisions are pushed into
+ * and popped out of an incremental term status, so that moving from a tree to
+ * the next one costs only the decisions that differ, and the sign takes linear
+ * time.
+ */
+
+#include "common.h"
+#include "list.h"
+#include "circuit.h"
+#include "expr.h"
+#include "ctree.h"
+#include "matroid.h"
+
+/**
+ * \brief Branches are visited in natural order (exclusion first)
+ */
+#define FORWARD 0
+
+/**
+ * \brief Branches are visited in reverse order (inclusion first)
+ */
+#define REVERSE 1
+
+/**
+ * \brief This function is used by \e exchange function to complete its work
+ *
+ * \internal
+ * Candidates are decided in reverse order, so that undecided ones are always
+ * the trailing ones for the feasibility test. Each level stores its visit
+ * direction and the number of branches already tried.
+ *
+ * \param crep circuit representation reference
+ * \param chain %list pointer wiht the newly allocated stacks as payload
+ * \param ccgi circuit graph's common components
+ * \param ccgv voltage graph's common components
+ * \param nodes nodes into the tree
+ * \result zero if some error occurs, a positive value otherwise
+ */
+static int
+xhelper (const circ_t* crep, list_t** chain, int* ccgi, int* ccgv, node_t* nodes)
+{
+  int ret;
+  int pos;
+  int cnt;
+  int base;
+  int iter;
+  int swap;
+  int* dir;
+  int* stage;
+  double* vrest;
+  char* cand;
+  mstat_t* ms;
+  tstate_t* ts;
+  enum {
+    TF,  // Test Flag
+    NF,  // Next branch Flag
+    IF,  // Include Flag
+    XF,  // eXclude Flag
+    BF,  // BackTrack Flag
+    OF  // Out Flag
+  } flag;
+  ret = 1;
+  ms = mstat_new(crep, ccgi, ccgv);
+  ts = ts_new(crep);
+  for(iter = 0; iter < ms->ncand / 2; ++iter) {
+    swap = ms->cand[iter];
+    ms->cand[iter] = ms->cand[ms->ncand - 1 - iter];
+    ms->cand[ms->ncand - 1 - iter] = swap;
+  }
+  // numerical factor of the trailing candidates (and of the loops) out of the tree
+  cand = XMALLOC(char, crep->ednum);
+  for(iter = 0; iter < crep->ednum; ++iter)
+    cand[iter] = 0;
+  for(iter = 0; iter < ms->ncand; ++iter)
+    cand[ms->cand[iter]] = 1;
+  vrest = XMALLOC(double, ms->ncand + 1);
+  vrest[ms->ncand] = 1.;
+  for(iter = 0; iter < crep->ednum; ++iter)
+    if(!cand[iter]) vrest[ms->ncand] *= ts_factor(crep, iter, 0);
+  for(iter = ms->ncand - 1; iter >= 0; --iter)
+    vrest[iter] = vrest[iter + 1] * ts_factor(crep, ms->cand[iter], 0);
+  XFREE(cand);
+  dir = XMALLOC(int, ms->ncand + 1);
+  stage = XMALLOC(int, ms->ncand + 1);
+  // Tree-on-graph size (# of nodes - 1)
+  base = cnt = 1 + crep->efnum;
+  pos = 0;
+  dir[0] = FORWARD;
+  flag = ms_feasible(ms, 0, -1, (crep->nnum - 1) - cnt) ? TF : OF;
+  while((ret)&&(flag != OF)) {
+    switch(flag) {
+    case TF:
+      if(cnt == (crep->nnum - 1)) {
+	VERBOSE(".");
+	// "burn"
+	ts_burn(ts, nodes, vrest[pos]);
+	// ! "burn"
+	flag = BF;
+      } else if(pos == ms->ncand) ret = 0;
+      else {
+	stage[pos] = 0;
+	flag = NF;
+      }
+      break;
+    case NF:
+      if(stage[pos] == 2) flag = BF;
+      else {
+	flag = ((dir[pos] == FORWARD) == (stage[pos] == 0)) ? XF : IF;
+	++stage[pos];
+      }
+      break;
+    case IF:
+      if(ms_feasible(ms, pos + 1, ms->cand[pos], (crep->nnum - 1) - cnt - 1)) {
+	ms->dec[pos] = INCLUDED;
+	ts_push(ts, ms->cand[pos], 1);
+	nodes[cnt++] = ms->cand[pos];
+	dir[pos + 1] = (dir[pos] == FORWARD) ? REVERSE : FORWARD;
+	++pos;
+	flag = TF;
+      } else flag = NF;
+      break;
+    case XF:
+      ms->dec[pos] = EXCLUDED;
+      if(ms_feasible(ms, pos + 1, -1, (crep->nnum - 1) - cnt)) {
+	ts_push(ts, ms->cand[pos], 0);
+	dir[pos + 1] = dir[pos];
+	++pos;
+	flag = TF;
+      } else {
+	ms->dec[pos] = UNDECIDED;
+	flag = NF;
+      }
+      break;
+    case BF:
+      // back to the previous level, whose branches could be still to be tried
+      if(--pos < 0) flag = OF;
+      else {
+	ts_pop(ts);
+	if(ms->dec[pos] == INCLUDED) --cnt;
+	ms->dec[pos] = UNDECIDED;
+	flag = NF;
+      }
+      break;
+    case OF:
+      break;
+    }
+  }
+  if(cnt < base) ret = 0;
+  *chain = (list_t*) ts_chain(ts, NULL);
+  XFREE(stage);
+  XFREE(dir);
+  XFREE(vrest);
+  ts_del(ts);
+  mstat_del(ms);
+  return ret;
+}
+
+/**
+ * \brief Circuit-to-expression conversion function using the exchange finder
+ *
+ * \internal
+ * Exchange-order finder entry point: it drives \e xhelper function, which
+ * really solves common trees problem, by means of \e ct_solve.
+ *
+ * \param crep %circuit reference
+ * \param yrefchain pointer to be used to store the first %list
+ * \param grefchain pointer to be used to store the second %list
+ * \result zero if some error occurs, a positive value otherwise
+ */
+int
+exchange (const circ_t* crep, list_t** yrefchain, list_t** grefchain)
+{
+  return ct_solve(crep, yrefchain, grefchain, xhelper);
+}
@@ -35,10 +35,20 @@
  * in a correct manner.
  */
 
+#include <math.h>
+#include <limits.h>
+
 #include "common.h"
 #include "expr.h"
 #include "list.h"
 #include "circuit.h"
+#include "ctree.h"
+#include "checkpoint.h"
+#include "symmetry.h"
+#include "nest.h"
+#include "spill.h"
+#include "cts.h"
+#include "subckt.h"
 
 /**
  * \brief It splashes separator
@@ -57,83 +67,298 @@ sep (const int cnt, FILE* fref)
   fprintf(fref, "\n");
 }
 
+/**
+ * \brief It loads the current term of a %list cursor
+ *
+ * \internal
+ *
+ * \param cur cursor
+ */
+static void
+expr_load (struct ecursor* cur)
+{
+  const expr_t* elist;
+  elist = (const expr_t*) cur->src;
+  cur->end = (elist == NULL);
+  if(elist != NULL) {
+    cur->vpart = elist->vpart;
+    cur->etoken = list_length(elist->epart);
+    cur->degree = elist->degree;
+    cur->trunc = elist->trunc;
+    cur->hook = elist->epart;
+  }
+}
+
+/**
+ * \brief It moves a %list cursor to the next term
+ *
+ * \internal
+ *
+ * \param cur cursor
+ * \return a positive value if there is a term, zero otherwise
+ */
+static int
+expr_next (struct ecursor* cur)
+{
+  if(cur->src != NULL) {
+    cur->src = ((const expr_t*) cur->src)->next;
+    expr_load(cur);
+  }
+  return !cur->end;
+}
+
+/**
+ * \brief It gives the next symbol of a %list cursor
+ *
+ * \internal
+ *
+ * \param cur cursor
+ * \return the symbol, NULL if there is none
+ */
+static const char*
+expr_symbol (struct ecursor* cur)
+{
+  const list_t* hook;
+  hook = (const list_t*) cur->hook;
+  if(hook == NULL) return NULL;
+  cur->hook = list_next(hook);
+  return list_data(char, hook);
+}
+
+/**
+ * \brief It sets a cursor over a %list of expressions
+ *
+ * \param cur cursor to be set (on the first term)
+ * \param elist %list of expressions
+ */
+void
+expr_cursor (struct ecursor* cur, const expr_t* elist)
+{
+  cur->next = expr_next;
+  cur->symbol = expr_symbol;
+  cur->src = elist;
+  cur->hook = NULL;
+  expr_load(cur);
+}
+
+/**
+ * \brief Output text buffer
+ *
+ * Text goes to a file a large chunk at a time, or it is kept in memory (or
+ * only counted, when there is no buffer at all).
+ */
+struct sbuf
+{
+  char* data;  /**< Buffered text (NULL means length only) */
+  size_t cnt;  /**< Number of buffered characters */
+  size_t size;  /**< Allocated characters */
+  FILE* file;  /**< Destination file (NULL means in memory) */
+  int length;  /**< Length of the whole text */
+};
+
+/**
+ * \brief It puts text into an output buffer
+ *
+ * \internal
+ *
+ * \param sb output buffer
+ * \param str text
+ * \param cnt length of the text
+ */
+static void
+sb_put (struct sbuf* sb, const char* str, const size_t cnt)
+{
+  sb->length += cnt;
+  if(sb->data != NULL) {
+    if((sb->file != NULL) && (sb->cnt + cnt > sb->size)) {
+      fwrite(sb->data, 1, sb->cnt, sb->file);
+      sb->cnt = 0;
+    }
+    if(sb->cnt + cnt > sb->size) {
+      sb->size = 2 * sb->size + cnt;
+      sb->data = XREALLOC(char, sb->data, sb->size);
+    }
+    memcpy(sb->data + sb->cnt, str, cnt);
+    sb->cnt += cnt;
+  }
+}
+
+/**
+ * \brief It puts a numeric part into an output buffer
+ *
+ * \internal
+ * Small integers (the most common values) are formatted at once, the other
+ * values as "%.3g" does.
+ *
+ * \param sb output buffer
+ * \param val value (non-negative)
+ */
+static void
+sb_value (struct sbuf* sb, const double val)
+{
+  char buf[BUF_SIZE];
+  int num;
+  int dtmp;
+  if((val >= 1) && (val < 1000) && ((double) (num = (int) val) == val)) {
+    dtmp = BUF_SIZE;
+    do {
+      buf[--dtmp] = '0' + (num % 10);
+      num /= 10;
+    } while(num > 0);
+    buf[--dtmp] = ' ';
+    sb_put(sb, buf + dtmp, BUF_SIZE - dtmp);
+  } else {
+    if((dtmp = snprintf(buf, BUF_SIZE, " %.3g", val)) < 0)
+      fatal("unable to manage vpart value");
+    sb_put(sb, buf, dtmp);
+  }
+}
+
 /**
  * \brief It splashes a single degree-group
  *
  * This is an helpful function used to splash one degree-group at a time.
- * \param elist %list of expressions
- * \param fref output file
- * \param mode modality of use (length only or length plus splash)
- * \param buf pre-allocated buffer
- * \return the length of the splashed expression
+ * \param cur cursor over the expression
+ * \param sb output buffer
  */
-static int
-splash_group (expr_t** elist, FILE* fref, const int mode, char* buf)
+static void
+splash_group (struct ecursor* cur, struct sbuf* sb)
 {
-  expr_t* iter;
-  list_t* ehook;
+  const char* name;
   int degree;
-  int dtmp;
-  int length;
   int zero;
+  int trunc;
   double unl;
   double acc;
-  length = 0;
   acc = 0;
   zero = 1;
-  iter = *elist;
-  degree = iter->degree;
-  while((iter != NULL) && (iter->degree == degree)) {
-    if(iter->vpart != 0) {
+  trunc = 0;
+  degree = cur->degree;
+  while((!cur->end) && (cur->degree == degree)) {
+    if(cur->trunc) trunc = 1;
+    if(cur->vpart != 0) {
       zero = 0;
-      if(iter->epart == NULL) {
-	acc += iter->vpart;
+      if(cur->etoken == 0) {
+	acc += cur->vpart;
       } else {
-	if(iter->vpart > 0) {
-	  if(mode) fprintf(fref, " +");
-	  else length += 2;
-	} else {
-	  if(mode) fprintf(fref, " -");
-	  else length += 2;
-	}
-	if((iter->vpart != 1) && (iter->vpart != -1)) {
-	  unl = iter->vpart;
+	sb_put(sb, (cur->vpart > 0) ? " +" : " -", 2);
+	if((cur->vpart != 1) && (cur->vpart != -1)) {
+	  unl = cur->vpart;
 	  if(unl < 0) unl *= -1;
-	  if(mode) fprintf(fref, " %.3g", unl);
-	  else {
-	    if((dtmp = snprintf(buf, BUF_SIZE, " %.3g", unl)) == -1)
-	      fatal("unable to manage vpart value");
-	    else length += dtmp;
-	  }
+	  sb_value(sb, unl);
 	}
-	ehook = iter->epart;
-	while(ehook != NULL) {
-	  if(mode) fprintf(fref, " %s", list_data(char, ehook));
-	  else length += strlen(list_data(char, ehook)) + 1;
-	  ehook = list_next(ehook);
+	while((name = (*(cur->symbol))(cur)) != NULL) {
+	  sb_put(sb, " ", 1);
+	  sb_put(sb, name, strlen(name));
 	}
       }
     }
-    iter = list_next_entry(expr_t, iter);
+    (*(cur->next))(cur);
   }
-  *elist = iter;
   if((acc != 0) || (zero)) {
     if(acc < 0) {
-      if(mode) fprintf(fref, " -");
-      else length += 2;
+      sb_put(sb, " -", 2);
       acc *= -1;
-    } else {
-      if(mode) fprintf(fref, " +");
-      else length += 2;
-    }
-    if(mode) fprintf(fref, " %.3g", acc);
-    else {
-      if((dtmp = snprintf(buf, BUF_SIZE, " %.3g", acc)) == -1)
-	fatal("unable to manage vpart value");
-      else length += dtmp;
+    } else sb_put(sb, " +", 2);
+    sb_value(sb, acc);
+  }
+  if(trunc) {
+    // truncation marker (some terms are missing)
+    sb_put(sb, " ...", 4);
+  }
+}
+
+/**
+ * \brief It splashes an expression into an output buffer
+ *
+ * \internal
+ *
+ * \param cur cursor over the expression
+ * \param sb output buffer
+ */
+static void
+splash_text (struct ecursor* cur, struct sbuf* sb)
+{
+  char buf[BUF_SIZE];
+  int degree;
+  int dtmp;
+  degree = -1;
+  if(!cur->end) {
+    while(!cur->end) {
+      if(degree != -1) sb_put(sb, " + (", 4);
+      else sb_put(sb, " (", 2);
+      degree = cur->degree;
+      splash_group(cur, sb);
+      sb_put(sb, " )", 2);
+      if(degree != 0) {
+	sb_put(sb, " s", 2);
+	if(degree > 1) {
+	  if((dtmp = snprintf(buf, BUF_SIZE, "^%d", degree)) < 0)
+	    fatal("unable to manage degree value");
+	  sb_put(sb, buf, dtmp);
+	}
+      }
     }
+  } else sb_put(sb, " NULL", 5);
+  sb_put(sb, "\n", 1);
+}
+
+/**
+ * \brief It splashes an expression given by means of a cursor.
+ *
+ * This function works as \e splash does, but terms can come from any source
+ * (see %struct %ecursor); the cursor is consumed.
+ *
+ * \param cur cursor over the expression
+ * \param fref output file
+ * \param mode modality of use (length only or length plus splash)
+ * \return the length of the splashed expression
+ */
+int
+splash_cursor (struct ecursor* cur, FILE* fref, const int mode)
+{
+  struct sbuf sb;
+  sb.cnt = 0;
+  sb.size = mode ? SPLASH_BUF : 0;
+  sb.data = mode ? XMALLOC(char, sb.size) : NULL;
+  sb.file = fref;
+  sb.length = 0;
+  splash_text(cur, &sb);
+  if(sb.cnt > 0) fwrite(sb.data, 1, sb.cnt, fref);
+  XFREE(sb.data);
+  return sb.length;
+}
+
+/**
+ * \brief It splashes numerator and denominator
+ *
+ * Both the expressions are formatted once: the numerator is written a large
+ * chunk at a time, while the denominator is kept in memory until the
+ * separator, as long as the longer of them, has been written.
+ *
+ * \param num cursor over the numerator
+ * \param den cursor over the denominator
+ * \param fref output file
+ */
+void
+splash_pair (struct ecursor* num, struct ecursor* den, FILE* fref)
+{
+  struct sbuf sb[2];
+  int g;
+  for(g = 0; g < 2; ++g) {
+    sb[g].cnt = 0;
+    sb[g].size = SPLASH_BUF;
+    sb[g].data = XMALLOC(char, sb[g].size);
+    sb[g].file = g ? NULL : fref;
+    sb[g].length = 0;
   }
-  return length;
+  splash_text(num, &(sb[0]));
+  fwrite(sb[0].data, 1, sb[0].cnt, fref);
+  splash_text(den, &(sb[1]));
+  sep(((sb[1].length > sb[0].length) ? sb[1].length : sb[0].length), fref);
+  fwrite(sb[1].data, 1, sb[1].cnt, fref);
+  for(g = 0; g < 2; ++g)
+    XFREE(sb[g].data);
 }
 
 /**
@@ -153,48 +378,9 @@ splash_group (expr_t** elist, FILE* fref, const int mode, char* buf)
 int
 splash (expr_t* elist, FILE* fref, const int mode)
 {
-  int degree;
-  int length;
-  int dtmp;
-  char* buf;
-  length = 0;
-  degree = -1;
-  if(!mode) buf = XMALLOC(char, BUF_SIZE);
-  else buf = 0;
-  if(elist != NULL) {
-    while(elist != NULL) {
-      if(degree != -1) {
-	if(mode) fprintf(fref, " + (");
-	else length += 4;
-      } else {
-	if(mode) fprintf(fref, " (");
-	else length += 2;
-      }
-      degree = elist->degree;
-      length += splash_group(&elist, fref, mode, buf);
-      if(mode) fprintf(fref, " )");
-      else length += 2;
-      if(degree != 0) {
-	if(mode) fprintf(fref, " s");
-	else length += 2;
-	if(degree > 1) {
-	  if(mode) fprintf(fref, "^%d", degree);
-	  else {
-	    if((dtmp = snprintf(buf, BUF_SIZE, " %d", degree)) == -1)
-	      fatal("unable to manage degree value");
-	    else length += dtmp;
-	  }
-	}
-      }
-    }
-  } else {
-    if(mode) fprintf(fref, " NULL");
-    else length += 5;
-  }
-  ++length;
-  if(mode) fprintf(fref, "\n");
-  XFREE(buf);
-  return length;
+  struct ecursor cur;
+  expr_cursor(&cur, elist);
+  return splash_cursor(&cur, fref, mode);
 }
 
 /**
@@ -260,6 +446,9 @@ expr_t*
 expr_from_file (FILE* file)
 {
   expr_t* elist;
+  expr_t* eslice;
+  expr_t** eiter;
+  list_t** hook;
   size_t ll;
   size_t dim;
   char* tbuf;
@@ -271,22 +460,27 @@ expr_from_file (FILE* file)
   size_t pos;
   rerr = 0;
   elist = NULL;
+  eiter = &elist;
   if(file != NULL) {
     // get token count
     if(fread(&ll, sizeof(ll), 1, file) != 1)
       rerr = (rerr == 0) ? 1 : rerr;
     while((!rerr) && (ll > 0)) {
-      elist = (expr_t*) list_add((list_t*) expr_new(), (list_t*) elist);
+      // same order as on file
+      eslice = expr_new();
+      *eiter = eslice;
+      eiter = &(eslice->next);
+      hook = &(eslice->epart);
       // get degree
-      if(fread(&(elist->degree), sizeof(elist->degree), 1, file) != 1)
+      if(fread(&(eslice->degree), sizeof(eslice->degree), 1, file) != 1)
 	rerr = (rerr == 0) ? 1 : rerr;
       // get vpart
-      if(fread(&(elist->vpart), sizeof(elist->vpart), 1, file) != 1)
+      if(fread(&(eslice->vpart), sizeof(eslice->vpart), 1, file) != 1)
 	rerr = (rerr == 0) ? 1 : rerr;
       // get etoken
-      if(fread(&(elist->etoken), sizeof(elist->etoken), 1, file) != 1)
+      if(fread(&(eslice->etoken), sizeof(eslice->etoken), 1, file) != 1)
 	rerr = (rerr == 0) ? 1 : rerr;
-      iter = elist->etoken;
+      iter = eslice->etoken;
       while((!rerr) && (iter > 0)) {
 	// get epart
 	tbuf = NULL;
@@ -331,7 +525,8 @@ expr_from_file (FILE* file)
 	}
 	 XFREE(bbuf);
 	// ins epart
-	elist->epart = list_add(list_new((void*) tbuf), elist->epart);
+	*hook = list_new((void*) tbuf);
+	hook = &((*hook)->next);
 	--iter;
       }
       --ll;
@@ -361,6 +556,7 @@ expr_new ()
   eslice->vpart = 1;
   eslice->etoken = 0;
   eslice->degree = 0;
+  eslice->trunc = 0;
   eslice->epart = NULL;
   return eslice;
 }
@@ -392,258 +588,454 @@ free_expr (expr_t* elist)
 }
 
 /**
- * \brief Gaussian elimination algorithm
+ * \brief Degree range test
  *
  * \internal
- * This is a support function used to reduce incident matrices. It is based on
- * the Gauss elimination algorithm that permits to write a given <i>m*n</i>
- * matrix M as a <i>n*n</i> diagonal matrix D. This function is an ad-hoc
- * function, that means it is designed to be more efficient (of course, it is
- * also less generic), like a specific per-problem function.
- *
- * \param matrix matrix to be reduced.
- * \param row number of rows (number of nodes into the tree)
- * \param col number of columns (number of edges of the tree, that is the number
- *     of nodes minus one)
- * \return determinant of the matrix
+ *
+ * \return a positive value if a degree range has been asked for, zero
+ *   otherwise
  */
 static int
-to_diagonal_matrix (int* matrix, const int row, const int col)
+dranged ()
+{
+  return (env.degmin > 0) || (env.degmax < INT_MAX);
+}
+
+/**
+ * \brief Contribution of an %edge to the degree
+ *
+ * \internal
+ * Z edges contribute to the degree of a term when they're out of the tree and
+ * Y edges when they're into the tree, so that pushing an %edge into the tree
+ * adds its degree (Y edges) or takes it away (Z edges).
+ *
+ * \param eptr %edge reference
+ * \result contribution of the %edge
+ */
+static int
+dweight (const edge_t* eptr)
+{
+  if(eptr->type == Y) return eptr->degree;
+  else if(eptr->type == Z) return -eptr->degree;
+  else return 0;
+}
+
+/**
+ * \brief Degree bounds table maker
+ *
+ * \internal
+ * For each position, it counts the edges that follow it (itself included), by
+ * contribution: row \e pos of the table has 2 * \e top + 1 entries, the first
+ * one for contribution -top.
+ *
+ * \param crep circuit representation reference
+ * \param top highest contribution (absolute value)
+ * \result newly allocated table
+ */
+static int*
+dtable (const circ_t* crep, int* top)
 {
-  int det;
+  int* dtab;
   int iter;
-  int cnt;
-  int swap;
-  int ofs;
-  int weight;
-  ofs = 0;
-  det = 1;
-  for(ofs = 0; ofs < col; ++ofs) {
-    for(iter = ofs; iter < row; ++iter) {
-      if(matrix[iter * col + ofs] != 0) {
-	if(iter != ofs) {
-	  for(cnt = ofs; cnt < col; ++cnt) {
-	    swap = matrix[iter * col + cnt];
-	    matrix[iter * col + cnt] = matrix[ofs * col + cnt];
-	    matrix[ofs * col + cnt] = swap;
-	  }
-	  det *= -1;
-	}
-	for(iter = ofs + 1; iter < row; ++iter) {
-	  if(matrix[iter * col + ofs] != 0) {
-	    weight = -1 * matrix[ofs * col + ofs] / matrix[iter * col + ofs];
-	    for(cnt = ofs; cnt < col; ++cnt)
-	      matrix[iter * col + cnt] += matrix[ofs * col + cnt] * weight;
-	  }
-	}
-	iter = row;
-      }
-    }
+  int width;
+  int col;
+  *top = 0;
+  for(iter = 0; iter < crep->ednum; ++iter)
+    if(abs(dweight(&crep->edge[iter])) > *top) *top = abs(dweight(&crep->edge[iter]));
+  width = 2 * (*top) + 1;
+  dtab = XMALLOC(int, (crep->ednum + 1) * width);
+  for(col = 0; col < width; ++col)
+    dtab[crep->ednum * width + col] = 0;
+  for(iter = crep->ednum - 1; iter >= 0; --iter) {
+    for(col = 0; col < width; ++col)
+      dtab[iter * width + col] = dtab[(iter + 1) * width + col];
+    ++dtab[iter * width + *top + dweight(&crep->edge[iter])];
   }
-  for(iter = 0; iter < col; ++iter)
-    det *= matrix[iter * col + iter];
-  return det;
+  return dtab;
 }
 
 /**
- * \brief Adds an %edge to the current partial tree
+ * \brief Degree range pruning test
  *
  * \internal
- * It is used to add an %edge to the current partial tree in a correct manner;
- * the added %edge isn't surely a valid %edge for that tree but only a potential
- * one.
+ * The degree of the terms of a subtree lies between the actual one plus the
+ * lowest and the highest contributions that \e left edges following \e pos can
+ * still give.
  *
- * \param cc actual common components
- * \param nt tail node of the %edge
- * \param nh head node of the %edge
- * \param nnum number of nodes
+ * \param dtab degree bounds table
+ * \param top highest contribution (absolute value)
+ * \param pos last decided %edge
+ * \param left number of edges still to be pushed into the tree
+ * \param degree actual degree
+ * \result a positive value if the subtree can hold some terms into the range,
+ *   zero otherwise
  */
-static void
-ctrlplus (int* cc, const node_t nt, const node_t nh, const int nnum)
+static int
+dtest (const int* dtab, const int top, const int pos, const int left, const int degree)
 {
-  int root;
-  int iter;
-  int tmp;
-  int mem;
-  root = cc[2 * nh];
-  for(iter = 0; iter < nnum; ++iter)
-    if(cc[2 * iter] == root)
-      cc[2 * iter] = cc[2 * nt];
-  iter = cc[2 * nh + 1];
-  mem = nh;
-  if(iter != -1)
-    while(mem != root) {
-      tmp = cc[2 * iter + 1];
-      cc[2 * iter + 1] = mem;
-      mem = iter;
-      iter = tmp;
-    }
-  cc[2 * nh + 1] = nt;
+  const int* row;
+  int need;
+  int take;
+  int col;
+  int dmin;
+  int dmax;
+  row = dtab + (pos + 1) * (2 * top + 1);
+  dmin = dmax = degree;
+  for(col = 0, need = left; need > 0; ++col) {
+    take = (row[col] < need) ? row[col] : need;
+    dmin += take * (col - top);
+    need -= take;
+  }
+  for(col = 2 * top, need = left; need > 0; --col) {
+    take = (row[col] < need) ? row[col] : need;
+    dmax += take * (col - top);
+    need -= take;
+  }
+  return (dmax >= env.degmin) && (dmin <= env.degmax);
 }
 
 /**
- * \brief Deletes an %edge from the current partial tree
+ * \brief Symbol test
  *
  * \internal
- * It is used to delete an %edge from the current partial tree in a correct
- * manner; the %edge must have been added by a previous call to \e ctrlplus.
  *
- * \param cc actual common components
- * \param nt tail node of the %edge
- * \param nh head node of the %edge
- * \param nnum number of nodes
+ * \param eslice expression token
+ * \param name symbol name
+ * \result a positive value if the token contains the symbol, zero otherwise
  */
-static void
-ctrlminus (int* cc, node_t nt, node_t nh, const int nnum)
+static int
+contains (const expr_t* eslice, const char* name)
+{
+  list_t* iter;
+  for(iter = eslice->epart; iter != NULL; iter = list_next(iter))
+    if(!strcmp(list_data(const char, iter), name)) return 1;
+  return 0;
+}
+
+/**
+ * \brief It drops the terms that don't match the constraints
+ *
+ * \internal
+ * Engines that don't prune the search by degree or by symbols are filtered
+ * afterwards (only symbolic components can be told apart, of course).
+ *
+ * \param elist %list of expressions
+ * \result filtered %list of expressions
+ */
+static expr_t*
+efilter (expr_t* elist)
 {
-  int tmp;
+  expr_t** eiter;
+  expr_t* etmp;
+  char** name;
+  int drop;
+  eiter = &elist;
+  while(*eiter != NULL) {
+    drop = ((*eiter)->degree < env.degmin) || ((*eiter)->degree > env.degmax);
+    for(name = env.with; (!drop) && (name != NULL) && (*name != NULL); ++name)
+      drop = !contains(*eiter, *name);
+    for(name = env.without; (!drop) && (name != NULL) && (*name != NULL); ++name)
+      drop = contains(*eiter, *name);
+    if(drop) {
+      etmp = *eiter;
+      *eiter = list_next_entry(expr_t, etmp);
+      etmp->next = NULL;
+      free_expr(etmp);
+    } else eiter = (expr_t**) &((*eiter)->next);
+  }
+  return elist;
+}
+
+/**
+ * \brief Explored fraction of grimbleby's search tree
+ *
+ * \internal
+ * Children of each node along the actual path are counted again: those that
+ * come before the chosen one have been explored. The subtree of a child is
+ * supposed to be as large as the number of ways the remaining edges can fill
+ * the tree (a binomial coefficient, since edges are pushed in order), so that
+ * the result is an estimate.
+ *
+ * \param crep circuit representation reference
+ * \param nodes nodes into the tree
+ * \param base number of edges into the tree at the root
+ * \param cnt number of edges into the tree
+ * \param pos scan position
+ * \param fixed symbol constraints (NULL if there are none)
+ * \result explored fraction of the search tree
+ */
+static double
+gcover (const circ_t* crep, const node_t* nodes, const int base, const int cnt, const int pos, const int* fixed)
+{
+  int* ccgi;
+  int* ccgv;
+  int level;
   int iter;
-  int flag = 1;
-  if(cc[2 * nh + 1] != nt) {
-    tmp = nt;
-    nt = nh;
-    nh = tmp;
-  }
-  cc[2 * nh + 1] = -1;
-  cc[2 * nh] = nh;
-  while(flag) {
-    flag = 0;
-    for(iter = 0; iter < nnum; ++iter) {
-      if((iter != nh)&&(cc[2 * iter + 1] != -1)) {
-        if((cc[ 2 * iter] != nh)&&(cc[2 * cc[2 * iter + 1]] == nh)) {
-          cc[2 * iter] = nh;
-          flag = 1;
-        }
+  int first;
+  int last;
+  int slots;
+  double* size;
+  double top;
+  double done;
+  double all;
+  double weight;
+  double cover;
+  ccgi = XMALLOC(int, 2*crep->nnum);
+  ccgv = XMALLOC(int, 2*crep->nnum);
+  size = XMALLOC(double, crep->ednum);
+  for(iter = 0; iter < crep->nnum; ++iter) {
+    ccgi[2*iter] = ccgv[2*iter] = iter;
+    ccgi[2*iter + 1] = ccgv[2*iter + 1] = -1;
+  }
+  for(iter = 0; iter < base; ++iter) {
+    ctrlplus(ccgi, crep->edge[nodes[iter]].giref[0]->node, crep->edge[nodes[iter]].giref[1]->node, crep->nnum);
+    ctrlplus(ccgv, crep->edge[nodes[iter]].gvref[0]->node, crep->edge[nodes[iter]].gvref[1]->node, crep->nnum);
+  }
+  cover = 0.;
+  weight = 1.;
+  first = 0;
+  for(level = base; (level <= cnt) && (level < crep->nnum - 1); ++level) {
+    last = (level < cnt) ? nodes[level] : pos;
+    slots = (crep->nnum - 1) - (level + 1);
+    // subtree sizes (logarithms)
+    top = -HUGE_VAL;
+    for(iter = first; iter <= crep->ednum - (crep->nnum - 1 - level); ++iter) {
+      if((!testloop(ccgi, crep->edge[iter].giref[0]->node, crep->edge[iter].giref[1]->node)) &&
+	 (!testloop(ccgv, crep->edge[iter].gvref[0]->node, crep->edge[iter].gvref[1]->node)) &&
+	 ((fixed == NULL) || (fixed[iter] >= 0))) {
+	size[iter] = lgamma(crep->ednum - iter) - lgamma(slots + 1) - lgamma(crep->ednum - iter - slots);
+	if(size[iter] > top) top = size[iter];
+      } else size[iter] = -HUGE_VAL;
+    }
+    all = done = 0.;
+    for(iter = first; iter <= crep->ednum - (crep->nnum - 1 - level); ++iter)
+      if(size[iter] != -HUGE_VAL) {
+	all += exp(size[iter] - top);
+	if(iter < last) done += exp(size[iter] - top);
       }
+    if(all == 0.) break;
+    cover += weight * done / all;
+    if(level < cnt) {
+      weight *= exp(size[nodes[level]] - top) / all;
+      ctrlplus(ccgi, crep->edge[nodes[level]].giref[0]->node, crep->edge[nodes[level]].giref[1]->node, crep->nnum);
+      ctrlplus(ccgv, crep->edge[nodes[level]].gvref[0]->node, crep->edge[nodes[level]].gvref[1]->node, crep->nnum);
+      first = nodes[level] + 1;
     }
   }
+  XFREE(size);
+  XFREE(ccgv);
+  XFREE(ccgi);
+  return cover;
 }
 
 /**
- * \brief Test for loop
+ * \brief Highest number of asymmetric edges for shared components
  *
  * \internal
- * This test whether adding an %edge to the partial common tree results in a
- * loop or not; a loop situation is something to avoid.
+ * Edges whose nodes differ between the current and the voltage graph.
+ */
+#define GC_ASYM 6
+
+/**
+ * \brief Connectivity status of grimbleby's finder
  *
- * \param cc actual common components
- * \param nh head node of the %edge
- * \param nt tail node of the %edge
- * \result zero whether adding the %edge results in a loop, a positive value
- *   otherwise
+ * \internal
+ * Common components of both the graphs are kept apart, unless almost all the
+ * edges have the same nodes into both the graphs (passive circuits, where only
+ * sources and reference edges differ). Then, the components due to those
+ * symmetric edges are the same for both the graphs and they're shared, while
+ * the few asymmetric edges into the tree are simply listed: each %edge costs
+ * a single update and, if it's symmetric and no asymmetric edges are into the
+ * tree, a single test.
  */
-static int
-testloop (const int* cc, const int nh, const int nt)
+struct gconn
 {
-  return (cc[2*nh] == cc[2*nt]) ? 1 : 0;
-}
+  const circ_t* crep;  /**< Circuit representation reference */
+  int* ccgi;  /**< Current graph's common components */
+  int* ccgv;  /**< Voltage graph's common components */
+  int* cc;  /**< Shared common components (NULL if they're kept apart) */
+  char* sym;  /**< Symmetric edges */
+  int* alist;  /**< Asymmetric edges into the tree */
+  int acnt;  /**< Number of asymmetric edges into the tree */
+  int* mark;  /**< Visited components */
+  int stamp;  /**< Actual visit stamp */
+};
 
 /**
- * \brief List-of-nodes-to-expression-token converter
+ * \brief Connectivity status maker
  *
  * \internal
- * This function adds a token to the expression and returns the head of a new
- * tight and sorted expression
+ * Shared components start from the edges already pushed in by \e ct_solve;
+ * otherwise, components received from \e ct_solve are used as they are.
  *
+ * \param gc connectivity status to be initialized
  * \param crep circuit representation reference
+ * \param ccgi current graph's common components
+ * \param ccgv voltage graph's common components
  * \param nodes nodes into the tree
- * \param mask pre-allocated %mask support array
- * \param maskmark step marker, nothing more
- * \param giimat current graph pre-allocated matrix
- * \param gvimat voltage pre-allocated graph matrix
- * \param chain chain of expressions
- * \result chain of expressions' head
  */
-static expr_t*
-to_expr (const circ_t* crep, const node_t* nodes, int* mask, int maskmark, int* giimat, int* gvimat, expr_t* chain)
+static void
+gc_init (struct gconn* gc, const circ_t* crep, int* ccgi, int* ccgv, const node_t* nodes)
 {
   int iter;
-  int actv;
-  int offset;
-  expr_t* eslice;
-  expr_t** eiter;
-  expr_t* elist;
-  list_t** liter;
-  list_t* lhook;
-  void* hook;
-  elist = chain;
-  for(iter = 0; iter < crep->ednum; ++iter)
-    mask[iter] = 0;
-  eslice = expr_new();
-  for(iter = 0; iter < (crep->nnum * (crep->nnum - 1)); ++iter) {
-    giimat[iter] = 0;
-    gvimat[iter] = 0;
-  }
-  offset = 0;
-  for(iter = 0; iter < crep->nnum - 1; ++iter)
-    mask[nodes[iter]] = maskmark;
+  int asym;
+  edge_t* eptr;
+  gc->crep = crep;
+  gc->ccgi = ccgi;
+  gc->ccgv = ccgv;
+  gc->cc = NULL;
+  gc->sym = XMALLOC(char, crep->ednum);
+  asym = 0;
   for(iter = 0; iter < crep->ednum; ++iter) {
-    if(mask[iter] == maskmark) {
-      giimat[(crep->nnum - 1) * crep->edge[iter].giref[0]->node + offset] = -1;
-      giimat[(crep->nnum - 1) * crep->edge[iter].giref[1]->node + offset] = 1;
-      gvimat[(crep->nnum - 1) * crep->edge[iter].gvref[0]->node + offset] = -1;
-      gvimat[(crep->nnum - 1) * crep->edge[iter].gvref[1]->node + offset] = 1;
-      ++offset;
-    }
-    if(((mask[iter] == maskmark) && (crep->edge[iter].type == Y)) ||	\
-       ((mask[iter] != maskmark) && (crep->edge[iter].type == Z))) {
-      if(crep->edge[iter].sym) {
-	if(crep->edge[iter].name) {
-	  // ordered insertion
-	  liter = &(eslice->epart);
-	  while((*liter != NULL) && (strcmp(list_data(const char, (*liter)), crep->edge[iter].name) < 0))
-	    liter = &((*liter)->next);
-	  *liter = list_add(list_new((void*) xstrdup(crep->edge[iter].name)), *liter);
-	  // unordered insertion
-	  // eslice->epart = list_add(list_new((void*) xstrdup(crep->edge[iter].name)), eslice->epart);
-	  ++(eslice->etoken);
-	}
-	// sign-handler (generators' direction)
-	// eslice->vpart *= crep->edge[iter].value;
-      } else eslice->vpart *= crep->edge[iter].value;
-      eslice->degree += crep->edge[iter].degree;
+    eptr = &crep->edge[iter];
+    gc->sym[iter] = ((eptr->giref[0]->node == eptr->gvref[0]->node) && (eptr->giref[1]->node == eptr->gvref[1]->node)) ||
+      ((eptr->giref[0]->node == eptr->gvref[1]->node) && (eptr->giref[1]->node == eptr->gvref[0]->node));
+    if(!gc->sym[iter]) ++asym;
+  }
+  if(asym <= GC_ASYM) {
+    gc->cc = XMALLOC(int, 2*crep->nnum);
+    gc->mark = XMALLOC(int, crep->nnum);
+    gc->alist = XMALLOC(int, asym + 1);
+    gc->acnt = 0;
+    gc->stamp = 0;
+    for(iter = 0; iter < crep->nnum; ++iter) {
+      gc->cc[2*iter] = iter;
+      gc->cc[2*iter + 1] = -1;
+      gc->mark[iter] = 0;
     }
+    for(iter = 0; iter <= crep->efnum; ++iter)
+      if(gc->sym[nodes[iter]])
+	ctrlplus(gc->cc, crep->edge[nodes[iter]].giref[0]->node, crep->edge[nodes[iter]].giref[1]->node, crep->nnum);
+      else gc->alist[gc->acnt++] = nodes[iter];
   }
-  // sign computation
-  eslice->vpart *= to_diagonal_matrix(giimat, crep->nnum, (crep->nnum - 1));
-  eslice->vpart *= to_diagonal_matrix(gvimat, crep->nnum, (crep->nnum - 1));
-  // shrink-step
-  eiter = &elist;
-  actv = 0;
-  // find ...
-  while((*eiter != NULL) && (eslice->degree <= (*eiter)->degree) && (!actv)) {
-    if((eslice->degree == (*eiter)->degree) && (eslice->epart != NULL)) {
-      lhook = eslice->epart;
-      liter = &((*eiter)->epart);
-      while(*liter != NULL) {
-	if((lhook != NULL) && (strcmp(list_data(const char, lhook), list_data(const char, (*liter)))))
-	  break;
-	else {
-	  lhook = list_next(lhook);
-	  liter = &((*liter)->next);
-	}
+}
+
+/**
+ * \brief Connectivity status destroyer
+ *
+ * \internal
+ *
+ * \param gc connectivity status
+ */
+static void
+gc_free (struct gconn* gc)
+{
+  if(gc->cc != NULL) {
+    XFREE(gc->alist);
+    XFREE(gc->mark);
+    XFREE(gc->cc);
+  }
+  XFREE(gc->sym);
+}
+
+/**
+ * \brief Shared components reachability test
+ *
+ * \internal
+ * Two nodes are connected if they belong to the same shared component or if
+ * their components are linked by the asymmetric edges into the tree (as they
+ * are into the requested graph).
+ *
+ * \param gc connectivity status
+ * \param gv voltage graph if positive, current graph otherwise
+ * \param nt tail node
+ * \param nh head node
+ * \result a positive value if the nodes are connected, zero otherwise
+ */
+static int
+gc_reach (struct gconn* gc, const int gv, const int nt, const int nh)
+{
+  const edge_t* eptr;
+  int iter;
+  int grow;
+  int ct;
+  int ch;
+  if(gc->cc[2*nt] == gc->cc[2*nh]) return 1;
+  if(gc->acnt == 0) return 0;
+  if(++gc->stamp == INT_MAX) {
+    for(iter = 0; iter < gc->crep->nnum; ++iter)
+      gc->mark[iter] = 0;
+    gc->stamp = 1;
+  }
+  gc->mark[gc->cc[2*nt]] = gc->stamp;
+  do {
+    grow = 0;
+    for(iter = 0; iter < gc->acnt; ++iter) {
+      eptr = &gc->crep->edge[gc->alist[iter]];
+      ct = gc->cc[2*((gv) ? eptr->gvref[0]->node : eptr->giref[0]->node)];
+      ch = gc->cc[2*((gv) ? eptr->gvref[1]->node : eptr->giref[1]->node)];
+      if((gc->mark[ct] == gc->stamp) != (gc->mark[ch] == gc->stamp)) {
+	gc->mark[ct] = gc->mark[ch] = gc->stamp;
+	grow = 1;
       }
-      if((*liter == NULL) && (lhook == NULL))
-	actv = !actv;
     }
-    if(!actv)
-      eiter = &((*eiter)->next);
-  }
-  // ... and shrink ...
-  if(actv) {
-    (*eiter)->vpart += eslice->vpart;
-    while(eslice->epart != NULL) {
-      lhook = eslice->epart;
-      eslice->epart = list_next(lhook);
-      hook = list_data(void, lhook);
-      XFREE(hook);
-      XFREE(lhook);
-    }
-    XFREE(eslice);
-  } else
-    // ... or insert, of course!
-    *eiter = (expr_t*) list_add((list_t*) eslice, (list_t*) *eiter);
-  return elist;
+  } while(grow);
+  return gc->mark[gc->cc[2*nh]] == gc->stamp;
+}
+
+/**
+ * \brief Loop test for both the graphs
+ *
+ * \internal
+ *
+ * \param gc connectivity status
+ * \param pos %edge to be tested
+ * \result a positive value if the %edge results in a loop in any of the
+ *   graphs, zero otherwise
+ */
+static int
+gc_loop (struct gconn* gc, const int pos)
+{
+  const edge_t* eptr;
+  eptr = &gc->crep->edge[pos];
+  if(gc->cc == NULL)
+    return testloop(gc->ccgi, eptr->giref[0]->node, eptr->giref[1]->node) ||
+      testloop(gc->ccgv, eptr->gvref[0]->node, eptr->gvref[1]->node);
+  else return gc_reach(gc, 0, eptr->giref[0]->node, eptr->giref[1]->node) ||
+	 (((!gc->sym[pos]) || (gc->acnt > 0)) && gc_reach(gc, 1, eptr->gvref[0]->node, eptr->gvref[1]->node));
+}
+
+/**
+ * \brief It pushes an %edge into the tree
+ *
+ * \internal
+ *
+ * \param gc connectivity status
+ * \param pos %edge to be pushed
+ */
+static void
+gc_push (struct gconn* gc, const int pos)
+{
+  const edge_t* eptr;
+  eptr = &gc->crep->edge[pos];
+  if(gc->cc == NULL) {
+    ctrlplus(gc->ccgi, eptr->giref[0]->node, eptr->giref[1]->node, gc->crep->nnum);
+    ctrlplus(gc->ccgv, eptr->gvref[0]->node, eptr->gvref[1]->node, gc->crep->nnum);
+  } else if(gc->sym[pos])
+    ctrlplus(gc->cc, eptr->giref[0]->node, eptr->giref[1]->node, gc->crep->nnum);
+  else gc->alist[gc->acnt++] = pos;
+}
+
+/**
+ * \brief It pops an %edge out of the tree
+ *
+ * \internal
+ * Edges must be popped in reverse order.
+ *
+ * \param gc connectivity status
+ * \param pos %edge to be popped
+ */
+static void
+gc_pop (struct gconn* gc, const int pos)
+{
+  const edge_t* eptr;
+  eptr = &gc->crep->edge[pos];
+  if(gc->cc == NULL) {
+    ctrlminus(gc->ccgi, eptr->giref[0]->node, eptr->giref[1]->node, gc->crep->nnum);
+    ctrlminus(gc->ccgv, eptr->gvref[0]->node, eptr->gvref[1]->node, gc->crep->nnum);
+  } else if(gc->sym[pos])
+    ctrlminus(gc->cc, eptr->giref[0]->node, eptr->giref[1]->node, gc->crep->nnum);
+  else --gc->acnt;
 }
 
 /**
@@ -653,6 +1045,16 @@ to_expr (const circ_t* crep, const node_t* nodes, int* mask, int maskmark, int*
  * This function is the core of grimbleby's algorithm, that means this function
  * finds all the common trees between two proposed graphs storing them as an
  * ordered, human readable circuit expression (thanks to to_expr function).
+ * Its status is checkpointed from time to time and it can be resumed from a
+ * checkpoint; when it's asked to stop (or it runs out of its budget), terms
+ * found so far are marked as truncated. Branches that can't give terms into
+ * the degree range are pruned, while symbol constraints force edges into or
+ * out of the tree. Passive circuits share the common components of both the
+ * graphs (see %struct %gconn). When symmetries are asked for, only the
+ * greatest tree of each orbit is searched and the others are mapped from it
+ * (see %struct %symm). Terms are spilled to temporary files from time to time,
+ * if asked for (see %struct %spill), and then they aren't checkpointed. Trees
+ * are saved into the common trees store as well, if it's being written.
  *
  * \param crep circuit representation reference
  * \param chain %list pointer wiht the newly allocated stacks as payload
@@ -672,7 +1074,22 @@ ghelper (const circ_t* crep, list_t** chain, int* ccgi, int* ccgv, node_t* nodes
   int* mask;
   int iter;
   int maskmark;
+  int block;
+  int tick;
+  int* dtab;
+  int* fixed;
+  int base;
+  int clash;
+  int top;
+  int degree;
+  int icnt;
+  int burnt;
+  double trees;
+  double sign;
+  const node_t* images;
   expr_t* elist;
+  struct gconn gc;
+  symm_t* sy;
   enum {
     TF,  // Test Flag
     SF,  // Select Flag
@@ -690,17 +1107,97 @@ ghelper (const circ_t* crep, list_t** chain, int* ccgi, int* ccgv, node_t* nodes
   giimat = XMALLOC(int, (crep->nnum * (crep->nnum - 1)));
   gvimat = XMALLOC(int, (crep->nnum * (crep->nnum - 1)));
   elist = NULL;
+  trees = 0.;
   for(iter = 0; iter < crep->ednum; ++iter)
     mask[iter] = 0;
   maskmark = 0;
+  gc_init(&gc, crep, ccgi, ccgv, nodes);
+  // resume (common components rebuilt from the edges into the tree)
+  block = (&crep->edge[nodes[crep->efnum]] == crep->gref);
+  iter = flag;
+  cts_block(block);
+  if(ckp_resume(block, &pos, &cnt, nodes, &iter, OF, &elist, &trees)) {
+    flag = iter;
+    for(iter = 1 + crep->efnum; iter < cnt; ++iter)
+      gc_push(&gc, nodes[iter]);
+  }
+  // symbol constraints (forced edges pushed in first, once and for all)
+  fixed = NULL;
+  base = 1 + crep->efnum;
+  if(constrained() || (env.pin >= 0)) {
+    fixed = gfixed(crep, &clash);
+    for(iter = 0; iter < crep->ednum; ++iter)
+      if(fixed[iter] > 0) {
+	if(cnt == base) {
+	  if((cnt == crep->nnum - 1) || gc_loop(&gc, iter)) {
+	    clash = 1;
+	    break;
+	  }
+	  nodes[cnt++] = iter;
+	  gc_push(&gc, iter);
+	}
+	++base;
+      }
+    if(clash) flag = OF;
+  }
+  if(ckp_stopped()) flag = OF;
+  // symmetries (actual tree included)
+  sy = NULL;
+  if(SYMMETRY() && (sy = sy_new(crep, nodes, fixed)) != NULL)
+    for(iter = 0; iter < cnt; ++iter)
+      sy_push(sy, nodes[iter]);
+  // degree of the actual tree (Z edges all out of it, at first)
+  dtab = NULL;
+  top = degree = 0;
+  if(dranged()) {
+    dtab = dtable(crep, &top);
+    for(iter = 0; iter < crep->ednum; ++iter)
+      if(crep->edge[iter].type == Z) degree += crep->edge[iter].degree;
+    for(iter = 0; iter < cnt; ++iter)
+      degree += dweight(&crep->edge[nodes[iter]]);
+  }
+  // forced edges could fill the tree at once
+  if((flag == SF) && (pos == -1) && (cnt == crep->nnum - 1)) {
+    if((dtab == NULL) || ((degree >= env.degmin) && (degree <= env.degmax))) {
+      sign = to_sign(crep, nodes, mask, ++maskmark, giimat, gvimat);
+      cts_put(nodes, sign);
+      elist = to_term(crep, nodes, mask, ++maskmark, sign, elist);
+      ++trees;
+    }
+    flag = OF;
+  }
+  tick = 0;
+  burnt = 0;
   while((ret)&&(flag != OF)) {
+    if((!(++tick & CKP_TICK)) && ckp_due(trees)) {
+      if(env.spilled == NULL) ckp_save(crep, block, pos, cnt, nodes, flag, elist, trees);
+      if(ckp_stopped()) break;
+    }
     switch(flag) {
     case TF:
       if(cnt == (crep->nnum - 1)) {
 	VERBOSE(".");
 	// "burn"
-	elist = to_expr (crep, nodes, mask, ++maskmark, giimat, gvimat, elist);
+	if(sy == NULL) {
+	  sign = to_sign(crep, nodes, mask, ++maskmark, giimat, gvimat);
+	  cts_put(nodes, sign);
+	  elist = to_term(crep, nodes, mask, ++maskmark, sign, elist);
+	  ++trees;
+	} else if((icnt = sy_orbit(sy, nodes, cnt, &images)) > 0) {
+	  // the whole orbit, same sign
+	  sign = to_sign(crep, nodes, mask, ++maskmark, giimat, gvimat);
+	  for(iter = 0; iter < icnt; ++iter) {
+	    cts_put(&images[iter * cnt], sign);
+	    elist = to_term(crep, &images[iter * cnt], mask, ++maskmark, sign, elist);
+	  }
+	  trees += icnt;
+	}
 	// ! "burn"
+	// numerator first, as into the files
+	if((env.spilled != NULL) && (!(++burnt & SPILL_TICK)))
+	  elist = spill_terms(env.spilled, !block, elist, 0);
+	// common trees budget tested at once
+	if(env.maxterms > 0) tick = CKP_TICK;
 	flag = BF;
       } else flag = SF;
       break;
@@ -710,29 +1207,34 @@ ghelper (const circ_t* crep, list_t** chain, int* ccgi, int* ccgv, node_t* nodes
       else flag = LF;
       break;
     case LF:
-      if(testloop(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node)) flag = SF;
-      else if(testloop(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node)) flag = SF;
+      if((sy != NULL) && sy_prune(sy, pos)) flag = EF;
+      else if((fixed != NULL) && (fixed[pos] < 0)) flag = SF;
+      else if(gc_loop(&gc, pos)) flag = SF;
       else flag = IF;
       break;
     case IF:
       if(cnt == (crep->nnum - 1)) ret = 0;
+      else if((dtab != NULL) && (!dtest(dtab, top, pos, (crep->nnum - 2) - cnt, degree + dweight(&crep->edge[pos]))))
+	flag = SF;
       else {
+	degree += dweight(&crep->edge[pos]);
 	nodes[cnt++] = pos;
-	ctrlplus(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node, crep->nnum);
-	ctrlplus(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node, crep->nnum);
+	gc_push(&gc, pos);
+	if(sy != NULL) sy_push(sy, pos);
 	flag = TF;
       }
       break;
     case EF:
-      if(cnt == 1 + crep->efnum) flag = OF;
+      if(cnt == base) flag = OF;
       else flag = BF;
       break;
     case BF:
-      if(cnt == 1 + crep->efnum) ret = 0;
+      if(cnt == base) ret = 0;
       else {
 	pos = nodes[--cnt];
-	ctrlminus(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node, crep->nnum);
-	ctrlminus(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node, crep->nnum);
+	degree -= dweight(&crep->edge[pos]);
+	gc_pop(&gc, pos);
+	if(sy != NULL) sy_pop(sy, pos);
 	flag = SF;
       }
       break;
@@ -741,19 +1243,50 @@ ghelper (const circ_t* crep, list_t** chain, int* ccgi, int* ccgv, node_t* nodes
     }
   }
   *chain = (list_t*) elist;
+  if(ckp_stopped()) {
+    // partial results
+    ckp_cover(block, gcover(crep, nodes, base, cnt, pos, fixed), trees);
+    for(; elist != NULL; elist = list_next_entry(expr_t, elist))
+      elist->trunc = 1;
+    if(env.spilled != NULL) env.spilled->trunc[!block] = 1;
+  } else ckp_cover(block, 1., trees);
+  *chain = (list_t*) spill_terms(env.spilled, !block, (expr_t*) *chain, 1);
+  // common components given back as they were (forced edges included)
+  while(cnt > 1 + crep->efnum)
+    gc_pop(&gc, nodes[--cnt]);
+  gc_free(&gc);
+  sy_del(sy);
+  XFREE(fixed);
+  XFREE(dtab);
   XFREE(gvimat);
   XFREE(giimat);
   XFREE(mask);
   return ret;
 }
 
+/**
+ * \brief Store test
+ *
+ * \internal
+ * Trees found under a degree range or symbol constraints, or resumed, aren't
+ * all the trees of the circuit, so they aren't stored.
+ *
+ * \return a positive value if the trees are to be stored, zero otherwise
+ */
+static int
+archived ()
+{
+  return ARCHIVE() && (!dranged()) && (!constrained()) && (!RESUME());
+}
+
 /**
  * \brief Circuit-to-expression conversion function using grimbleby's algorithm
  *
  * \internal
- * Grimbleby's algorithm entry point: support elements are pushed in before to
- * invoke \e ghelper function which really solves common trees
- * problem. Connected components variations are tracked here.
+ * Grimbleby's algorithm entry point: it drives \e ghelper function, which
+ * really solves common trees problem, by means of \e ct_solve. It is the only
+ * finder that can be checkpointed, and its trees can be stored (unless
+ * they're filtered or resumed).
  *
  * \param crep %circuit reference
  * \param yrefchain pointer to be used to store the first %list
@@ -764,55 +1297,126 @@ static int
 grimbleby (const circ_t* crep, list_t** yrefchain, list_t** grefchain)
 {
   int ret;
-  int* ccgi;
-  int* ccgv;
-  int iter;
-  list_t* fiter;
-  edge_t* etmp;
+  ckp_start(crep, yrefchain);
+  if(archived()) cts_start(crep);
+  ret = ct_solve(crep, yrefchain, grefchain, ghelper);
+  cts_end(ret && (!ckp_stopped()));
+  ckp_end();
+  return ret;
+}
+
+/**
+ * \brief Circuit-to-expression conversion function using the stored trees
+ *
+ * \internal
+ * Trees saved by a previous run of grimbleby's finder are read back in a single
+ * pass (see cts.h) and turned into terms for the actual values and symbolic
+ * flags of the components, without any search. Terms are filtered as soon as
+ * they're spilled, if they are.
+ * <br> If a component has been added since the store was written, grimbleby's
+ * finder searches only for the trees that contain its %edge (it's pinned into
+ * them) and the others come from the store, as they are. If a component has
+ * been removed, the trees that contain its %edge are dropped. The store is
+ * written again for the actual circuit, if asked for, and all the trees are
+ * searched for when it can't be used at all.
+ *
+ * \param crep %circuit reference
+ * \param yrefchain pointer to be used to store the first %list
+ * \param grefchain pointer to be used to store the second %list
+ * \result zero if some error occurs, a positive value otherwise
+ */
+static int
+restore (const circ_t* crep, list_t** yrefchain, list_t** grefchain)
+{
+  cts_t* st;
+  expr_t* elist[2];
   node_t* nodes;
-  if(crep != NULL) {
-    ret = 1;
-    ccgi = XMALLOC(int, 2*crep->nnum);
-    ccgv = XMALLOC(int, 2*crep->nnum);
-    nodes = XMALLOC(node_t, crep->nnum - 1);
-    for(iter = 0; iter < crep->nnum; ++iter) {
-      ccgi[2*iter] = ccgv[2*iter] = iter;
-      ccgi[2*iter + 1] = ccgv[2*iter + 1] = -1;
-    }
-    // forced edges!! :-) ... test loop needed ??
-    iter = -1;
-    fiter = crep->flist;
-    while(fiter) {
-      etmp = list_data(edge_t, fiter);
-      ctrlplus(ccgi, etmp->giref[0]->node, etmp->giref[1]->node, crep->nnum);
-      ctrlplus(ccgv, etmp->gvref[0]->node, etmp->gvref[1]->node, crep->nnum);
-      nodes[++iter] = edge_number(crep, etmp);
-      fiter = list_next(fiter);
-    }
-    ++iter;
-    if(crep->yref != NULL) {
-      ctrlplus(ccgi, crep->yref->giref[0]->node, crep->yref->giref[1]->node, crep->nnum);
-      ctrlplus(ccgv, crep->yref->gvref[0]->node, crep->yref->gvref[1]->node, crep->nnum);
-      nodes[iter] = edge_number(crep, crep->yref);
-      if(ret) ret = ghelper(crep, yrefchain, ccgi, ccgv, nodes);
-      ctrlminus(ccgi, crep->yref->giref[0]->node, crep->yref->giref[1]->node, crep->nnum);
-      ctrlminus(ccgv, crep->yref->gvref[0]->node, crep->yref->gvref[1]->node, crep->nnum);
-    }
-    if(crep->gref != NULL) {
-      ctrlplus(ccgi, crep->gref->giref[0]->node, crep->gref->giref[1]->node, crep->nnum);
-      ctrlplus(ccgv, crep->gref->gvref[0]->node, crep->gref->gvref[1]->node, crep->nnum);
-      nodes[iter] = edge_number(crep, crep->gref);
-      if(ret) ret = ghelper(crep, grefchain, ccgi, ccgv, nodes);
-      ctrlminus(ccgi, crep->gref->giref[0]->node, crep->gref->giref[1]->node, crep->nnum);
-      ctrlminus(ccgv, crep->gref->gvref[0]->node, crep->gref->gvref[1]->node, crep->nnum);
+  int* mask;
+  int maskmark;
+  int block;
+  int wblock;
+  int burnt;
+  int ret;
+  double sign;
+  if((st = cts_load(crep)) == NULL)
+    return grimbleby(crep, yrefchain, grefchain);
+  if(archived()) cts_start(crep);
+  ret = 1;
+  elist[0] = elist[1] = NULL;
+  // only the trees that contain the added edge are searched for
+  if((env.pin = cts_added(st)) >= 0) {
+    ret = ct_solve(crep, yrefchain, grefchain, ghelper);
+    elist[0] = (expr_t*) *yrefchain;
+    elist[1] = (expr_t*) *grefchain;
+    env.pin = -1;
+  }
+  nodes = XMALLOC(node_t, crep->nnum);
+  mask = XMALLOC(int, crep->ednum + 1);
+  maskmark = 0;
+  wblock = -1;
+  burnt = 0;
+  while(ret && cts_next(st, &block, nodes, &sign)) {
+    if(block != wblock) cts_block(wblock = block);
+    cts_put(nodes, sign);
+    elist[block] = to_term(crep, nodes, mask, ++maskmark, sign, elist[block]);
+    if((env.spilled != NULL) && (!(++burnt & SPILL_TICK))) {
+      if(dranged() || constrained()) elist[block] = efilter(elist[block]);
+      elist[block] = spill_terms(env.spilled, !block, elist[block], 0);
     }
-    XFREE(ccgi);
-    XFREE(ccgv);
-    XFREE(nodes);
-  } else {
-    warning("Null pointer!");
-    ret = 0;
   }
+  for(block = 0; (block < 2) && (env.spilled != NULL); ++block) {
+    if(dranged() || constrained()) elist[block] = efilter(elist[block]);
+    elist[block] = spill_terms(env.spilled, !block, elist[block], 1);
+  }
+  *yrefchain = (list_t*) elist[0];
+  *grefchain = (list_t*) elist[1];
+  cts_free(st);
+  cts_end(ret);
+  XFREE(mask);
+  XFREE(nodes);
+  return ret;
+}
+
+/**
+ * \brief Block-to-expression conversion function
+ *
+ * Circuits built to describe a block (see subckt.h) are solved by grimbleby's
+ * finder, whatever the engine is, with no degree range nor symbol constraints:
+ * they're solved before the %circuit is, so that neither checkpoints nor
+ * stores nor spills are involved. Only the yref block is searched for.
+ *
+ * \param crep %circuit reference
+ * \param chain pointer to be used to store the %list
+ * \result zero if some error occurs, a positive value otherwise
+ */
+int
+block_to_expr (const circ_t* crep, list_t** chain)
+{
+  char* none[1];
+  char** with;
+  char** without;
+  list_t* unused;
+  int degmin;
+  int degmax;
+  int pin;
+  int ret;
+  degmin = env.degmin;
+  degmax = env.degmax;
+  with = env.with;
+  without = env.without;
+  pin = env.pin;
+  none[0] = NULL;
+  env.degmin = 0;
+  env.degmax = INT_MAX;
+  env.with = env.without = none;
+  env.pin = -1;
+  unused = NULL;
+  ret = ct_solve(crep, chain, &unused, ghelper);
+  env.degmin = degmin;
+  env.degmax = degmax;
+  env.with = with;
+  env.without = without;
+  env.pin = pin;
   return ret;
 }
 
@@ -824,6 +1428,13 @@ grimbleby (const circ_t* crep, list_t** yrefchain, list_t** grefchain)
  * are final, easy to manage parts of the resolution process. As a matter of
  * fact, this function does more: indeed, it returns tight and sorted
  * expressions, all-in-one! :-)
+ * <br> The common trees finder is chosen by means of the environment (see
+ * %enum %engine), as well as the range of the powers of s to be kept and the
+ * symbols that terms must or must not contain.
+ * <br> Finders that split the circuit into pieces can give nested expressions
+ * instead (see %env), unless some of the terms are to be filtered out, and
+ * grimbleby's finder (or the store of its trees) can spill the terms to
+ * temporary files, leaving the lists empty.
  *
  * \param crep %circuit reference
  * \param yrefchain pointer to be used to store the first %list
@@ -835,8 +1446,45 @@ circ_to_expr (const circ_t* crep, list_t** yrefchain, list_t** grefchain)
 {
   int ret;
   int (*cf) (const circ_t*, list_t**, list_t**);
-  // Here will be common trees finder function switch
-  cf = grimbleby;
+  // common trees finder function switch
+  switch(env.engine) {
+  case KBEST:
+    cf = kbest;
+    break;
+  case MATROID:
+    cf = matroid;
+    break;
+  case EXCHANGE:
+    cf = exchange;
+    break;
+  case CASCADE:
+    cf = cascade;
+    break;
+  case TEARING:
+    cf = tearing;
+    break;
+  case STORE:
+    cf = restore;
+    break;
+  case GRIMBLEBY:
+  default:
+    cf = grimbleby;
+  }
+  // nested expressions can't be filtered
+  if(NESTED() && ((cf == cascade) || (cf == tearing))) {
+    if(sub_reduced())
+      warning("Hierarchical expressions aren't nested, expanded ones given");
+    else if(dranged() || constrained())
+      warning("Nested expressions can't be filtered, expanded ones given");
+    else env.nest = nest_new();
+  }
+  // spilled terms can't be checkpointed
+  if((env.spill > 0) && ((cf == grimbleby) || (cf == restore)) && (!env.checkpoint) && (!RESUME()) && (!env.maxtime) && (!env.maxmem) && (!env.maxterms))
+    env.spilled = spill_new(env.spill);
   ret = (*cf)(crep, yrefchain, grefchain);
+  if(ret && (dranged() || constrained()) && (cf != grimbleby)) {
+    *yrefchain = (list_t*) efilter((expr_t*) *yrefchain);
+    *grefchain = (list_t*) efilter((expr_t*) *grefchain);
+  }
   return ret;
 }
@@ -52,6 +52,11 @@
  */
 #define BUF_SIZE 32
 
+/**
+ * \brief Output buffer size (splash)
+ */
+#define SPLASH_BUF (1 << 20)
+
 /**
  * \brief Expression token type
  *
@@ -67,6 +72,7 @@ struct expr
   double vpart;  /**< Numeric part of the expression */
   int etoken;  /**< Number of symbolic elements */
   short int degree;  /**< Degree of the specific token */
+  short int trunc;  /**< Truncation marker (degree-group is not complete) */
   list_t* epart;  /**< List of symbolic elements */
 };
 
@@ -77,12 +83,59 @@ typedef
 struct expr
 expr_t;
 
+/**
+ * \brief Read-only cursor over the terms of an expression
+ *
+ * Expressions can be splashed from any source that fills a cursor, like a
+ * %list of tokens or a mapped .fdt file, without being copied. The cursor
+ * holds the current term, if any.
+ */
+struct ecursor
+{
+  int (*next) (struct ecursor*);  /**< Moves to the next term, zero if there is none */
+  const char* (*symbol) (struct ecursor*);  /**< Next symbol of the term, NULL if there is none */
+  const void* src;  /**< Source (private) */
+  const void* hook;  /**< Position into the source (private) */
+  unsigned long long idx[5];  /**< Position into the source (private) */
+  double vpart;  /**< Numeric part of the term */
+  int etoken;  /**< Number of symbols of the term */
+  int degree;  /**< Degree of the term */
+  int trunc;  /**< Truncation marker of the term */
+  int end;  /**< There is no current term (past the last one) */
+};
+
+/**
+ * \brief Available common trees finders
+ *
+ * These are the engines that \e circ_to_expr can use to find the common trees
+ * of the circuit.
+ */
+enum engine
+{
+  GRIMBLEBY,  /**< Grimbleby's algorithm, all the common trees (default) */
+  KBEST,  /**< Only the k highest-magnitude common trees per power of s */
+  MATROID,  /**< Matroid intersection based, polynomial delay per tree */
+  EXCHANGE,  /**< Matroid based, revolving-door order and incremental terms */
+  CASCADE,  /**< Chain of stages, solved one by one and multiplied together */
+  TEARING,  /**< Torn apart across small separators, pieces joined together */
+  STORE  /**< Trees read back from the store of a previous run (see cts.h) */
+};
+
 extern void
 sep (const int, FILE*);
 
+extern void
+expr_cursor (struct ecursor*, const expr_t*);
+
+extern int
+splash_cursor (struct ecursor*, FILE*, const int);
+
 extern int
 splash (expr_t*, FILE*, const int);
 
+extern void
+splash_pair (struct ecursor*, struct ecursor*, FILE*);
+
 extern int
 expr_to_file (const expr_t*, FILE*);
 
@@ -98,4 +151,7 @@ free_expr (expr_t*);
 int
 circ_to_expr (const circ_t*, list_t**, list_t**);
 
+int
+block_to_expr (const circ_t*, list_t**);
+
 #endif /* EXPR_H */
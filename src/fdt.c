@@ -0,0 +1,1870 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file fdt.c
+ *
+ * \brief Portable .fdt files
+ *
+ * This set of functions can be used to write expressions into version 2 .fdt
+ * files and to read them back (see fdt.h for the layout). Data are gathered
+ * into large buffers, so that writing or reading a file takes a few large
+ * sequential transfers instead of one per item. Files can also be mapped in
+ * memory and their terms splashed as they are, without being rebuilt.
+ * <br> Packed files are written block by block, each block compressed on its
+ * own (when zlib is available), and blocks can be decoded in any order.
+ */
+
+#include <string.h>
+#include <limits.h>
+#include <sys/mman.h>
+
+#include "common.h"
+#include "list.h"
+#include "expr.h"
+#include "fdt.h"
+
+#ifdef HAVE_ZLIB_H
+#include <zlib.h>
+#endif /* HAVE_ZLIB_H */
+
+/**
+ * \brief Size of the output buffer (bytes)
+ */
+#define FDT_BUF (1 << 20)
+
+/**
+ * \brief Largest coefficients dictionary (packed files)
+ */
+#define FDT_DICT (1 << 20)
+
+/**
+ * \brief Largest decoded block (packed files)
+ */
+#define FDT_MAXRAW (1ULL << 30)
+
+/**
+ * \brief Rounds a size up to a multiple of 8 bytes
+ */
+#define FDT_ALIGN(size) \
+  ((((unsigned long long) (size)) + 7ULL) & ~7ULL)
+
+/**
+ * \brief Buffered output
+ */
+struct fdt_out
+{
+  FILE* file;  /**< Output file */
+  unsigned char* buf;  /**< Pending bytes */
+  size_t cnt;  /**< Number of pending bytes */
+  unsigned long long pos;  /**< Bytes written so far (pending ones too) */
+  unsigned long long hash;  /**< Checksum of the bytes written so far */
+  int werr;  /**< Errors occurred */
+};
+
+/**
+ * \brief Symbol names table
+ *
+ * Names are numbered in order of appearance and looked up by means of an hash
+ * table (open addressing).
+ */
+struct fdt_syms
+{
+  char** name;  /**< Names (copies) */
+  unsigned int cnt;  /**< Number of names */
+  unsigned int size;  /**< Allocated names */
+  unsigned int* slot;  /**< Hash table (index plus one, zero if free) */
+  unsigned int ssize;  /**< Hash table size (power of two) */
+  unsigned long long bytes;  /**< Size of all the names (NUL-terminated) */
+};
+
+/**
+ * \brief Growing buffer
+ */
+struct fdt_buf
+{
+  unsigned char* data;  /**< Bytes */
+  size_t cnt;  /**< Number of bytes */
+  size_t size;  /**< Allocated bytes */
+};
+
+/**
+ * \brief Coefficients table (packed files)
+ *
+ * Values are counted by means of an hash table (open addressing), up to
+ * FDT_DICT different values, then those that occur more than once become the
+ * dictionary.
+ */
+struct fdt_dict
+{
+  unsigned long long* key;  /**< Bits of the values */
+  unsigned long long* cnt;  /**< Occurrences of the values (zero if free) */
+  unsigned long long* idx;  /**< Index into the dictionary plus one (zero if none) */
+  unsigned int size;  /**< Hash table size (power of two) */
+  unsigned int dcnt;  /**< Number of different values */
+};
+
+/**
+ * \brief Checksum update
+ *
+ * 64-bit FNV-1a hash, \a hash is FDT_SEED at the beginning.
+ *
+ * \param hash checksum so far
+ * \param data bytes to be added
+ * \param cnt number of bytes
+ * \return updated checksum
+ */
+unsigned long long
+fdt_hash (unsigned long long hash, const unsigned char* data, size_t cnt)
+{
+  size_t iter;
+  for(iter = 0; iter < cnt; ++iter) {
+    hash ^= data[iter];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+/**
+ * \brief Little-endian value
+ *
+ * \internal
+ *
+ * \param data bytes
+ * \param n number of bytes
+ * \return the value
+ */
+static unsigned long long
+fdt_get (const unsigned char* data, const int n)
+{
+  unsigned long long val;
+  int iter;
+  val = 0;
+  for(iter = n - 1; iter >= 0; --iter)
+    val = (val << 8) | data[iter];
+  return val;
+}
+
+/**
+ * \brief It reads the header
+ *
+ * \param data first FDT_HEAD bytes of the file
+ * \param head header to be filled
+ * \return a positive value if the header is valid, zero if the magic number
+ *   doesn't match, a negative value otherwise
+ */
+int
+fdt_head_get (const unsigned char* data, struct fdt_head* head)
+{
+  int g;
+  if(memcmp(data, FDT_MAGIC, strlen(FDT_MAGIC)))
+    return 0;
+  head->version = (unsigned int) fdt_get(data + 8, 4);
+  head->flags = (unsigned int) fdt_get(data + 12, 4);
+  head->scnt = (unsigned int) fdt_get(data + 16, 4);
+  head->ssize = fdt_get(data + 24, 8);
+  for(g = 0; g < 2; ++g) {
+    head->tcnt[g] = fdt_get(data + 32 + 8 * g, 8);
+    head->rcnt[g] = fdt_get(data + 48 + 8 * g, 8);
+  }
+  head->dcnt = fdt_get(data + 64, 8);
+  head->bsize = (unsigned int) fdt_get(data + 72, 4);
+  // sizes large enough to overflow the layout are not valid at all
+  if((head->version != FDT_VERSION) || ((head->flags & ~(FDT_PACKED | FDT_INDEXED)) != 0) || (head->ssize >> 48)
+     || (head->tcnt[0] >> 48) || (head->tcnt[1] >> 48) || (head->rcnt[0] >> 48) || (head->rcnt[1] >> 48))
+    return -1;
+  if((head->flags & FDT_PACKED) && ((head->dcnt > FDT_DICT) || (head->bsize == 0) || (head->bsize > FDT_BLOCK)))
+    return -1;
+  return 1;
+}
+
+/**
+ * \brief It computes the sections of a file
+ *
+ * Block index, checksum and size of packed files can't be computed from the
+ * header, they're left zero. So are checksum and size of indexed files, as
+ * well as the sections of their lookup index.
+ *
+ * \param head header of the file
+ * \param lay sections to be filled
+ */
+void
+fdt_layout (const struct fdt_head* head, struct fdt_layout* lay)
+{
+  unsigned long long pos;
+  int g;
+  pos = FDT_HEAD;
+  lay->soff = pos;
+  pos += 8 * ((unsigned long long) head->scnt + 1);
+  lay->names = pos;
+  pos += FDT_ALIGN(head->ssize);
+  lay->dict = lay->blocks = lay->index = lay->lookup = 0;
+  for(g = 0; g < 2; ++g)
+    lay->bcnt[g] = lay->nrun[g] = lay->run[g] = lay->poff[g] = lay->post[g] = 0;
+  if(head->flags & FDT_PACKED) {
+    // the block index is given by the trailer
+    lay->dict = pos;
+    lay->blocks = pos + 8 * head->dcnt;
+    for(g = 0; g < 2; ++g) {
+      lay->bcnt[g] = (head->tcnt[g] + head->bsize - 1) / head->bsize;
+      lay->vpart[g] = lay->roff[g] = lay->degree[g] = lay->tflag[g] = lay->ref[g] = 0;
+    }
+    lay->sum = lay->size = 0;
+    return;
+  }
+  for(g = 0; g < 2; ++g) {
+    lay->vpart[g] = pos;
+    pos += 8 * head->tcnt[g];
+    lay->roff[g] = pos;
+    pos += 8 * (head->tcnt[g] + 1);
+    lay->degree[g] = pos;
+    pos += FDT_ALIGN(4 * head->tcnt[g]);
+    lay->tflag[g] = pos;
+    pos += FDT_ALIGN(head->tcnt[g]);
+    lay->ref[g] = pos;
+    pos += FDT_ALIGN(4 * head->rcnt[g]);
+  }
+  if(head->flags & FDT_INDEXED) {
+    lay->lookup = pos;
+    lay->sum = lay->size = 0;
+  } else {
+    lay->sum = pos;
+    lay->size = pos + 8;
+  }
+}
+
+/**
+ * \brief It writes pending bytes
+ *
+ * \internal
+ *
+ * \param fo buffered output
+ */
+static void
+fo_flush (struct fdt_out* fo)
+{
+  fo->hash = fdt_hash(fo->hash, fo->buf, fo->cnt);
+  if((!fo->werr) && (fo->cnt > 0) && (fwrite(fo->buf, 1, fo->cnt, fo->file) != fo->cnt))
+    fo->werr = 1;
+  fo->cnt = 0;
+}
+
+/**
+ * \brief It puts a little-endian value
+ *
+ * \internal
+ *
+ * \param fo buffered output
+ * \param val value
+ * \param n number of bytes
+ */
+static void
+fo_put (struct fdt_out* fo, unsigned long long val, const int n)
+{
+  int iter;
+  if(fo->cnt + n > FDT_BUF) fo_flush(fo);
+  for(iter = 0; iter < n; ++iter) {
+    fo->buf[fo->cnt++] = (unsigned char) (val & 0xff);
+    val >>= 8;
+  }
+  fo->pos += n;
+}
+
+/**
+ * \brief It puts raw bytes
+ *
+ * \internal
+ *
+ * \param fo buffered output
+ * \param data bytes
+ * \param cnt number of bytes
+ */
+static void
+fo_bytes (struct fdt_out* fo, const void* data, size_t cnt)
+{
+  const unsigned char* ptr;
+  size_t len;
+  ptr = (const unsigned char*) data;
+  while(cnt > 0) {
+    if(fo->cnt == FDT_BUF) fo_flush(fo);
+    len = (cnt < FDT_BUF - fo->cnt) ? cnt : (FDT_BUF - fo->cnt);
+    memcpy(fo->buf + fo->cnt, ptr, len);
+    fo->cnt += len;
+    fo->pos += len;
+    ptr += len;
+    cnt -= len;
+  }
+}
+
+/**
+ * \brief It writes raw bytes out of the checksum
+ *
+ * \internal
+ * Pending bytes are written first, then \a data are written at once.
+ *
+ * \param fo buffered output
+ * \param data bytes
+ * \param cnt number of bytes
+ */
+static void
+fo_raw (struct fdt_out* fo, const unsigned char* data, size_t cnt)
+{
+  fo_flush(fo);
+  if((!fo->werr) && (cnt > 0) && (fwrite(data, 1, cnt, fo->file) != cnt))
+    fo->werr = 1;
+  fo->pos += cnt;
+}
+
+/**
+ * \brief It puts a varint into a growing buffer
+ *
+ * \internal
+ *
+ * \param fb growing buffer
+ * \param val value
+ */
+static void
+fb_varint (struct fdt_buf* fb, unsigned long long val)
+{
+  if(fb->cnt + 10 > fb->size) {
+    fb->size = 2 * fb->size + 10;
+    fb->data = XREALLOC(unsigned char, fb->data, fb->size);
+  }
+  while(val >= 0x80) {
+    fb->data[fb->cnt++] = (unsigned char) ((val & 0x7f) | 0x80);
+    val >>= 7;
+  }
+  fb->data[fb->cnt++] = (unsigned char) val;
+}
+
+/**
+ * \brief It puts a little-endian f64 into a growing buffer
+ *
+ * \internal
+ *
+ * \param fb growing buffer
+ * \param val value
+ */
+static void
+fb_double (struct fdt_buf* fb, const double val)
+{
+  unsigned long long bits;
+  int iter;
+  memcpy(&bits, &val, sizeof(bits));
+  if(fb->cnt + 8 > fb->size) {
+    fb->size = 2 * fb->size + 8;
+    fb->data = XREALLOC(unsigned char, fb->data, fb->size);
+  }
+  for(iter = 0; iter < 8; ++iter) {
+    fb->data[fb->cnt++] = (unsigned char) (bits & 0xff);
+    bits >>= 8;
+  }
+}
+
+/**
+ * \brief It reads a varint
+ *
+ * \internal
+ *
+ * \param data bytes
+ * \param size number of bytes
+ * \param pos position, moved past the varint
+ * \param val pointer to be used to store the value
+ * \return a positive value if the varint lies within the bytes, zero
+ *   otherwise
+ */
+static int
+fdt_varint (const unsigned char* data, const size_t size, size_t* pos, unsigned long long* val)
+{
+  int shift;
+  *val = 0;
+  for(shift = 0; (*pos < size) && (shift < 64); shift += 7) {
+    *val |= ((unsigned long long) (data[*pos] & 0x7f)) << shift;
+    if(!(data[(*pos)++] & 0x80)) return 1;
+  }
+  return 0;
+}
+
+/**
+ * \brief It looks for a coefficient
+ *
+ * \internal
+ *
+ * \param fd coefficients table
+ * \param key bits of the value
+ * \return slot of the value, or the free slot to be used
+ */
+static unsigned int
+fd_slot (const struct fdt_dict* fd, const unsigned long long key)
+{
+  unsigned int idx;
+  idx = (unsigned int) ((key * 0x9e3779b97f4a7c15ULL) >> 32) & (fd->size - 1);
+  while((fd->cnt[idx] != 0) && (fd->key[idx] != key))
+    idx = (idx + 1) & (fd->size - 1);
+  return idx;
+}
+
+/**
+ * \brief It counts a coefficient
+ *
+ * \internal
+ * New values are ignored once the table is full.
+ *
+ * \param fd coefficients table
+ * \param val value
+ */
+static void
+fd_add (struct fdt_dict* fd, const double val)
+{
+  unsigned long long key;
+  unsigned long long* okey;
+  unsigned long long* ocnt;
+  unsigned int osize;
+  unsigned int idx;
+  unsigned int iter;
+  memcpy(&key, &val, sizeof(key));
+  idx = fd_slot(fd, key);
+  if(fd->cnt[idx] != 0) ++(fd->cnt[idx]);
+  else if(fd->dcnt < FDT_DICT) {
+    fd->key[idx] = key;
+    fd->cnt[idx] = 1;
+    if(2 * ++(fd->dcnt) > fd->size) {
+      okey = fd->key;
+      ocnt = fd->cnt;
+      osize = fd->size;
+      fd->size *= 2;
+      fd->key = XMALLOC(unsigned long long, fd->size);
+      fd->cnt = XALLOC(unsigned long long, fd->size);
+      for(iter = 0; iter < osize; ++iter)
+	if(ocnt[iter] != 0) {
+	  idx = fd_slot(fd, okey[iter]);
+	  fd->key[idx] = okey[iter];
+	  fd->cnt[idx] = ocnt[iter];
+	}
+      XFREE(okey);
+      XFREE(ocnt);
+    }
+  }
+}
+
+/**
+ * \brief Compares coefficients by occurrences
+ *
+ * \internal
+ * \param a first slot
+ * \param b second slot
+ * \return comparison result, as required by qsort
+ */
+static int
+fd_compare (const void* a, const void* b)
+{
+  const unsigned long long* ca;
+  const unsigned long long* cb;
+  ca = (const unsigned long long*) a;
+  cb = (const unsigned long long*) b;
+  if(ca[0] != cb[0]) return (ca[0] < cb[0]) ? 1 : -1;
+  return (ca[1] > cb[1]) ? 1 : ((ca[1] < cb[1]) ? -1 : 0);
+}
+
+/**
+ * \brief It pads the section to a multiple of 8 bytes
+ *
+ * \internal
+ *
+ * \param fo buffered output
+ */
+static void
+fo_pad (struct fdt_out* fo)
+{
+  while(fo->pos % 8)
+    fo_put(fo, 0, 1);
+}
+
+/**
+ * \brief It looks for a name
+ *
+ * \internal
+ *
+ * \param fs names table
+ * \param name name to be looked for
+ * \return slot of the name, or the free slot to be used
+ */
+static unsigned int
+fs_slot (const struct fdt_syms* fs, const char* name)
+{
+  unsigned int idx;
+  idx = (unsigned int) fdt_hash(FDT_SEED, (const unsigned char*) name, strlen(name)) & (fs->ssize - 1);
+  while((fs->slot[idx] != 0) && strcmp(fs->name[fs->slot[idx] - 1], name))
+    idx = (idx + 1) & (fs->ssize - 1);
+  return idx;
+}
+
+/**
+ * \brief It adds a name, if it's not there yet
+ *
+ * \internal
+ *
+ * \param fs names table
+ * \param name name to be added
+ */
+static void
+fs_add (struct fdt_syms* fs, const char* name)
+{
+  unsigned int idx;
+  unsigned int iter;
+  idx = fs_slot(fs, name);
+  if(fs->slot[idx] == 0) {
+    if(fs->cnt == fs->size) {
+      fs->size *= 2;
+      fs->name = XREALLOC(char*, fs->name, fs->size);
+    }
+    fs->name[fs->cnt++] = xstrdup(name);
+    fs->slot[idx] = fs->cnt;
+    fs->bytes += strlen(name) + 1;
+    if(2 * fs->cnt > fs->ssize) {
+      XFREE(fs->slot);
+      fs->ssize *= 2;
+      fs->slot = XALLOC(unsigned int, fs->ssize);
+      for(iter = 0; iter < fs->cnt; ++iter)
+	fs->slot[fs_slot(fs, fs->name[iter])] = iter + 1;
+    }
+  }
+}
+
+/**
+ * \brief Compares names
+ *
+ * \internal
+ * \param a first name
+ * \param b second name
+ * \return comparison result, as required by qsort
+ */
+static int
+fs_compare (const void* a, const void* b)
+{
+  return strcmp(*((const char* const*) a), *((const char* const*) b));
+}
+
+/**
+ * \brief It writes the blocks of an expression (packed files)
+ *
+ * \internal
+ * Terms are encoded FDT_BLOCK at a time, each block is compressed if it gets
+ * smaller and written at once.
+ *
+ * \param fo buffered output
+ * \param fs names table
+ * \param fd coefficients table
+ * \param rank sorted position of each name
+ * \param cur cursor over the expression
+ * \param index block index to be filled (four values per block)
+ */
+static void
+fdt_pack (struct fdt_out* fo, const struct fdt_syms* fs, const struct fdt_dict* fd, const unsigned int* rank, struct ecursor* cur, unsigned long long* index)
+{
+  struct fdt_buf raw;
+  const char* name;
+  unsigned char* out;
+  unsigned long long cnt;
+  unsigned long long key;
+  unsigned long long sym;
+  unsigned long long prev;
+  unsigned long long diff;
+  unsigned long long size;
+  int method;
+#ifdef HAVE_ZLIB_H
+  uLongf zsize;
+#endif /* HAVE_ZLIB_H */
+  raw.size = 4096;
+  raw.data = XMALLOC(unsigned char, raw.size);
+  while(!cur->end) {
+    raw.cnt = 0;
+    for(cnt = 0; (cnt < FDT_BLOCK) && (!cur->end); ++cnt, cur->next(cur)) {
+      fb_varint(&raw, (((unsigned long long) cur->degree) << 1) | (cur->trunc ? 1 : 0));
+      memcpy(&key, &(cur->vpart), sizeof(key));
+      key = fd->idx[fd_slot(fd, key)];
+      fb_varint(&raw, key);
+      if(key == 0) fb_double(&raw, cur->vpart);
+      fb_varint(&raw, cur->etoken);
+      for(prev = 0; (name = cur->symbol(cur)) != NULL; prev = sym) {
+	sym = rank[fs->slot[fs_slot(fs, name)] - 1];
+	diff = sym - prev;
+	fb_varint(&raw, (diff << 1) ^ ((sym < prev) ? ~0ULL : 0ULL));
+      }
+    }
+    out = raw.data;
+    size = raw.cnt;
+    method = FDT_STORED;
+#ifdef HAVE_ZLIB_H
+    zsize = compressBound(raw.cnt);
+    out = XMALLOC(unsigned char, zsize);
+    if((compress2(out, &zsize, raw.data, raw.cnt, Z_DEFAULT_COMPRESSION) == Z_OK) && (zsize < raw.cnt)) {
+      size = zsize;
+      method = FDT_DEFLATED;
+    } else {
+      XFREE(out);
+      out = raw.data;
+    }
+#endif /* HAVE_ZLIB_H */
+    *(index++) = fo->pos;
+    *(index++) = fdt_hash(FDT_SEED, out, size);
+    *(index++) = (size << 32) | raw.cnt;
+    *(index++) = method;
+    fo_raw(fo, out, size);
+    if(out != raw.data) XFREE(out);
+  }
+  XFREE(raw.data);
+}
+
+/**
+ * \brief It writes the lookup index
+ *
+ * \internal
+ * Runs of terms with the same degree first, then the postings of each symbol,
+ * built part by part.
+ *
+ * \param fo buffered output
+ * \param fs names table
+ * \param rank sorted position of each name
+ * \param set how to set a cursor over numerator (0) or denominator (1)
+ * \param src source of the terms
+ * \param unit terms per posting
+ */
+static void
+fdt_lookup_put (struct fdt_out* fo, const struct fdt_syms* fs, const unsigned int* rank, fdt_set_t set, const void* src, const unsigned long long unit)
+{
+  struct fdt_buf post;
+  struct ecursor cur;
+  const char* name;
+  int degree;
+  unsigned long long* start;
+  unsigned long long* last;
+  unsigned long long* term;
+  unsigned long long nrun;
+  unsigned long long first;
+  unsigned long long cnt;
+  unsigned long long prev;
+  unsigned int sym;
+  int g;
+  // runs of terms with the same degree
+  for(g = 0; g < 2; ++g) {
+    for(nrun = 0, degree = 0, set(&cur, src, g); !cur.end; cur.next(&cur))
+      if((nrun == 0) || (cur.degree != degree)) {
+	degree = cur.degree;
+	++nrun;
+      }
+    fo_put(fo, nrun, 8);
+  }
+  for(g = 0; g < 2; ++g)
+    for(first = 0, set(&cur, src, g); !cur.end; first += cnt) {
+      for(cnt = 0, degree = cur.degree; (!cur.end) && (cur.degree == degree); cur.next(&cur))
+	++cnt;
+      fo_put(fo, (unsigned int) degree, 8);
+      fo_put(fo, first, 8);
+      fo_put(fo, cnt, 8);
+    }
+  // postings, each one once per term (block)
+  start = XALLOC(unsigned long long, fs->cnt + 1);
+  last = XMALLOC(unsigned long long, fs->cnt + 1);
+  post.size = 4096;
+  post.data = XMALLOC(unsigned char, post.size);
+  for(g = 0; g < 2; ++g) {
+    for(sym = 0; sym <= fs->cnt; ++sym) {
+      start[sym] = 0;
+      last[sym] = ~0ULL;
+    }
+    for(first = 0, set(&cur, src, g); !cur.end; cur.next(&cur), ++first)
+      while((name = cur.symbol(&cur)) != NULL) {
+	sym = rank[fs->slot[fs_slot(fs, name)] - 1];
+	if(last[sym] != first / unit) {
+	  last[sym] = first / unit;
+	  ++start[sym + 1];
+	}
+      }
+    for(sym = 0; sym < fs->cnt; ++sym) {
+      start[sym + 1] += start[sym];
+      last[sym] = ~0ULL;
+    }
+    term = XMALLOC(unsigned long long, start[fs->cnt] + 1);
+    for(first = 0, set(&cur, src, g); !cur.end; cur.next(&cur), ++first)
+      while((name = cur.symbol(&cur)) != NULL) {
+	sym = rank[fs->slot[fs_slot(fs, name)] - 1];
+	if(last[sym] != first / unit) {
+	  last[sym] = first / unit;
+	  term[start[sym]++] = first / unit;
+	}
+      }
+    // start[sym] is now the end of the postings of sym
+    post.cnt = 0;
+    for(cnt = 0, sym = 0; sym < fs->cnt; ++sym) {
+      fo_put(fo, post.cnt, 8);
+      for(prev = 0; cnt < start[sym]; prev = term[cnt++])
+	fb_varint(&post, term[cnt] - prev);
+    }
+    fo_put(fo, post.cnt, 8);
+    fo_bytes(fo, post.data, post.cnt);
+    fo_pad(fo);
+    XFREE(term);
+  }
+  XFREE(post.data);
+  XFREE(last);
+  XFREE(start);
+}
+
+/**
+ * \brief It sets a cursor over a %list of expressions
+ *
+ * \internal
+ *
+ * \param cur cursor to be set
+ * \param src numerator and denominator
+ * \param g numerator (0) or denominator (1)
+ */
+static void
+fdt_elist (struct ecursor* cur, const void* src, const int g)
+{
+  expr_cursor(cur, ((const expr_t* const*) src)[g]);
+}
+
+/**
+ * \brief How to put expressions on file (version 2).
+ *
+ * Numerator and denominator are written together, along with the names of
+ * their symbols, each one once and sorted, and the lookup index. Packed files
+ * are written a block at a time.
+ *
+ * \param num numerator
+ * \param den denominator
+ * \param file file to be used
+ * \param packed a positive value for packed files, zero otherwise
+ * \return number of errors occurred
+ */
+int
+fdt_to_file (const expr_t* num, const expr_t* den, FILE* file, const int packed)
+{
+  const expr_t* elist[2];
+  elist[0] = num;
+  elist[1] = den;
+  return fdt_write(fdt_elist, elist, file, packed);
+}
+
+/**
+ * \brief How to put expressions on file from any source (version 2).
+ *
+ * Like \e fdt_to_file, but the terms are read through cursors, so they
+ * don't have to be all in memory; the source is read a few times over.
+ *
+ * \param set how to set a cursor over numerator (0) or denominator (1)
+ * \param src source of the terms
+ * \param file file to be used
+ * \param packed a positive value for packed files, zero otherwise
+ * \return number of errors occurred
+ */
+int
+fdt_write (fdt_set_t set, const void* src, FILE* file, const int packed)
+{
+  struct fdt_out fo;
+  struct fdt_syms fs;
+  struct fdt_dict fd;
+  struct ecursor cur;
+  const char* name;
+  const char** sorted;
+  unsigned int* rank;
+  unsigned long long* order;
+  unsigned long long* index;
+  unsigned long long dcnt;
+  unsigned long long bcnt;
+  unsigned long long tcnt[2];
+  unsigned long long rcnt[2];
+  unsigned long long off;
+  unsigned long long bits;
+  unsigned int pos;
+  int g;
+  if(file == NULL) return 0;
+  fs.size = 64;
+  fs.cnt = 0;
+  fs.name = XMALLOC(char*, fs.size);
+  fs.ssize = 128;
+  fs.slot = XALLOC(unsigned int, fs.ssize);
+  fs.bytes = 0;
+  fd.size = 1024;
+  fd.dcnt = 0;
+  fd.key = XMALLOC(unsigned long long, fd.size);
+  fd.cnt = XALLOC(unsigned long long, fd.size);
+  fd.idx = NULL;
+  // symbols, coefficients and sizes
+  for(g = 0; g < 2; ++g) {
+    tcnt[g] = rcnt[g] = 0;
+    for(set(&cur, src, g); !cur.end; cur.next(&cur)) {
+      ++tcnt[g];
+      if(packed) fd_add(&fd, cur.vpart);
+      while((name = cur.symbol(&cur)) != NULL) {
+	fs_add(&fs, name);
+	++rcnt[g];
+      }
+    }
+  }
+  // names sorted, symbols numbered accordingly
+  sorted = XMALLOC(const char*, fs.cnt + 1);
+  rank = XMALLOC(unsigned int, fs.cnt + 1);
+  for(pos = 0; pos < fs.cnt; ++pos)
+    sorted[pos] = fs.name[pos];
+  qsort(sorted, fs.cnt, sizeof(const char*), fs_compare);
+  for(pos = 0; pos < fs.cnt; ++pos)
+    rank[fs.slot[fs_slot(&fs, sorted[pos])] - 1] = pos;
+  // dictionary, most frequent values first
+  dcnt = 0;
+  fd.idx = XALLOC(unsigned long long, fd.size);
+  order = XMALLOC(unsigned long long, 2 * fd.dcnt + 2);
+  for(pos = 0; pos < fd.size; ++pos)
+    if(fd.cnt[pos] > 1) {
+      order[2 * dcnt] = fd.cnt[pos];
+      order[2 * dcnt + 1] = fd.key[pos];
+      ++dcnt;
+    }
+  qsort(order, dcnt, 2 * sizeof(unsigned long long), fd_compare);
+  for(off = 0; off < dcnt; ++off)
+    fd.idx[fd_slot(&fd, order[2 * off + 1])] = off + 1;
+  fo.file = file;
+  fo.buf = XMALLOC(unsigned char, FDT_BUF);
+  fo.cnt = 0;
+  fo.pos = 0;
+  fo.hash = FDT_SEED;
+  fo.werr = 0;
+  // header
+  fo_bytes(&fo, FDT_MAGIC, strlen(FDT_MAGIC));
+  fo_put(&fo, FDT_VERSION, 4);
+  fo_put(&fo, FDT_INDEXED | (packed ? FDT_PACKED : 0), 4);
+  fo_put(&fo, fs.cnt, 4);
+  fo_put(&fo, 0, 4);
+  fo_put(&fo, fs.bytes, 8);
+  for(g = 0; g < 2; ++g)
+    fo_put(&fo, tcnt[g], 8);
+  for(g = 0; g < 2; ++g)
+    fo_put(&fo, rcnt[g], 8);
+  fo_put(&fo, packed ? dcnt : 0, 8);
+  fo_put(&fo, packed ? FDT_BLOCK : 0, 4);
+  while(fo.pos < FDT_HEAD)
+    fo_put(&fo, 0, 4);
+  // symbol names
+  for(off = 0, pos = 0; pos < fs.cnt; ++pos) {
+    fo_put(&fo, off, 8);
+    off += strlen(sorted[pos]) + 1;
+  }
+  fo_put(&fo, off, 8);
+  for(pos = 0; pos < fs.cnt; ++pos)
+    fo_bytes(&fo, sorted[pos], strlen(sorted[pos]) + 1);
+  fo_pad(&fo);
+  if(packed) {
+    // dictionary, blocks and their index
+    for(off = 0; off < dcnt; ++off)
+      fo_put(&fo, order[2 * off + 1], 8);
+    bcnt = (tcnt[0] + FDT_BLOCK - 1) / FDT_BLOCK + (tcnt[1] + FDT_BLOCK - 1) / FDT_BLOCK;
+    index = XMALLOC(unsigned long long, 4 * bcnt + 1);
+    set(&cur, src, 0);
+    fdt_pack(&fo, &fs, &fd, rank, &cur, index);
+    set(&cur, src, 1);
+    fdt_pack(&fo, &fs, &fd, rank, &cur, index + 4 * ((tcnt[0] + FDT_BLOCK - 1) / FDT_BLOCK));
+    fo_raw(&fo, (const unsigned char*) "\0\0\0\0\0\0\0", FDT_ALIGN(fo.pos) - fo.pos);
+    off = fo.pos;
+    for(pos = 0; pos < bcnt; ++pos) {
+      fo_put(&fo, index[4 * pos], 8);
+      fo_put(&fo, index[4 * pos + 1], 8);
+      fo_put(&fo, index[4 * pos + 2] >> 32, 4);
+      fo_put(&fo, index[4 * pos + 2] & 0xffffffffULL, 4);
+      fo_put(&fo, index[4 * pos + 3], 4);
+      fo_put(&fo, 0, 4);
+    }
+    fdt_lookup_put(&fo, &fs, rank, set, src, FDT_BLOCK);
+    fo_put(&fo, off, 8);
+    XFREE(index);
+  }
+  // terms, one array at a time
+  for(g = 0; (g < 2) && (!packed); ++g) {
+    for(set(&cur, src, g); !cur.end; cur.next(&cur)) {
+      memcpy(&bits, &(cur.vpart), sizeof(bits));
+      fo_put(&fo, bits, 8);
+    }
+    for(off = 0, set(&cur, src, g); !cur.end; cur.next(&cur)) {
+      fo_put(&fo, off, 8);
+      off += cur.etoken;
+    }
+    fo_put(&fo, off, 8);
+    for(set(&cur, src, g); !cur.end; cur.next(&cur))
+      fo_put(&fo, (unsigned int) cur.degree, 4);
+    fo_pad(&fo);
+    for(set(&cur, src, g); !cur.end; cur.next(&cur))
+      fo_put(&fo, cur.trunc ? 1 : 0, 1);
+    fo_pad(&fo);
+    for(set(&cur, src, g); !cur.end; cur.next(&cur))
+      while((name = cur.symbol(&cur)) != NULL)
+	fo_put(&fo, rank[fs.slot[fs_slot(&fs, name)] - 1], 4);
+    fo_pad(&fo);
+  }
+  if(!packed) fdt_lookup_put(&fo, &fs, rank, set, src, 1);
+  // checksum
+  fo_flush(&fo);
+  bits = fo.hash;
+  fo_put(&fo, bits, 8);
+  fo_flush(&fo);
+  XFREE(fo.buf);
+  XFREE(order);
+  XFREE(fd.idx);
+  XFREE(fd.cnt);
+  XFREE(fd.key);
+  XFREE(rank);
+  XFREE(sorted);
+  XFREE(fs.slot);
+  for(pos = 0; pos < fs.cnt; ++pos)
+    XFREE(fs.name[pos]);
+  XFREE(fs.name);
+  if(fo.werr)
+    warning("Some error occurs writing expression on file!");
+  return fo.werr;
+}
+
+/**
+ * \brief It checks a whole file
+ *
+ * \internal
+ * Checksum first, then every offset and every symbol is checked to lie within
+ * its section, so that cursors can trust the data.
+ *
+ * \param map mapped file
+ * \return a positive value if the data are consistent, zero otherwise
+ */
+static int
+fdt_check (const fdt_map_t* map)
+{
+  const unsigned char* data;
+  const struct fdt_head* head;
+  const struct fdt_layout* lay;
+  unsigned long long iter;
+  unsigned long long off;
+  unsigned long long next;
+  long long degree;
+  int g;
+  data = map->data;
+  head = &(map->head);
+  lay = &(map->lay);
+  if(head->flags & FDT_PACKED) {
+    // blocks are checked one at a time, when decoded
+    if(fdt_get(data + lay->sum, 8) != fdt_hash(fdt_hash(FDT_SEED, data, lay->blocks), data + lay->index, lay->sum - lay->index))
+      return 0;
+  } else if(fdt_get(data + lay->sum, 8) != fdt_hash(FDT_SEED, data, lay->sum))
+    return 0;
+  // names must lie within their section, NUL-terminated
+  for(iter = 0; iter < head->scnt; ++iter) {
+    off = fdt_get(data + lay->soff + 8 * iter, 8);
+    next = fdt_get(data + lay->soff + 8 * (iter + 1), 8);
+    if((next <= off) || (next > head->ssize) || (data[lay->names + next - 1] != '\0'))
+      return 0;
+  }
+  for(g = 0; (g < 2) && (!(head->flags & FDT_PACKED)); ++g) {
+    off = 0;
+    if(fdt_get(data + lay->roff[g], 8) != 0) return 0;
+    for(iter = 0; iter < head->tcnt[g]; ++iter) {
+      next = fdt_get(data + lay->roff[g] + 8 * (iter + 1), 8);
+      degree = (int) fdt_get(data + lay->degree[g] + 4 * iter, 4);
+      if((next < off) || (next - off > INT_MAX) || (degree < 0) || (degree > SHRT_MAX))
+	return 0;
+      off = next;
+    }
+    if(off != head->rcnt[g]) return 0;
+    for(iter = 0; iter < head->rcnt[g]; ++iter)
+      if(fdt_get(data + lay->ref[g] + 4 * iter, 4) >= head->scnt)
+	return 0;
+  }
+  return 1;
+}
+
+/**
+ * \brief It reads the lookup index
+ *
+ * \internal
+ * Runs must cover all the terms, in order, and postings must lie within the
+ * lookup index, that must end right where it's expected to. Postings are
+ * checked later, when decoded.
+ *
+ * \param map mapped file
+ * \param pos beginning of the lookup index
+ * \param end end of the lookup index
+ * \return a positive value if the lookup index is consistent, zero otherwise
+ */
+static int
+fdt_lookup_get (fdt_map_t* map, unsigned long long pos, const unsigned long long end)
+{
+  struct fdt_layout* lay;
+  unsigned long long iter;
+  unsigned long long first;
+  unsigned long long cnt;
+  unsigned long long off;
+  unsigned long long next;
+  int g;
+  lay = &(map->lay);
+  lay->lookup = pos;
+  if((pos > end) || (end - pos < 16)) return 0;
+  for(g = 0; g < 2; ++g)
+    if((lay->nrun[g] = fdt_get(map->data + pos + 8 * g, 8)) > map->head.tcnt[g])
+      return 0;
+  pos += 16;
+  for(g = 0; g < 2; ++g) {
+    if((end - pos) / 24 < lay->nrun[g]) return 0;
+    lay->run[g] = pos;
+    for(first = 0, iter = 0; iter < lay->nrun[g]; ++iter, pos += 24) {
+      cnt = fdt_get(map->data + pos + 16, 8);
+      if((fdt_get(map->data + pos, 8) > SHRT_MAX) || (fdt_get(map->data + pos + 8, 8) != first)
+	 || (cnt == 0) || (cnt > map->head.tcnt[g] - first))
+	return 0;
+      first += cnt;
+    }
+    if(first != map->head.tcnt[g]) return 0;
+  }
+  for(g = 0; g < 2; ++g) {
+    if((end - pos) / 8 < (unsigned long long) map->head.scnt + 1) return 0;
+    lay->poff[g] = pos;
+    pos += 8 * ((unsigned long long) map->head.scnt + 1);
+    lay->post[g] = pos;
+    if(fdt_get(map->data + lay->poff[g], 8) != 0) return 0;
+    for(off = 0, iter = 1; iter <= map->head.scnt; ++iter, off = next)
+      if((next = fdt_get(map->data + lay->poff[g] + 8 * iter, 8)) < off)
+	return 0;
+    if((off >> 48) || (FDT_ALIGN(off) > end - pos)) return 0;
+    pos += FDT_ALIGN(off);
+  }
+  return (pos == end);
+}
+
+/**
+ * \brief It reads the block index of a packed file
+ *
+ * \internal
+ * The trailer gives the block index, then blocks must follow each other from
+ * the first one to the index and their sizes must be sound. The lookup index
+ * follows the block index, if any.
+ *
+ * \param map mapped file
+ * \return a positive value if the index is consistent, zero otherwise
+ */
+static int
+fdt_index (fdt_map_t* map)
+{
+  const unsigned char* entry;
+  struct fdt_layout* lay;
+  unsigned long long bcnt;
+  unsigned long long iter;
+  unsigned long long off;
+  unsigned long long stored;
+  unsigned long long raw;
+  unsigned int method;
+  lay = &(map->lay);
+  bcnt = lay->bcnt[0] + lay->bcnt[1];
+  lay->size = map->size;
+  lay->sum = map->size - 8;
+  lay->index = fdt_get(map->data + map->size - 16, 8);
+  if((lay->index < lay->blocks) || (lay->index > map->size - 16) || (lay->index % 8 != 0) || ((map->size - 16 - lay->index) / 32 < bcnt))
+    return 0;
+  if(map->head.flags & FDT_INDEXED) {
+    if(!fdt_lookup_get(map, lay->index + 32 * bcnt, map->size - 16))
+      return 0;
+  } else if(lay->index + 32 * bcnt != map->size - 16)
+    return 0;
+  map->maxraw = 0;
+  for(off = lay->blocks, iter = 0; iter < bcnt; ++iter) {
+    entry = map->data + lay->index + 32 * iter;
+    stored = fdt_get(entry + 16, 4);
+    raw = fdt_get(entry + 20, 4);
+    method = (unsigned int) fdt_get(entry + 24, 4);
+    if((fdt_get(entry, 8) != off) || (stored > lay->index - off) || (raw == 0) || (raw > FDT_MAXRAW))
+      return 0;
+#ifdef HAVE_ZLIB_H
+    if((method != FDT_STORED) && (method != FDT_DEFLATED))
+      return 0;
+#else /* HAVE_ZLIB_H */
+    if(method != FDT_STORED)
+      return 0;
+#endif /* HAVE_ZLIB_H */
+    if((method == FDT_STORED) && (stored != raw))
+      return 0;
+    if(raw > map->maxraw) map->maxraw = raw;
+    off += stored;
+  }
+  return (FDT_ALIGN(off) == lay->index);
+}
+
+/**
+ * \brief It maps a file (version 2)
+ *
+ * If the file doesn't start with the magic number of version 2, it is rewound
+ * and nothing is mapped. Otherwise, the whole file is mapped in memory (or
+ * read at once, when it can't be mapped) and checked. Blocks of packed files
+ * are checked later, when decoded.
+ *
+ * \param file file to be used
+ * \return the mapped file, zero if it's not a version 2 one
+ */
+fdt_map_t*
+fdt_map (FILE* file)
+{
+  fdt_map_t* map;
+  unsigned char buf[FDT_HEAD];
+  struct fdt_head head;
+  void* data;
+  long size;
+  int rerr;
+  if((file == NULL) || (fread(buf, 1, FDT_HEAD, file) != FDT_HEAD) || (!(rerr = fdt_head_get(buf, &head)))) {
+    if(file != NULL) rewind(file);
+    return NULL;
+  }
+  map = XMALLOC(fdt_map_t, 1);
+  map->head = head;
+  fdt_layout(&head, &(map->lay));
+  map->data = NULL;
+  map->size = 0;
+  map->mapped = 0;
+  map->scratch = NULL;
+  map->held = NULL;
+  map->maxraw = 0;
+  rerr = (rerr < 0);
+  if((!rerr) && ((fseek(file, 0, SEEK_END) != 0) || ((size = ftell(file)) < 0)))
+    rerr = 1;
+  if((!rerr) && (head.flags & FDT_PACKED) && ((unsigned long long) size < map->lay.blocks + 16))
+    rerr = 1;
+  if((!rerr) && (!(head.flags & FDT_PACKED)) && (head.flags & FDT_INDEXED) && ((unsigned long long) size < map->lay.lookup + 8))
+    rerr = 1;
+  if((!rerr) && (!(head.flags & (FDT_PACKED | FDT_INDEXED))) && ((unsigned long long) size != map->lay.size))
+    rerr = 1;
+  if(!rerr) {
+    map->size = (size_t) size;
+    data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+    if(data != MAP_FAILED) {
+      map->mapped = 1;
+      madvise(data, map->size, MADV_SEQUENTIAL);
+    } else {
+      // read at once
+      data = XMALLOC(unsigned char, map->size);
+      rewind(file);
+      if(fread(data, 1, map->size, file) != map->size)
+	rerr = 1;
+    }
+    map->data = (const unsigned char*) data;
+  }
+  if((!rerr) && (head.flags & FDT_PACKED) && (!fdt_index(map)))
+    rerr = 1;
+  if((!rerr) && (!(head.flags & FDT_PACKED)) && (head.flags & FDT_INDEXED)) {
+    // the lookup index ends right before the checksum
+    map->lay.size = map->size;
+    map->lay.sum = map->size - 8;
+    if(!fdt_lookup_get(map, map->lay.lookup, map->lay.sum))
+      rerr = 1;
+  }
+  if((!rerr) && (!fdt_check(map)))
+    rerr = 1;
+  if((!rerr) && (head.flags & FDT_PACKED)) {
+    map->scratch = XMALLOC(unsigned char, map->maxraw + 1);
+    map->held = XALLOC(unsigned long long, 2);
+  }
+  if(rerr) {
+    fdt_unmap(map);
+    fatal("Error loading expression!");
+  }
+  return map;
+}
+
+/**
+ * \brief It unmaps a file
+ *
+ * \param map mapped file
+ */
+void
+fdt_unmap (fdt_map_t* map)
+{
+  void* data;
+  if(map != NULL) {
+    data = (void*) map->data;
+    if(map->mapped) munmap(data, map->size);
+    else XFREE(data);
+    XFREE(map->scratch);
+    XFREE(map->held);
+    XFREE(map);
+  }
+}
+
+/**
+ * \brief It loads the current term of a mapped cursor
+ *
+ * \internal
+ * Positions are the part (numerator or denominator), the current term, its
+ * next symbol and the first symbol of the following term.
+ *
+ * \param cur cursor
+ */
+static void
+fdt_load (struct ecursor* cur)
+{
+  const fdt_map_t* map;
+  unsigned long long term;
+  unsigned long long bits;
+  int g;
+  map = (const fdt_map_t*) cur->src;
+  g = (int) cur->idx[0];
+  term = cur->idx[1];
+  cur->end = (term >= map->head.tcnt[g]);
+  if(!cur->end) {
+    bits = fdt_get(map->data + map->lay.vpart[g] + 8 * term, 8);
+    memcpy(&(cur->vpart), &bits, sizeof(bits));
+    cur->idx[2] = fdt_get(map->data + map->lay.roff[g] + 8 * term, 8);
+    cur->idx[3] = fdt_get(map->data + map->lay.roff[g] + 8 * (term + 1), 8);
+    cur->etoken = (int) (cur->idx[3] - cur->idx[2]);
+    cur->degree = (int) fdt_get(map->data + map->lay.degree[g] + 4 * term, 4);
+    cur->trunc = map->data[map->lay.tflag[g] + term] & 1;
+  }
+}
+
+/**
+ * \brief It moves a mapped cursor to the next term
+ *
+ * \internal
+ *
+ * \param cur cursor
+ * \return a positive value if there is a term, zero otherwise
+ */
+static int
+fdt_next (struct ecursor* cur)
+{
+  if(!cur->end) {
+    ++(cur->idx[1]);
+    fdt_load(cur);
+  }
+  return !cur->end;
+}
+
+/**
+ * \brief It gives the next symbol of a mapped cursor
+ *
+ * \internal
+ * Names are not copied, they're given as they are in the file.
+ *
+ * \param cur cursor
+ * \return the symbol, NULL if there is none
+ */
+static const char*
+fdt_symbol (struct ecursor* cur)
+{
+  const fdt_map_t* map;
+  unsigned long long sym;
+  map = (const fdt_map_t*) cur->src;
+  if(cur->end || (cur->idx[2] >= cur->idx[3])) return NULL;
+  sym = fdt_get(map->data + map->lay.ref[cur->idx[0]] + 4 * (cur->idx[2]++), 4);
+  return (const char*) (map->data + map->lay.names + fdt_get(map->data + map->lay.soff + 8 * sym, 8));
+}
+
+/**
+ * \brief It decodes a block of a packed file
+ *
+ * Blocks don't depend on each other, so they can be decoded in any order (and
+ * at the same time, each one into its own buffer). The decoded block is fully
+ * checked, so that its terms can be read as they are.
+ *
+ * \param map mapped file
+ * \param g numerator (zero) or denominator (one)
+ * \param b block
+ * \param out buffer to be used, large enough for the largest block
+ *   (\e maxraw bytes)
+ * \return size of the decoded block, zero if the block is corrupted
+ */
+size_t
+fdt_block (const fdt_map_t* map, const int g, const unsigned long long b, unsigned char* out)
+{
+  const unsigned char* entry;
+  const unsigned char* data;
+  unsigned long long stored;
+  unsigned long long term;
+  unsigned long long nsym;
+  unsigned long long val;
+  unsigned long long sym;
+  size_t raw;
+  size_t pos;
+#ifdef HAVE_ZLIB_H
+  uLongf zsize;
+#endif /* HAVE_ZLIB_H */
+  if(b >= map->lay.bcnt[g]) return 0;
+  entry = map->data + map->lay.index + 32 * (b + (g ? map->lay.bcnt[0] : 0));
+  data = map->data + fdt_get(entry, 8);
+  stored = fdt_get(entry + 16, 4);
+  raw = (size_t) fdt_get(entry + 20, 4);
+  if(fdt_get(entry + 8, 8) != fdt_hash(FDT_SEED, data, stored))
+    return 0;
+  if(fdt_get(entry + 24, 4) == FDT_STORED) memcpy(out, data, raw);
+#ifdef HAVE_ZLIB_H
+  else {
+    zsize = raw;
+    if((uncompress(out, &zsize, data, stored) != Z_OK) || (zsize != raw))
+      return 0;
+  }
+#endif /* HAVE_ZLIB_H */
+  // terms of the block, up to the last byte
+  term = map->head.tcnt[g] - b * map->head.bsize;
+  if(term > map->head.bsize) term = map->head.bsize;
+  for(pos = 0; term > 0; --term) {
+    if((!fdt_varint(out, raw, &pos, &val)) || ((val >> 1) > SHRT_MAX)
+       || (!fdt_varint(out, raw, &pos, &val)) || (val > map->head.dcnt))
+      return 0;
+    if(val == 0) {
+      if(raw - pos < 8) return 0;
+      pos += 8;
+    }
+    if((!fdt_varint(out, raw, &pos, &nsym)) || (nsym > INT_MAX))
+      return 0;
+    for(sym = 0; nsym > 0; --nsym) {
+      if(!fdt_varint(out, raw, &pos, &val)) return 0;
+      sym += (val >> 1) ^ (~(val & 1) + 1);
+      if(sym >= map->head.scnt) return 0;
+    }
+  }
+  return (pos == raw) ? raw : 0;
+}
+
+/**
+ * \brief It makes the block of a packed cursor the decoded one
+ *
+ * \internal
+ * Cursors share the decoded block of the map, it's decoded again whenever it
+ * has been replaced by another cursor.
+ *
+ * \param cur cursor (on a term)
+ */
+static void
+fdt_hold (const struct ecursor* cur)
+{
+  const fdt_map_t* map;
+  unsigned long long block;
+  map = (const fdt_map_t*) cur->src;
+  block = cur->idx[1] / map->head.bsize;
+  if((map->held[0] != cur->idx[0]) || (map->held[1] != block + 1)) {
+    if(!fdt_block(map, (int) cur->idx[0], block, map->scratch))
+      fatal("Error loading expression!");
+    map->held[0] = cur->idx[0];
+    map->held[1] = block + 1;
+  }
+}
+
+/**
+ * \brief It loads the current term of a packed cursor
+ *
+ * \internal
+ * Positions are the part (numerator or denominator), the current term, the
+ * next byte of the decoded block, the symbols left and the last symbol.
+ *
+ * \param cur cursor
+ */
+static void
+fdt_pload (struct ecursor* cur)
+{
+  const fdt_map_t* map;
+  unsigned long long term;
+  unsigned long long val;
+  size_t pos;
+  int g;
+  map = (const fdt_map_t*) cur->src;
+  g = (int) cur->idx[0];
+  term = cur->idx[1];
+  cur->end = (term >= map->head.tcnt[g]);
+  if(!cur->end) {
+    if(term % map->head.bsize == 0) cur->idx[2] = 0;
+    fdt_hold(cur);
+    pos = (size_t) cur->idx[2];
+    fdt_varint(map->scratch, map->maxraw, &pos, &val);
+    cur->degree = (int) (val >> 1);
+    cur->trunc = (int) (val & 1);
+    fdt_varint(map->scratch, map->maxraw, &pos, &val);
+    if(val == 0) {
+      val = fdt_get(map->scratch + pos, 8);
+      pos += 8;
+    } else val = fdt_get(map->data + map->lay.dict + 8 * (val - 1), 8);
+    memcpy(&(cur->vpart), &val, sizeof(val));
+    fdt_varint(map->scratch, map->maxraw, &pos, &val);
+    cur->etoken = (int) val;
+    cur->idx[2] = pos;
+    cur->idx[3] = val;
+    cur->idx[4] = 0;
+  }
+}
+
+/**
+ * \brief It moves a packed cursor to the next term
+ *
+ * \internal
+ * Symbols not yet read are skipped.
+ *
+ * \param cur cursor
+ * \return a positive value if there is a term, zero otherwise
+ */
+static int
+fdt_pnext (struct ecursor* cur)
+{
+  const fdt_map_t* map;
+  unsigned long long val;
+  size_t pos;
+  if(!cur->end) {
+    map = (const fdt_map_t*) cur->src;
+    pos = (size_t) cur->idx[2];
+    if(cur->idx[3] > 0) fdt_hold(cur);
+    for(; cur->idx[3] > 0; --(cur->idx[3]))
+      fdt_varint(map->scratch, map->maxraw, &pos, &val);
+    cur->idx[2] = pos;
+    ++(cur->idx[1]);
+    fdt_pload(cur);
+  }
+  return !cur->end;
+}
+
+/**
+ * \brief It gives the next symbol of a packed cursor
+ *
+ * \internal
+ *
+ * \param cur cursor
+ * \return the symbol, NULL if there is none
+ */
+static const char*
+fdt_psymbol (struct ecursor* cur)
+{
+  const fdt_map_t* map;
+  unsigned long long val;
+  size_t pos;
+  map = (const fdt_map_t*) cur->src;
+  if(cur->end || (cur->idx[3] == 0)) return NULL;
+  fdt_hold(cur);
+  pos = (size_t) cur->idx[2];
+  fdt_varint(map->scratch, map->maxraw, &pos, &val);
+  cur->idx[2] = pos;
+  cur->idx[4] += (val >> 1) ^ (~(val & 1) + 1);
+  --(cur->idx[3]);
+  return (const char*) (map->data + map->lay.names + fdt_get(map->data + map->lay.soff + 8 * cur->idx[4], 8));
+}
+
+/**
+ * \brief It sets a cursor over a mapped file
+ *
+ * Cursors over packed files share one decoded block per map, they can be
+ * used together but they're faster one at a time.
+ *
+ * \param cur cursor to be set (on the first term)
+ * \param map mapped file
+ * \param g numerator (zero) or denominator (one)
+ */
+void
+fdt_cursor (struct ecursor* cur, const fdt_map_t* map, const int g)
+{
+  cur->src = map;
+  cur->hook = NULL;
+  cur->idx[0] = g;
+  cur->idx[1] = 0;
+  if(map->head.flags & FDT_PACKED) {
+    cur->next = fdt_pnext;
+    cur->symbol = fdt_psymbol;
+    fdt_pload(cur);
+  } else {
+    cur->next = fdt_next;
+    cur->symbol = fdt_symbol;
+    fdt_load(cur);
+  }
+}
+
+/**
+ * \brief It moves a cursor over a mapped file to a term
+ *
+ * Terms of plain files are reached at once. Terms of packed files are reached
+ * from the beginning of their block, unless the cursor is already on a
+ * previous term of the same block.
+ *
+ * \param cur cursor (set by \e fdt_cursor)
+ * \param term term to be reached (past the last one means the end)
+ */
+void
+fdt_seek (struct ecursor* cur, const unsigned long long term)
+{
+  const fdt_map_t* map;
+  unsigned long long bsize;
+  map = (const fdt_map_t*) cur->src;
+  if(map->head.flags & FDT_PACKED) {
+    bsize = map->head.bsize;
+    if(cur->end || (term < cur->idx[1]) || (term / bsize != cur->idx[1] / bsize)) {
+      cur->idx[1] = term - term % bsize;
+      fdt_pload(cur);
+    }
+    while((!cur->end) && (cur->idx[1] < term))
+      fdt_pnext(cur);
+  } else {
+    cur->idx[1] = term;
+    fdt_load(cur);
+  }
+}
+
+/**
+ * \brief It looks for a symbol into the current term
+ *
+ * \internal
+ * Symbols are not read, the cursor doesn't move.
+ *
+ * \param cur cursor (set by \e fdt_cursor)
+ * \param sym symbol
+ * \return a positive value if the term contains the symbol, zero otherwise
+ */
+static int
+fdt_has (const struct ecursor* cur, const unsigned long long sym)
+{
+  const fdt_map_t* map;
+  unsigned long long iter;
+  unsigned long long val;
+  unsigned long long prev;
+  size_t pos;
+  map = (const fdt_map_t*) cur->src;
+  if(map->head.flags & FDT_PACKED) {
+    if(cur->idx[3] > 0) fdt_hold(cur);
+    pos = (size_t) cur->idx[2];
+    for(prev = cur->idx[4], iter = cur->idx[3]; iter > 0; --iter) {
+      fdt_varint(map->scratch, map->maxraw, &pos, &val);
+      prev += (val >> 1) ^ (~(val & 1) + 1);
+      if(prev == sym) return 1;
+    }
+  } else
+    for(iter = cur->idx[2]; iter < cur->idx[3]; ++iter)
+      if(fdt_get(map->data + map->lay.ref[cur->idx[0]] + 4 * iter, 4) == sym)
+	return 1;
+  return 0;
+}
+
+/**
+ * \brief It looks for a symbol by name
+ *
+ * \internal
+ * Names of indexed files are sorted, they're looked for by bisection.
+ *
+ * \param map mapped file
+ * \param name name of the symbol
+ * \param sym pointer to be used to store the symbol
+ * \return a positive value if the symbol has been found, zero otherwise
+ */
+static int
+fdt_find (const fdt_map_t* map, const char* name, unsigned long long* sym)
+{
+  unsigned long long lo;
+  unsigned long long hi;
+  int cmp;
+  lo = 0;
+  hi = map->head.scnt;
+  while(lo < hi) {
+    *sym = (map->head.flags & FDT_INDEXED) ? (lo + (hi - lo) / 2) : lo;
+    cmp = strcmp(name, (const char*) (map->data + map->lay.names + fdt_get(map->data + map->lay.soff + 8 * (*sym), 8)));
+    if(cmp == 0) return 1;
+    if(!(map->head.flags & FDT_INDEXED)) ++lo;
+    else if(cmp < 0) hi = *sym;
+    else lo = *sym + 1;
+  }
+  return 0;
+}
+
+/**
+ * \brief It decodes the postings of a symbol
+ *
+ * \internal
+ *
+ * \param map mapped file (indexed)
+ * \param g numerator (zero) or denominator (one)
+ * \param sym symbol
+ * \param cnt pointer to be used to store the number of postings
+ * \return the postings, in increasing order
+ */
+static unsigned long long*
+fdt_postings (const fdt_map_t* map, const int g, const unsigned long long sym, unsigned long long* cnt)
+{
+  unsigned long long* post;
+  unsigned long long limit;
+  unsigned long long val;
+  unsigned long long prev;
+  size_t off;
+  size_t end;
+  off = (size_t) fdt_get(map->data + map->lay.poff[g] + 8 * sym, 8);
+  end = (size_t) fdt_get(map->data + map->lay.poff[g] + 8 * (sym + 1), 8);
+  limit = (map->head.flags & FDT_PACKED) ? map->lay.bcnt[g] : map->head.tcnt[g];
+  post = XMALLOC(unsigned long long, end - off + 1);
+  for(*cnt = 0, prev = 0; off < end; prev = post[(*cnt)++]) {
+    // each posting follows the previous one
+    if((!fdt_varint(map->data + map->lay.post[g], end, &off, &val)) || (val >= limit - prev)
+       || ((*cnt > 0) && (val == 0)))
+      fatal("Error loading expression!");
+    post[*cnt] = prev + val;
+  }
+  return post;
+}
+
+/**
+ * \brief It sets a query over a mapped file
+ *
+ * Postings of the symbols the terms must contain are intersected, so that
+ * only the terms (blocks) that contain all of them are looked at. Files
+ * without the lookup index are scanned term by term.
+ *
+ * \param map mapped file
+ * \param g numerator (zero) or denominator (one)
+ * \param degmin lowest degree
+ * \param degmax highest degree
+ * \param with symbols the terms must contain (NULL terminated)
+ * \param without symbols the terms must not contain (NULL terminated)
+ * \return the query
+ */
+fdt_query_t*
+fdt_query_new (const fdt_map_t* map, const int g, const int degmin, const int degmax, char** with, char** without)
+{
+  fdt_query_t* query;
+  unsigned long long* post;
+  unsigned long long cnt;
+  unsigned long long iter;
+  unsigned long long keep;
+  unsigned long long pos;
+  int n;
+  query = XMALLOC(fdt_query_t, 1);
+  query->map = map;
+  query->g = g;
+  query->degmin = degmin;
+  query->degmax = degmax;
+  query->none = 0;
+  for(n = 0; with[n] != NULL; ++n);
+  query->with = XMALLOC(unsigned long long, n + 1);
+  for(n = 0; without[n] != NULL; ++n);
+  query->without = XMALLOC(unsigned long long, n + 1);
+  query->nwith = query->nwithout = 0;
+  for(n = 0; with[n] != NULL; ++n)
+    if(fdt_find(map, with[n], query->with + query->nwith)) ++(query->nwith);
+    else query->none = 1;
+  for(n = 0; without[n] != NULL; ++n)
+    if(fdt_find(map, without[n], query->without + query->nwithout)) ++(query->nwithout);
+  query->unit = (map->head.flags & FDT_PACKED) ? map->head.bsize : 1;
+  query->cand = NULL;
+  query->ccnt = 0;
+  if((map->head.flags & FDT_INDEXED) && (!query->none))
+    for(n = 0; n < query->nwith; ++n) {
+      post = fdt_postings(map, g, query->with[n], &cnt);
+      if(query->cand == NULL) {
+	query->cand = post;
+	query->ccnt = cnt;
+      } else {
+	// intersection, both are sorted
+	for(keep = 0, pos = 0, iter = 0; (iter < query->ccnt) && (pos < cnt); )
+	  if(query->cand[iter] < post[pos]) ++iter;
+	  else if(query->cand[iter] > post[pos]) ++pos;
+	  else {
+	    query->cand[keep++] = query->cand[iter++];
+	    ++pos;
+	  }
+	query->ccnt = keep;
+	XFREE(post);
+      }
+    }
+  return query;
+}
+
+/**
+ * \brief It moves a query cursor to the next matching term
+ *
+ * \internal
+ * Runs of terms out of the range of degrees are skipped, as well as terms
+ * (blocks) that aren't candidate ones.
+ *
+ * \param cur cursor
+ * \return a positive value if there is a term, zero otherwise
+ */
+static int
+fdt_qnext (struct ecursor* cur)
+{
+  fdt_query_t* query;
+  const fdt_map_t* map;
+  const unsigned char* run;
+  unsigned long long term;
+  int match;
+  int n;
+  query = (fdt_query_t*) cur->hook;
+  map = query->map;
+  cur->end = 1;
+  for(term = query->term; (!query->none) && cur->end; ) {
+    if(map->head.flags & FDT_INDEXED) {
+      while(query->rpos < map->lay.nrun[query->g]) {
+	run = map->data + map->lay.run[query->g] + 24 * query->rpos;
+	if((fdt_get(run + 8, 8) + fdt_get(run + 16, 8) > term)
+	   && ((long long) fdt_get(run, 8) >= query->degmin) && ((long long) fdt_get(run, 8) <= query->degmax))
+	  break;
+	++(query->rpos);
+      }
+      if(query->rpos == map->lay.nrun[query->g]) break;
+      run = map->data + map->lay.run[query->g] + 24 * query->rpos;
+      if(term < fdt_get(run + 8, 8)) term = fdt_get(run + 8, 8);
+    } else if(term >= map->head.tcnt[query->g])
+      break;
+    if(query->cand != NULL) {
+      while((query->cpos < query->ccnt) && (query->cand[query->cpos] < term / query->unit))
+	++(query->cpos);
+      if(query->cpos == query->ccnt) break;
+      if(query->cand[query->cpos] > term / query->unit) {
+	term = query->cand[query->cpos] * query->unit;
+	continue;
+      }
+    }
+    fdt_seek(&(query->inner), term++);
+    match = (query->inner.degree >= query->degmin) && (query->inner.degree <= query->degmax);
+    for(n = 0; match && (n < query->nwith); ++n)
+      match = fdt_has(&(query->inner), query->with[n]);
+    for(n = 0; match && (n < query->nwithout); ++n)
+      match = !fdt_has(&(query->inner), query->without[n]);
+    if(match) {
+      cur->vpart = query->inner.vpart;
+      cur->etoken = query->inner.etoken;
+      cur->degree = query->inner.degree;
+      cur->trunc = query->inner.trunc;
+      cur->end = 0;
+    }
+  }
+  query->term = term;
+  return !cur->end;
+}
+
+/**
+ * \brief It gives the next symbol of a query cursor
+ *
+ * \internal
+ *
+ * \param cur cursor
+ * \return the symbol, NULL if there is none
+ */
+static const char*
+fdt_qsymbol (struct ecursor* cur)
+{
+  fdt_query_t* query;
+  query = (fdt_query_t*) cur->hook;
+  if(cur->end) return NULL;
+  return (*(query->inner.symbol))(&(query->inner));
+}
+
+/**
+ * \brief It sets a cursor over the terms a query matches
+ *
+ * The cursor can be set over and over again, from the first matching term.
+ *
+ * \param cur cursor to be set
+ * \param query query
+ */
+void
+fdt_query_cursor (struct ecursor* cur, fdt_query_t* query)
+{
+  cur->next = fdt_qnext;
+  cur->symbol = fdt_qsymbol;
+  cur->src = query->map;
+  cur->hook = query;
+  fdt_cursor(&(query->inner), query->map, query->g);
+  query->cpos = query->rpos = query->term = 0;
+  fdt_qnext(cur);
+}
+
+/**
+ * \brief It deletes a query
+ *
+ * \param query query
+ */
+void
+fdt_query_del (fdt_query_t* query)
+{
+  if(query != NULL) {
+    XFREE(query->cand);
+    XFREE(query->with);
+    XFREE(query->without);
+    XFREE(query);
+  }
+}
+
+/**
+ * \brief It rebuilds an expression
+ *
+ * \internal
+ *
+ * \param cur cursor over the expression
+ * \return the expression
+ */
+static expr_t*
+fdt_decode (struct ecursor* cur)
+{
+  expr_t* elist;
+  expr_t** eiter;
+  expr_t* eslice;
+  list_t** hook;
+  const char* name;
+  elist = NULL;
+  eiter = &elist;
+  while(!cur->end) {
+    eslice = expr_new();
+    eslice->vpart = cur->vpart;
+    eslice->etoken = cur->etoken;
+    eslice->degree = (short int) cur->degree;
+    eslice->trunc = (short int) cur->trunc;
+    hook = &(eslice->epart);
+    while((name = (*(cur->symbol))(cur)) != NULL) {
+      *hook = list_new((void*) xstrdup(name));
+      hook = &((*hook)->next);
+    }
+    *eiter = eslice;
+    eiter = &((*eiter)->next);
+    (*(cur->next))(cur);
+  }
+  return elist;
+}
+
+/**
+ * \brief How to retrieve expressions from file (version 2).
+ *
+ * If the file doesn't start with the magic number of version 2, it is rewound
+ * and nothing is loaded. Otherwise, the file is mapped and the expressions are
+ * rebuilt from it.
+ *
+ * \param file file to be used
+ * \param num pointer to be used to store the numerator
+ * \param den pointer to be used to store the denominator
+ * \result a positive value if the expressions have been loaded, zero otherwise
+ */
+int
+fdt_from_file (FILE* file, expr_t** num, expr_t** den)
+{
+  struct ecursor cur;
+  fdt_map_t* map;
+  if((map = fdt_map(file)) == NULL)
+    return 0;
+  fdt_cursor(&cur, map, 0);
+  *num = fdt_decode(&cur);
+  fdt_cursor(&cur, map, 1);
+  *den = fdt_decode(&cur);
+  fdt_unmap(map);
+  return 1;
+}
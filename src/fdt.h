@@ -0,0 +1,286 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file fdt.h
+ *
+ * \brief Portable .fdt files
+ *
+ * This file contains the layout of version 2 of the .fdt files, together with
+ * the prototypes of the functions that write, read and map it.
+ * <br> All the values are little-endian, whatever the host is, and every
+ * section starts on a multiple of 8 bytes (padded with zeros):
+ * - header (see %struct %fdt_head), 80 bytes starting with "SPCNGFD2";
+ * - offsets of the symbol names into the names section (u64, one more than
+ *   the symbols);
+ * - symbol names, NUL-terminated, each one stored once;
+ * - for the numerator and then for the denominator: numeric parts (f64, one
+ *   per term), offsets of the symbols of each term into the symbols section
+ *   (u64, one more than the terms), degrees (i32), flags (u8, bit 0 is the
+ *   truncation marker) and symbols of all the terms (u32, index of the name);
+ * - lookup index (flag FDT_INDEXED, see below);
+ * - checksum of all the previous bytes (u64, 64-bit FNV-1a).
+ *
+ * Packed files (flag FDT_PACKED) keep the header and the symbol names, then:
+ * - coefficients dictionary (f64, the values that occur more than once, most
+ *   frequent first);
+ * - blocks of up to FDT_BLOCK terms, numerator first, each one compressed on
+ *   its own (zlib) or stored as it is;
+ * - block index (32 bytes per block: u64 offset, u64 checksum of the stored
+ *   bytes, u32 stored size, u32 decoded size, u32 method, u32 reserved);
+ * - lookup index (flag FDT_INDEXED, see below);
+ * - offset of the block index (u64);
+ * - checksum of all the previous bytes but the blocks and their padding
+ *   (u64).
+ *
+ * A decoded block is a sequence of terms, each one made of varints: degree
+ * times two plus truncation marker, coefficient (index into the dictionary
+ * plus one, or zero followed by the f64 value), number of symbols and then the
+ * symbols, each one as the zigzag-coded difference from the previous one
+ * (from zero for the first one). Symbol names are sorted, so that differences
+ * within sorted terms are small and positive.
+ *
+ * The lookup index lets queries read only the terms they ask for:
+ * - number of runs of terms with the same degree (u64, numerator and
+ *   denominator);
+ * - for the numerator and then for the denominator, the runs (u64 degree, u64
+ *   first term, u64 number of terms);
+ * - for the numerator and then for the denominator, offsets of the postings
+ *   of each symbol into the postings section (u64, one more than the
+ *   symbols), then the postings (varints, padded): the terms (blocks, for
+ *   packed files) that contain the symbol, each one as the difference from
+ *   the previous one (from zero for the first one).
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef FDT_H
+#define FDT_H 1
+
+#include "common.h"
+#include "expr.h"
+
+/**
+ * \brief Magic number of version 2
+ */
+#define FDT_MAGIC "SPCNGFD2"
+
+/**
+ * \brief Format version
+ */
+#define FDT_VERSION 2
+
+/**
+ * \brief Header size (bytes)
+ */
+#define FDT_HEAD 80
+
+/**
+ * \brief Packed file flag
+ */
+#define FDT_PACKED 0x01
+
+/**
+ * \brief Indexed file flag
+ */
+#define FDT_INDEXED 0x02
+
+/**
+ * \brief Terms per block (packed files)
+ */
+#define FDT_BLOCK 4096
+
+/**
+ * \brief Block stored as it is (packed files)
+ */
+#define FDT_STORED 0
+
+/**
+ * \brief Block compressed by means of zlib (packed files)
+ */
+#define FDT_DEFLATED 1
+
+/**
+ * \brief Initial value of the checksum
+ */
+#define FDT_SEED 0xcbf29ce484222325ULL
+
+/**
+ * \brief Header of a .fdt file
+ *
+ * Offsets within the header are given in brackets, the remaining bytes are
+ * reserved (zero).
+ */
+struct fdt_head
+{
+  unsigned int version;  /**< Format version [8, u32] */
+  unsigned int flags;  /**< Format flags (FDT_PACKED, FDT_INDEXED) [12, u32] */
+  unsigned int scnt;  /**< Number of symbols [16, u32] */
+  unsigned long long ssize;  /**< Size of the symbol names [24, u64] */
+  unsigned long long tcnt[2];  /**< Number of terms (numerator and denominator) [32, u64] */
+  unsigned long long rcnt[2];  /**< Number of symbols of all the terms (numerator and denominator) [48, u64] */
+  unsigned long long dcnt;  /**< Coefficients into the dictionary (packed files) [64, u64] */
+  unsigned int bsize;  /**< Terms per block (packed files) [72, u32] */
+};
+
+/**
+ * \brief Sections of a .fdt file
+ *
+ * Offsets from the beginning of the file, as given by the header (and by the
+ * trailer and the lookup index, if any).
+ */
+struct fdt_layout
+{
+  unsigned long long soff;  /**< Offsets of the symbol names */
+  unsigned long long names;  /**< Symbol names */
+  unsigned long long vpart[2];  /**< Numeric parts */
+  unsigned long long roff[2];  /**< Offsets of the symbols of the terms */
+  unsigned long long degree[2];  /**< Degrees */
+  unsigned long long tflag[2];  /**< Flags */
+  unsigned long long ref[2];  /**< Symbols of the terms */
+  unsigned long long dict;  /**< Coefficients dictionary (packed files) */
+  unsigned long long blocks;  /**< First block (packed files) */
+  unsigned long long bcnt[2];  /**< Number of blocks (packed files) */
+  unsigned long long index;  /**< Block index (packed files) */
+  unsigned long long lookup;  /**< Lookup index (indexed files) */
+  unsigned long long nrun[2];  /**< Number of runs of terms (indexed files) */
+  unsigned long long run[2];  /**< Runs of terms (indexed files) */
+  unsigned long long poff[2];  /**< Offsets of the postings (indexed files) */
+  unsigned long long post[2];  /**< Postings (indexed files) */
+  unsigned long long sum;  /**< Checksum */
+  unsigned long long size;  /**< Whole file */
+};
+
+/**
+ * \brief Mapped .fdt file
+ */
+struct fdt_map
+{
+  const unsigned char* data;  /**< Whole file */
+  size_t size;  /**< Size of the file */
+  int mapped;  /**< Data are mapped (they're allocated otherwise) */
+  struct fdt_head head;  /**< Header */
+  struct fdt_layout lay;  /**< Sections */
+  unsigned char* scratch;  /**< Decoded block of the cursors (packed files) */
+  unsigned long long* held;  /**< Part and block (plus one) decoded into scratch (packed files) */
+  unsigned long long maxraw;  /**< Largest decoded block (packed files) */
+};
+
+/**
+ * \brief Simpler %struct %fdt_map definition
+ */
+typedef
+struct fdt_map
+fdt_map_t;
+
+/**
+ * \brief Query over a mapped .fdt file
+ *
+ * Terms of a part (numerator or denominator) whose degree lies within a range
+ * and that contain all the given symbols and none of the others. Candidate
+ * terms are given by the lookup index, when there is one.
+ */
+struct fdt_query
+{
+  const fdt_map_t* map;  /**< Mapped file */
+  struct ecursor inner;  /**< Cursor over the file */
+  int g;  /**< Numerator (zero) or denominator (one) */
+  int degmin;  /**< Lowest degree */
+  int degmax;  /**< Highest degree */
+  int none;  /**< No term can match */
+  unsigned long long* with;  /**< Symbols the terms must contain */
+  int nwith;  /**< Number of symbols the terms must contain */
+  unsigned long long* without;  /**< Symbols the terms must not contain */
+  int nwithout;  /**< Number of symbols the terms must not contain */
+  unsigned long long unit;  /**< Terms per posting (one, or a block) */
+  unsigned long long* cand;  /**< Candidate postings (NULL means all) */
+  unsigned long long ccnt;  /**< Number of candidate postings */
+  unsigned long long cpos;  /**< Current candidate posting */
+  unsigned long long rpos;  /**< Current run */
+  unsigned long long term;  /**< Next term to be looked at */
+};
+
+/**
+ * \brief Simpler %struct %fdt_query definition
+ */
+typedef
+struct fdt_query
+fdt_query_t;
+
+/**
+ * \brief How to set a cursor over the numerator (0) or the denominator (1)
+ *
+ * Sources of terms other than lists of expressions can be put on file by
+ * means of \e fdt_write, as long as their cursors can be set over and over.
+ */
+typedef
+void (*fdt_set_t) (struct ecursor*, const void*, const int);
+
+extern int
+fdt_head_get (const unsigned char*, struct fdt_head*);
+
+extern void
+fdt_layout (const struct fdt_head*, struct fdt_layout*);
+
+extern unsigned long long
+fdt_hash (unsigned long long, const unsigned char*, size_t);
+
+extern int
+fdt_to_file (const expr_t*, const expr_t*, FILE*, const int);
+
+extern int
+fdt_write (fdt_set_t, const void*, FILE*, const int);
+
+extern int
+fdt_from_file (FILE*, expr_t**, expr_t**);
+
+extern fdt_map_t*
+fdt_map (FILE*);
+
+extern void
+fdt_unmap (fdt_map_t*);
+
+extern size_t
+fdt_block (const fdt_map_t*, const int, const unsigned long long, unsigned char*);
+
+extern void
+fdt_cursor (struct ecursor*, const fdt_map_t*, const int);
+
+extern void
+fdt_seek (struct ecursor*, const unsigned long long);
+
+extern fdt_query_t*
+fdt_query_new (const fdt_map_t*, const int, const int, const int, char**, char**);
+
+extern void
+fdt_query_cursor (struct ecursor*, fdt_query_t*);
+
+extern void
+fdt_query_del (fdt_query_t*);
+
+#endif /* FDT_H */
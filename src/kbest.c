@@ -0,0 +1,616 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file kbest.c
+ *
+ * \brief K-best dominant common trees finder
+ *
+ * This file contains a lighter relative of grimbleby's algorithm: instead of
+ * finding all the common trees, it keeps only the k highest-magnitude common
+ * trees for each power of s. The magnitude of a tree is the magnitude of the
+ * token it turns into, so that edges are weighted with log|value| (admittances
+ * when they are into the tree, impedances when they are out of the tree) and
+ * a branch-and-bound search discards branches which can't contribute.
+ * <br> Required and forbidden symbols force their edges into or out of the
+ * tree before the search starts, so that the trees are ranked among those
+ * that satisfy the constraints.
+ */
+
+#include <math.h>
+
+#include "common.h"
+#include "list.h"
+#include "circuit.h"
+#include "expr.h"
+#include "ctree.h"
+
+/**
+ * \brief Logarithm of a null value
+ *
+ * Null values have no logarithm, so this (huge) negative value is used
+ * instead; it keeps trees with null tokens at the bottom of the ranking.
+ */
+#define LOGZERO 1e6
+
+/**
+ * \brief K-best heap
+ *
+ * Min-heap of the best common trees found so far for a given power of s; the
+ * root is the worst kept tree, that is the one to be replaced first.
+ */
+struct kheap
+{
+  int cnt;  /**< Number of kept trees */
+  int trunc;  /**< Some trees have been discarded */
+  double* score;  /**< Magnitude (logarithm) of the kept trees */
+  node_t* trees;  /**< Edges of the kept trees */
+};
+
+/**
+ * \brief Simpler %struct %kheap definition
+ */
+typedef
+struct kheap
+kheap_t;
+
+/**
+ * \brief Search status
+ *
+ * All the informations needed by the branch-and-bound search, allocated once
+ * and shared by the yref and gref blocks.
+ */
+struct kstat
+{
+  int k;  /**< Number of trees per power of s */
+  int dmax;  /**< Max degree of a token */
+  int dzero;  /**< Degree of the token of an empty tree */
+  double wzero;  /**< Magnitude (logarithm) of the token of an empty tree */
+  double* weight;  /**< Weight of the edges (contribution when into the tree) */
+  int* delta;  /**< Degree of the edges (contribution when into the tree) */
+  int* order;  /**< Edges sorted by weight (greater first) */
+  int* dplus;  /**< Positive degree contributions of the edges from here on */
+  int* dminus;  /**< Negative degree contributions of the edges from here on */
+  int* uf;  /**< Union-find support array */
+  int* fixed;  /**< Edges forced into (positive) or out of (negative) the tree, NULL if none */
+  kheap_t* heap;  /**< One heap for each power of s */
+};
+
+/**
+ * \brief Simpler %struct %kstat definition
+ */
+typedef
+struct kstat
+kstat_t;
+
+/**
+ * \brief Logarithm of the magnitude of a value
+ *
+ * \internal
+ * \param value value of interest
+ * \return log|value| or -LOGZERO if \a value is null
+ */
+static double
+logmag (const double value)
+{
+  return (value != 0) ? log(fabs(value)) : -LOGZERO;
+}
+
+/**
+ * \brief Union-find lookup with path halving
+ *
+ * \internal
+ * \param uf union-find support array
+ * \param item item of interest
+ * \return representative of \a item
+ */
+static int
+uf_find (int* uf, int item)
+{
+  while(uf[item] != item) {
+    uf[item] = uf[uf[item]];
+    item = uf[item];
+  }
+  return item;
+}
+
+/**
+ * \brief Upper bound for the completion of a partial tree on a single graph
+ *
+ * \internal
+ * Starting from the connected components of the partial tree, it builds the
+ * maximum weight completion that uses edges following \a pos (greedy
+ * algorithm, the graphic matroid is good for this purpose). Every common tree
+ * that extends the partial one is also a completion on a single graph, so that
+ * this is an upper bound for them.
+ *
+ * \param crep circuit representation reference
+ * \param ks search status
+ * \param cc actual common components of the graph
+ * \param gv zero for the current graph, a positive value for the voltage one
+ * \param pos last edge into the partial tree
+ * \param need number of edges still needed
+ * \param bound pointer to be used to store the bound
+ * \result zero if the partial tree can't be completed, a positive value
+ *   otherwise
+ */
+static int
+kbound (const circ_t* crep, kstat_t* ks, const int* cc, const int gv, const int pos, const int need, double* bound)
+{
+  int iter;
+  int edge;
+  int got;
+  int na;
+  int nb;
+  tn_t** ref;
+  for(iter = 0; iter < crep->nnum; ++iter)
+    ks->uf[iter] = iter;
+  *bound = 0;
+  got = 0;
+  for(iter = 0; (iter < crep->ednum) && (got < need); ++iter) {
+    edge = ks->order[iter];
+    if((edge > pos) && ((ks->fixed == NULL) || (ks->fixed[edge] >= 0))) {
+      ref = gv ? crep->edge[edge].gvref : crep->edge[edge].giref;
+      na = uf_find(ks->uf, cc[2 * ref[0]->node]);
+      nb = uf_find(ks->uf, cc[2 * ref[1]->node]);
+      if(na != nb) {
+	ks->uf[na] = nb;
+	*bound += ks->weight[edge];
+	++got;
+      }
+    }
+  }
+  return (got == need);
+}
+
+/**
+ * \brief Pruning test
+ *
+ * \internal
+ * It tells whether the partial tree can be discarded, that is, whether none of
+ * the trees extending it can enter the heaps of the powers of s that they can
+ * reach. Heaps of reachable powers of s are marked as truncated if so.
+ *
+ * \param crep circuit representation reference
+ * \param ks search status
+ * \param ccgi circuit graph's common components
+ * \param ccgv voltage graph's common components
+ * \param pos last edge into the partial tree
+ * \param cnt number of edges into the partial tree
+ * \param wacc weight of the partial tree
+ * \param dacc degree of the partial tree
+ * \result a positive value if the partial tree has to be discarded, zero
+ *   otherwise
+ */
+static int
+kprune (const circ_t* crep, kstat_t* ks, const int* ccgi, const int* ccgv, const int pos, const int cnt, const double wacc, const int dacc)
+{
+  double bi;
+  double bv;
+  int dlow;
+  int dhigh;
+  int iter;
+  int ret;
+  if(!kbound(crep, ks, ccgi, 0, pos, (crep->nnum - 1) - cnt, &bi)) ret = 1;
+  else if(!kbound(crep, ks, ccgv, 1, pos, (crep->nnum - 1) - cnt, &bv)) ret = 1;
+  else {
+    bi = ks->wzero + wacc + ((bi < bv) ? bi : bv);
+    dlow = ks->dzero + dacc + ks->dminus[pos + 1];
+    dhigh = ks->dzero + dacc + ks->dplus[pos + 1];
+    if(dlow < 0) dlow = 0;
+    if(dhigh > ks->dmax) dhigh = ks->dmax;
+    ret = 1;
+    for(iter = dlow; (iter <= dhigh) && ret; ++iter)
+      if((ks->heap[iter].cnt < ks->k) || (bi > ks->heap[iter].score[0]))
+	ret = 0;
+    if(ret)
+      for(iter = dlow; iter <= dhigh; ++iter)
+	ks->heap[iter].trunc = 1;
+  }
+  return ret;
+}
+
+/**
+ * \brief Restores the heap property moving down an item
+ *
+ * \internal
+ * \param heap heap of interest
+ * \param item item to be moved
+ * \param size size of a tree
+ */
+static void
+kheap_down (kheap_t* heap, int item, const int size)
+{
+  int child;
+  int iter;
+  double swap;
+  node_t ntmp;
+  while((child = 2 * item + 1) < heap->cnt) {
+    if((child + 1 < heap->cnt) && (heap->score[child + 1] < heap->score[child]))
+      ++child;
+    if(heap->score[item] <= heap->score[child])
+      break;
+    swap = heap->score[item];
+    heap->score[item] = heap->score[child];
+    heap->score[child] = swap;
+    for(iter = 0; iter < size; ++iter) {
+      ntmp = heap->trees[item * size + iter];
+      heap->trees[item * size + iter] = heap->trees[child * size + iter];
+      heap->trees[child * size + iter] = ntmp;
+    }
+    item = child;
+  }
+}
+
+/**
+ * \brief Offers a common tree to the heap of its power of s
+ *
+ * \internal
+ * \param ks search status
+ * \param nodes edges of the tree
+ * \param size size of a tree
+ * \param score magnitude (logarithm) of the tree
+ * \param degree power of s of the tree
+ */
+static void
+kheap_offer (kstat_t* ks, const node_t* nodes, const int size, const double score, const int degree)
+{
+  kheap_t* heap;
+  int item;
+  int parent;
+  int iter;
+  double swap;
+  node_t ntmp;
+  heap = &(ks->heap[degree]);
+  if(heap->cnt < ks->k) {
+    // sift-up insertion
+    item = heap->cnt++;
+    heap->score[item] = score;
+    for(iter = 0; iter < size; ++iter)
+      heap->trees[item * size + iter] = nodes[iter];
+    while((item > 0) && (heap->score[(parent = (item - 1) / 2)] > heap->score[item])) {
+      swap = heap->score[item];
+      heap->score[item] = heap->score[parent];
+      heap->score[parent] = swap;
+      for(iter = 0; iter < size; ++iter) {
+	ntmp = heap->trees[item * size + iter];
+	heap->trees[item * size + iter] = heap->trees[parent * size + iter];
+	heap->trees[parent * size + iter] = ntmp;
+      }
+      item = parent;
+    }
+  } else {
+    heap->trunc = 1;
+    if(score > heap->score[0]) {
+      // replace the worst one
+      heap->score[0] = score;
+      for(iter = 0; iter < size; ++iter)
+	heap->trees[iter] = nodes[iter];
+      kheap_down(heap, 0, size);
+    }
+  }
+}
+
+/**
+ * \brief Search status constructor
+ *
+ * \internal
+ * \param crep circuit representation reference
+ * \param k number of trees per power of s
+ * \param fixed edges forced into or out of the tree (NULL if none), taken
+ * \return newly allocated search status
+ */
+static kstat_t*
+kstat_new (const circ_t* crep, const int k, int* fixed)
+{
+  kstat_t* ks;
+  int iter;
+  int cnt;
+  int swap;
+  int deg;
+  ks = XMALLOC(kstat_t, 1);
+  ks->k = k;
+  ks->dmax = 0;
+  ks->dzero = 0;
+  ks->wzero = 0;
+  ks->weight = XMALLOC(double, crep->ednum);
+  ks->delta = XMALLOC(int, crep->ednum);
+  ks->order = XMALLOC(int, crep->ednum);
+  ks->dplus = XMALLOC(int, crep->ednum + 1);
+  ks->dminus = XMALLOC(int, crep->ednum + 1);
+  ks->uf = XMALLOC(int, crep->nnum);
+  ks->fixed = fixed;
+  for(iter = 0; iter < crep->ednum; ++iter) {
+    ks->weight[iter] = 0;
+    ks->delta[iter] = 0;
+    if(crep->edge[iter].type == Y) {
+      ks->weight[iter] = logmag(crep->edge[iter].value);
+      ks->delta[iter] = crep->edge[iter].degree;
+    } else if(crep->edge[iter].type == Z) {
+      // impedances contribute when out of the tree
+      ks->wzero += logmag(crep->edge[iter].value);
+      ks->dzero += crep->edge[iter].degree;
+      ks->weight[iter] = -logmag(crep->edge[iter].value);
+      ks->delta[iter] = -crep->edge[iter].degree;
+    }
+    if(ks->delta[iter] > 0)
+      ks->dmax += ks->delta[iter];
+    else ks->dmax -= ks->delta[iter];
+    ks->order[iter] = iter;
+  }
+  // suffix sums of degree contributions (forced edges are already decided)
+  ks->dplus[crep->ednum] = ks->dminus[crep->ednum] = 0;
+  for(iter = crep->ednum - 1; iter >= 0; --iter) {
+    deg = ((fixed == NULL) || (!fixed[iter])) ? ks->delta[iter] : 0;
+    ks->dplus[iter] = ks->dplus[iter + 1] + ((deg > 0) ? deg : 0);
+    ks->dminus[iter] = ks->dminus[iter + 1] + ((deg < 0) ? deg : 0);
+  }
+  // insertion sort, greater weight first
+  for(iter = 1; iter < crep->ednum; ++iter) {
+    swap = ks->order[iter];
+    for(cnt = iter; (cnt > 0) && (ks->weight[ks->order[cnt - 1]] < ks->weight[swap]); --cnt)
+      ks->order[cnt] = ks->order[cnt - 1];
+    ks->order[cnt] = swap;
+  }
+  ks->heap = XMALLOC(kheap_t, ks->dmax + 1);
+  for(iter = 0; iter <= ks->dmax; ++iter) {
+    ks->heap[iter].cnt = 0;
+    ks->heap[iter].trunc = 0;
+    ks->heap[iter].score = XMALLOC(double, k);
+    ks->heap[iter].trees = XMALLOC(node_t, k * (crep->nnum - 1));
+  }
+  return ks;
+}
+
+/**
+ * \brief Search status destructor
+ *
+ * \internal
+ * \param ks search status
+ */
+static void
+kstat_del (kstat_t* ks)
+{
+  int iter;
+  for(iter = 0; iter <= ks->dmax; ++iter) {
+    XFREE(ks->heap[iter].score);
+    XFREE(ks->heap[iter].trees);
+  }
+  XFREE(ks->heap);
+  XFREE(ks->fixed);
+  XFREE(ks->uf);
+  XFREE(ks->dminus);
+  XFREE(ks->dplus);
+  XFREE(ks->order);
+  XFREE(ks->delta);
+  XFREE(ks->weight);
+  XFREE(ks);
+}
+
+/**
+ * \brief This function is used by \e kbest function to complete its work
+ *
+ * \internal
+ * This function walks the same search tree of grimbleby's algorithm, but it
+ * keeps into the heaps only the k best common trees for each power of s and
+ * it discards branches whose upper bound can't beat the kept ones. Edges
+ * forced by the symbol constraints are pushed in first, once and for all. At
+ * the end, kept trees are stored as an ordered, human readable circuit expression
+ * (thanks to to_expr function) and truncated degree-groups are marked.
+ *
+ * \param crep circuit representation reference
+ * \param chain %list pointer wiht the newly allocated stacks as payload
+ * \param ccgi circuit graph's common components
+ * \param ccgv voltage graph's common components
+ * \param nodes nodes into the tree
+ * \result zero if some error occurs, a positive value otherwise
+ */
+static int
+khelper (const circ_t* crep, list_t** chain, int* ccgi, int* ccgv, node_t* nodes)
+{
+  int ret;
+  int pos;
+  int cnt;
+  int base;
+  int size;
+  int* giimat;
+  int* gvimat;
+  int* mask;
+  int iter;
+  int deg;
+  int maskmark;
+  int kept;
+  int clash;
+  int* fixed;
+  int* dacc;
+  double* wacc;
+  double swap;
+  kstat_t* ks;
+  kheap_t* heap;
+  expr_t* elist;
+  expr_t* eiter;
+  enum {
+    TF,  // Test Flag
+    SF,  // Select Flag
+    LF,  // Loop Flag
+    IF,  // Include Flag
+    EF,  // End Flag
+    BF,  // BackTrack Flag
+    OF  // Out Flag
+  } flag = SF;
+  ret = 1;
+  pos = -1;
+  // Tree-on-graph size (# of nodes - 1)
+  size = crep->nnum - 1;
+  cnt = 1 + crep->efnum;
+  fixed = NULL;
+  clash = 0;
+  if(constrained()) fixed = gfixed(crep, &clash);
+  ks = kstat_new(crep, (env.kbest > 0) ? env.kbest : 1, fixed);
+  wacc = XMALLOC(double, size + 1);
+  dacc = XMALLOC(int, size + 1);
+  wacc[cnt] = 0;
+  dacc[cnt] = 0;
+  for(iter = 0; iter < cnt; ++iter) {
+    wacc[cnt] += ks->weight[nodes[iter]];
+    dacc[cnt] += ks->delta[nodes[iter]];
+  }
+  // symbol constraints (forced edges pushed in first, once and for all)
+  for(iter = 0; (fixed != NULL) && (iter < crep->ednum) && (!clash); ++iter)
+    if(fixed[iter] > 0) {
+      if((cnt == size) || testloop(ccgi, crep->edge[iter].giref[0]->node, crep->edge[iter].giref[1]->node) ||
+	 testloop(ccgv, crep->edge[iter].gvref[0]->node, crep->edge[iter].gvref[1]->node))
+	clash = 1;
+      else {
+	nodes[cnt++] = iter;
+	wacc[cnt] = wacc[cnt - 1] + ks->weight[iter];
+	dacc[cnt] = dacc[cnt - 1] + ks->delta[iter];
+	ctrlplus(ccgi, crep->edge[iter].giref[0]->node, crep->edge[iter].giref[1]->node, crep->nnum);
+	ctrlplus(ccgv, crep->edge[iter].gvref[0]->node, crep->edge[iter].gvref[1]->node, crep->nnum);
+      }
+    }
+  base = cnt;
+  if(clash) flag = OF;
+  else if(cnt == size) {
+    // forced edges fill the tree at once
+    kheap_offer(ks, nodes, size, ks->wzero + wacc[cnt], ks->dzero + dacc[cnt]);
+    flag = OF;
+  }
+  while((ret)&&(flag != OF)) {
+    switch(flag) {
+    case TF:
+      if(cnt == size) {
+	kheap_offer(ks, nodes, size, ks->wzero + wacc[cnt], ks->dzero + dacc[cnt]);
+	flag = BF;
+      } else if(kprune(crep, ks, ccgi, ccgv, pos, cnt, wacc[cnt], dacc[cnt])) flag = BF;
+      else flag = SF;
+      break;
+    case SF:
+      ++pos;
+      if(size - cnt > crep->ednum - pos) flag = EF;
+      else flag = LF;
+      break;
+    case LF:
+      if((fixed != NULL) && fixed[pos]) flag = SF;
+      else if(testloop(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node)) flag = SF;
+      else if(testloop(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node)) flag = SF;
+      else flag = IF;
+      break;
+    case IF:
+      if(cnt == size) ret = 0;
+      else {
+	nodes[cnt++] = pos;
+	wacc[cnt] = wacc[cnt - 1] + ks->weight[pos];
+	dacc[cnt] = dacc[cnt - 1] + ks->delta[pos];
+	ctrlplus(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node, crep->nnum);
+	ctrlplus(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node, crep->nnum);
+	flag = TF;
+      }
+      break;
+    case EF:
+      if(cnt == base) flag = OF;
+      else flag = BF;
+      break;
+    case BF:
+      if(cnt == base) ret = 0;
+      else {
+	pos = nodes[--cnt];
+	ctrlminus(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node, crep->nnum);
+	ctrlminus(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node, crep->nnum);
+	flag = SF;
+      }
+      break;
+    case OF:
+      break;
+    }
+  }
+  // common components given back as they were (forced edges included)
+  while(cnt > 1 + crep->efnum) {
+    pos = nodes[--cnt];
+    ctrlminus(ccgi, crep->edge[pos].giref[0]->node, crep->edge[pos].giref[1]->node, crep->nnum);
+    ctrlminus(ccgv, crep->edge[pos].gvref[0]->node, crep->edge[pos].gvref[1]->node, crep->nnum);
+  }
+  // "burn" kept trees, greater magnitude first
+  mask = XMALLOC(int, crep->ednum);
+  giimat = XMALLOC(int, (crep->nnum * (crep->nnum - 1)));
+  gvimat = XMALLOC(int, (crep->nnum * (crep->nnum - 1)));
+  elist = NULL;
+  maskmark = 0;
+  for(deg = ks->dmax; deg >= 0; --deg) {
+    heap = &(ks->heap[deg]);
+    kept = heap->cnt;
+    for(iter = kept - 1; iter > 0; --iter) {
+      // heap-sort: worst tree is moved at the end
+      swap = heap->score[0];
+      heap->score[0] = heap->score[iter];
+      heap->score[iter] = swap;
+      for(cnt = 0; cnt < size; ++cnt) {
+	pos = heap->trees[cnt];
+	heap->trees[cnt] = heap->trees[iter * size + cnt];
+	heap->trees[iter * size + cnt] = pos;
+      }
+      heap->cnt = iter;
+      kheap_down(heap, 0, size);
+    }
+    heap->cnt = kept;
+    for(iter = 0; iter < heap->cnt; ++iter) {
+      VERBOSE(".");
+      elist = to_expr (crep, &(heap->trees[iter * size]), mask, ++maskmark, giimat, gvimat, elist);
+    }
+  }
+  // truncation markers
+  for(eiter = elist; eiter != NULL; eiter = list_next_entry(expr_t, eiter))
+    if((eiter->degree >= 0) && (eiter->degree <= ks->dmax))
+      eiter->trunc = ks->heap[eiter->degree].trunc;
+  *chain = (list_t*) elist;
+  XFREE(gvimat);
+  XFREE(giimat);
+  XFREE(mask);
+  XFREE(dacc);
+  XFREE(wacc);
+  kstat_del(ks);
+  return ret;
+}
+
+/**
+ * \brief Circuit-to-expression conversion function using the k-best finder
+ *
+ * \internal
+ * K-best finder entry point: it drives \e khelper function, which really
+ * solves common trees problem, by means of \e ct_solve. The number of trees
+ * per power of s is taken from the environment.
+ *
+ * \param crep %circuit reference
+ * \param yrefchain pointer to be used to store the first %list
+ * \param grefchain pointer to be used to store the second %list
+ * \result zero if some error occurs, a positive value otherwise
+ */
+int
+kbest (const circ_t* crep, list_t** yrefchain, list_t** grefchain)
+{
+  return ct_solve(crep, yrefchain, grefchain, khelper);
+}
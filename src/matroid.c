@@ -0,0 +1,527 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file matroid.c
+ *
+ * \brief Polynomial-delay common trees finder
+ *
+ * Common trees of the current graph and the voltage graph are the common bases
+ * of two graphic matroids. This finder walks a binary search tree where each
+ * edge is either included into or excluded from the tree, and it enters a
+ * branch only if a common base exists that agrees with the decisions taken so
+ * far (matroid intersection test). Since every visited branch leads to at
+ * least a common tree, the time between two found trees is polynomial.
+ */
+
+#include "common.h"
+#include "list.h"
+#include "circuit.h"
+#include "expr.h"
+#include "ctree.h"
+#include "matroid.h"
+
+/**
+ * \brief Union-find lookup with path halving
+ *
+ * \internal
+ * \param uf union-find support array
+ * \param item item of interest
+ * \return representative of \a item
+ */
+static int
+uf_find (int* uf, int item)
+{
+  while(uf[item] != item) {
+    uf[item] = uf[uf[item]];
+    item = uf[item];
+  }
+  return item;
+}
+
+/**
+ * \brief Contracts the included edges
+ *
+ * \internal
+ * It initializes the union-find support arrays with the included edges, so
+ * that both the graphs are contracted accordingly.
+ *
+ * \param ms finder status
+ * \param extra further edge to be contracted (negative value for none)
+ * \result zero if included edges contain a loop, a positive value otherwise
+ */
+static int
+ms_contract (mstat_t* ms, const int extra)
+{
+  int iter;
+  int graph;
+  int edge;
+  int na;
+  int nb;
+  int ret;
+  ret = 1;
+  for(iter = 0; iter < 2 * ms->nnum; ++iter)
+    ms->uf[iter] = iter % ms->nnum;
+  for(iter = 0; (iter <= ms->ncand) && ret; ++iter) {
+    if(iter < ms->ncand) {
+      if(ms->dec[iter] != INCLUDED) continue;
+      edge = ms->cand[iter];
+    } else if(extra >= 0) edge = extra;
+    else continue;
+    for(graph = 0; graph < 2; ++graph) {
+      na = uf_find(ms->uf + graph * ms->nnum, ms->ends[4 * edge + 2 * graph]);
+      nb = uf_find(ms->uf + graph * ms->nnum, ms->ends[4 * edge + 2 * graph + 1]);
+      if(na == nb) ret = 0;
+      else ms->uf[graph * ms->nnum + na] = nb;
+    }
+  }
+  return ret;
+}
+
+/**
+ * \brief Builds the forest of the actual common independent set
+ *
+ * \internal
+ * It roots every tree of the forest made of the elements into the set, so
+ * that fundamental cycles can be found walking towards the roots.
+ *
+ * \param ms finder status
+ * \param node contracted end-points of the elements
+ * \param nelem number of elements
+ */
+static void
+ms_forest (mstat_t* ms, const int* node, const int nelem)
+{
+  int iter;
+  int root;
+  int first;
+  int last;
+  int cur;
+  int lnk;
+  int cnt;
+  for(iter = 0; iter < ms->nnum; ++iter) {
+    ms->head[iter] = -1;
+    ms->tree[iter] = -1;
+  }
+  cnt = 0;
+  for(iter = 0; iter < nelem; ++iter)
+    if(ms->inset[iter]) {
+      ms->link[2 * cnt] = node[2 * iter + 1];
+      ms->link[2 * cnt + 1] = iter;
+      ms->next[cnt] = ms->head[node[2 * iter]];
+      ms->head[node[2 * iter]] = cnt++;
+      ms->link[2 * cnt] = node[2 * iter];
+      ms->link[2 * cnt + 1] = iter;
+      ms->next[cnt] = ms->head[node[2 * iter + 1]];
+      ms->head[node[2 * iter + 1]] = cnt++;
+    }
+  for(root = 0; root < ms->nnum; ++root)
+    if(ms->tree[root] == -1) {
+      ms->tree[root] = root;
+      ms->parent[root] = -1;
+      ms->pelem[root] = -1;
+      ms->depth[root] = 0;
+      first = last = 0;
+      ms->queue[last++] = root;
+      while(first < last) {
+	cur = ms->queue[first++];
+	for(lnk = ms->head[cur]; lnk != -1; lnk = ms->next[lnk])
+	  if(ms->tree[ms->link[2 * lnk]] == -1) {
+	    ms->tree[ms->link[2 * lnk]] = root;
+	    ms->parent[ms->link[2 * lnk]] = cur;
+	    ms->pelem[ms->link[2 * lnk]] = ms->link[2 * lnk + 1];
+	    ms->depth[ms->link[2 * lnk]] = ms->depth[cur] + 1;
+	    ms->queue[last++] = ms->link[2 * lnk];
+	  }
+      }
+    }
+}
+
+/**
+ * \brief Computes the exchange relations for a graph
+ *
+ * \internal
+ * For each element out of the set, it tells whether it can be added to the
+ * set (into \e sfree) or which elements of the set are into its fundamental
+ * cycle (into \e cycle), that is, which ones can be exchanged with it. Rows
+ * of \e cycle have a column for each element of the set (see \e col).
+ *
+ * \param ms finder status
+ * \param node contracted end-points of the elements
+ * \param nelem number of elements
+ * \param size number of elements into the set
+ * \param graph zero for the current graph, one for the voltage graph
+ */
+static void
+ms_exchange (mstat_t* ms, const int* node, const int nelem, const int size, const int graph)
+{
+  int iter;
+  int na;
+  int nb;
+  char* row;
+  ms_forest(ms, node, nelem);
+  for(iter = 0; iter < nelem; ++iter) {
+    if(ms->inset[iter]) continue;
+    na = node[2 * iter];
+    nb = node[2 * iter + 1];
+    row = ms->cycle + ((size_t) graph * nelem + iter) * size;
+    memset(row, 0, size);
+    if(ms->tree[na] != ms->tree[nb]) ms->sfree[graph * nelem + iter] = 1;
+    else {
+      ms->sfree[graph * nelem + iter] = 0;
+      while(na != nb) {
+	if(ms->depth[na] >= ms->depth[nb]) {
+	  row[ms->col[ms->pelem[na]]] = 1;
+	  na = ms->parent[na];
+	} else {
+	  row[ms->col[ms->pelem[nb]]] = 1;
+	  nb = ms->parent[nb];
+	}
+      }
+    }
+  }
+}
+
+/**
+ * \brief Feasibility test
+ *
+ * \internal
+ * It tells whether a common tree exists that contains the included edges and
+ * the optional \a extra one, and that doesn't contain the excluded ones. Still
+ * undecided candidates after \a from are the elements of a matroid
+ * intersection problem (on the contracted graphs), solved by means of
+ * shortest augmenting paths.
+ *
+ * \param ms finder status
+ * \param from first undecided candidate
+ * \param extra further edge to be included (negative value for none)
+ * \param need number of edges that the elements must supply
+ * \result a positive value if such a common tree exists, zero otherwise
+ */
+int
+ms_feasible (mstat_t* ms, const int from, const int extra, const int need)
+{
+  int* node;
+  int nelem;
+  int size;
+  int iter;
+  int edge;
+  int graph;
+  int first;
+  int last;
+  int cur;
+  int found;
+  int na;
+  int nb;
+  int ret;
+  if(!ms_contract(ms, extra)) return 0;
+  if(need == 0) return 1;
+  if(ms->ncand - from < need) return 0;
+  // elements: undecided candidates that are not loops
+  node = XMALLOC(int, 4 * (ms->ncand - from));
+  nelem = 0;
+  for(iter = from; iter < ms->ncand; ++iter) {
+    edge = ms->cand[iter];
+    if(edge == extra) continue;
+    na = uf_find(ms->uf, ms->ends[4 * edge]);
+    nb = uf_find(ms->uf, ms->ends[4 * edge + 1]);
+    if(na == nb) continue;
+    node[2 * nelem] = na;
+    node[2 * nelem + 1] = nb;
+    na = uf_find(ms->uf + ms->nnum, ms->ends[4 * edge + 2]);
+    nb = uf_find(ms->uf + ms->nnum, ms->ends[4 * edge + 3]);
+    if(na == nb) continue;
+    node[2 * (ms->ncand - from) + 2 * nelem] = na;
+    node[2 * (ms->ncand - from) + 2 * nelem + 1] = nb;
+    ms->elem[nelem++] = edge;
+  }
+  // shift voltage graph end-points right after the current graph ones
+  for(iter = 0; iter < 2 * nelem; ++iter)
+    node[2 * nelem + iter] = node[2 * (ms->ncand - from) + iter];
+  // greedy start
+  size = 0;
+  for(iter = 0; iter < nelem; ++iter) {
+    na = uf_find(ms->uf, node[2 * iter]);
+    nb = uf_find(ms->uf, node[2 * iter + 1]);
+    ms->inset[iter] = 0;
+    if(na != nb) {
+      first = uf_find(ms->uf + ms->nnum, node[2 * nelem + 2 * iter]);
+      last = uf_find(ms->uf + ms->nnum, node[2 * nelem + 2 * iter + 1]);
+      if(first != last) {
+	ms->uf[na] = nb;
+	ms->uf[ms->nnum + first] = last;
+	ms->inset[iter] = 1;
+	++size;
+      }
+    }
+  }
+  // augmenting paths
+  found = 1;
+  while((size < need) && found) {
+    cur = 0;
+    for(iter = 0; iter < nelem; ++iter)
+      ms->col[iter] = ms->inset[iter] ? cur++ : -1;
+    for(graph = 0; graph < 2; ++graph)
+      ms_exchange(ms, node + 2 * nelem * graph, nelem, size, graph);
+    found = -1;
+    first = last = 0;
+    for(iter = 0; iter < nelem; ++iter) {
+      ms->prev[iter] = -2;
+      if((!ms->inset[iter]) && ms->sfree[iter]) {
+	ms->prev[iter] = -1;
+	ms->queue[last++] = iter;
+      }
+    }
+    while((first < last) && (found == -1)) {
+      cur = ms->queue[first++];
+      if(!ms->inset[cur]) {
+	if(ms->sfree[nelem + cur]) found = cur;
+	else
+	  for(iter = 0; iter < nelem; ++iter)
+	    if((ms->prev[iter] == -2) && ms->inset[iter] && ms->cycle[((size_t) nelem + cur) * size + ms->col[iter]]) {
+	      ms->prev[iter] = cur;
+	      ms->queue[last++] = iter;
+	    }
+      } else {
+	for(iter = 0; iter < nelem; ++iter)
+	  if((ms->prev[iter] == -2) && (!ms->inset[iter]) && (!ms->sfree[iter]) && ms->cycle[(size_t) iter * size + ms->col[cur]]) {
+	    ms->prev[iter] = cur;
+	    ms->queue[last++] = iter;
+	  }
+      }
+    }
+    if(found != -1) {
+      for(cur = found; cur != -1; cur = ms->prev[cur])
+	ms->inset[cur] = !ms->inset[cur];
+      ++size;
+      found = 1;
+    } else found = 0;
+  }
+  ret = (size >= need);
+  XFREE(node);
+  return ret;
+}
+
+/**
+ * \brief Finder status constructor
+ *
+ * \internal
+ * \param crep circuit representation reference
+ * \param ccgi circuit graph's common components (base included)
+ * \param ccgv voltage graph's common components (base included)
+ * \return newly allocated finder status
+ */
+mstat_t*
+mstat_new (const circ_t* crep, const int* ccgi, const int* ccgv)
+{
+  mstat_t* ms;
+  int iter;
+  ms = XMALLOC(mstat_t, 1);
+  ms->nnum = crep->nnum;
+  ms->ncand = 0;
+  ms->cand = XMALLOC(int, crep->ednum);
+  ms->ends = XMALLOC(int, 4 * crep->ednum);
+  ms->dec = XMALLOC(int, crep->ednum);
+  for(iter = 0; iter < crep->ednum; ++iter) {
+    ms->ends[4 * iter] = ccgi[2 * crep->edge[iter].giref[0]->node];
+    ms->ends[4 * iter + 1] = ccgi[2 * crep->edge[iter].giref[1]->node];
+    ms->ends[4 * iter + 2] = ccgv[2 * crep->edge[iter].gvref[0]->node];
+    ms->ends[4 * iter + 3] = ccgv[2 * crep->edge[iter].gvref[1]->node];
+    // loops (base edges included) can't be part of the tree
+    if((ms->ends[4 * iter] != ms->ends[4 * iter + 1]) && (ms->ends[4 * iter + 2] != ms->ends[4 * iter + 3])) {
+      ms->dec[ms->ncand] = UNDECIDED;
+      ms->cand[ms->ncand++] = iter;
+    }
+  }
+  ms->uf = XMALLOC(int, 2 * crep->nnum);
+  ms->sfree = XMALLOC(int, 2 * crep->ednum);
+  // the set is a forest, it has less elements than the nodes
+  ms->cycle = XMALLOC(char, 2 * (size_t) ms->ncand * crep->nnum);
+  ms->col = XMALLOC(int, crep->ednum);
+  ms->elem = XMALLOC(int, crep->ednum);
+  ms->inset = XMALLOC(int, crep->ednum);
+  ms->prev = XMALLOC(int, crep->ednum);
+  ms->queue = XMALLOC(int, crep->ednum + crep->nnum);
+  ms->head = XMALLOC(int, crep->nnum);
+  ms->next = XMALLOC(int, 2 * crep->ednum);
+  ms->link = XMALLOC(int, 4 * crep->ednum);
+  ms->parent = XMALLOC(int, crep->nnum);
+  ms->pelem = XMALLOC(int, crep->nnum);
+  ms->depth = XMALLOC(int, crep->nnum);
+  ms->tree = XMALLOC(int, crep->nnum);
+  return ms;
+}
+
+/**
+ * \brief Finder status destructor
+ *
+ * \internal
+ * \param ms finder status
+ */
+void
+mstat_del (mstat_t* ms)
+{
+  XFREE(ms->tree);
+  XFREE(ms->depth);
+  XFREE(ms->pelem);
+  XFREE(ms->parent);
+  XFREE(ms->link);
+  XFREE(ms->next);
+  XFREE(ms->head);
+  XFREE(ms->queue);
+  XFREE(ms->prev);
+  XFREE(ms->inset);
+  XFREE(ms->elem);
+  XFREE(ms->col);
+  XFREE(ms->cycle);
+  XFREE(ms->sfree);
+  XFREE(ms->uf);
+  XFREE(ms->dec);
+  XFREE(ms->ends);
+  XFREE(ms->cand);
+  XFREE(ms);
+}
+
+/**
+ * \brief This function is used by \e matroid function to complete its work
+ *
+ * \internal
+ * Candidates are decided in order, first trying to include them and then to
+ * exclude them; a decision is taken only if the feasibility test succeeds, so
+ * that backtracking never wanders into dead branches. Found common trees are
+ * stored as an ordered, human readable circuit expression (thanks to to_expr
+ * function).
+ *
+ * \param crep circuit representation reference
+ * \param chain %list pointer wiht the newly allocated stacks as payload
+ * \param ccgi circuit graph's common components
+ * \param ccgv voltage graph's common components
+ * \param nodes nodes into the tree
+ * \result zero if some error occurs, a positive value otherwise
+ */
+static int
+mhelper (const circ_t* crep, list_t** chain, int* ccgi, int* ccgv, node_t* nodes)
+{
+  int ret;
+  int pos;
+  int cnt;
+  int base;
+  int* giimat;
+  int* gvimat;
+  int* mask;
+  int iter;
+  int maskmark;
+  mstat_t* ms;
+  expr_t* elist;
+  enum {
+    TF,  // Test Flag
+    IF,  // Include Flag
+    XF,  // eXclude Flag
+    BF,  // BackTrack Flag
+    OF  // Out Flag
+  } flag;
+  ret = 1;
+  ms = mstat_new(crep, ccgi, ccgv);
+  // Tree-on-graph size (# of nodes - 1)
+  base = cnt = 1 + crep->efnum;
+  mask = XMALLOC(int, crep->ednum);
+  giimat = XMALLOC(int, (crep->nnum * (crep->nnum - 1)));
+  gvimat = XMALLOC(int, (crep->nnum * (crep->nnum - 1)));
+  elist = NULL;
+  for(iter = 0; iter < crep->ednum; ++iter)
+    mask[iter] = 0;
+  maskmark = 0;
+  pos = 0;
+  flag = ms_feasible(ms, 0, -1, (crep->nnum - 1) - cnt) ? TF : OF;
+  while((ret)&&(flag != OF)) {
+    switch(flag) {
+    case TF:
+      if(cnt == (crep->nnum - 1)) {
+	VERBOSE(".");
+	// "burn"
+	elist = to_expr (crep, nodes, mask, ++maskmark, giimat, gvimat, elist);
+	// ! "burn"
+	flag = BF;
+      } else if(pos == ms->ncand) ret = 0;
+      else flag = IF;
+      break;
+    case IF:
+      if(ms_feasible(ms, pos + 1, ms->cand[pos], (crep->nnum - 1) - cnt - 1)) {
+	ms->dec[pos] = INCLUDED;
+	nodes[cnt++] = ms->cand[pos++];
+	flag = TF;
+      } else flag = XF;
+      break;
+    case XF:
+      ms->dec[pos] = EXCLUDED;
+      if(ms_feasible(ms, pos + 1, -1, (crep->nnum - 1) - cnt)) {
+	++pos;
+	flag = TF;
+      } else flag = BF;
+      break;
+    case BF:
+      // back to the last candidate whose exclusion is still to be tried
+      do {
+	ms->dec[pos] = UNDECIDED;
+	--pos;
+      } while((pos >= 0) && (ms->dec[pos] == EXCLUDED));
+      if(pos < 0) flag = OF;
+      else {
+	--cnt;
+	flag = XF;
+      }
+      break;
+    case OF:
+      break;
+    }
+  }
+  if(cnt < base) ret = 0;
+  *chain = (list_t*) elist;
+  XFREE(gvimat);
+  XFREE(giimat);
+  XFREE(mask);
+  mstat_del(ms);
+  return ret;
+}
+
+/**
+ * \brief Circuit-to-expression conversion function using the matroid finder
+ *
+ * \internal
+ * Polynomial-delay finder entry point: it drives \e mhelper function, which
+ * really solves common trees problem, by means of \e ct_solve.
+ *
+ * \param crep %circuit reference
+ * \param yrefchain pointer to be used to store the first %list
+ * \param grefchain pointer to be used to store the second %list
+ * \result zero if some error occurs, a positive value otherwise
+ */
+int
+matroid (const circ_t* crep, list_t** yrefchain, list_t** grefchain)
+{
+  return ct_solve(crep, yrefchain, grefchain, mhelper);
+}
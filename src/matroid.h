@@ -0,0 +1,109 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file matroid.h
+ *
+ * \brief Matroid intersection support
+ *
+ * This file contains the status of the matroid intersection test and the
+ * prototypes of the functions that manage it, so that finders that walk the
+ * decision tree in their own order can share the same feasibility test.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef MATROID_H
+#define MATROID_H 1
+
+#include "common.h"
+#include "circuit.h"
+
+/**
+ * \brief Edge decision: not yet decided
+ */
+#define UNDECIDED 0
+
+/**
+ * \brief Edge decision: included into the tree
+ */
+#define INCLUDED 1
+
+/**
+ * \brief Edge decision: excluded from the tree
+ */
+#define EXCLUDED 2
+
+/**
+ * \brief Matroid intersection status
+ *
+ * All the informations needed by the finder, allocated once and shared by the
+ * yref and gref blocks. Arrays related to the graphs are doubled, the first
+ * half is for the current graph and the second one for the voltage graph.
+ */
+struct mstat
+{
+  int nnum;  /**< Number of nodes */
+  int ncand;  /**< Number of candidate edges */
+  int* cand;  /**< Candidate edges (not loops once the base is contracted) */
+  int* ends;  /**< Edges' end-points (contracted base) into both the graphs */
+  int* dec;  /**< Decision for each candidate */
+  int* uf;  /**< Union-find support arrays */
+  int* sfree;  /**< Element can be added to the set (both the graphs) */
+  char* cycle;  /**< Element of the set is into the cycle of another one (both the graphs) */
+  int* col;  /**< Column of the elements of the set into the cycle rows */
+  int* elem;  /**< Elements of the intersection problem (edges) */
+  int* inset;  /**< Element is into the actual common independent set */
+  int* prev;  /**< Previous element along the augmenting path */
+  int* queue;  /**< Breadth-first search queue */
+  int* head;  /**< Forest adjacency: first link of each node */
+  int* next;  /**< Forest adjacency: next link */
+  int* link;  /**< Forest adjacency: linked node and element (pairs) */
+  int* parent;  /**< Forest: parent node */
+  int* pelem;  /**< Forest: element towards the parent node */
+  int* depth;  /**< Forest: depth of the node */
+  int* tree;  /**< Forest: tree of the node */
+};
+
+/**
+ * \brief Simpler %struct %mstat definition
+ */
+typedef
+struct mstat
+mstat_t;
+
+extern int
+ms_feasible (mstat_t*, const int, const int, const int);
+
+extern mstat_t*
+mstat_new (const circ_t*, const int*, const int*);
+
+extern void
+mstat_del (mstat_t*);
+
+#endif /* MATROID_H */
@@ -0,0 +1,458 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file nest.c
+ *
+ * \brief Nested expressions
+ *
+ * This set of functions can be used to build a sequence of named expressions,
+ * where each one is either a polynomial or a sum of products of the previous
+ * ones, and to splash it or to move it to and from file. Finders that split
+ * the circuit into pieces can give it instead of the expanded expression, so
+ * that the size of the result grows with the number of pieces rather than
+ * with the number of common trees.
+ */
+
+#include <string.h>
+
+#include "common.h"
+#include "list.h"
+#include "expr.h"
+#include "nest.h"
+
+/**
+ * \brief Magic number of nested expressions on file
+ */
+#define NEST_MAGIC "SPCNGNE1"
+
+/**
+ * \brief Nested expressions maker
+ *
+ * This function allocates and returns an empty sequence, both the numerator
+ * and the denominator are zero.
+ *
+ * \return newly allocated sequence
+ */
+nest_t*
+nest_new ()
+{
+  nest_t* ns;
+  ns = XMALLOC(nest_t, 1);
+  ns->def = NULL;
+  ns->cnt = 0;
+  ns->size = 0;
+  ns->root[0] = NEST_NONE;
+  ns->root[1] = NEST_NONE;
+  return ns;
+}
+
+/**
+ * \brief It frees nested expressions
+ *
+ * \param ns sequence to be freed
+ */
+void
+nest_del (nest_t* ns)
+{
+  int iter;
+  if(ns != NULL) {
+    for(iter = 0; iter < ns->cnt; ++iter) {
+      free_expr(ns->def[iter].leaf);
+      XFREE(ns->def[iter].prod);
+    }
+    XFREE(ns->def);
+    XFREE(ns);
+  }
+}
+
+/**
+ * \brief It appends a new definition
+ *
+ * \internal
+ *
+ * \param ns sequence
+ * \return identifier of the definition
+ */
+static int
+nest_def (nest_t* ns)
+{
+  if(ns->cnt == ns->size) {
+    ns->size = (ns->size) ? (2 * ns->size) : 64;
+    ns->def = XREALLOC(struct ndef, ns->def, ns->size);
+  }
+  ns->def[ns->cnt].leaf = NULL;
+  ns->def[ns->cnt].prod = NULL;
+  ns->def[ns->cnt].pcnt = 0;
+  ns->def[ns->cnt].psize = 0;
+  return ns->cnt++;
+}
+
+/**
+ * \brief It appends a polynomial
+ *
+ * The sequence takes ownership of the expression.
+ *
+ * \param ns sequence
+ * \param leaf expression (NULL means zero)
+ * \return identifier of the definition
+ */
+int
+nest_leaf (nest_t* ns, expr_t* leaf)
+{
+  int id;
+  id = nest_def(ns);
+  ns->def[id].leaf = leaf;
+  return id;
+}
+
+/**
+ * \brief It appends an empty sum
+ *
+ * \param ns sequence
+ * \return identifier of the definition
+ */
+int
+nest_sum (nest_t* ns)
+{
+  return nest_def(ns);
+}
+
+/**
+ * \brief It adds a product to a sum
+ *
+ * \param ns sequence
+ * \param id sum to be extended
+ * \param sign sign of the product
+ * \param first first factor (a definition or NEST_ONE)
+ * \param second second factor (a definition or NEST_ONE)
+ */
+void
+nest_add (nest_t* ns, const int id, const int sign, const int first, const int second)
+{
+  struct ndef* def;
+  def = &(ns->def[id]);
+  if(def->pcnt == def->psize) {
+    def->psize = (def->psize) ? (2 * def->psize) : 4;
+    def->prod = XREALLOC(struct nprod, def->prod, def->psize);
+  }
+  def->prod[def->pcnt].sign = sign;
+  def->prod[def->pcnt].first = first;
+  def->prod[def->pcnt].second = second;
+  ++(def->pcnt);
+}
+
+/**
+ * \brief It skips trivial definitions
+ *
+ * \internal
+ * Empty definitions are zero, while a sum made of a single product by one with
+ * positive sign is the other factor.
+ *
+ * \param ns sequence
+ * \param id definition (or NEST_ONE, or NEST_NONE)
+ * \return the definition to be used instead
+ */
+static int
+nest_target (const nest_t* ns, int id)
+{
+  const struct ndef* def;
+  while(id >= 0) {
+    def = &(ns->def[id]);
+    if(def->leaf != NULL) break;
+    if(def->pcnt == 0) id = NEST_NONE;
+    else if((def->pcnt == 1) && (def->prod[0].sign == 1) && (def->prod[0].first == NEST_ONE))
+      id = def->prod[0].second;
+    else if((def->pcnt == 1) && (def->prod[0].sign == 1) && (def->prod[0].second == NEST_ONE))
+      id = def->prod[0].first;
+    else break;
+  }
+  return id;
+}
+
+/**
+ * \brief It numbers the definitions in use
+ *
+ * \internal
+ * Definitions reachable from the roots are numbered from one, each one after
+ * all the definitions it refers to, the others are numbered zero.
+ *
+ * \param ns sequence
+ * \param num number of each definition
+ * \param order definitions in order of number
+ * \return number of definitions in use
+ */
+static int
+nest_number (const nest_t* ns, int* num, int* order)
+{
+  const struct ndef* def;
+  int* stack;
+  int* next;
+  int top;
+  int cnt;
+  int id;
+  int r;
+  stack = XMALLOC(int, ns->cnt + 1);
+  next = XMALLOC(int, ns->cnt + 1);
+  for(id = 0; id < ns->cnt; ++id)
+    num[id] = 0;
+  cnt = 0;
+  for(r = 0; r < 2; ++r) {
+    top = 0;
+    id = nest_target(ns, ns->root[r]);
+    if((id >= 0) && (num[id] == 0)) {
+      num[id] = -1;
+      stack[top] = id;
+      next[top++] = 0;
+    }
+    while(top > 0) {
+      def = &(ns->def[stack[top - 1]]);
+      if(next[top - 1] < 2 * def->pcnt) {
+	id = (next[top - 1] % 2) ? def->prod[next[top - 1] / 2].second : def->prod[next[top - 1] / 2].first;
+	++(next[top - 1]);
+	id = nest_target(ns, id);
+	if((id >= 0) && (num[id] == 0)) {
+	  num[id] = -1;
+	  stack[top] = id;
+	  next[top++] = 0;
+	}
+      } else {
+	order[cnt] = stack[--top];
+	num[order[cnt]] = cnt + 1;
+	++cnt;
+      }
+    }
+  }
+  XFREE(next);
+  XFREE(stack);
+  return cnt;
+}
+
+/**
+ * \brief It splashes a reference to a definition
+ *
+ * \internal
+ *
+ * \param id definition (or NEST_ONE, or NEST_NONE)
+ * \param num number of each definition
+ * \param fref output file (NULL to get the length only)
+ * \return the length of the splashed reference
+ */
+static int
+nest_ref (const int id, const int* num, FILE* fref)
+{
+  char buf[BUF_SIZE];
+  if(id >= 0) snprintf(buf, BUF_SIZE, " X%d", num[id]);
+  else if(id == NEST_ONE) snprintf(buf, BUF_SIZE, " 1");
+  else snprintf(buf, BUF_SIZE, " NULL");
+  if(fref != NULL) fprintf(fref, "%s\n", buf);
+  return strlen(buf) + 1;
+}
+
+/**
+ * \brief It splashes nested expressions
+ *
+ * Definitions in use are splashed one per line, like "X3 = + X1 X2 - X4", then
+ * numerator and denominator are splashed as usual, separated by a line of '-'
+ * characters.
+ *
+ * \param ns sequence
+ * \param fref output file
+ */
+void
+nest_splash (const nest_t* ns, FILE* fref)
+{
+  const struct ndef* def;
+  int* num;
+  int* order;
+  int first;
+  int second;
+  int cnt;
+  int iter;
+  int pos;
+  int none;
+  int ul;
+  int dl;
+  num = XMALLOC(int, ns->cnt + 1);
+  order = XMALLOC(int, ns->cnt + 1);
+  cnt = nest_number(ns, num, order);
+  for(iter = 0; iter < cnt; ++iter) {
+    def = &(ns->def[order[iter]]);
+    fprintf(fref, " X%d =", iter + 1);
+    if(def->leaf != NULL) splash(def->leaf, fref, 1);
+    else {
+      none = 1;
+      for(pos = 0; pos < def->pcnt; ++pos) {
+	first = nest_target(ns, def->prod[pos].first);
+	second = nest_target(ns, def->prod[pos].second);
+	if((first == NEST_NONE) || (second == NEST_NONE)) continue;
+	none = 0;
+	fprintf(fref, " %c", (def->prod[pos].sign > 0) ? '+' : '-');
+	if((first == NEST_ONE) && (second == NEST_ONE)) fprintf(fref, " 1");
+	if(first >= 0) fprintf(fref, " X%d", num[first]);
+	if(second >= 0) fprintf(fref, " X%d", num[second]);
+      }
+      if(none) fprintf(fref, " NULL");
+      fprintf(fref, "\n");
+    }
+  }
+  first = nest_target(ns, ns->root[0]);
+  second = nest_target(ns, ns->root[1]);
+  ul = nest_ref(first, num, NULL);
+  dl = nest_ref(second, num, NULL);
+  nest_ref(first, num, fref);
+  sep(((dl > ul) ? dl : ul), fref);
+  nest_ref(second, num, fref);
+  XFREE(order);
+  XFREE(num);
+}
+
+/**
+ * \brief How to put nested expressions on file.
+ *
+ * Only the definitions in use are written, in the same order they would be
+ * splashed, after a magic number that tells them apart from the expanded
+ * expressions.
+ *
+ * \param ns sequence
+ * \param file file to be used
+ * \return number of errors occurred
+ */
+int
+nest_to_file (const nest_t* ns, FILE* file)
+{
+  const struct ndef* def;
+  int* num;
+  int* order;
+  int data[3];
+  int cnt;
+  int iter;
+  int pos;
+  int id;
+  int werr;
+  werr = 0;
+  if(file != NULL) {
+    num = XMALLOC(int, ns->cnt + 1);
+    order = XMALLOC(int, ns->cnt + 1);
+    cnt = nest_number(ns, num, order);
+    // mem magic and count
+    if(fwrite(NEST_MAGIC, sizeof(char), strlen(NEST_MAGIC), file) != strlen(NEST_MAGIC))
+      werr = 1;
+    if((!werr) && (fwrite(&cnt, sizeof(cnt), 1, file) != 1))
+      werr = 1;
+    for(iter = 0; (iter < cnt) && (!werr); ++iter) {
+      def = &(ns->def[order[iter]]);
+      // mem kind (number of products, -1 for polynomials)
+      data[0] = (def->leaf != NULL) ? -1 : 0;
+      for(pos = 0; (def->leaf == NULL) && (pos < def->pcnt); ++pos)
+	if((nest_target(ns, def->prod[pos].first) != NEST_NONE) && (nest_target(ns, def->prod[pos].second) != NEST_NONE))
+	  ++data[0];
+      if(fwrite(data, sizeof(int), 1, file) != 1)
+	werr = 1;
+      if((!werr) && (def->leaf != NULL))
+	werr = expr_to_file(def->leaf, file);
+      // mem products (factors by number, zero means one)
+      for(pos = 0; (def->leaf == NULL) && (pos < def->pcnt) && (!werr); ++pos) {
+	data[0] = def->prod[pos].sign;
+	data[1] = nest_target(ns, def->prod[pos].first);
+	data[2] = nest_target(ns, def->prod[pos].second);
+	if((data[1] == NEST_NONE) || (data[2] == NEST_NONE)) continue;
+	data[1] = (data[1] >= 0) ? num[data[1]] : 0;
+	data[2] = (data[2] >= 0) ? num[data[2]] : 0;
+	if(fwrite(data, sizeof(int), 3, file) != 3)
+	  werr = 1;
+      }
+    }
+    // mem roots (zero means one, -1 means zero)
+    for(iter = 0; (iter < 2) && (!werr); ++iter) {
+      id = nest_target(ns, ns->root[iter]);
+      data[0] = (id >= 0) ? num[id] : ((id == NEST_ONE) ? 0 : -1);
+      if(fwrite(data, sizeof(int), 1, file) != 1)
+	werr = 1;
+    }
+    XFREE(order);
+    XFREE(num);
+  }
+  if(werr)
+    warning("Some error occurs writing nested expressions on file!");
+  return werr;
+}
+
+/**
+ * \brief How to retrieve nested expressions from file.
+ *
+ * If the file doesn't start with the magic number of nested expressions, it is
+ * rewound and nothing is loaded.
+ *
+ * \param file file to be used
+ * \result loaded sequence if any, zero otherwise
+ */
+nest_t*
+nest_from_file (FILE* file)
+{
+  nest_t* ns;
+  char magic[sizeof(NEST_MAGIC)];
+  int data[3];
+  int cnt;
+  int iter;
+  int pos;
+  int id;
+  int rerr;
+  ns = NULL;
+  if(file != NULL) {
+    if((fread(magic, sizeof(char), strlen(NEST_MAGIC), file) != strlen(NEST_MAGIC))
+       || strncmp(magic, NEST_MAGIC, strlen(NEST_MAGIC))) {
+      rewind(file);
+      return NULL;
+    }
+    ns = nest_new();
+    rerr = (fread(&cnt, sizeof(cnt), 1, file) != 1) || (cnt < 0);
+    for(iter = 0; (iter < cnt) && (!rerr); ++iter) {
+      id = nest_def(ns);
+      if(fread(data, sizeof(int), 1, file) != 1)
+	rerr = 1;
+      else if(data[0] < 0) {
+	if((ns->def[id].leaf = expr_from_file(file)) == NULL)
+	  rerr = 1;
+      } else
+	for(pos = data[0]; (pos > 0) && (!rerr); --pos)
+	  if((fread(data, sizeof(int), 3, file) != 3)
+	     || (data[1] < 0) || (data[1] > iter) || (data[2] < 0) || (data[2] > iter))
+	    rerr = 1;
+	  else nest_add(ns, id, data[0], (data[1] > 0) ? (data[1] - 1) : NEST_ONE, (data[2] > 0) ? (data[2] - 1) : NEST_ONE);
+    }
+    for(iter = 0; (iter < 2) && (!rerr); ++iter)
+      if((fread(data, sizeof(int), 1, file) != 1) || (data[0] < -1) || (data[0] > cnt))
+	rerr = 1;
+      else ns->root[iter] = (data[0] > 0) ? (data[0] - 1) : ((data[0] == 0) ? NEST_ONE : NEST_NONE);
+    if(rerr) {
+      nest_del(ns);
+      fatal("Error loading nested expressions!");
+    }
+  }
+  return ns;
+}
@@ -0,0 +1,127 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file nest.h
+ *
+ * \brief Nested expressions
+ *
+ * This file contains the sequence of named expressions that finders which
+ * split the circuit into pieces can give instead of the expanded one, together
+ * with the prototypes of the functions that build it, splash it and move it to
+ * and from file.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef NEST_H
+#define NEST_H 1
+
+#include "common.h"
+#include "expr.h"
+
+/**
+ * \brief No definition (the expression is zero)
+ */
+#define NEST_NONE -1
+
+/**
+ * \brief No definition (the expression is one)
+ */
+#define NEST_ONE -2
+
+/**
+ * \brief Product of a sum: sign times two definitions
+ */
+struct nprod
+{
+  int sign;  /**< Sign of the product */
+  int first;  /**< First factor (a definition or NEST_ONE) */
+  int second;  /**< Second factor (a definition or NEST_ONE) */
+};
+
+/**
+ * \brief Definition of a sequence
+ *
+ * A definition is either a polynomial, as the other finders give, or a sum of
+ * products of other definitions.
+ */
+struct ndef
+{
+  expr_t* leaf;  /**< Polynomial (NULL for sums) */
+  struct nprod* prod;  /**< Products of the sum */
+  int pcnt;  /**< Number of products */
+  int psize;  /**< Allocated products */
+};
+
+/**
+ * \brief Sequence of nested expressions
+ *
+ * Definitions can refer to each other in any order, as long as there are no
+ * cycles: they are written children first.
+ */
+struct nest
+{
+  struct ndef* def;  /**< Definitions */
+  int cnt;  /**< Number of definitions */
+  int size;  /**< Allocated definitions */
+  int root[2];  /**< Numerator and denominator */
+};
+
+/**
+ * \brief Simpler %struct %nest definition
+ */
+typedef
+struct nest
+nest_t;
+
+extern nest_t*
+nest_new ();
+
+extern void
+nest_del (nest_t*);
+
+extern int
+nest_leaf (nest_t*, expr_t*);
+
+extern int
+nest_sum (nest_t*);
+
+extern void
+nest_add (nest_t*, const int, const int, const int, const int);
+
+extern void
+nest_splash (const nest_t*, FILE*);
+
+extern int
+nest_to_file (const nest_t*, FILE*);
+
+extern nest_t*
+nest_from_file (FILE*);
+
+#endif /* NEST_H */
@@ -37,15 +37,84 @@
  * the main function, obviously.
  */
 
+#include <getopt.h>
+#include <limits.h>
+#include <math.h>
+
 #include "common.h"
 #include "parser.h"
 #include "circuit.h"
 #include "list.h"
 #include "expr.h"
+#include "count.h"
+#include "estimate.h"
+#include "checkpoint.h"
+#include "subckt.h"
+#include "nest.h"
+#include "fdt.h"
+#include "spill.h"
+#include "cts.h"
+#include "eval.h"
 
 extern int
 spcng_parse (circ_t*);
 
+unsigned short int flags;
+
+struct env env;
+
+/**
+ * \brief Long options
+ *
+ * Long counterparts of the command-line options.
+ */
+static struct option long_options[] = {
+  { "help", no_argument, NULL, 'h' },
+  { "info", no_argument, NULL, 'i' },
+  { "verbose", no_argument, NULL, 'v' },
+  { "sapwin", no_argument, NULL, 's' },
+  { "binary", no_argument, NULL, 'b' },
+  { "engine", required_argument, NULL, 'e' },
+  { "kbest", required_argument, NULL, 'k' },
+  { "count", no_argument, NULL, 'c' },
+  { "estimate", required_argument, NULL, 't' },
+  { "checkpoint", required_argument, NULL, 'p' },
+  { "resume", no_argument, NULL, 'r' },
+  { "max-time", required_argument, NULL, 'T' },
+  { "max-memory", required_argument, NULL, 'M' },
+  { "max-terms", required_argument, NULL, 'N' },
+  { "degree", required_argument, NULL, 'd' },
+  { "with", required_argument, NULL, 'w' },
+  { "without", required_argument, NULL, 'x' },
+  { "symmetry", no_argument, NULL, 'y' },
+  { "nested", no_argument, NULL, 'n' },
+  { "compress", no_argument, NULL, 'z' },
+  { "query", no_argument, NULL, 'q' },
+  { "spill", required_argument, NULL, 'S' },
+  { "archive", no_argument, NULL, 'a' },
+  { "generate", no_argument, NULL, 'g' },
+  { "sweep", required_argument, NULL, 'f' },
+  { "values", required_argument, NULL, 'V' },
+  { "hierarchical", no_argument, NULL, 'H' },
+  { NULL, 0, NULL, 0 }
+};
+
+/**
+ * \brief Engine names
+ *
+ * Names of the common trees finders, in the same order of %enum %engine.
+ */
+static const char* engines[] = {
+  "grimbleby",
+  "kbest",
+  "matroid",
+  "exchange",
+  "cascade",
+  "tearing",
+  "store",
+  NULL
+};
+
 /**
  * \brief Usage function
  *
@@ -63,7 +132,47 @@ usage ()
   -i : informations about sapec-ng\n \
   -v : verbose mode\n \
   -s : SapWin compatibility (reverse current generator)\n \
-  -b : input from binary file\n");
+  -b : input from binary file\n \
+  -e, --engine=NAME : common trees finder (grimbleby, kbest, matroid,\n \
+                      exchange, cascade, tearing, store)\n \
+  -k, --kbest=NUM : only the NUM highest-magnitude trees per power of s\n \
+  -c, --count : count common trees per power of s, without enumeration\n \
+  -t, --estimate=NUM : estimate the work of the finder (NUM random samples,\n \
+                       grimbleby, kbest, matroid and exchange only)\n \
+  -p, --checkpoint=SEC : save the status of the finder every SEC seconds\n \
+  -r, --resume : resume the finder from the last checkpoint\n \
+  -T, --max-time=SEC : stop the finder after SEC seconds\n \
+  -M, --max-memory=MB : stop the finder when it uses MB megabytes\n \
+  -N, --max-terms=NUM : stop the finder after NUM common trees\n \
+  -d, --degree=LO:HI : only the powers of s from LO to HI (either can be\n \
+                       omitted, a single power is allowed as well)\n \
+  -w, --with=NAME : only the terms that contain NAME (repeatable)\n \
+  -x, --without=NAME : only the terms that don't contain NAME (repeatable)\n \
+  -y, --symmetry : enumerate one common tree per orbit of the symmetries\n \
+                   of the circuit (grimbleby only)\n \
+  -n, --nested : sequence of named expressions, not expanded (cascade and\n \
+                 tearing only)\n \
+  -z, --compress : packed .fdt file (dictionary, varints and compressed\n \
+                   blocks)\n \
+  -q, --query : terms of a .fdt file selected by -d, -w and -x, read by\n \
+                means of its index and splashed on the standard output\n \
+  -S, --spill=NUM : keep at most NUM terms in memory, the others sorted\n \
+                    into temporary files and merged at the end (grimbleby\n \
+                    and store only, neither checkpointed nor budgeted)\n \
+  -a, --archive : save the common trees into FILE.cts (grimbleby and\n \
+                  store only), to be evaluated again by the store engine\n \
+                  for new values or symbolic flags, or after a component\n \
+                  has been added or removed (only the new trees searched)\n \
+  -g, --generate : H(s) compiled into FILE.c, a C source that evaluates it\n \
+                   for the values of the symbols and a complex s\n \
+  -f, --sweep=LO:HI:NUM : magnitude (dB) and phase (degrees) of H(j2pif)\n \
+                          at NUM log-spaced frequencies from LO to HI Hz,\n \
+                          written into FILE.csv\n \
+  -V, --values=FILE : sets of values of the symbols for the sweep, one per\n \
+                      line as NAME=VALUE pairs (the netlist by default)\n \
+  -H, --hierarchical : each distinct subcircuit reduced once to its port\n \
+                       admittances, instances of the top level analysed as\n \
+                       multi-terminal elements\n");
   printf("\n");
 }
 
@@ -83,6 +192,202 @@ info ()
   printf("\n");
 }
 
+/**
+ * \brief Degree range parser
+ *
+ * It reads a range of powers of s, like "LO:HI", "LO:", ":HI" or "N", into
+ * the environment.
+ *
+ * \param arg range to be parsed
+ * \return zero if the range is wrong, a positive value otherwise
+ */
+int
+degrees (const char* arg)
+{
+  char* end;
+  env.degmin = 0;
+  env.degmax = INT_MAX;
+  if(*arg != ':') {
+    env.degmin = strtol(arg, &end, 10);
+    if(end == arg) return 0;
+    arg = end;
+    if(*arg == '\0') env.degmax = env.degmin;
+  }
+  if(*arg == ':') {
+    ++arg;
+    if(*arg != '\0') {
+      env.degmax = strtol(arg, &end, 10);
+      if((end == arg) || (*end != '\0')) return 0;
+    }
+  } else if(*arg != '\0') return 0;
+  return (env.degmin >= 0) && (env.degmin <= env.degmax);
+}
+
+/**
+ * \brief Frequency sweep parser
+ *
+ * It reads a sweep, like "LO:HI:NUM", into the environment.
+ *
+ * \param arg sweep to be parsed
+ * \return zero if the sweep is wrong, a positive value otherwise
+ */
+int
+frequencies (const char* arg)
+{
+  char* end;
+  env.fmin = strtod(arg, &end);
+  if((end == arg) || (*end != ':')) return 0;
+  arg = end + 1;
+  env.fmax = strtod(arg, &end);
+  if((end == arg) || (*end != ':')) return 0;
+  arg = end + 1;
+  env.fcnt = strtol(arg, &end, 10);
+  if((end == arg) || (*end != '\0')) return 0;
+  return (env.fmin > 0.) && (env.fmin <= env.fmax) && (env.fcnt > 0);
+}
+
+/**
+ * \brief Symbol constraints check
+ *
+ * It warns about required or forbidden symbols that don't belong to any
+ * component of the circuit.
+ *
+ * \param crep %circuit reference
+ */
+void
+symbols (const circ_t* crep)
+{
+  char** name;
+  char buf[4 * BUF_SIZE];
+  int iter;
+  int pass;
+  for(pass = 0; pass < 2; ++pass)
+    for(name = (pass) ? env.without : env.with; *name != NULL; ++name) {
+      for(iter = 0; (iter < crep->ednum) && ((crep->edge[iter].name == NULL) || strcmp(crep->edge[iter].name, *name)); ++iter);
+      if(iter == crep->ednum) {
+	snprintf(buf, 4 * BUF_SIZE, "Unknown symbol: %s", *name);
+	warning(buf);
+      }
+    }
+}
+
+/**
+ * \brief Partial results statistics
+ *
+ * It splashes why the finder has been stopped and how much of the search
+ * space of each block has been explored.
+ *
+ * \param fref output file
+ */
+void
+coverage (FILE* fref)
+{
+  double cover;
+  double trees;
+  fprintf(fref, "* partial results (%s):", ckp_reason());
+  ckp_coverage(1, &cover, &trees);
+  fprintf(fref, " numerator %.1f%% explored, %.0f common trees;", 100. * cover, trees);
+  ckp_coverage(0, &cover, &trees);
+  fprintf(fref, " denominator %.1f%% explored, %.0f common trees\n", 100. * cover, trees);
+}
+
+/**
+ * \brief Compiled evaluator writer
+ *
+ * It compiles numerator and denominator and writes the program as a C source
+ * file (see eval.h); the cursors are consumed.
+ *
+ * \param name output file name
+ * \param num cursor over the numerator
+ * \param den cursor over the denominator
+ * \param crep %circuit reference (NULL if the values of the symbols are
+ *   unknown)
+ */
+void
+generate (const char* name, struct ecursor* num, struct ecursor* den, const circ_t* crep)
+{
+  eval_t* ev;
+  double* values;
+  FILE* fref;
+  if((fref = fopen(name, "w")) != NULL) {
+    ev = eval_compile(num, den);
+    values = (crep != NULL) ? eval_values(ev, crep) : NULL;
+    eval_write(ev, values, fref);
+    fclose(fref);
+    XFREE(values);
+    eval_del(ev);
+  }
+}
+
+/**
+ * \brief Frequency sweep writer
+ *
+ * It compiles numerator and denominator and writes magnitude and phase of
+ * H(j2pif) as CSV lines, for each set of values of the symbols (see
+ * \e eval_read); the cursors are consumed.
+ *
+ * \param name output file name
+ * \param num cursor over the numerator
+ * \param den cursor over the denominator
+ * \param crep %circuit reference (NULL if the values of the symbols are
+ *   unknown, they're all one then)
+ */
+void
+sweep (const char* name, struct ecursor* num, struct ecursor* den, const circ_t* crep)
+{
+  eval_t* ev;
+  double* init;
+  double* values;
+  double* freq;
+  double* omega;
+  double* mag;
+  double* phase;
+  FILE* fref;
+  FILE* fset;
+  int set;
+  int iter;
+  fset = NULL;
+  if((env.values != NULL) && ((fset = fopen(env.values, "r")) == NULL))
+    warning("Unable to read the values of the symbols");
+  else if((fref = fopen(name, "w")) != NULL) {
+    ev = eval_compile(num, den);
+    if(crep != NULL) init = eval_values(ev, crep);
+    else {
+      init = XMALLOC(double, ev->ncnt + 1);
+      for(iter = 0; iter < ev->ncnt; ++iter)
+	init[iter] = 1.;
+    }
+    values = XMALLOC(double, ev->ncnt + 1);
+    freq = XMALLOC(double, env.fcnt);
+    omega = XMALLOC(double, env.fcnt);
+    mag = XMALLOC(double, env.fcnt);
+    phase = XMALLOC(double, env.fcnt);
+    for(iter = 0; iter < env.fcnt; ++iter) {
+      freq[iter] = (env.fcnt > 1) ? env.fmin * pow(env.fmax / env.fmin, (double) iter / (env.fcnt - 1)) : env.fmin;
+      omega[iter] = 2. * M_PI * freq[iter];
+    }
+    fprintf(fref, "set,frequency,magnitude,phase\n");
+    for(set = 0; ; ++set) {
+      memcpy(values, init, ev->ncnt * sizeof(double));
+      if((fset != NULL) && (!eval_read(ev, fset, values))) break;
+      eval_coeffs(ev, values);
+      eval_sweep(ev, omega, env.fcnt, mag, phase);
+      for(iter = 0; iter < env.fcnt; ++iter)
+	fprintf(fref, "%d,%.9g,%.9g,%.9g\n", set, freq[iter], mag[iter], phase[iter]);
+      if(fset == NULL) break;
+    }
+    fclose(fref);
+    XFREE(phase);
+    XFREE(mag);
+    XFREE(omega);
+    XFREE(freq);
+    XFREE(values);
+    XFREE(init);
+    eval_del(ev);
+  }
+  if(fset != NULL) fclose(fset);
+}
+
 /**
  * \brief Core function
  *
@@ -94,15 +399,15 @@ info ()
 void
 resolve (const char* ifile)
 {
-  int ul;
-  int dl;
   int length;
   circ_t* crep;
   list_t* yrefchain;
   list_t* grefchain;
+  struct ecursor cur[2];
   char* buf;
   extern FILE* yyin;
   FILE* fref;
+  FILE* flat;
   if(ifile != NULL) {
     yrefchain = NULL;
     grefchain = NULL;
@@ -111,6 +416,11 @@ resolve (const char* ifile)
     // parser link ! :-)
     if((yyin = fopen(ifile, "r")) != NULL) {
       VERBOSE(".");
+      // subcircuits expanded, if any
+      if((flat = sub_flatten(yyin)) != NULL) {
+	fclose(yyin);
+	yyin = flat;
+      }
       spcng_parse(crep);
       fclose(yyin);
     }
@@ -118,7 +428,30 @@ resolve (const char* ifile)
     VERBOSE(".");
     circ_normalize(crep);
     VERBOSE(".");
-    if(circ_to_expr(crep, &yrefchain, &grefchain)) {
+    if(env.checkpoint || RESUME() || env.maxtime || env.maxmem || env.maxterms) {
+      if(env.engine == GRIMBLEBY) ckp_open(ifile);
+      else warning("Only grimbleby engine can be checkpointed or budgeted");
+    }
+    if((env.engine == GRIMBLEBY) || (env.engine == STORE)) cts_open(ifile);
+    if((env.engine != GRIMBLEBY) && SYMMETRY())
+      warning("Only grimbleby engine is symmetry-aware");
+    if((env.engine != CASCADE) && (env.engine != TEARING) && NESTED())
+      warning("Only cascade and tearing engines give nested expressions");
+    else if(NESTED() && COMPRESS())
+      warning("Nested expressions are stored uncompressed");
+    if((env.engine != GRIMBLEBY) && (env.engine != STORE) && env.spill)
+      warning("Only grimbleby and store engines can spill terms");
+    else if(env.spill && (env.checkpoint || RESUME() || env.maxtime || env.maxmem || env.maxterms))
+      warning("Checkpointed or budgeted terms aren't spilled");
+    if((env.engine != GRIMBLEBY) && (env.engine != STORE) && ARCHIVE())
+      warning("Only grimbleby and store engines can store common trees");
+    else if(ARCHIVE() && (RESUME() || (env.degmin > 0) || (env.degmax < INT_MAX) || (*env.with != NULL) || (*env.without != NULL)))
+      warning("Filtered or resumed common trees aren't stored");
+    symbols(crep);
+    if(COUNT() || env.estimate) {
+      if(COUNT()) circ_count(crep, stdout);
+      if(env.estimate) circ_estimate(crep, env.estimate, stdout);
+    } else if(circ_to_expr(crep, &yrefchain, &grefchain)) {
       VERBOSE(".");
       length = strlen(ifile);
       buf = XMALLOC(char, length + 4 + 1);
@@ -127,25 +460,79 @@ resolve (const char* ifile)
       strcat(buf, ".out");
       if((fref = fopen(buf, "w")) != NULL) {
 	VERBOSE(".");
-        ul = splash((expr_t*) grefchain, NULL, 0);
-        dl = splash((expr_t*) yrefchain, NULL, 0);
-        splash((expr_t*) grefchain, fref, 1);
-        sep(((dl > ul) ? dl : ul), fref);
-        splash((expr_t*) yrefchain, fref, 1);
+	sub_splash(fref);
+	if(env.nest != NULL) nest_splash(env.nest, fref);
+	else if(env.spilled != NULL) {
+	  // terms merged straight from the runs
+	  spill_cursor(&cur[0], env.spilled, 0);
+	  spill_cursor(&cur[1], env.spilled, 1);
+	  splash_pair(&cur[0], &cur[1], fref);
+	} else {
+	  expr_cursor(&cur[0], (expr_t*) grefchain);
+	  expr_cursor(&cur[1], (expr_t*) yrefchain);
+	  splash_pair(&cur[0], &cur[1], fref);
+	}
+	if(ckp_stopped()) coverage(fref);
         fclose(fref);
       }
       buf[length] = '\0';
       strcat(buf, ".fdt");
       if((fref = fopen(buf, "wb")) != NULL) {
 	VERBOSE(".");
-	expr_to_file((expr_t*) grefchain, fref);
-	expr_to_file((expr_t*) yrefchain, fref);
+	if(env.nest != NULL) nest_to_file(env.nest, fref);
+	else if(env.spilled != NULL) fdt_write(spill_cursor, env.spilled, fref, COMPRESS());
+	else fdt_to_file((expr_t*) grefchain, (expr_t*) yrefchain, fref, COMPRESS());
 	fclose(fref);
       }
+      if(GENERATE()) {
+	buf[length] = '\0';
+	strcat(buf, ".c");
+	VERBOSE(".");
+	if(env.nest != NULL) warning("Nested expressions can't be compiled");
+	else if(sub_reduced()) warning("Hierarchical expressions can't be compiled");
+	else {
+	  if(env.spilled != NULL) {
+	    spill_cursor(&cur[0], env.spilled, 0);
+	    spill_cursor(&cur[1], env.spilled, 1);
+	  } else {
+	    expr_cursor(&cur[0], (expr_t*) grefchain);
+	    expr_cursor(&cur[1], (expr_t*) yrefchain);
+	  }
+	  generate(buf, &cur[0], &cur[1], crep);
+	}
+      }
+      if(env.fcnt) {
+	buf[length] = '\0';
+	strcat(buf, ".csv");
+	VERBOSE(".");
+	if(env.nest != NULL) warning("Nested expressions can't be compiled");
+	else if(sub_reduced()) warning("Hierarchical expressions can't be compiled");
+	else {
+	  if(env.spilled != NULL) {
+	    spill_cursor(&cur[0], env.spilled, 0);
+	    spill_cursor(&cur[1], env.spilled, 1);
+	  } else {
+	    expr_cursor(&cur[0], (expr_t*) grefchain);
+	    expr_cursor(&cur[1], (expr_t*) yrefchain);
+	  }
+	  sweep(buf, &cur[0], &cur[1], crep);
+	}
+      }
       XFREE(buf);
+      nest_del(env.nest);
+      env.nest = NULL;
       free_expr((expr_t*) yrefchain);
       free_expr((expr_t*) grefchain);
     }
+    spill_del(env.spilled);
+    env.spilled = NULL;
+    if(ckp_stopped()) {
+      warning("Stopped, partial results written (use -r to resume)");
+      coverage(stderr);
+    }
+    ckp_close();
+    cts_close();
+    sub_close();
     circ_del(crep);
   }
   VERBOSE(".\n");
@@ -162,20 +549,26 @@ resolve (const char* ifile)
 void
 load_and_splash (const char* ifile)
 {
-  int ul;
-  int dl;
   int length;
   list_t* yrefchain;
   list_t* grefchain;
+  nest_t* ns;
+  fdt_map_t* map;
+  struct ecursor cur[2];
   char* buf;
   FILE* fref;
   if(ifile != NULL) {
     yrefchain = NULL;
     grefchain = NULL;
+    ns = NULL;
+    map = NULL;
     if((fref = fopen(ifile, "r")) != NULL) {
       VERBOSE("parsing file ... \n");
-      grefchain = (list_t*) expr_from_file(fref);
-      yrefchain = (list_t*) expr_from_file(fref);
+      // nested expressions first, then version 2 (mapped), legacy files otherwise
+      if(((ns = nest_from_file(fref)) == NULL) && ((map = fdt_map(fref)) == NULL)) {
+	grefchain = (list_t*) expr_from_file(fref);
+	yrefchain = (list_t*) expr_from_file(fref);
+      }
       fclose(fref);
     }
     length = strlen(ifile);
@@ -185,20 +578,96 @@ load_and_splash (const char* ifile)
     strcat(buf, ".out");
     if((fref = fopen(buf, "w")) != NULL) {
       VERBOSE("writing text file ...\n");
-      ul = splash((expr_t*) grefchain, NULL, 0);
-      dl = splash((expr_t*) yrefchain, NULL, 0);
-      splash((expr_t*) grefchain, fref, 1);
-      sep(((dl > ul) ? dl : ul), fref);
-      splash((expr_t*) yrefchain, fref, 1);
+      if(ns != NULL) nest_splash(ns, fref);
+      else if(map != NULL) {
+	// terms splashed straight from the mapped file
+	fdt_cursor(&cur[0], map, 0);
+	fdt_cursor(&cur[1], map, 1);
+	splash_pair(&cur[0], &cur[1], fref);
+      } else {
+	expr_cursor(&cur[0], (expr_t*) grefchain);
+	expr_cursor(&cur[1], (expr_t*) yrefchain);
+	splash_pair(&cur[0], &cur[1], fref);
+      }
       fclose(fref);
     }
+    if(GENERATE()) {
+      buf[length] = '\0';
+      strcat(buf, ".c");
+      VERBOSE("writing compiled evaluator ...\n");
+      if(ns != NULL) warning("Nested expressions can't be compiled");
+      else {
+	if(map != NULL) {
+	  fdt_cursor(&cur[0], map, 0);
+	  fdt_cursor(&cur[1], map, 1);
+	} else {
+	  expr_cursor(&cur[0], (expr_t*) grefchain);
+	  expr_cursor(&cur[1], (expr_t*) yrefchain);
+	}
+	generate(buf, &cur[0], &cur[1], NULL);
+      }
+    }
+    if(env.fcnt) {
+      buf[length] = '\0';
+      strcat(buf, ".csv");
+      VERBOSE("writing frequency sweep ...\n");
+      if(ns != NULL) warning("Nested expressions can't be compiled");
+      else {
+	if(map != NULL) {
+	  fdt_cursor(&cur[0], map, 0);
+	  fdt_cursor(&cur[1], map, 1);
+	} else {
+	  expr_cursor(&cur[0], (expr_t*) grefchain);
+	  expr_cursor(&cur[1], (expr_t*) yrefchain);
+	}
+	sweep(buf, &cur[0], &cur[1], NULL);
+      }
+    }
     XFREE(buf);
+    fdt_unmap(map);
+    nest_del(ns);
     free_expr((expr_t*) yrefchain);
     free_expr((expr_t*) grefchain);
   }
   VERBOSE("terminate ...\n");
 }
 
+/**
+ * \brief Query function
+ *
+ * This function maps a version 2 binary file and splashes on the standard
+ * output only the terms selected by the range of powers of s and by the
+ * symbols the terms must (or must not) contain.
+ *
+ * \param ifile input binary file
+ */
+void
+query (const char* ifile)
+{
+  int g;
+  fdt_map_t* map;
+  fdt_query_t* sel[2];
+  struct ecursor cur[2];
+  FILE* fref;
+  map = NULL;
+  if((fref = fopen(ifile, "r")) != NULL) {
+    VERBOSE("parsing file ... \n");
+    map = fdt_map(fref);
+    fclose(fref);
+  }
+  if(map != NULL) {
+    for(g = 0; g < 2; ++g)
+      sel[g] = fdt_query_new(map, g, env.degmin, env.degmax, env.with, env.without);
+    fdt_query_cursor(&cur[0], sel[0]);
+    fdt_query_cursor(&cur[1], sel[1]);
+    splash_pair(&cur[0], &cur[1], stdout);
+    for(g = 0; g < 2; ++g)
+      fdt_query_del(sel[g]);
+    fdt_unmap(map);
+  } else warning("Only version 2 .fdt files can be queried");
+  VERBOSE("terminate ...\n");
+}
+
 /**
  * \brief The main function
  *
@@ -212,10 +681,32 @@ load_and_splash (const char* ifile)
 int
 main (int argc, char** argv)
 {
-  char opt;
+  int opt;
+  int iter;
+  int nwith;
+  int nwithout;
   CLEAR_FLAGS();
   SET_RUNNABLE();
-  while((opt = getopt(argc, argv, "bsvih")) != -1) {
+  env.engine = GRIMBLEBY;
+  env.kbest = 0;
+  env.estimate = 0;
+  env.checkpoint = 0;
+  env.maxtime = 0;
+  env.maxmem = 0;
+  env.maxterms = 0;
+  env.degmin = 0;
+  env.degmax = INT_MAX;
+  env.with = XMALLOC(char*, argc + 1);
+  env.without = XMALLOC(char*, argc + 1);
+  env.nest = NULL;
+  env.spill = 0;
+  env.spilled = NULL;
+  env.pin = -1;
+  env.fcnt = 0;
+  env.values = NULL;
+  nwith = nwithout = 0;
+  env.with[0] = env.without[0] = NULL;
+  while((opt = getopt_long(argc, argv, "bsvihcrynzqagHe:k:t:p:T:M:N:d:w:x:S:f:V:", long_options, NULL)) != -1) {
     switch(opt){
     case 'v':
       SET_VERBOSE();
@@ -232,6 +723,108 @@ main (int argc, char** argv)
     case 'b':
       SET_BINARY();
       break;
+    case 'c':
+      SET_COUNT();
+      break;
+    case 'r':
+      SET_RESUME();
+      break;
+    case 'y':
+      SET_SYMMETRY();
+      break;
+    case 'n':
+      SET_NESTED();
+      break;
+    case 'z':
+      SET_COMPRESS();
+      break;
+    case 'q':
+      SET_QUERY();
+      break;
+    case 'a':
+      SET_ARCHIVE();
+      break;
+    case 'g':
+      SET_GENERATE();
+      break;
+    case 'H':
+      SET_HIERARCHY();
+      break;
+    case 'e':
+      for(iter = 0; (engines[iter] != NULL) && strcmp(engines[iter], optarg); ++iter);
+      if(engines[iter] != NULL) env.engine = iter;
+      else {
+	SET_HELP();
+	printf("Unknown engine: %s\n", optarg);
+      }
+      break;
+    case 'k':
+      env.engine = KBEST;
+      if((env.kbest = atoi(optarg)) <= 0) {
+	SET_HELP();
+	printf("Wrong number of trees: %s\n", optarg);
+      }
+      break;
+    case 't':
+      if((env.estimate = atoi(optarg)) <= 0) {
+	SET_HELP();
+	printf("Wrong number of samples: %s\n", optarg);
+      }
+      break;
+    case 'p':
+      if((env.checkpoint = atoi(optarg)) <= 0) {
+	SET_HELP();
+	printf("Wrong number of seconds: %s\n", optarg);
+      }
+      break;
+    case 'T':
+      if((env.maxtime = atoi(optarg)) <= 0) {
+	SET_HELP();
+	printf("Wrong number of seconds: %s\n", optarg);
+      }
+      break;
+    case 'M':
+      if((env.maxmem = atoi(optarg)) <= 0) {
+	SET_HELP();
+	printf("Wrong number of megabytes: %s\n", optarg);
+      }
+      break;
+    case 'N':
+      if((env.maxterms = atoi(optarg)) <= 0) {
+	SET_HELP();
+	printf("Wrong number of trees: %s\n", optarg);
+      }
+      break;
+    case 'S':
+      if((env.spill = atoi(optarg)) <= 0) {
+	SET_HELP();
+	printf("Wrong number of terms: %s\n", optarg);
+      }
+      break;
+    case 'd':
+      if(!degrees(optarg)) {
+	SET_HELP();
+	printf("Wrong range of powers: %s\n", optarg);
+      }
+      break;
+    case 'f':
+      if(!frequencies(optarg)) {
+	SET_HELP();
+	env.fcnt = 0;
+	printf("Wrong frequency sweep: %s\n", optarg);
+      }
+      break;
+    case 'V':
+      env.values = optarg;
+      break;
+    case 'w':
+      env.with[nwith++] = optarg;
+      env.with[nwith] = NULL;
+      break;
+    case 'x':
+      env.without[nwithout++] = optarg;
+      env.without[nwithout] = NULL;
+      break;
     default:
       SET_HELP();
       printf("Unknow option: %c\n", optopt);
@@ -245,6 +838,11 @@ main (int argc, char** argv)
     info();
     CLEAR_FLAGS();
   }
+  if(QUERY()) {
+    if(optind < argc) query(argv[optind]);
+    else query("./circuit.fdt");
+    CLEAR_FLAGS();
+  }
   if(BINARY()) {
     if(optind < argc) load_and_splash(argv[optind]);
     else load_and_splash("./circuit.fdt");
@@ -254,5 +852,7 @@ main (int argc, char** argv)
     if(optind < argc) resolve(argv[optind]);
     else resolve("./circuit");
   }
+  XFREE(env.with);
+  XFREE(env.without);
   return EXIT_SUCCESS;
 }
@@ -0,0 +1,584 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file spill.c
+ *
+ * \brief Spilled terms
+ *
+ * When the terms found by grimbleby's finder grow too many, they are sorted by
+ * decreasing degree and then by symbols and written to a temporary file as a
+ * run, so that the memory in use doesn't grow with the size of the result.
+ * Runs are merged back a term at a time by means of a heap, summing the
+ * numeric parts of equal terms (terms without symbols are never summed, as it
+ * happens in memory), and the merged terms feed the writers through cursors.
+ * Each record of a run is made by the degree, the number of symbols and the
+ * numeric part of the term, followed by its NUL-terminated symbols.
+ */
+
+#include <string.h>
+
+#include "common.h"
+#include "list.h"
+#include "expr.h"
+#include "spill.h"
+
+/**
+ * \brief Runs merged at a time
+ *
+ * As soon as there are SPILL_WAYS runs of the same level, they are merged
+ * into a single run of the next level.
+ */
+#define SPILL_WAYS 32
+
+/**
+ * \brief Term read from a run
+ */
+struct sread
+{
+  FILE* file;  /**< Run */
+  int degree;  /**< Degree of the term */
+  int etoken;  /**< Number of symbols of the term */
+  double vpart;  /**< Numeric part of the term */
+  char* names;  /**< Symbols of the term (NUL-terminated, one after the other) */
+  size_t ncnt;  /**< Size of the symbols */
+  size_t nsize;  /**< Allocated size */
+};
+
+/**
+ * \brief Merge of some runs
+ *
+ * Runs are kept into a heap by their current term (ties are broken by the
+ * position of the runs, so that equal terms are summed in order).
+ */
+struct smerge
+{
+  struct sread* rd;  /**< Runs */
+  int rcnt;  /**< Number of runs */
+  int* heap;  /**< Heap of the runs that aren't over yet */
+  int hcnt;  /**< Size of the heap */
+  char* names;  /**< Symbols of the current term */
+  size_t ncnt;  /**< Size of the symbols */
+  size_t nsize;  /**< Allocated size */
+};
+
+/**
+ * \brief Term to be spilled
+ */
+struct sterm
+{
+  const expr_t* term;  /**< Term */
+  size_t pos;  /**< Position into the %list */
+};
+
+/**
+ * \brief It compares two terms
+ *
+ * \internal
+ * Decreasing degree first, then symbols one at a time.
+ *
+ * \param da degree of the first term
+ * \param ca number of symbols of the first term
+ * \param na symbols of the first term
+ * \param db degree of the second term
+ * \param cb number of symbols of the second term
+ * \param nb symbols of the second term
+ * \return less than, equal to or greater than zero, as strcmp does
+ */
+static int
+sp_compare (const int da, const int ca, const char* na, const int db, const int cb, const char* nb)
+{
+  int iter;
+  int ret;
+  if(da != db) return (da > db) ? -1 : 1;
+  for(iter = 0; (iter < ca) && (iter < cb); ++iter) {
+    if((ret = strcmp(na, nb)) != 0) return ret;
+    na += strlen(na) + 1;
+    nb += strlen(nb) + 1;
+  }
+  return (ca > cb) - (ca < cb);
+}
+
+/**
+ * \brief qsort comparator for terms to be spilled
+ *
+ * \internal
+ *
+ * \param a first term
+ * \param b second term
+ * \return less than, equal to or greater than zero, as strcmp does
+ */
+static int
+st_compare (const void* a, const void* b)
+{
+  const struct sterm* ta;
+  const struct sterm* tb;
+  const list_t* ia;
+  const list_t* ib;
+  int ret;
+  ta = (const struct sterm*) a;
+  tb = (const struct sterm*) b;
+  if(ta->term->degree != tb->term->degree)
+    return (ta->term->degree > tb->term->degree) ? -1 : 1;
+  ia = ta->term->epart;
+  ib = tb->term->epart;
+  for(; (ia != NULL) && (ib != NULL); ia = list_next(ia), ib = list_next(ib))
+    if((ret = strcmp(list_data(char, ia), list_data(char, ib))) != 0)
+      return ret;
+  if((ia != NULL) || (ib != NULL)) return (ia != NULL) ? 1 : -1;
+  return (ta->pos > tb->pos) - (ta->pos < tb->pos);
+}
+
+/**
+ * \brief It opens a new run
+ *
+ * \internal
+ *
+ * \return the temporary file
+ */
+static FILE*
+sp_open ()
+{
+  FILE* file;
+  if((file = tmpfile()) == NULL) fatal("Can't spill terms");
+  return file;
+}
+
+/**
+ * \brief It closes a run that has been written
+ *
+ * \internal
+ *
+ * \param file run
+ */
+static void
+sp_written (FILE* file)
+{
+  if(fflush(file) || ferror(file)) fatal("Error spilling terms!");
+}
+
+/**
+ * \brief It puts the head of a term into a run
+ *
+ * \internal
+ *
+ * \param file run
+ * \param degree degree of the term
+ * \param etoken number of symbols of the term
+ * \param vpart numeric part of the term
+ */
+static void
+sp_put (FILE* file, const int degree, const int etoken, const double vpart)
+{
+  fwrite(&degree, sizeof(degree), 1, file);
+  fwrite(&etoken, sizeof(etoken), 1, file);
+  fwrite(&vpart, sizeof(vpart), 1, file);
+}
+
+/**
+ * \brief It reads the next term of a run
+ *
+ * \internal
+ *
+ * \param rd run
+ * \return a positive value if there is a term, zero if the run is over
+ */
+static int
+sr_load (struct sread* rd)
+{
+  int cnt;
+  int ch;
+  if(fread(&rd->degree, sizeof(rd->degree), 1, rd->file) != 1) {
+    if(ferror(rd->file)) fatal("Error loading spilled terms!");
+    return 0;
+  }
+  if((fread(&rd->etoken, sizeof(rd->etoken), 1, rd->file) != 1) ||
+     (fread(&rd->vpart, sizeof(rd->vpart), 1, rd->file) != 1))
+    fatal("Error loading spilled terms!");
+  for(rd->ncnt = 0, cnt = 0; cnt < rd->etoken; ) {
+    if((ch = getc(rd->file)) == EOF) fatal("Error loading spilled terms!");
+    if(rd->ncnt == rd->nsize) {
+      rd->nsize *= 2;
+      rd->names = XREALLOC(char, rd->names, rd->nsize);
+    }
+    rd->names[rd->ncnt++] = (char) ch;
+    if(ch == '\0') ++cnt;
+  }
+  return 1;
+}
+
+/**
+ * \brief It tests whether a run comes before another one into the heap
+ *
+ * \internal
+ *
+ * \param sm merge
+ * \param a first run
+ * \param b second run
+ * \return a positive value if the first run comes first, zero otherwise
+ */
+static int
+sm_less (const struct smerge* sm, const int a, const int b)
+{
+  int ret;
+  ret = sp_compare(sm->rd[a].degree, sm->rd[a].etoken, sm->rd[a].names, sm->rd[b].degree, sm->rd[b].etoken, sm->rd[b].names);
+  return (ret < 0) || ((ret == 0) && (a < b));
+}
+
+/**
+ * \brief It moves a run down the heap, where it belongs
+ *
+ * \internal
+ *
+ * \param sm merge
+ * \param pos position into the heap
+ */
+static void
+sm_down (struct smerge* sm, int pos)
+{
+  int child;
+  int tmp;
+  while((child = 2 * pos + 1) < sm->hcnt) {
+    if((child + 1 < sm->hcnt) && sm_less(sm, sm->heap[child + 1], sm->heap[child])) ++child;
+    if(!sm_less(sm, sm->heap[child], sm->heap[pos])) break;
+    tmp = sm->heap[pos];
+    sm->heap[pos] = sm->heap[child];
+    sm->heap[child] = tmp;
+    pos = child;
+  }
+}
+
+/**
+ * \brief It moves the run on top of the heap to its next term
+ *
+ * \internal
+ *
+ * \param sm merge
+ */
+static void
+sm_advance (struct smerge* sm)
+{
+  if(!sr_load(&sm->rd[sm->heap[0]]))
+    sm->heap[0] = sm->heap[--sm->hcnt];
+  sm_down(sm, 0);
+}
+
+/**
+ * \brief It frees a merge
+ *
+ * \internal
+ *
+ * \param sm merge (the runs are left open)
+ */
+static void
+sm_del (struct smerge* sm)
+{
+  int iter;
+  if(sm != NULL) {
+    for(iter = 0; iter < sm->rcnt; ++iter)
+      XFREE(sm->rd[iter].names);
+    XFREE(sm->rd);
+    XFREE(sm->heap);
+    XFREE(sm->names);
+    XFREE(sm);
+  }
+}
+
+/**
+ * \brief It loads the next merged term of a cursor
+ *
+ * \internal
+ * Equal terms of the runs are summed, unless they haven't any symbol.
+ *
+ * \param cur cursor
+ */
+static void
+sp_load (struct ecursor* cur)
+{
+  struct smerge* sm;
+  struct sread* rd;
+  sm = (struct smerge*) cur->hook;
+  cur->end = (sm->hcnt == 0);
+  if(!cur->end) {
+    rd = &sm->rd[sm->heap[0]];
+    if(rd->ncnt > sm->nsize) {
+      sm->nsize = rd->ncnt;
+      sm->names = XREALLOC(char, sm->names, sm->nsize);
+    }
+    memcpy(sm->names, rd->names, rd->ncnt);
+    sm->ncnt = rd->ncnt;
+    cur->degree = rd->degree;
+    cur->etoken = rd->etoken;
+    cur->vpart = rd->vpart;
+    cur->trunc = ((const spill_t*) cur->src)->trunc[cur->idx[0]];
+    sm_advance(sm);
+    while((cur->etoken > 0) && (sm->hcnt > 0)) {
+      rd = &sm->rd[sm->heap[0]];
+      if(sp_compare(cur->degree, cur->etoken, sm->names, rd->degree, rd->etoken, rd->names))
+	break;
+      cur->vpart += rd->vpart;
+      sm_advance(sm);
+    }
+    cur->idx[1] = cur->etoken;
+    cur->idx[2] = 0;
+  }
+}
+
+/**
+ * \brief It moves a merge cursor to the next term
+ *
+ * \internal
+ *
+ * \param cur cursor
+ * \return a positive value if there is a term, zero otherwise
+ */
+static int
+sp_next (struct ecursor* cur)
+{
+  if(!cur->end) sp_load(cur);
+  return !cur->end;
+}
+
+/**
+ * \brief It gives the next symbol of a merge cursor
+ *
+ * \internal
+ *
+ * \param cur cursor
+ * \return the symbol, NULL if there is none
+ */
+static const char*
+sp_symbol (struct ecursor* cur)
+{
+  const char* name;
+  if(cur->idx[1] == 0) return NULL;
+  name = ((const struct smerge*) cur->hook)->names + cur->idx[2];
+  cur->idx[2] += strlen(name) + 1;
+  --cur->idx[1];
+  return name;
+}
+
+/**
+ * \brief It sets a cursor over some of the runs
+ *
+ * \internal
+ * The previous merge of the same part, if any, is freed.
+ *
+ * \param cur cursor to be set (on the first term)
+ * \param sp spilled terms
+ * \param g numerator (0) or denominator (1)
+ * \param first first run to be merged (the others follow)
+ */
+static void
+sp_set (struct ecursor* cur, spill_t* sp, const int g, const int first)
+{
+  struct smerge* sm;
+  int iter;
+  sm_del(sp->merge[g]);
+  sm = XMALLOC(struct smerge, 1);
+  sm->rd = XMALLOC(struct sread, sp->rcnt[g] + 1);
+  sm->rcnt = sp->rcnt[g];
+  sm->heap = XMALLOC(int, sp->rcnt[g] + 1);
+  sm->hcnt = 0;
+  sm->nsize = 64;
+  sm->ncnt = 0;
+  sm->names = XMALLOC(char, sm->nsize);
+  for(iter = 0; iter < sp->rcnt[g]; ++iter) {
+    sm->rd[iter].file = sp->run[g][iter];
+    sm->rd[iter].nsize = 64;
+    sm->rd[iter].names = XMALLOC(char, sm->rd[iter].nsize);
+    if(iter >= first) {
+      rewind(sm->rd[iter].file);
+      if(sr_load(&sm->rd[iter])) sm->heap[sm->hcnt++] = iter;
+    }
+  }
+  for(iter = sm->hcnt / 2; iter >= 0; --iter)
+    sm_down(sm, iter);
+  sp->merge[g] = sm;
+  cur->next = sp_next;
+  cur->symbol = sp_symbol;
+  cur->src = sp;
+  cur->hook = sm;
+  cur->idx[0] = g;
+  sp_load(cur);
+}
+
+/**
+ * \brief It merges the last runs, if they are too many
+ *
+ * \internal
+ * SPILL_WAYS runs of the same level become a single run of the next level, as
+ * long as there are any.
+ *
+ * \param sp spilled terms
+ * \param g numerator (0) or denominator (1)
+ */
+static void
+sp_compact (spill_t* sp, const int g)
+{
+  struct ecursor cur;
+  FILE* file;
+  int first;
+  int level;
+  int iter;
+  while(sp->rcnt[g] >= SPILL_WAYS) {
+    first = sp->rcnt[g] - SPILL_WAYS;
+    level = sp->level[g][first];
+    if(level != sp->level[g][sp->rcnt[g] - 1]) break;
+    file = sp_open();
+    for(sp_set(&cur, sp, g, first); !cur.end; cur.next(&cur)) {
+      sp_put(file, cur.degree, cur.etoken, cur.vpart);
+      fwrite(sp->merge[g]->names, 1, sp->merge[g]->ncnt, file);
+    }
+    sp_written(file);
+    sm_del(sp->merge[g]);
+    sp->merge[g] = NULL;
+    for(iter = first; iter < sp->rcnt[g]; ++iter)
+      fclose(sp->run[g][iter]);
+    sp->run[g][first] = file;
+    sp->level[g][first] = level + 1;
+    sp->rcnt[g] = first + 1;
+  }
+}
+
+/**
+ * \brief It allocates a new set of spilled terms
+ *
+ * \param limit terms kept in memory before being spilled
+ * \return spilled terms, none at first
+ */
+spill_t*
+spill_new (const int limit)
+{
+  spill_t* sp;
+  int g;
+  sp = XMALLOC(spill_t, 1);
+  for(g = 0; g < 2; ++g) {
+    sp->rsize[g] = SPILL_WAYS;
+    sp->rcnt[g] = 0;
+    sp->run[g] = XMALLOC(FILE*, sp->rsize[g]);
+    sp->level[g] = XMALLOC(int, sp->rsize[g]);
+    sp->trunc[g] = 0;
+    sp->merge[g] = NULL;
+  }
+  sp->limit = limit;
+  return sp;
+}
+
+/**
+ * \brief It frees a set of spilled terms, temporary files included
+ *
+ * \param sp spilled terms
+ */
+void
+spill_del (spill_t* sp)
+{
+  int iter;
+  int g;
+  if(sp != NULL) {
+    for(g = 0; g < 2; ++g) {
+      sm_del(sp->merge[g]);
+      for(iter = 0; iter < sp->rcnt[g]; ++iter)
+	fclose(sp->run[g][iter]);
+      XFREE(sp->run[g]);
+      XFREE(sp->level[g]);
+    }
+    XFREE(sp);
+  }
+}
+
+/**
+ * \brief It spills the terms in memory, if they are too many
+ *
+ * The terms are sorted and written as a new run, then they are freed.
+ *
+ * \param sp spilled terms (NULL means never)
+ * \param g numerator (0) or denominator (1)
+ * \param elist terms in memory
+ * \param all a positive value to spill the terms whatever their number is
+ * \return the terms left in memory (NULL once spilled)
+ */
+expr_t*
+spill_terms (spill_t* sp, const int g, expr_t* elist, const int all)
+{
+  struct sterm* st;
+  const expr_t* eiter;
+  const list_t* iter;
+  FILE* file;
+  size_t cnt;
+  size_t pos;
+  if(sp == NULL) return elist;
+  for(cnt = 0, eiter = elist; (eiter != NULL) && (all || (cnt < (size_t) sp->limit)); eiter = eiter->next)
+    ++cnt;
+  if(((!all) && (cnt < (size_t) sp->limit)) || (elist == NULL)) return elist;
+  for(; eiter != NULL; eiter = eiter->next)
+    ++cnt;
+  st = XMALLOC(struct sterm, cnt);
+  for(pos = 0, eiter = elist; eiter != NULL; eiter = eiter->next, ++pos) {
+    st[pos].term = eiter;
+    st[pos].pos = pos;
+  }
+  qsort(st, cnt, sizeof(struct sterm), st_compare);
+  file = sp_open();
+  for(pos = 0; pos < cnt; ++pos) {
+    sp_put(file, st[pos].term->degree, list_length(st[pos].term->epart), st[pos].term->vpart);
+    for(iter = st[pos].term->epart; iter != NULL; iter = list_next(iter))
+      fwrite(list_data(char, iter), 1, strlen(list_data(char, iter)) + 1, file);
+  }
+  sp_written(file);
+  XFREE(st);
+  free_expr(elist);
+  // the merge of this part, if any, is stale
+  sm_del(sp->merge[g]);
+  sp->merge[g] = NULL;
+  if(sp->rcnt[g] == sp->rsize[g]) {
+    sp->rsize[g] *= 2;
+    sp->run[g] = XREALLOC(FILE*, sp->run[g], sp->rsize[g]);
+    sp->level[g] = XREALLOC(int, sp->level[g], sp->rsize[g]);
+  }
+  sp->run[g][sp->rcnt[g]] = file;
+  sp->level[g][sp->rcnt[g]++] = 0;
+  sp_compact(sp, g);
+  return NULL;
+}
+
+/**
+ * \brief It sets a cursor over the spilled terms of a part
+ *
+ * Runs are merged from the start every time a cursor is set, so that the
+ * terms can be read over and over (see \e fdt_write); only one cursor per
+ * part is allowed at a time.
+ *
+ * \param cur cursor to be set (on the first term)
+ * \param src spilled terms (see %struct %spill)
+ * \param g numerator (0) or denominator (1)
+ */
+void
+spill_cursor (struct ecursor* cur, const void* src, const int g)
+{
+  sp_set(cur, (spill_t*) src, g, 0);
+}
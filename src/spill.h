@@ -0,0 +1,95 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file spill.h
+ *
+ * \brief Spilled terms
+ *
+ * This file contains the sorted runs of terms that grimbleby's finder moves to
+ * temporary files when they grow too many to be kept in memory, together with
+ * the prototypes of the functions that write them and merge them back.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef SPILL_H
+#define SPILL_H 1
+
+#include "common.h"
+#include "expr.h"
+
+/**
+ * \brief Steps between two checks
+ *
+ * Finders test whether the terms in memory are to be spilled once every
+ * SPILL_TICK + 1 common trees (SPILL_TICK must be a power of two minus one).
+ */
+#define SPILL_TICK 0x3f
+
+/**
+ * \brief Spilled terms
+ *
+ * Runs of terms, one temporary file each, sorted by decreasing degree and then
+ * by symbols; runs of the numerator (0) and of the denominator (1) are kept
+ * apart. Runs of the same level are merged together as soon as they are too
+ * many, so that few files are open at a time. Terms come back merged through
+ * cursors, with the numeric parts of equal terms summed, one cursor per part
+ * at a time.
+ */
+struct spill
+{
+  FILE** run[2];  /**< Runs */
+  int rcnt[2];  /**< Number of runs */
+  int rsize[2];  /**< Allocated runs */
+  int* level[2];  /**< Merge level of the runs (how many times merged) */
+  int trunc[2];  /**< Truncation marker of the terms */
+  int limit;  /**< Terms kept in memory before being spilled */
+  struct smerge* merge[2];  /**< Merge of the runs (private) */
+};
+
+/**
+ * \brief Simpler %struct %spill definition
+ */
+typedef
+struct spill
+spill_t;
+
+extern spill_t*
+spill_new (const int);
+
+extern void
+spill_del (spill_t*);
+
+extern expr_t*
+spill_terms (spill_t*, const int, expr_t*, const int);
+
+extern void
+spill_cursor (struct ecursor*, const void*, const int);
+
+#endif /* SPILL_H */
@@ -0,0 +1,892 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file subckt.c
+ *
+ * \brief Subcircuits expansion
+ *
+ * Netlists can define subcircuits (.SUBCKT name ports ... .ENDS) and use them
+ * many times (X instances: the name of the instance, the nodes bound to the
+ * ports and the name of the subcircuit). Each card sits on its own line.
+ * <br> Each subcircuit is built once into a template, nested instances
+ * expanded, whose nodes are the ground, the ports and the internal nodes, so
+ * that an instance costs no more than a copy of its template: internal nodes
+ * get fresh numbers (after the ones of the top level) and names of elements
+ * get the name of the instance as suffix (R1 of X1 becomes R1_X1). The flat
+ * netlist is written to a temporary file and read by the parser as usual.
+ * <br> In hierarchical mode, instances of the top level aren't expanded: each
+ * distinct template (a cache keyed by its contents) is reduced once to its
+ * port description, that is the port admittance matrix referred to the
+ * ground, and instances are replaced by multi-terminal elements, one
+ * symbolic transconductance per non-zero entry (H1_2_X1 and so on).
+ * <br> Entry (i, j) is the ratio between two common trees sums of the block:
+ * the determinant, whose circuit has the ports merged into the ground, and a
+ * numerator, whose circuit has port i merged into the ground but into the
+ * current graph and port j merged into the ground but into the voltage graph,
+ * where they take the place of each other. Blocks with sources or whose
+ * determinant is zero can't be described, and their instances are expanded.
+ */
+
+#include <limits.h>
+
+#include "common.h"
+#include "circuit.h"
+#include "list.h"
+#include "expr.h"
+#include "subckt.h"
+
+/**
+ * \brief Initial size of the line buffer
+ */
+#define SUB_LINE 256
+
+/**
+ * \brief Card of the netlist
+ */
+struct scard
+{
+  char* text;  /**< Line as it is */
+  char* buf;  /**< Tokens support buffer */
+  char** tok;  /**< Tokens (comments dropped) */
+  int cnt;  /**< Number of tokens */
+};
+
+/**
+ * \brief Element of a template
+ *
+ * Nodes are references: zero is the ground, then the ports (from one) and
+ * the internal nodes.
+ */
+struct selm
+{
+  char* name;  /**< Name of the element */
+  int ncnt;  /**< Number of nodes */
+  int node[4];  /**< Node references */
+  char** rest;  /**< Value and symbolic status tokens */
+  int rcnt;  /**< Number of value tokens */
+};
+
+/**
+ * \brief Subcircuit definition
+ */
+struct sdef
+{
+  char* name;  /**< Name of the subcircuit */
+  int pcnt;  /**< Number of ports */
+  int* port;  /**< Local nodes of the ports */
+  struct scard* body;  /**< Cards of the body */
+  int bcnt;  /**< Number of cards */
+  struct selm* elm;  /**< Template elements */
+  int ecnt;  /**< Number of template elements */
+  int esize;  /**< Allocated template elements */
+  int icnt;  /**< Number of internal nodes */
+  int state;  /**< Template status (0 raw, 1 under way, 2 built) */
+};
+
+/**
+ * \brief Local nodes map
+ */
+struct smap
+{
+  int* local;  /**< Local nodes */
+  int* ref;  /**< Related references */
+  int cnt;  /**< Number of nodes */
+  int size;  /**< Allocated nodes */
+};
+
+/**
+ * \brief Port description of a block
+ */
+struct sport
+{
+  char* key;  /**< Contents of the template (cache key) */
+  char* name;  /**< Name of the subcircuit */
+  int pcnt;  /**< Number of ports */
+  expr_t* det;  /**< Determinant (NULL if the block can't be described) */
+  expr_t** num;  /**< Numerators of the entries, row by row (NULL if zero) */
+};
+
+/**
+ * \brief Port descriptions and reduced instances
+ */
+static struct
+{
+  struct sport* port;  /**< Port descriptions, one per distinct template */
+  int pcnt;  /**< Number of port descriptions */
+  int psize;  /**< Allocated port descriptions */
+  char** inst;  /**< Names of the reduced instances */
+  int* of;  /**< Port descriptions of the reduced instances */
+  int icnt;  /**< Number of reduced instances */
+  int isize;  /**< Allocated reduced instances */
+} hier = { NULL, 0, 0, NULL, NULL, 0, 0 };
+
+extern void
+elm (int, int, const int, const int, const int, const double, char*, circ_t*);
+
+/**
+ * \brief It reads a line
+ *
+ * \internal
+ *
+ * \param in input stream
+ * \result line (newline included), NULL at the end of the stream
+ */
+static char*
+sub_line (FILE* in)
+{
+  char* buf;
+  size_t size;
+  size_t len;
+  size = SUB_LINE;
+  buf = XMALLOC(char, size);
+  len = 0;
+  while(fgets(buf + len, size - len, in) != NULL) {
+    len += strlen(buf + len);
+    if((buf[len - 1] == '\n') || (len < size - 1)) break;
+    size *= 2;
+    buf = XREALLOC(char, buf, size);
+  }
+  if(len == 0) {
+    XFREE(buf);
+    buf = NULL;
+  }
+  return buf;
+}
+
+/**
+ * \brief It splits a line into tokens
+ *
+ * \internal
+ * As the lexer does, a token that starts with '*' is a comment up to the end
+ * of the line.
+ *
+ * \param card card to be filled
+ * \param text line
+ */
+static void
+sub_split (struct scard* card, char* text)
+{
+  char* tok;
+  card->text = text;
+  card->buf = xstrdup(text);
+  card->tok = XMALLOC(char*, strlen(text) / 2 + 1);
+  card->cnt = 0;
+  for(tok = strtok(card->buf, " \t\r\n"); (tok != NULL) && (*tok != '*'); tok = strtok(NULL, " \t\r\n"))
+    card->tok[card->cnt++] = tok;
+}
+
+/**
+ * \brief Number of nodes of an element
+ *
+ * \internal
+ *
+ * \param name name of the element
+ * \result number of nodes, zero if the card isn't an element
+ */
+static int
+sub_arity (const char* name)
+{
+  if(strchr("RGCLVI", *name) != NULL) return 2;
+  if(strchr("HEFYA", *name) != NULL) return 4;
+  return 0;
+}
+
+/**
+ * \brief It reads a node
+ *
+ * \internal
+ *
+ * \param tok token
+ * \param node node read
+ * \result a positive value if the token is a node, zero otherwise
+ */
+static int
+sub_node (const char* tok, int* node)
+{
+  char* end;
+  long val;
+  val = strtol(tok, &end, 10);
+  if((*tok == '\0') || (*end != '\0') || (val < 0) || (val > SHRT_MAX)) return 0;
+  *node = (int) val;
+  return 1;
+}
+
+/**
+ * \brief It finds a subcircuit
+ *
+ * \internal
+ *
+ * \param def subcircuits
+ * \param dcnt number of subcircuits
+ * \param name name of the subcircuit
+ * \result subcircuit, NULL if it doesn't exist
+ */
+static struct sdef*
+sub_find (struct sdef* def, const int dcnt, const char* name)
+{
+  int iter;
+  for(iter = 0; iter < dcnt; ++iter)
+    if(!strcmp(def[iter].name, name)) return &def[iter];
+  return NULL;
+}
+
+/**
+ * \brief It gives the reference of a local node
+ *
+ * \internal
+ * Local nodes met for the first time (ports aside) are internal nodes.
+ *
+ * \param def subcircuit under way
+ * \param map local nodes map
+ * \param tok token of the local node
+ * \result reference of the node
+ */
+static int
+sub_ref (struct sdef* def, struct smap* map, const char* tok)
+{
+  int local;
+  int iter;
+  local = 0;
+  if(!sub_node(tok, &local)) fatal("Wrong node into a subcircuit");
+  if(local == 0) return 0;
+  for(iter = 0; (iter < map->cnt) && (map->local[iter] != local); ++iter);
+  if(iter == map->cnt) {
+    if(map->cnt == map->size) {
+      map->size = 2 * map->size + 8;
+      map->local = XREALLOC(int, map->local, map->size);
+      map->ref = XREALLOC(int, map->ref, map->size);
+    }
+    map->local[map->cnt] = local;
+    map->ref[map->cnt++] = def->pcnt + 1 + def->icnt++;
+  }
+  return map->ref[iter];
+}
+
+/**
+ * \brief It adds an element to a template
+ *
+ * \internal
+ *
+ * \param def subcircuit under way
+ * \param name name of the element
+ * \param inst name of the instance it comes from (NULL if none)
+ * \param ncnt number of nodes
+ * \param node node references
+ * \param rest value tokens
+ * \param rcnt number of value tokens
+ */
+static void
+sub_add (struct sdef* def, const char* name, const char* inst, const int ncnt, const int* node, char* const* rest, const int rcnt)
+{
+  struct selm* elm;
+  int iter;
+  if(def->ecnt == def->esize) {
+    def->esize = 2 * def->esize + 8;
+    def->elm = XREALLOC(struct selm, def->elm, def->esize);
+  }
+  elm = &def->elm[def->ecnt++];
+  if(inst != NULL) {
+    elm->name = XMALLOC(char, strlen(name) + strlen(inst) + 2);
+    sprintf(elm->name, "%s_%s", name, inst);
+  } else elm->name = xstrdup(name);
+  elm->ncnt = ncnt;
+  for(iter = 0; iter < ncnt; ++iter)
+    elm->node[iter] = node[iter];
+  elm->rest = XMALLOC(char*, rcnt + 1);
+  for(iter = 0; iter < rcnt; ++iter)
+    elm->rest[iter] = xstrdup(rest[iter]);
+  elm->rcnt = rcnt;
+}
+
+/**
+ * \brief It builds the template of a subcircuit
+ *
+ * \internal
+ * Templates of nested instances are built first (once and for all), then they
+ * are copied into the template, their internal nodes following the ones
+ * already met.
+ *
+ * \param def subcircuits
+ * \param dcnt number of subcircuits
+ * \param sub subcircuit to be built
+ */
+static void
+sub_build (struct sdef* def, const int dcnt, struct sdef* sub)
+{
+  struct scard* card;
+  struct sdef* inner;
+  struct selm* elm;
+  struct smap map;
+  int* actual;
+  int node[4];
+  int iter;
+  int pos;
+  int base;
+  int arity;
+  if(sub->state == 2) return;
+  if(sub->state == 1) fatal("Recursive subcircuit");
+  sub->state = 1;
+  map.local = map.ref = NULL;
+  map.cnt = map.size = 0;
+  for(iter = 0; iter < sub->pcnt; ++iter) {
+    for(pos = 0; (pos < map.cnt) && (map.local[pos] != sub->port[iter]); ++pos);
+    if(pos < map.cnt) fatal("Duplicate port of a subcircuit");
+    if(map.cnt == map.size) {
+      map.size = 2 * map.size + 8;
+      map.local = XREALLOC(int, map.local, map.size);
+      map.ref = XREALLOC(int, map.ref, map.size);
+    }
+    map.local[map.cnt] = sub->port[iter];
+    map.ref[map.cnt++] = iter + 1;
+  }
+  for(card = sub->body; card < sub->body + sub->bcnt; ++card) {
+    if(card->cnt == 0) continue;
+    if(!strcmp(card->tok[0], ".OUT"))
+      warning("Output node into a subcircuit ignored");
+    else if(card->tok[0][0] == 'X') {
+      inner = (card->cnt < 2) ? NULL : sub_find(def, dcnt, card->tok[card->cnt - 1]);
+      if(inner == NULL) fatal("Unknown subcircuit");
+      sub_build(def, dcnt, inner);
+      if(card->cnt - 2 != inner->pcnt) fatal("Wrong number of nodes of a subcircuit instance");
+      actual = XMALLOC(int, inner->pcnt + 1);
+      for(iter = 0; iter < inner->pcnt; ++iter)
+	actual[iter] = sub_ref(sub, &map, card->tok[iter + 1]);
+      base = sub->pcnt + 1 + sub->icnt;
+      for(elm = inner->elm; elm < inner->elm + inner->ecnt; ++elm) {
+	for(iter = 0; iter < elm->ncnt; ++iter)
+	  if(elm->node[iter] == 0) node[iter] = 0;
+	  else if(elm->node[iter] <= inner->pcnt) node[iter] = actual[elm->node[iter] - 1];
+	  else node[iter] = base + elm->node[iter] - inner->pcnt - 1;
+	sub_add(sub, elm->name, card->tok[0], elm->ncnt, node, elm->rest, elm->rcnt);
+      }
+      sub->icnt += inner->icnt;
+      XFREE(actual);
+    } else if((arity = sub_arity(card->tok[0])) && (card->cnt > arity)) {
+      for(iter = 0; iter < arity; ++iter)
+	node[iter] = sub_ref(sub, &map, card->tok[iter + 1]);
+      sub_add(sub, card->tok[0], NULL, arity, node, &card->tok[1 + arity], card->cnt - 1 - arity);
+    } else fatal("Wrong card into a subcircuit");
+  }
+  XFREE(map.ref);
+  XFREE(map.local);
+  sub->state = 2;
+}
+
+/**
+ * \brief Contents of a template
+ *
+ * \internal
+ * Ports, elements, nodes and values are written down one after another, so
+ * that templates with the same contents get the same key, whatever the name
+ * of their subcircuits is.
+ *
+ * \param sub subcircuit (built)
+ * \result key of the template
+ */
+static char*
+sub_key (const struct sdef* sub)
+{
+  const struct selm* elm;
+  char* key;
+  size_t len;
+  size_t size;
+  int iter;
+  len = BUF_SIZE;
+  for(elm = sub->elm; elm < sub->elm + sub->ecnt; ++elm) {
+    len += strlen(elm->name) + 4 * BUF_SIZE;
+    for(iter = 0; iter < elm->rcnt; ++iter)
+      len += strlen(elm->rest[iter]) + 1;
+  }
+  key = XMALLOC(char, len);
+  size = sprintf(key, "%d", sub->pcnt);
+  for(elm = sub->elm; elm < sub->elm + sub->ecnt; ++elm) {
+    size += sprintf(key + size, "|%s", elm->name);
+    for(iter = 0; iter < elm->ncnt; ++iter)
+      size += sprintf(key + size, " %d", elm->node[iter]);
+    for(iter = 0; iter < elm->rcnt; ++iter)
+      size += sprintf(key + size, " %s", elm->rest[iter]);
+  }
+  return key;
+}
+
+/**
+ * \brief It builds the circuit of a template
+ *
+ * \internal
+ * Elements are added the same way the parser does, nodes of the template
+ * being nodes of the circuit. Independent sources have no place into a port
+ * description.
+ *
+ * \param sub subcircuit (built)
+ * \result circuit (normalized), NULL if the template holds sources
+ */
+static circ_t*
+sub_proto (const struct sdef* sub)
+{
+  const struct selm* part;
+  circ_t* proto;
+  char* end;
+  double val;
+  long sym;
+  int node[4];
+  int iter;
+  for(part = sub->elm; part < sub->elm + sub->ecnt; ++part)
+    if((*part->name == 'V') || (*part->name == 'I')) return NULL;
+  proto = XMALLOC(circ_t, 1);
+  circ_init(proto);
+  for(part = sub->elm; part < sub->elm + sub->ecnt; ++part) {
+    for(iter = 0; iter < 4; ++iter)
+      node[iter] = (iter < part->ncnt) ? part->node[iter] : 0;
+    val = 0.;
+    sym = 0;
+    if(*part->name != 'A') {
+      if(part->rcnt != 2) fatal("Wrong card into a subcircuit");
+      val = strtod(part->rest[0], &end);
+      if(*end != '\0') fatal("Wrong card into a subcircuit");
+      sym = strtol(part->rest[1], &end, 10);
+      if(*end != '\0') fatal("Wrong card into a subcircuit");
+    }
+    elm(node[0], node[1], node[2], node[3], !sym, val, part->name, proto);
+  }
+  circ_normalize(proto);
+  return proto;
+}
+
+/**
+ * \brief It merges a node of a template
+ *
+ * \internal
+ *
+ * \param node node of the template
+ * \param map internal nodes of the template, renumbered
+ * \param pcnt number of ports
+ * \param sel port that isn't merged into the ground (zero means none)
+ * \param top node of the port that isn't merged
+ * \result node of the circuit
+ */
+static node_t
+sub_merge (const node_t node, const int* map, const int pcnt, const int sel, const int top)
+{
+  if(node == 0) return 0;
+  if(node <= pcnt) return (node == sel) ? top : 0;
+  return map[node];
+}
+
+/**
+ * \brief Forced edges test
+ *
+ * \internal
+ * Forced edges that close a loop into either the graphs leave no common
+ * trees (and they're pushed into the trees without any test).
+ *
+ * \param crep circuit reference
+ * \result a positive value if the forced edges close a loop, zero otherwise
+ */
+static int
+sub_loop (const circ_t* crep)
+{
+  const list_t* fiter;
+  const edge_t* eptr;
+  int* root;
+  int ret;
+  int iter;
+  int na;
+  int nb;
+  int g;
+  root = XMALLOC(int, 2 * crep->nnum);
+  for(iter = 0; iter < 2 * crep->nnum; ++iter)
+    root[iter] = iter;
+  ret = 0;
+  for(fiter = crep->flist; (fiter != NULL) && (!ret); fiter = list_next(fiter)) {
+    eptr = list_data(edge_t, fiter);
+    for(g = 0; g < 2; ++g) {
+      na = g * crep->nnum + (g ? eptr->gvref[0]->node : eptr->giref[0]->node);
+      nb = g * crep->nnum + (g ? eptr->gvref[1]->node : eptr->giref[1]->node);
+      while(root[na] != na) na = root[na];
+      while(root[nb] != nb) nb = root[nb];
+      if(na == nb) ret = 1;
+      else root[na] = nb;
+    }
+  }
+  XFREE(root);
+  return ret;
+}
+
+/**
+ * \brief It solves a circuit of a port description
+ *
+ * \internal
+ * Ports are merged into the ground, but port \a row into the current graph
+ * and port \a col into the voltage graph (zero means none), that take the
+ * place of each other into a node of their own. The yref %edge hangs from the
+ * ground.
+ *
+ * \param proto circuit of the template
+ * \param map internal nodes of the template, renumbered
+ * \param top number of the nodes merged or renumbered (ground included)
+ * \param pcnt number of ports
+ * \param row port into the current graph
+ * \param col port into the voltage graph
+ * \param elist pointer to be used to store the common trees sum
+ * \result zero if some error occurs, a positive value otherwise
+ */
+static int
+sub_solve (const circ_t* proto, const int* map, const int top, const int pcnt, const int row, const int col, expr_t** elist)
+{
+  const edge_t* eptr;
+  circ_t* crep;
+  list_t* chain;
+  node_t node[4];
+  int iter;
+  int ret;
+  crep = XMALLOC(circ_t, 1);
+  circ_init(crep);
+  for(iter = 0; iter < proto->ednum; ++iter) {
+    eptr = &proto->edge[iter];
+    node[0] = sub_merge(eptr->giref[0]->head->node, map, pcnt, row, top);
+    node[1] = sub_merge(eptr->giref[0]->node, map, pcnt, row, top);
+    node[2] = sub_merge(eptr->gvref[0]->head->node, map, pcnt, col, top);
+    node[3] = sub_merge(eptr->gvref[0]->node, map, pcnt, col, top);
+    if(eptr->type == F) addnullor(crep, node[0], node[1], node[2], node[3], eptr->name, eptr->value, eptr->sym);
+    else addsimple(crep, node[0], node[1], node[2], node[3], eptr->name, eptr->type, eptr->degree, eptr->value, eptr->sym);
+  }
+  // isolated nodes count as well
+  crep->nnum = top + (row > 0);
+  chain = NULL;
+  ret = setyref(crep, 0);
+  if(ret && (!sub_loop(crep))) ret = block_to_expr(crep, &chain);
+  *elist = (expr_t*) chain;
+  circ_del(crep);
+  return ret;
+}
+
+/**
+ * \brief It gives the port description of a subcircuit
+ *
+ * \internal
+ * Templates with the same contents share their port description, that is
+ * computed once and for all (the determinant first, then the numerators only
+ * if it isn't zero).
+ *
+ * \param sub subcircuit (built)
+ * \result port description (its determinant is NULL if it can't be given)
+ */
+static struct sport*
+sub_describe (const struct sdef* sub)
+{
+  struct sport* port;
+  circ_t* proto;
+  char* key;
+  int* map;
+  int top;
+  int iter;
+  int row;
+  int col;
+  int ret;
+  key = sub_key(sub);
+  for(port = hier.port; (port < hier.port + hier.pcnt) && strcmp(port->key, key); ++port);
+  if(port < hier.port + hier.pcnt) {
+    XFREE(key);
+    return port;
+  }
+  if(hier.pcnt == hier.psize) {
+    hier.psize = 2 * hier.psize + 8;
+    hier.port = XREALLOC(struct sport, hier.port, hier.psize);
+  }
+  port = &hier.port[hier.pcnt++];
+  port->key = key;
+  port->name = xstrdup(sub->name);
+  port->pcnt = sub->pcnt;
+  port->det = NULL;
+  port->num = XMALLOC(expr_t*, sub->pcnt * sub->pcnt + 1);
+  for(iter = 0; iter < sub->pcnt * sub->pcnt; ++iter)
+    port->num[iter] = NULL;
+  if((proto = sub_proto(sub)) != NULL) {
+    // internal nodes renumbered from one, in order
+    map = XMALLOC(int, proto->nnum + 1);
+    for(iter = 0; iter < proto->nnum; ++iter)
+      map[iter] = 0;
+    for(iter = 0; iter < proto->ednum; ++iter) {
+      map[proto->edge[iter].giref[0]->node] = 1;
+      map[proto->edge[iter].giref[1]->node] = 1;
+      map[proto->edge[iter].gvref[0]->node] = 1;
+      map[proto->edge[iter].gvref[1]->node] = 1;
+    }
+    top = 1;
+    for(iter = sub->pcnt + 1; iter < proto->nnum; ++iter)
+      if(map[iter]) map[iter] = top++;
+    ret = sub_solve(proto, map, top, sub->pcnt, 0, 0, &port->det);
+    for(row = 1; ret && (port->det != NULL) && (row <= sub->pcnt); ++row)
+      for(col = 1; ret && (col <= sub->pcnt); ++col)
+	ret = sub_solve(proto, map, top, sub->pcnt, row, col, &port->num[(row - 1) * sub->pcnt + col - 1]);
+    if(!ret) {
+      for(iter = 0; iter < sub->pcnt * sub->pcnt; ++iter) {
+	free_expr(port->num[iter]);
+	port->num[iter] = NULL;
+      }
+      free_expr(port->det);
+      port->det = NULL;
+    }
+    XFREE(map);
+    circ_del(proto);
+  }
+  if(port->det == NULL) warning("Subcircuit without port description, expanded");
+  return port;
+}
+
+/**
+ * \brief Subcircuits expansion
+ *
+ * It reads the netlist and, if it defines or uses subcircuits, it writes the
+ * flat netlist to a temporary file: cards of the top level are copied as they
+ * are, instances are replaced by the elements of their templates. Otherwise,
+ * the input stream is rewound and left to the parser.
+ * <br> In hierarchical mode, instances whose templates can be
+ * described are replaced by the entries of their port descriptions instead,
+ * that are kept until \e sub_close is invoked.
+ *
+ * \param in input stream
+ * \result flat netlist (rewound), NULL if there are no subcircuits
+ */
+FILE*
+sub_flatten (FILE* in)
+{
+  struct scard* card;
+  struct sdef* def;
+  struct sdef* sub;
+  struct selm* elm;
+  struct sport* port;
+  FILE* out;
+  char* text;
+  int* actual;
+  int ccnt;
+  int csize;
+  int dcnt;
+  int iter;
+  int pos;
+  int node;
+  int fresh;
+  int arity;
+  int row;
+  int col;
+  int nested;
+  // cards
+  card = NULL;
+  ccnt = csize = 0;
+  nested = 0;
+  while((text = sub_line(in)) != NULL) {
+    if(ccnt == csize) {
+      csize = 2 * csize + 64;
+      card = XREALLOC(struct scard, card, csize);
+    }
+    sub_split(&card[ccnt], text);
+    if((card[ccnt].cnt > 0) && ((card[ccnt].tok[0][0] == 'X') || !strcmp(card[ccnt].tok[0], ".SUBCKT")))
+      nested = 1;
+    ++ccnt;
+  }
+  out = NULL;
+  if(nested) {
+    // definitions
+    def = XMALLOC(struct sdef, ccnt);
+    dcnt = 0;
+    for(iter = 0; iter < ccnt; ++iter)
+      if((card[iter].cnt > 0) && !strcmp(card[iter].tok[0], ".SUBCKT")) {
+	if((card[iter].cnt < 2) || (sub_find(def, dcnt, card[iter].tok[1]) != NULL))
+	  fatal("Wrong or duplicate subcircuit");
+	sub = &def[dcnt++];
+	sub->name = card[iter].tok[1];
+	sub->pcnt = card[iter].cnt - 2;
+	sub->port = XMALLOC(int, sub->pcnt + 1);
+	for(pos = 0; pos < sub->pcnt; ++pos)
+	  if(!sub_node(card[iter].tok[pos + 2], &sub->port[pos]) || (sub->port[pos] == 0))
+	    fatal("Wrong port of a subcircuit");
+	sub->body = &card[iter + 1];
+	for(pos = iter + 1; (pos < ccnt) && ((card[pos].cnt == 0) || strcmp(card[pos].tok[0], ".ENDS")); ++pos)
+	  if((card[pos].cnt > 0) && (!strcmp(card[pos].tok[0], ".SUBCKT") || !strcmp(card[pos].tok[0], ".END")))
+	    fatal("Unterminated subcircuit");
+	if(pos == ccnt) fatal("Unterminated subcircuit");
+	sub->bcnt = pos - iter - 1;
+	sub->elm = NULL;
+	sub->ecnt = sub->esize = sub->icnt = sub->state = 0;
+	// hidden to the top level
+	card[iter].cnt = -1 - sub->bcnt;
+	iter = pos;
+	card[pos].cnt = -1;
+      } else if((card[iter].cnt > 0) && !strcmp(card[iter].tok[0], ".ENDS"))
+	fatal("Unexpected end of subcircuit");
+    // fresh nodes follow the ones of the top level
+    fresh = 0;
+    for(iter = 0; iter < ccnt; ++iter)
+      if(card[iter].cnt < 0) iter -= card[iter].cnt + 1;
+      else if(card[iter].cnt > 0) {
+	arity = sub_arity(card[iter].tok[0]);
+	if(card[iter].tok[0][0] == 'X') arity = card[iter].cnt - 2;
+	else if(!strcmp(card[iter].tok[0], ".OUT")) arity = 1;
+	for(pos = 1; (pos <= arity) && (pos < card[iter].cnt); ++pos)
+	  if(sub_node(card[iter].tok[pos], &node) && (node >= fresh))
+	    fresh = node + 1;
+      }
+    // flat netlist
+    if((out = tmpfile()) == NULL) fatal("Can't expand subcircuits");
+    for(iter = 0; iter < ccnt; ++iter)
+      if(card[iter].cnt < 0) iter -= card[iter].cnt + 1;
+      else if((card[iter].cnt > 0) && (card[iter].tok[0][0] == 'X')) {
+	sub = (card[iter].cnt < 2) ? NULL : sub_find(def, dcnt, card[iter].tok[card[iter].cnt - 1]);
+	if(sub == NULL) fatal("Unknown subcircuit");
+	sub_build(def, dcnt, sub);
+	if(card[iter].cnt - 2 != sub->pcnt) fatal("Wrong number of nodes of a subcircuit instance");
+	actual = XMALLOC(int, sub->pcnt + 1);
+	for(pos = 0; pos < sub->pcnt; ++pos)
+	  if(!sub_node(card[iter].tok[pos + 1], &actual[pos]))
+	    fatal("Wrong node of a subcircuit instance");
+	port = HIERARCHY() ? sub_describe(sub) : NULL;
+	if((port != NULL) && (port->det != NULL)) {
+	  // one transconductance per entry, those of the ground left out
+	  for(row = 0; row < sub->pcnt; ++row)
+	    for(col = 0; col < sub->pcnt; ++col)
+	      if((port->num[row * sub->pcnt + col] != NULL) && actual[row] && actual[col])
+		fprintf(out, "H%d_%d_%s %d 0 %d 0 1 0\n", row + 1, col + 1, card[iter].tok[0], actual[row], actual[col]);
+	  if(hier.icnt == hier.isize) {
+	    hier.isize = 2 * hier.isize + 8;
+	    hier.inst = XREALLOC(char*, hier.inst, hier.isize);
+	    hier.of = XREALLOC(int, hier.of, hier.isize);
+	  }
+	  hier.inst[hier.icnt] = xstrdup(card[iter].tok[0]);
+	  hier.of[hier.icnt++] = port - hier.port;
+	} else {
+	  for(elm = sub->elm; elm < sub->elm + sub->ecnt; ++elm) {
+	    fprintf(out, "%s_%s", elm->name, card[iter].tok[0]);
+	    for(pos = 0; pos < elm->ncnt; ++pos)
+	      if(elm->node[pos] == 0) fprintf(out, " 0");
+	      else if(elm->node[pos] <= sub->pcnt) fprintf(out, " %d", actual[elm->node[pos] - 1]);
+	      else fprintf(out, " %d", fresh + elm->node[pos] - sub->pcnt - 1);
+	    for(pos = 0; pos < elm->rcnt; ++pos)
+	      fprintf(out, " %s", elm->rest[pos]);
+	    fprintf(out, "\n");
+	  }
+	  fresh += sub->icnt;
+	}
+	XFREE(actual);
+      } else {
+	fputs(card[iter].text, out);
+	if(card[iter].text[strlen(card[iter].text) - 1] != '\n') fputs("\n", out);
+      }
+    rewind(out);
+    for(sub = def; sub < def + dcnt; ++sub) {
+      for(elm = sub->elm; elm < sub->elm + sub->ecnt; ++elm) {
+	for(pos = 0; pos < elm->rcnt; ++pos)
+	  XFREE(elm->rest[pos]);
+	XFREE(elm->rest);
+	XFREE(elm->name);
+      }
+      XFREE(sub->elm);
+      XFREE(sub->port);
+    }
+    XFREE(def);
+  } else rewind(in);
+  for(iter = 0; iter < ccnt; ++iter) {
+    XFREE(card[iter].tok);
+    XFREE(card[iter].buf);
+    XFREE(card[iter].text);
+  }
+  XFREE(card);
+  return out;
+}
+
+/**
+ * \brief It tells whether instances have been reduced
+ *
+ * \return number of the instances replaced by their port descriptions
+ */
+int
+sub_reduced ()
+{
+  return hier.icnt;
+}
+
+/**
+ * \brief It splashes the port descriptions
+ *
+ * Port descriptions in use are splashed one line per polynomial, like
+ * "D_RC = ..." for the determinant and "H1_2_RC = ..." for the numerator of
+ * an entry (zero ones left out), then a line per reduced instance, like
+ * "X1 = RC", tells which description it takes: H1_2_X1 stands for H1_2_RC
+ * divided by D_RC.
+ *
+ * \param fref output file
+ */
+void
+sub_splash (FILE* fref)
+{
+  const struct sport* port;
+  int iter;
+  int row;
+  int col;
+  for(port = hier.port; port < hier.port + hier.pcnt; ++port) {
+    for(iter = 0; (iter < hier.icnt) && (&hier.port[hier.of[iter]] != port); ++iter);
+    if(iter == hier.icnt) continue;
+    fprintf(fref, " D_%s =", port->name);
+    splash(port->det, fref, 1);
+    for(row = 0; row < port->pcnt; ++row)
+      for(col = 0; col < port->pcnt; ++col)
+	if(port->num[row * port->pcnt + col] != NULL) {
+	  fprintf(fref, " H%d_%d_%s =", row + 1, col + 1, port->name);
+	  splash(port->num[row * port->pcnt + col], fref, 1);
+	}
+  }
+  for(iter = 0; iter < hier.icnt; ++iter)
+    fprintf(fref, " %s = %s\n", hier.inst[iter], hier.port[hier.of[iter]].name);
+}
+
+/**
+ * \brief It drops the port descriptions
+ *
+ * Port descriptions and reduced instances are freed, so that another netlist
+ * can be expanded.
+ */
+void
+sub_close ()
+{
+  struct sport* port;
+  int iter;
+  for(port = hier.port; port < hier.port + hier.pcnt; ++port) {
+    for(iter = 0; iter < port->pcnt * port->pcnt; ++iter)
+      free_expr(port->num[iter]);
+    free_expr(port->det);
+    XFREE(port->num);
+    XFREE(port->name);
+    XFREE(port->key);
+  }
+  for(iter = 0; iter < hier.icnt; ++iter)
+    XFREE(hier.inst[iter]);
+  XFREE(hier.inst);
+  XFREE(hier.of);
+  XFREE(hier.port);
+  hier.pcnt = hier.psize = 0;
+  hier.icnt = hier.isize = 0;
+}
@@ -0,0 +1,58 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file subckt.h
+ *
+ * \brief Subcircuits expansion functions prototypes
+ *
+ * This file contains the prototype of the function that expands subcircuits
+ * into a flat netlist, the one the parser reads, and the ones that manage the
+ * port descriptions of the instances reduced in hierarchical mode.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef SUBCKT_H
+#define SUBCKT_H 1
+
+#include "common.h"
+
+extern FILE*
+sub_flatten (FILE*);
+
+extern int
+sub_reduced ();
+
+extern void
+sub_splash (FILE*);
+
+extern void
+sub_close ();
+
+#endif /* SUBCKT_H */
@@ -0,0 +1,789 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file symmetry.c
+ *
+ * \brief Symmetries of a circuit
+ *
+ * Differential and matched circuits are made of equal halves, so that their
+ * common trees come in orbits: a permutation of the nodes that maps both the
+ * graphs onto themselves (edges onto equal edges, the ground and the
+ * additional %edge of the block fixed) maps a common tree onto a common tree
+ * with the same sign, value and degree, and symbols mapped the same way.
+ * <br> Symmetries are searched by means of a refinement of the nodes (rounds
+ * of colors, as the edges around them are) and a backtracking over the nodes
+ * of the same color. Then grimbleby's finder enumerates only the common trees
+ * that are the greatest ones of their orbits (in the lexicographic order of
+ * the edges), so that branches that can't lead to them are pruned, and the
+ * other trees of an orbit are burnt by mapping the edges of its leader.
+ */
+
+#include "common.h"
+#include "circuit.h"
+#include "symmetry.h"
+
+/**
+ * \brief Maximum number of symmetries
+ */
+#define SY_MAXGROUP 64
+
+/**
+ * \brief Maximum number of steps of the search
+ */
+#define SY_MAXSTEP 1000000
+
+/**
+ * \brief Search status
+ */
+struct sctx
+{
+  const circ_t* crep;  /**< Circuit representation reference */
+  int nnum;  /**< Number of nodes */
+  int ednum;  /**< Number of edges */
+  int* ecolor;  /**< Color of each %edge */
+  int* ekey;  /**< Endpoints of each %edge (four by four, normalized) */
+  int* ecls;  /**< Class of each %edge (same color, same endpoints) */
+  int ccnt;  /**< Number of classes */
+  int* cstart;  /**< First member of each class */
+  int* cmember;  /**< Members of the classes (class by class) */
+  int* slot;  /**< Hash table of the classes (open addressing) */
+  int ssize;  /**< Hash table size (power of two) */
+  int* ncol;  /**< Color of each node */
+  int* nstart;  /**< First node of each color */
+  int* nmember;  /**< Nodes of the colors (color by color) */
+  int* order;  /**< Nodes in search order */
+  int* bstart;  /**< First %edge to be tested at each depth */
+  int* bedge;  /**< Edges to be tested (depth by depth) */
+  int* map;  /**< Image of each node */
+  char* used;  /**< Image already used */
+  long steps;  /**< Steps of the search so far */
+  int abort;  /**< Search aborted */
+  int gcnt;  /**< Number of symmetries found */
+  int* emap;  /**< Symmetries found */
+};
+
+/**
+ * \brief Node to be refined
+ */
+struct snode
+{
+  unsigned long long raw;  /**< Raw color */
+  int node;  /**< Node identifier */
+};
+
+/**
+ * \brief It mixes a value into a hash
+ *
+ * \internal
+ *
+ * \param hash actual hash
+ * \param value value to be mixed
+ * \result new hash
+ */
+static unsigned long long
+sy_mix (unsigned long long hash, const unsigned long long value)
+{
+  hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  hash ^= hash >> 31;
+  hash *= 0xbf58476d1ce4e5b9ULL;
+  hash ^= hash >> 27;
+  return hash;
+}
+
+/**
+ * \brief Comparison function for nodes to be refined
+ *
+ * \internal
+ *
+ * \param a first node
+ * \param b second node
+ * \result comparison result, as qsort expects
+ */
+static int
+sy_compare (const void* a, const void* b)
+{
+  const struct snode* na;
+  const struct snode* nb;
+  na = (const struct snode*) a;
+  nb = (const struct snode*) b;
+  if(na->raw != nb->raw) return (na->raw < nb->raw) ? -1 : 1;
+  return na->node - nb->node;
+}
+
+/**
+ * \brief It gives the n-th endpoint of an %edge
+ *
+ * \internal
+ * Endpoints are the tail and the head into the current graph, then the tail
+ * and the head into the voltage graph.
+ *
+ * \param eptr %edge reference
+ * \param n endpoint
+ * \result node
+ */
+static int
+sy_end (const edge_t* eptr, const int n)
+{
+  switch(n) {
+  case 0:
+    return eptr->giref[0]->node;
+  case 1:
+    return eptr->giref[1]->node;
+  case 2:
+    return eptr->gvref[0]->node;
+  default:
+    return eptr->gvref[1]->node;
+  }
+}
+
+/**
+ * \brief It normalizes the endpoints of an %edge
+ *
+ * \internal
+ * An %edge can be reversed into both the graphs at once (signs cancel each
+ * other out), so that endpoints are given with the smaller tail into the
+ * current graph.
+ *
+ * \param key endpoints
+ */
+static void
+sy_norm (int* key)
+{
+  int tmp;
+  if((key[0] > key[1]) || ((key[0] == key[1]) && (key[2] > key[3]))) {
+    tmp = key[0];
+    key[0] = key[1];
+    key[1] = tmp;
+    tmp = key[2];
+    key[2] = key[3];
+    key[3] = tmp;
+  }
+}
+
+/**
+ * \brief It gives the hash slot of a class
+ *
+ * \internal
+ *
+ * \param sc search status
+ * \param color color of the edges
+ * \param key normalized endpoints
+ * \result slot of the class, or the free slot it should use
+ */
+static int
+sy_slot (const struct sctx* sc, const int color, const int* key)
+{
+  unsigned long long hash;
+  int iter;
+  int cls;
+  const int* ckey;
+  hash = sy_mix(0, color);
+  for(iter = 0; iter < 4; ++iter)
+    hash = sy_mix(hash, key[iter]);
+  iter = (int) (hash & (sc->ssize - 1));
+  while((cls = sc->slot[iter]) >= 0) {
+    ckey = &sc->ekey[4 * sc->cmember[sc->cstart[cls]]];
+    if((sc->ecolor[sc->cmember[sc->cstart[cls]]] == color) &&		\
+       (ckey[0] == key[0]) && (ckey[1] == key[1]) && (ckey[2] == key[2]) && (ckey[3] == key[3]))
+      break;
+    iter = (iter + 1) & (sc->ssize - 1);
+  }
+  return iter;
+}
+
+/**
+ * \brief It gives the class an %edge is mapped onto
+ *
+ * \internal
+ *
+ * \param sc search status
+ * \param edge %edge
+ * \result class, or -1 if no class has that color and those endpoints
+ */
+static int
+sy_image (const struct sctx* sc, const int edge)
+{
+  int key[4];
+  int iter;
+  for(iter = 0; iter < 4; ++iter)
+    key[iter] = sc->map[sy_end(&sc->crep->edge[edge], iter)];
+  sy_norm(key);
+  return sc->slot[sy_slot(sc, sc->ecolor[edge], key)];
+}
+
+/**
+ * \brief Edges classification
+ *
+ * \internal
+ * Edges have the same color if they are the same element as far as terms
+ * are concerned (type, degree, symbolic status, value of numerical ones), as
+ * well as forced edges, the additional ones and edges constrained by symbols.
+ * Edges of the same color with the same endpoints form a class.
+ *
+ * \param sc search status
+ * \param ref additional %edge of the block
+ * \param nodes nodes into the tree (forced edges first)
+ * \param fixed edges forced into (positive) or out of (negative) the tree
+ */
+static void
+sy_classify (struct sctx* sc, const int ref, const node_t* nodes, const int* fixed)
+{
+  const circ_t* crep;
+  const edge_t* ea;
+  const edge_t* eb;
+  int* tag;
+  int* csize;
+  int iter;
+  int other;
+  int ccnt;
+  crep = sc->crep;
+  tag = XMALLOC(int, sc->ednum);
+  for(iter = 0; iter < sc->ednum; ++iter) {
+    tag[iter] = 0;
+    if((fixed != NULL) && fixed[iter]) tag[iter] = (fixed[iter] > 0) ? 1 : 2;
+    if((&crep->edge[iter] == crep->yref) || (&crep->edge[iter] == crep->gref)) tag[iter] = 3;
+  }
+  for(iter = 0; iter < crep->efnum; ++iter)
+    tag[nodes[iter]] = 4;
+  tag[ref] = 5;
+  ccnt = 0;
+  for(iter = 0; iter < sc->ednum; ++iter) {
+    ea = &crep->edge[iter];
+    for(other = 0; other < iter; ++other) {
+      eb = &crep->edge[other];
+      if((tag[iter] == tag[other]) && (ea->type == eb->type) && (ea->degree == eb->degree) && \
+	 (ea->sym == eb->sym) && ((ea->name == NULL) == (eb->name == NULL)) && \
+	 (ea->sym || (ea->value == eb->value)) && (tag[iter] != 5))
+	break;
+    }
+    sc->ecolor[iter] = (other < iter) ? sc->ecolor[other] : ccnt++;
+    for(other = 0; other < 4; ++other)
+      sc->ekey[4 * iter + other] = sy_end(ea, other);
+    sy_norm(&sc->ekey[4 * iter]);
+  }
+  // classes
+  sc->ccnt = 0;
+  for(sc->ssize = 1; sc->ssize < 2 * sc->ednum; sc->ssize <<= 1);
+  sc->slot = XMALLOC(int, sc->ssize);
+  for(iter = 0; iter < sc->ssize; ++iter)
+    sc->slot[iter] = -1;
+  csize = XMALLOC(int, sc->ednum + 1);
+  for(iter = 0; iter < sc->ednum; ++iter) {
+    for(other = 0; other < iter; ++other)
+      if((sc->ecolor[other] == sc->ecolor[iter]) &&			\
+	 !memcmp(&sc->ekey[4 * other], &sc->ekey[4 * iter], 4 * sizeof(int)))
+	break;
+    if(other < iter) sc->ecls[iter] = sc->ecls[other];
+    else csize[sc->ecls[iter] = sc->ccnt++] = 0;
+    ++csize[sc->ecls[iter]];
+  }
+  sc->cstart[0] = 0;
+  for(iter = 0; iter < sc->ccnt; ++iter)
+    sc->cstart[iter + 1] = sc->cstart[iter] + csize[iter];
+  for(iter = 0; iter < sc->ccnt; ++iter)
+    csize[iter] = sc->cstart[iter];
+  for(iter = 0; iter < sc->ednum; ++iter)
+    sc->cmember[csize[sc->ecls[iter]]++] = iter;
+  for(iter = 0; iter < sc->ccnt; ++iter) {
+    other = sy_slot(sc, sc->ecolor[sc->cmember[sc->cstart[iter]]], &sc->ekey[4 * sc->cmember[sc->cstart[iter]]]);
+    sc->slot[other] = iter;
+  }
+  XFREE(csize);
+  XFREE(tag);
+}
+
+/**
+ * \brief Nodes refinement
+ *
+ * \internal
+ * The ground has a color of its own, then nodes are colored round by round as
+ * the edges around them are (their colors, the positions of the node into the
+ * edges and the colors of the other endpoints), until colors don't split
+ * anymore. Symmetries map nodes onto nodes of the same color.
+ *
+ * \param sc search status
+ * \result number of colors
+ */
+static int
+sy_refine (struct sctx* sc)
+{
+  const edge_t* eptr;
+  struct snode* sn;
+  unsigned long long* acc;
+  unsigned long long best;
+  unsigned long long hash;
+  static const int flip[2][4] = { { 0, 1, 2, 3 }, { 1, 0, 3, 2 } };
+  int end[4];
+  int ncnt;
+  int prev;
+  int iter;
+  int edge;
+  int dir;
+  int pos;
+  int node;
+  sn = XMALLOC(struct snode, sc->nnum);
+  acc = XMALLOC(unsigned long long, sc->nnum);
+  for(iter = 0; iter < sc->nnum; ++iter)
+    sc->ncol[iter] = (iter == sc->crep->basenode) ? 1 : 0;
+  ncnt = (sc->nnum > 1) ? 2 : 1;
+  prev = 0;
+  while(ncnt > prev) {
+    prev = ncnt;
+    for(iter = 0; iter < sc->nnum; ++iter)
+      acc[iter] = 0;
+    for(edge = 0; edge < sc->ednum; ++edge) {
+      eptr = &sc->crep->edge[edge];
+      for(iter = 0; iter < 4; ++iter)
+	end[iter] = sy_end(eptr, iter);
+      for(iter = 0; iter < 4; ++iter) {
+	node = end[iter];
+	for(pos = 0; (pos < iter) && (end[pos] != node); ++pos);
+	if(pos < iter) continue;
+	// the same whatever the direction of the edge
+	best = 0;
+	for(dir = 0; dir < 2; ++dir) {
+	  hash = sy_mix(0, sc->ecolor[edge]);
+	  for(pos = 0; pos < 4; ++pos)
+	    hash = sy_mix(hash, (end[flip[dir][pos]] == node) ? 0 : 1 + sc->ncol[end[flip[dir][pos]]]);
+	  if(!dir || (hash < best)) best = hash;
+	}
+	acc[node] += best;
+      }
+    }
+    for(iter = 0; iter < sc->nnum; ++iter) {
+      sn[iter].raw = sy_mix(sc->ncol[iter], acc[iter]);
+      sn[iter].node = iter;
+    }
+    qsort(sn, sc->nnum, sizeof(struct snode), sy_compare);
+    ncnt = 0;
+    for(iter = 0; iter < sc->nnum; ++iter) {
+      if(iter && (sn[iter].raw != sn[iter - 1].raw)) ++ncnt;
+      sc->ncol[sn[iter].node] = ncnt;
+    }
+    ++ncnt;
+  }
+  XFREE(acc);
+  XFREE(sn);
+  return ncnt;
+}
+
+/**
+ * \brief Search order
+ *
+ * \internal
+ * Nodes are searched in breadth-first order from the ground, so that edges
+ * can be tested as soon as their endpoints are all mapped.
+ *
+ * \param sc search status
+ * \param ncnt number of colors
+ */
+static void
+sy_order (struct sctx* sc, const int ncnt)
+{
+  int* depth;
+  int* cnt;
+  int head;
+  int tail;
+  int iter;
+  int edge;
+  int node;
+  int pos;
+  depth = XMALLOC(int, sc->nnum);
+  cnt = XMALLOC(int, ((ncnt > sc->nnum) ? ncnt : sc->nnum) + 1);
+  for(iter = 0; iter < sc->nnum; ++iter)
+    depth[iter] = -1;
+  head = tail = 0;
+  for(iter = 0; iter < sc->nnum; ++iter) {
+    node = (iter == 0) ? sc->crep->basenode : iter;
+    if(depth[node] >= 0) continue;
+    depth[node] = tail;
+    sc->order[tail++] = node;
+    while(head < tail) {
+      node = sc->order[head++];
+      for(edge = 0; edge < sc->ednum; ++edge) {
+	for(pos = 0; (pos < 4) && (sy_end(&sc->crep->edge[edge], pos) != node); ++pos);
+	if(pos < 4)
+	  for(pos = 0; pos < 4; ++pos)
+	    if(depth[sy_end(&sc->crep->edge[edge], pos)] < 0) {
+	      depth[sy_end(&sc->crep->edge[edge], pos)] = tail;
+	      sc->order[tail++] = sy_end(&sc->crep->edge[edge], pos);
+	    }
+      }
+    }
+  }
+  // edges by depth (the deepest endpoint)
+  for(iter = 0; iter <= sc->nnum; ++iter)
+    cnt[iter] = 0;
+  for(edge = 0; edge < sc->ednum; ++edge) {
+    head = 0;
+    for(pos = 0; pos < 4; ++pos)
+      if(depth[sy_end(&sc->crep->edge[edge], pos)] > head)
+	head = depth[sy_end(&sc->crep->edge[edge], pos)];
+    ++cnt[head];
+  }
+  sc->bstart[0] = 0;
+  for(iter = 0; iter < sc->nnum; ++iter)
+    sc->bstart[iter + 1] = sc->bstart[iter] + cnt[iter];
+  for(iter = 0; iter < sc->nnum; ++iter)
+    cnt[iter] = sc->bstart[iter];
+  for(edge = 0; edge < sc->ednum; ++edge) {
+    head = 0;
+    for(pos = 0; pos < 4; ++pos)
+      if(depth[sy_end(&sc->crep->edge[edge], pos)] > head)
+	head = depth[sy_end(&sc->crep->edge[edge], pos)];
+    sc->bedge[cnt[head]++] = edge;
+  }
+  // nodes by color
+  for(iter = 0; iter <= ncnt; ++iter)
+    cnt[iter] = 0;
+  for(iter = 0; iter < sc->nnum; ++iter)
+    ++cnt[sc->ncol[iter]];
+  sc->nstart[0] = 0;
+  for(iter = 0; iter < ncnt; ++iter)
+    sc->nstart[iter + 1] = sc->nstart[iter] + cnt[iter];
+  for(iter = 0; iter < ncnt; ++iter)
+    cnt[iter] = sc->nstart[iter];
+  for(iter = 0; iter < sc->nnum; ++iter)
+    sc->nmember[cnt[sc->ncol[iter]]++] = iter;
+  XFREE(cnt);
+  XFREE(depth);
+}
+
+/**
+ * \brief It records a symmetry
+ *
+ * \internal
+ * Each class is mapped onto its image, the first %edge onto the first one and
+ * so on, so that symmetries of the nodes give a group of permutations of the
+ * edges. The identity and symmetries already found are discarded.
+ *
+ * \param sc search status
+ */
+static void
+sy_record (struct sctx* sc)
+{
+  int* emap;
+  int cls;
+  int img;
+  int iter;
+  int moved;
+  emap = &sc->emap[sc->gcnt * sc->ednum];
+  moved = 0;
+  for(cls = 0; cls < sc->ccnt; ++cls) {
+    img = sy_image(sc, sc->cmember[sc->cstart[cls]]);
+    for(iter = 0; iter < sc->cstart[cls + 1] - sc->cstart[cls]; ++iter) {
+      emap[sc->cmember[sc->cstart[cls] + iter]] = sc->cmember[sc->cstart[img] + iter];
+      if(img != cls) moved = 1;
+    }
+  }
+  if(moved) {
+    for(iter = 0; iter < sc->gcnt; ++iter)
+      if(!memcmp(&sc->emap[iter * sc->ednum], emap, sc->ednum * sizeof(int)))
+	break;
+    if(iter == sc->gcnt) {
+      if(sc->gcnt == SY_MAXGROUP - 1) sc->abort = 1;
+      else ++sc->gcnt;
+    }
+  }
+}
+
+/**
+ * \brief Backtracking over the nodes
+ *
+ * \internal
+ * Nodes are mapped in search order onto unused nodes of the same color, then
+ * edges whose endpoints are all mapped are tested: their images must be
+ * classes of the same size.
+ *
+ * \param sc search status
+ * \param depth actual depth
+ */
+static void
+sy_search (struct sctx* sc, const int depth)
+{
+  int node;
+  int img;
+  int iter;
+  int edge;
+  int cls;
+  if(depth == sc->nnum) {
+    sy_record(sc);
+    return;
+  }
+  node = sc->order[depth];
+  for(iter = sc->nstart[sc->ncol[node]]; (iter < sc->nstart[sc->ncol[node] + 1]) && (!sc->abort); ++iter) {
+    img = sc->nmember[iter];
+    if(sc->used[img]) continue;
+    if(++sc->steps > SY_MAXSTEP) {
+      sc->abort = 1;
+      break;
+    }
+    sc->map[node] = img;
+    sc->used[img] = 1;
+    for(edge = sc->bstart[depth]; edge < sc->bstart[depth + 1]; ++edge) {
+      cls = sy_image(sc, sc->bedge[edge]);
+      if((cls < 0) || ((sc->cstart[cls + 1] - sc->cstart[cls]) !=	\
+		       (sc->cstart[sc->ecls[sc->bedge[edge]] + 1] - sc->cstart[sc->ecls[sc->bedge[edge]]])))
+	break;
+    }
+    if(edge == sc->bstart[depth + 1])
+      sy_search(sc, depth + 1);
+    sc->used[img] = 0;
+  }
+}
+
+/**
+ * \brief Symmetries of a block
+ *
+ * It searches the symmetries of the circuit that fix the ground, the
+ * additional %edge of the block, forced edges and edges constrained by
+ * symbols. Too many symmetries (or a search too long) are given up.
+ *
+ * \param crep circuit representation reference
+ * \param nodes nodes into the tree (forced edges, then the additional one)
+ * \param fixed edges forced into (positive) or out of (negative) the tree
+ * \result symmetries, NULL if none
+ */
+symm_t*
+sy_new (const circ_t* crep, const node_t* nodes, const int* fixed)
+{
+  struct sctx sc;
+  symm_t* sy;
+  unsigned long long seed;
+  int ncnt;
+  int iter;
+  int edge;
+  sy = NULL;
+  sc.crep = crep;
+  sc.nnum = crep->nnum;
+  sc.ednum = crep->ednum;
+  sc.ecolor = XMALLOC(int, sc.ednum);
+  sc.ekey = XMALLOC(int, 4 * sc.ednum);
+  sc.ecls = XMALLOC(int, sc.ednum);
+  sc.cstart = XMALLOC(int, sc.ednum + 1);
+  sc.cmember = XMALLOC(int, sc.ednum);
+  sc.ncol = XMALLOC(int, sc.nnum);
+  sc.nstart = XMALLOC(int, sc.nnum + 1);
+  sc.nmember = XMALLOC(int, sc.nnum);
+  sc.order = XMALLOC(int, sc.nnum);
+  sc.bstart = XMALLOC(int, sc.nnum + 1);
+  sc.bedge = XMALLOC(int, sc.ednum);
+  sc.map = XMALLOC(int, sc.nnum);
+  sc.used = XMALLOC(char, sc.nnum);
+  sc.emap = XMALLOC(int, SY_MAXGROUP * sc.ednum);
+  sc.steps = 0;
+  sc.abort = 0;
+  sc.gcnt = 0;
+  sy_classify(&sc, nodes[crep->efnum], nodes, fixed);
+  ncnt = sy_refine(&sc);
+  // discrete colors, nothing but the identity
+  if(ncnt < sc.nnum) {
+    sy_order(&sc, ncnt);
+    for(iter = 0; iter < sc.nnum; ++iter)
+      sc.used[iter] = 0;
+    sy_search(&sc, 0);
+  }
+  if(sc.abort)
+    warning("Too many symmetries, common trees enumerated as usual");
+  else if(sc.gcnt > 0) {
+    sy = XMALLOC(symm_t, 1);
+    sy->ednum = sc.ednum;
+    sy->gcnt = sc.gcnt;
+    sy->emap = XREALLOC(int, sc.emap, sc.gcnt * sc.ednum);
+    sc.emap = NULL;
+    sy->einv = XMALLOC(int, sc.gcnt * sc.ednum);
+    sy->first = XMALLOC(int, sc.gcnt);
+    for(iter = 0; iter < sc.gcnt; ++iter) {
+      sy->first[iter] = sc.ednum;
+      for(edge = 0; edge < sc.ednum; ++edge) {
+	sy->einv[iter * sc.ednum + sy->emap[iter * sc.ednum + edge]] = edge;
+	if((sy->emap[iter * sc.ednum + edge] != edge) && (sy->first[iter] == sc.ednum))
+	  sy->first[iter] = edge;
+      }
+    }
+    sy->in = XMALLOC(char, sc.ednum);
+    sy->ekey = XMALLOC(unsigned long long, sc.ednum);
+    sy->mark = XMALLOC(int, sc.ednum);
+    seed = 0x5ca1ab1eULL;
+    for(edge = 0; edge < sc.ednum; ++edge) {
+      sy->in[edge] = 0;
+      sy->mark[edge] = 0;
+      sy->ekey[edge] = seed = sy_mix(seed, edge);
+    }
+    sy->stamp = 0;
+    sy->ikey = XMALLOC(unsigned long long, sc.gcnt + 1);
+    sy->images = XMALLOC(node_t, (sc.gcnt + 1) * (sc.nnum - 1));
+  }
+  XFREE(sc.emap);
+  XFREE(sc.used);
+  XFREE(sc.map);
+  XFREE(sc.bedge);
+  XFREE(sc.bstart);
+  XFREE(sc.order);
+  XFREE(sc.nmember);
+  XFREE(sc.nstart);
+  XFREE(sc.ncol);
+  XFREE(sc.slot);
+  XFREE(sc.cmember);
+  XFREE(sc.cstart);
+  XFREE(sc.ecls);
+  XFREE(sc.ekey);
+  XFREE(sc.ecolor);
+  return sy;
+}
+
+/**
+ * \brief It frees the symmetries of a block
+ *
+ * \param sy symmetries
+ */
+void
+sy_del (symm_t* sy)
+{
+  if(sy != NULL) {
+    XFREE(sy->images);
+    XFREE(sy->ikey);
+    XFREE(sy->mark);
+    XFREE(sy->ekey);
+    XFREE(sy->in);
+    XFREE(sy->first);
+    XFREE(sy->einv);
+    XFREE(sy->emap);
+    XFREE(sy);
+  }
+}
+
+/**
+ * \brief It pushes an %edge into the actual tree
+ *
+ * \param sy symmetries
+ * \param edge %edge
+ */
+void
+sy_push (symm_t* sy, const int edge)
+{
+  sy->in[edge] = 1;
+}
+
+/**
+ * \brief It pops an %edge out of the actual tree
+ *
+ * \param sy symmetries
+ * \param edge %edge
+ */
+void
+sy_pop (symm_t* sy, const int edge)
+{
+  sy->in[edge] = 0;
+}
+
+/**
+ * \brief Pruning test
+ *
+ * Edges before the given position are decided (into the tree or not): if a
+ * symmetry maps them onto a greater sequence, no tree of the branch is the
+ * greatest one of its orbit.
+ *
+ * \param sy symmetries
+ * \param pos first undecided %edge
+ * \result a positive value if the branch can be pruned, zero otherwise
+ */
+int
+sy_prune (const symm_t* sy, const int pos)
+{
+  const int* einv;
+  int iter;
+  int edge;
+  for(iter = 0; iter < sy->gcnt; ++iter) {
+    einv = &sy->einv[iter * sy->ednum];
+    for(edge = sy->first[iter]; (edge < pos) && (einv[edge] < pos); ++edge)
+      if(sy->in[edge] != sy->in[einv[edge]]) {
+	if(!sy->in[edge]) return 1;
+	break;
+      }
+  }
+  return 0;
+}
+
+/**
+ * \brief Orbit of a common tree
+ *
+ * If the actual tree is the greatest one of its orbit, its distinct images
+ * are given (the tree itself first), otherwise the tree must be discarded.
+ *
+ * \param sy symmetries
+ * \param nodes nodes into the tree
+ * \param cnt number of nodes into the tree
+ * \param images images of the tree, one after the other
+ * \result number of images, zero if the tree must be discarded
+ */
+int
+sy_orbit (symm_t* sy, const node_t* nodes, const int cnt, const node_t** images)
+{
+  const int* emap;
+  const int* einv;
+  node_t* img;
+  unsigned long long key;
+  int icnt;
+  int iter;
+  int edge;
+  int other;
+  key = 0;
+  for(iter = 0; iter < cnt; ++iter) {
+    sy->images[iter] = nodes[iter];
+    key += sy->ekey[nodes[iter]];
+  }
+  sy->ikey[0] = key;
+  icnt = 1;
+  for(iter = 0; iter < sy->gcnt; ++iter) {
+    einv = &sy->einv[iter * sy->ednum];
+    for(edge = sy->first[iter]; (edge < sy->ednum) && (sy->in[edge] == sy->in[einv[edge]]); ++edge);
+    // mapped onto itself
+    if(edge == sy->ednum) continue;
+    // a greater tree into the orbit
+    if(!sy->in[edge]) return 0;
+    emap = &sy->emap[iter * sy->ednum];
+    img = &sy->images[icnt * cnt];
+    key = 0;
+    for(edge = 0; edge < cnt; ++edge) {
+      img[edge] = emap[nodes[edge]];
+      key += sy->ekey[img[edge]];
+    }
+    for(other = 1; other < icnt; ++other)
+      if(sy->ikey[other] == key) {
+	++sy->stamp;
+	for(edge = 0; edge < cnt; ++edge)
+	  sy->mark[img[edge]] = sy->stamp;
+	for(edge = 0; (edge < cnt) && (sy->mark[sy->images[other * cnt + edge]] == sy->stamp); ++edge);
+	if(edge == cnt) break;
+      }
+    if(other == icnt) sy->ikey[icnt++] = key;
+  }
+  *images = sy->images;
+  return icnt;
+}
@@ -0,0 +1,92 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file symmetry.h
+ *
+ * \brief Symmetries of a circuit
+ *
+ * This file contains the symmetries found into a block of a circuit and the
+ * prototypes of the functions that grimbleby's finder uses to enumerate only
+ * one common tree per orbit.
+ */
+
+/**
+ * \brief Useful to manage multiple inclusions
+ */
+#ifndef SYMMETRY_H
+#define SYMMETRY_H 1
+
+#include "common.h"
+#include "circuit.h"
+
+/**
+ * \brief Symmetries of a block
+ *
+ * Symmetries are permutations of the edges, the identity not included.
+ */
+struct symm
+{
+  int ednum;  /**< Number of edges */
+  int gcnt;  /**< Number of symmetries */
+  int* emap;  /**< Image of each %edge (symmetry by symmetry) */
+  int* einv;  /**< Preimage of each %edge (symmetry by symmetry) */
+  int* first;  /**< First %edge moved by each symmetry */
+  char* in;  /**< Edges into the actual tree */
+  unsigned long long* ekey;  /**< Key of each %edge */
+  unsigned long long* ikey;  /**< Key of each image of the tree */
+  int* mark;  /**< Marks support array */
+  int stamp;  /**< Actual mark */
+  node_t* images;  /**< Images of the tree */
+};
+
+/**
+ * \brief Simpler %struct %symm definition
+ */
+typedef
+struct symm
+symm_t;
+
+extern symm_t*
+sy_new (const circ_t*, const node_t*, const int*);
+
+extern void
+sy_del (symm_t*);
+
+extern void
+sy_push (symm_t*, const int);
+
+extern void
+sy_pop (symm_t*, const int);
+
+extern int
+sy_prune (const symm_t*, const int);
+
+extern int
+sy_orbit (symm_t*, const node_t*, const int, const node_t**);
+
+#endif /* SYMMETRY_H */
@@ -0,0 +1,723 @@
+/****************************************************************************************
+ *
+ *  Sapec-NG, Next Generation Symbolic Analysis Program for Electric Circuit
+ *  Copyright (C)  2007  Michele Caini
+ *
+ *
+ *  This file is part of Sapec-NG.
+ *
+ *  Sapec-NG is free software; you can redistribute it and/or modify
+ *  it under the terms of the GNU General Public License as published by
+ *  the Free Software Foundation; either version 2 of the License, or
+ *  (at your option) any later version.
+ *
+ *  This program is distributed in the hope that it will be useful,
+ *  but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ *  GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License
+ *  along with this program; if not, write to the Free Software
+ *  Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *
+ *  To contact me:   skypjack@gmail.com
+ *
+ ***************************************************************************************/
+
+/**
+ * \file tearing.c
+ *
+ * \brief Node-tearing common trees finder
+ *
+ * This file contains a common trees finder that tears the circuit apart
+ * across small sets of nodes (up to three ones, the ground being always
+ * shared), recursively. Both the pieces are solved on their own for each way
+ * the rows of the shared nodes can be given to them, that is for each way the
+ * shared nodes can be connected to the rest of the tree through a piece rather
+ * than the other one, then the results are joined together.
+ *
+ * Signs come from the Laplace expansion of the incident matrices of both the
+ * graphs along the columns of a piece, so that pieces are the same polynomials
+ * the cascade finder uses and results are joined the same way. Pieces met more
+ * than once are solved once.
+ */
+
+#include "common.h"
+#include "list.h"
+#include "circuit.h"
+#include "expr.h"
+#include "ctree.h"
+#include "cascade.h"
+#include "nest.h"
+
+/**
+ * \brief Pieces with no more edges are solved directly
+ */
+#define TR_LEAF 12
+
+/**
+ * \brief Maximum number of nodes of a separator
+ */
+#define TR_MAXSEP 3
+
+/**
+ * \brief Cost of a node of a separator (in edges of the larger piece)
+ */
+#define TR_PENALTY 2
+
+/**
+ * \brief Solved piece
+ */
+struct tpiece
+{
+  unsigned long long key;  /**< Hash key of the piece */
+  int* data;  /**< Edges and rows of both the graphs */
+  int ecnt;  /**< Number of edges */
+  int m;  /**< Number of rows (each graph) */
+  cpoly_t* poly;  /**< Resulting polynomial */
+  int nid;  /**< Resulting definition (nested expressions only) */
+};
+
+/**
+ * \brief Tearing status
+ */
+struct tstat
+{
+  cstat_t* cs;  /**< Cascade status */
+  struct tpiece* piece;  /**< Solved pieces */
+  int pcnt;  /**< Number of solved pieces */
+  int psize;  /**< Allocated pieces */
+  int* slot;  /**< Hash table of the pieces (open addressing) */
+  int ssize;  /**< Hash table size (power of two) */
+  int* nmap;  /**< Node vertex of each node (-1 if none) */
+  char* inrow[2];  /**< Node is a row of the actual piece (each graph) */
+  int* ids;  /**< Symbols support array */
+  int sep[TR_MAXSEP + 1];  /**< Number of separators of each size */
+};
+
+/**
+ * \brief Incidence graph of a piece
+ *
+ * Vertices are the nodes that are rows (but the ground) first and the edges
+ * then; each %edge is linked to the rows it is incident to, in both the
+ * graphs.
+ */
+struct tgraph
+{
+  int nv;  /**< Number of node vertices */
+  int vnum;  /**< Number of vertices */
+  int* node;  /**< Node of each node vertex */
+  int* rvert;  /**< Node vertex of each row, -1 for the ground (each graph) */
+  int* head;  /**< First link of each vertex (-1 if none) */
+  int* next;  /**< Next link */
+  int* link;  /**< Linked vertex */
+  int* comp;  /**< Component of each vertex (-1 if removed) */
+  int* queue;  /**< Visit queue */
+  int* size;  /**< Number of edges of each component */
+  int* order;  /**< Components sorted by size */
+  char* side;  /**< Side of each component */
+};
+
+/**
+ * \brief Hash key of a piece
+ *
+ * \internal
+ * \param data edges and rows of the piece
+ * \param cnt number of items
+ * \return the key
+ */
+static unsigned long long
+tr_key (const int* data, const int cnt)
+{
+  unsigned long long key;
+  int iter;
+  key = 0xcbf29ce484222325ULL;
+  for(iter = 0; iter < cnt; ++iter)
+    key = (key ^ (unsigned long long) (data[iter] + 1)) * 0x100000001b3ULL;
+  return key;
+}
+
+/**
+ * \brief Lookup slot of a piece
+ *
+ * \internal
+ * \param ts tearing status
+ * \param key hash key of the piece
+ * \param data edges and rows of the piece
+ * \param ecnt number of edges
+ * \param m number of rows (each graph)
+ * \return index of the matching slot or of the free one to be used
+ */
+static int
+tr_slot (const struct tstat* ts, const unsigned long long key, const int* data, const int ecnt, const int m)
+{
+  const struct tpiece* pptr;
+  int idx;
+  idx = (int) (key & (unsigned long long) (ts->ssize - 1));
+  while(ts->slot[idx] >= 0) {
+    pptr = &(ts->piece[ts->slot[idx]]);
+    if((pptr->key == key) && (pptr->ecnt == ecnt) && (pptr->m == m) &&
+       (!memcmp(pptr->data, data, (ecnt + 2 * m) * sizeof(int))))
+      break;
+    idx = (idx + 1) & (ts->ssize - 1);
+  }
+  return idx;
+}
+
+/**
+ * \brief Stores a solved piece
+ *
+ * \internal
+ * \param ts tearing status
+ * \param key hash key of the piece
+ * \param data edges and rows of the piece (it will be owned by the status)
+ * \param ecnt number of edges
+ * \param m number of rows (each graph)
+ * \param poly resulting polynomial (it will be owned by the status)
+ * \param nid resulting definition (nested expressions only)
+ */
+static void
+tr_store (struct tstat* ts, const unsigned long long key, int* data, const int ecnt, const int m, cpoly_t* poly, const int nid)
+{
+  struct tpiece* pptr;
+  int iter;
+  if(ts->pcnt == ts->psize) {
+    ts->psize *= 2;
+    ts->piece = XREALLOC(struct tpiece, ts->piece, ts->psize);
+  }
+  pptr = &(ts->piece[ts->pcnt]);
+  pptr->key = key;
+  pptr->data = data;
+  pptr->ecnt = ecnt;
+  pptr->m = m;
+  pptr->poly = poly;
+  pptr->nid = nid;
+  ts->slot[tr_slot(ts, key, data, ecnt, m)] = ts->pcnt++;
+  if(2 * ts->pcnt > ts->ssize) {
+    XFREE(ts->slot);
+    ts->ssize *= 2;
+    ts->slot = XMALLOC(int, ts->ssize);
+    for(iter = 0; iter < ts->ssize; ++iter)
+      ts->slot[iter] = -1;
+    for(iter = 0; iter < ts->pcnt; ++iter) {
+      pptr = &(ts->piece[iter]);
+      ts->slot[tr_slot(ts, pptr->key, pptr->data, pptr->ecnt, pptr->m)] = iter;
+    }
+  }
+}
+
+/**
+ * \brief Compares components by size
+ *
+ * \internal
+ * \param a first component
+ * \param b second component
+ * \return comparison result, as required by qsort
+ */
+static int
+tr_compare (const void* a, const void* b)
+{
+  return ((const int*) b)[1] - ((const int*) a)[1];
+}
+
+/**
+ * \brief Tears the incidence graph across a set of nodes
+ *
+ * \internal
+ * Components are found once the nodes of the separator are removed, then
+ * they're given to the smaller side, the larger ones first.
+ *
+ * \param tg incidence graph
+ * \param sep node vertices of the separator
+ * \param k number of nodes of the separator
+ * \return number of edges of the larger side, zero if the graph isn't torn
+ */
+static int
+tr_tear (struct tgraph* tg, const int* sep, const int k)
+{
+  int ccnt;
+  int iter;
+  int first;
+  int last;
+  int cur;
+  int dest;
+  int load[2];
+  int* pair;
+  for(iter = 0; iter < tg->vnum; ++iter)
+    tg->comp[iter] = -2;
+  for(iter = 0; iter < k; ++iter)
+    tg->comp[sep[iter]] = -1;
+  ccnt = 0;
+  for(iter = 0; iter < tg->vnum; ++iter)
+    if(tg->comp[iter] == -2) {
+      tg->size[ccnt] = 0;
+      first = 0;
+      last = 1;
+      tg->queue[0] = iter;
+      tg->comp[iter] = ccnt;
+      while(first < last) {
+	cur = tg->queue[first++];
+	if(cur >= tg->nv) ++(tg->size[ccnt]);
+	for(dest = tg->head[cur]; dest != -1; dest = tg->next[dest])
+	  if(tg->comp[tg->link[dest]] == -2) {
+	    tg->comp[tg->link[dest]] = ccnt;
+	    tg->queue[last++] = tg->link[dest];
+	  }
+      }
+      ++ccnt;
+    }
+  pair = tg->order;
+  for(iter = 0; iter < ccnt; ++iter) {
+    pair[2 * iter] = iter;
+    pair[2 * iter + 1] = tg->size[iter];
+  }
+  qsort(pair, ccnt, 2 * sizeof(int), tr_compare);
+  load[0] = load[1] = 0;
+  for(iter = 0; iter < ccnt; ++iter) {
+    cur = (load[1] < load[0]) ? 1 : 0;
+    tg->side[pair[2 * iter]] = cur;
+    load[cur] += pair[2 * iter + 1];
+  }
+  return (load[1] > 0) ? ((load[0] > load[1]) ? load[0] : load[1]) : 0;
+}
+
+/**
+ * \brief Best separator of a piece
+ *
+ * \internal
+ * Separators are tried from the smaller ones on (larger ones only for smaller
+ * pieces), the one that gives the smaller larger side wins, each node of the
+ * separator weighting as \e TR_PENALTY edges. Sides of the best separator are
+ * left into the incidence graph.
+ *
+ * \param tg incidence graph
+ * \param sep pointer to be used to store the separator
+ * \param ecnt number of edges of the piece
+ * \return number of nodes of the separator, -1 if there is no way to tear the
+ *   piece apart
+ */
+static int
+tr_separate (struct tgraph* tg, int* sep, const int ecnt)
+{
+  int cand[TR_MAXSEP];
+  int best;
+  int score;
+  int bestk;
+  int kmax;
+  int k;
+  int pos;
+  best = ecnt;
+  bestk = -1;
+  kmax = (tg->nv <= 40) ? 3 : ((tg->nv <= 160) ? 2 : 1);
+  for(k = 0; (k <= kmax) && (k <= tg->nv) && (best > (ecnt + 1) / 2 + TR_PENALTY * k); ++k) {
+    for(pos = 0; pos < k; ++pos)
+      cand[pos] = pos;
+    do {
+      score = tr_tear(tg, cand, k);
+      if((score > 0) && (score + TR_PENALTY * k < best)) {
+	best = score + TR_PENALTY * k;
+	bestk = k;
+	for(pos = 0; pos < k; ++pos)
+	  sep[pos] = cand[pos];
+      }
+      // next combination of k node vertices
+      for(pos = k - 1; (pos >= 0) && (cand[pos] == tg->nv - k + pos); --pos);
+      if(pos >= 0) {
+	++cand[pos];
+	for(++pos; pos < k; ++pos)
+	  cand[pos] = cand[pos - 1] + 1;
+	pos = 0;
+      }
+    } while((pos >= 0) && (k > 0));
+  }
+  if(bestk >= 0) tr_tear(tg, sep, bestk);
+  return bestk;
+}
+
+/**
+ * \brief Sign of the rows of the first piece
+ *
+ * \internal
+ * That is the parity of the positions of the rows given to the first piece.
+ *
+ * \param rows rows of the whole piece
+ * \param m number of rows
+ * \param first rows of the first piece (bit-mask support array)
+ * \return the sign
+ */
+static int
+tr_parity (const int* rows, const int m, const char* first)
+{
+  int iter;
+  int taken;
+  int sum;
+  taken = sum = 0;
+  for(iter = 0; iter < m; ++iter)
+    if(first[rows[iter]]) {
+      sum += iter - taken;
+      ++taken;
+    }
+  return (sum % 2) ? -1 : 1;
+}
+
+/**
+ * \brief Non-zero test of a solved piece
+ *
+ * \internal
+ * \param poly polynomial of the piece
+ * \param nid definition of the piece (nested expressions only)
+ * \return a positive value if the piece has common trees, zero otherwise
+ */
+static int
+tr_live (const cpoly_t* poly, const int nid)
+{
+  return (env.nest != NULL) ? (nid != NEST_NONE) : (poly->cnt > 0);
+}
+
+static cpoly_t*
+tr_solve (struct tstat*, const int*, const int, int* const*, const int, int*);
+
+/**
+ * \brief Joins the pieces of a torn piece
+ *
+ * \internal
+ * Rows of the shared nodes are given to the first piece or to the second one
+ * in any allowed way, that is so that the pieces get as many rows in both the
+ * graphs. Polynomials of the pieces are multiplied together for each of them,
+ * or their definitions are when nested expressions are asked for.
+ *
+ * \param ts tearing status
+ * \param tg incidence graph (with sides)
+ * \param edge edges of the whole piece
+ * \param ecnt number of edges of the whole piece
+ * \param rows rows of the whole piece
+ * \param m number of rows (each graph)
+ * \param poly polynomial the results are added to
+ * \param nid definition the results are added to (NEST_NONE if not created yet)
+ */
+static void
+tr_join (struct tstat* ts, struct tgraph* tg, const int* edge, const int ecnt, int* const* rows, const int m, cpoly_t* poly, int* nid)
+{
+  cpoly_t* first;
+  cpoly_t* second;
+  int nfirst;
+  int nsecond;
+  char* inside;
+  int* sedge[2];
+  int* srow[2][2];
+  int shared[2][TR_MAXSEP + 1];
+  int priv[2];
+  int scnt[2];
+  int ecnts[2];
+  int mask[2];
+  int take[2];
+  int cnt[2];
+  int iter;
+  int side;
+  int sign;
+  int vert;
+  int g;
+  inside = XMALLOC(char, ts->cs->crep->nnum);
+  for(iter = 0; iter < ts->cs->crep->nnum; ++iter)
+    inside[iter] = 0;
+  for(side = 0; side < 2; ++side) {
+    sedge[side] = XMALLOC(int, ecnt + 1);
+    ecnts[side] = 0;
+    for(g = 0; g < 2; ++g)
+      srow[side][g] = XMALLOC(int, m + 1);
+  }
+  for(iter = 0; iter < ecnt; ++iter) {
+    side = tg->side[tg->comp[tg->nv + iter]];
+    sedge[side][ecnts[side]++] = edge[iter];
+  }
+  // shared rows and rows of the first piece
+  for(g = 0; g < 2; ++g) {
+    scnt[g] = priv[g] = 0;
+    for(iter = 0; iter < m; ++iter) {
+      vert = tg->rvert[g * m + iter];
+      if((vert < 0) || (tg->comp[vert] < 0)) shared[g][scnt[g]++] = rows[g][iter];
+      else if(!tg->side[tg->comp[vert]]) ++priv[g];
+    }
+  }
+  for(mask[0] = 0; mask[0] < (1 << scnt[0]); ++mask[0])
+    for(mask[1] = 0; mask[1] < (1 << scnt[1]); ++mask[1]) {
+      for(g = 0; g < 2; ++g)
+	for(take[g] = priv[g], iter = 0; iter < scnt[g]; ++iter)
+	  if(mask[g] & (1 << iter)) ++take[g];
+      if(take[0] != take[1]) continue;
+      sign = 1;
+      for(g = 0; g < 2; ++g) {
+	for(iter = 0; iter < scnt[g]; ++iter)
+	  inside[shared[g][iter]] = (mask[g] & (1 << iter)) ? 1 : 0;
+	for(iter = 0; iter < m; ++iter) {
+	  vert = tg->rvert[g * m + iter];
+	  if((vert >= 0) && (tg->comp[vert] >= 0))
+	    inside[rows[g][iter]] = !tg->side[tg->comp[vert]];
+	}
+	cnt[0] = cnt[1] = 0;
+	for(iter = 0; iter < m; ++iter) {
+	  side = inside[rows[g][iter]] ? 0 : 1;
+	  srow[side][g][cnt[side]++] = rows[g][iter];
+	}
+	sign *= tr_parity(rows[g], m, inside);
+	for(iter = 0; iter < m; ++iter)
+	  inside[rows[g][iter]] = 0;
+      }
+      first = tr_solve(ts, sedge[0], ecnts[0], srow[0], take[0], &nfirst);
+      if(tr_live(first, nfirst)) {
+	second = tr_solve(ts, sedge[1], ecnts[1], srow[1], m - take[0], &nsecond);
+	if(tr_live(second, nsecond)) {
+	  if(env.nest != NULL) {
+	    if(*nid == NEST_NONE) *nid = nest_sum(env.nest);
+	    nest_add(env.nest, *nid, sign, nfirst, nsecond);
+	  } else cp_mul(poly, first, second, sign, ts->ids);
+	}
+      }
+    }
+  for(side = 0; side < 2; ++side) {
+    for(g = 0; g < 2; ++g)
+      XFREE(srow[side][g]);
+    XFREE(sedge[side]);
+  }
+  XFREE(inside);
+}
+
+/**
+ * \brief Solves a piece
+ *
+ * \internal
+ * Smaller pieces are solved directly, larger ones are torn apart across their
+ * best separator, if any. Rows with no edges mean no common trees at all.
+ *
+ * \param ts tearing status
+ * \param edge edges of the piece (increasing order)
+ * \param ecnt number of edges
+ * \param rows rows of both the graphs
+ * \param m number of rows (each graph)
+ * \param nid pointer to be used to store the definition of the piece (nested
+ *   expressions only)
+ * \return the polynomial of the piece (owned by the tearing status)
+ */
+static cpoly_t*
+tr_solve (struct tstat* ts, const int* edge, const int ecnt, int* const* rows, const int m, int* nid)
+{
+  const circ_t* crep;
+  const edge_t* eptr;
+  struct tgraph tg;
+  cpoly_t* poly;
+  unsigned long long key;
+  int* data;
+  int sep[TR_MAXSEP];
+  int lcnt;
+  int lptr;
+  int iter;
+  int node;
+  int k;
+  int g;
+  crep = ts->cs->crep;
+  data = XMALLOC(int, ecnt + 2 * m + 1);
+  for(iter = 0; iter < ecnt; ++iter)
+    data[iter] = edge[iter];
+  for(g = 0; g < 2; ++g)
+    for(iter = 0; iter < m; ++iter)
+      data[ecnt + g * m + iter] = rows[g][iter];
+  key = tr_key(data, ecnt + 2 * m);
+  iter = tr_slot(ts, key, data, ecnt, m);
+  if(ts->slot[iter] >= 0) {
+    XFREE(data);
+    *nid = ts->piece[ts->slot[iter]].nid;
+    return ts->piece[ts->slot[iter]].poly;
+  }
+  *nid = NEST_NONE;
+  if((ecnt <= TR_LEAF) || (m == 0)) poly = cs_enum(ts->cs, edge, ecnt, rows, m);
+  else {
+    poly = cp_new();
+    // incidence graph of the piece
+    tg.nv = 0;
+    tg.node = XMALLOC(int, 2 * m + 1);
+    for(g = 0; g < 2; ++g)
+      for(iter = 0; iter < m; ++iter) {
+	node = rows[g][iter];
+	ts->inrow[g][node] = 1;
+	if((node != crep->basenode) && (ts->nmap[node] < 0)) {
+	  ts->nmap[node] = tg.nv;
+	  tg.node[tg.nv++] = node;
+	}
+      }
+    tg.rvert = XMALLOC(int, 2 * m + 1);
+    for(g = 0; g < 2; ++g)
+      for(iter = 0; iter < m; ++iter)
+	tg.rvert[g * m + iter] = (rows[g][iter] != crep->basenode) ? ts->nmap[rows[g][iter]] : -1;
+    tg.vnum = tg.nv + ecnt;
+    tg.head = XMALLOC(int, tg.vnum);
+    tg.next = XMALLOC(int, 8 * ecnt + 1);
+    tg.link = XMALLOC(int, 8 * ecnt + 1);
+    tg.comp = XMALLOC(int, tg.vnum);
+    tg.queue = XMALLOC(int, tg.vnum);
+    tg.size = XMALLOC(int, tg.vnum);
+    tg.order = XMALLOC(int, 2 * tg.vnum);
+    tg.side = XMALLOC(char, tg.vnum);
+    for(iter = 0; iter < tg.vnum; ++iter)
+      tg.head[iter] = -1;
+    lcnt = 0;
+    for(iter = 0; iter < ecnt; ++iter) {
+      eptr = &(crep->edge[edge[iter]]);
+      for(g = 0; g < 2; ++g)
+	for(k = 0; k < 2; ++k) {
+	  node = (g ? eptr->gvref[k] : eptr->giref[k])->node;
+	  if(ts->inrow[g][node] && (node != crep->basenode)) {
+	    node = ts->nmap[node];
+	    for(lptr = tg.head[node]; (lptr != -1) && (tg.link[lptr] != tg.nv + iter); lptr = tg.next[lptr]);
+	    if(lptr == -1) {
+	      tg.link[lcnt] = tg.nv + iter;
+	      tg.next[lcnt] = tg.head[node];
+	      tg.head[node] = lcnt++;
+	      tg.link[lcnt] = node;
+	      tg.next[lcnt] = tg.head[tg.nv + iter];
+	      tg.head[tg.nv + iter] = lcnt++;
+	    }
+	  }
+	}
+    }
+    // marks are shared by all the pieces
+    for(g = 0; g < 2; ++g)
+      for(iter = 0; iter < m; ++iter)
+	ts->inrow[g][rows[g][iter]] = 0;
+    for(iter = 0; iter < tg.nv; ++iter)
+      ts->nmap[tg.node[iter]] = -1;
+    for(iter = 0; (iter < tg.nv) && (tg.head[iter] != -1); ++iter);
+    if(iter == tg.nv) {
+      if((k = tr_separate(&tg, sep, ecnt)) >= 0) {
+	++(ts->sep[k]);
+	tr_join(ts, &tg, edge, ecnt, rows, m, poly, nid);
+      } else {
+	cp_del(poly);
+	poly = cs_enum(ts->cs, edge, ecnt, rows, m);
+      }
+    }
+    XFREE(tg.side);
+    XFREE(tg.order);
+    XFREE(tg.size);
+    XFREE(tg.queue);
+    XFREE(tg.comp);
+    XFREE(tg.link);
+    XFREE(tg.next);
+    XFREE(tg.head);
+    XFREE(tg.rvert);
+    XFREE(tg.node);
+  }
+  // leaves of the nested expressions
+  if((env.nest != NULL) && (*nid == NEST_NONE) && (poly->cnt > 0))
+    *nid = nest_leaf(env.nest, cp_chain(crep, poly, 1));
+  tr_store(ts, key, data, ecnt, m, poly, *nid);
+  return poly;
+}
+
+/**
+ * \brief Tearing solver of a block
+ *
+ * \internal
+ * The whole block is a piece whose rows are all the nodes but those of the
+ * additional %edge, then the sign common to all the terms is fixed. Sizes of
+ * the separators are reported on the standard error in verbose mode.
+ *
+ * \param crep %circuit reference
+ * \param ref additional %edge of the block
+ * \param other additional %edge of the other block
+ * \param chain pointer to be used to store the %list
+ * \param block name of the block
+ */
+static void
+tr_block (const circ_t* crep, const edge_t* ref, const edge_t* other, list_t** chain, const char* block)
+{
+  struct tstat ts;
+  char report[128];
+  cpoly_t* poly;
+  int* rows[2];
+  int* edge;
+  int nid;
+  int ecnt;
+  int cnt[2];
+  int iter;
+  int g;
+  ts.cs = cs_new(crep, ref, other);
+  ts.psize = 16;
+  ts.pcnt = 0;
+  ts.piece = XMALLOC(struct tpiece, ts.psize);
+  ts.ssize = 32;
+  ts.slot = XMALLOC(int, ts.ssize);
+  for(iter = 0; iter < ts.ssize; ++iter)
+    ts.slot[iter] = -1;
+  ts.nmap = XMALLOC(int, crep->nnum);
+  ts.ids = XMALLOC(int, crep->ednum + 1);
+  for(iter = 0; iter < crep->nnum; ++iter)
+    ts.nmap[iter] = -1;
+  for(iter = 0; iter <= TR_MAXSEP; ++iter)
+    ts.sep[iter] = 0;
+  edge = XMALLOC(int, crep->ednum + 1);
+  ecnt = 0;
+  for(iter = 0; iter < crep->ednum; ++iter)
+    if(ts.cs->estage[iter] >= 0)
+      edge[ecnt++] = iter;
+  for(g = 0; g < 2; ++g) {
+    ts.inrow[g] = XMALLOC(char, crep->nnum);
+    rows[g] = XMALLOC(int, crep->nnum + 1);
+    cnt[g] = 0;
+    for(iter = 0; iter < crep->nnum; ++iter) {
+      ts.inrow[g][iter] = 0;
+      if(!ts.cs->drop[g][iter])
+	rows[g][cnt[g]++] = iter;
+    }
+  }
+  poly = (cnt[0] == cnt[1]) ? tr_solve(&ts, edge, ecnt, rows, cnt[0], &nid) : NULL;
+  if((poly != NULL) && (env.nest != NULL) && (nid != NEST_NONE)) {
+    iter = nest_sum(env.nest);
+    nest_add(env.nest, iter, cs_sign(ts.cs, rows, cnt[0]), nid, NEST_ONE);
+    env.nest->root[(ref == crep->gref) ? 0 : 1] = iter;
+  } else if((poly != NULL) && (poly->cnt > 0))
+    *chain = (list_t*) cp_chain(crep, poly, cs_sign(ts.cs, rows, cnt[0]));
+  snprintf(report, sizeof(report), "\ntearing, %s: %d pieces torn apart, separators of 0/1/2/3 nodes: %d/%d/%d/%d\n",
+	   block, ts.sep[0] + ts.sep[1] + ts.sep[2] + ts.sep[3], ts.sep[0], ts.sep[1], ts.sep[2], ts.sep[3]);
+  VERBOSE(report);
+  for(iter = 0; iter < ts.pcnt; ++iter) {
+    cp_del(ts.piece[iter].poly);
+    XFREE(ts.piece[iter].data);
+  }
+  for(g = 0; g < 2; ++g) {
+    XFREE(rows[g]);
+    XFREE(ts.inrow[g]);
+  }
+  XFREE(edge);
+  XFREE(ts.ids);
+  XFREE(ts.nmap);
+  XFREE(ts.slot);
+  XFREE(ts.piece);
+  cs_del(ts.cs);
+}
+
+/**
+ * \brief Node-tearing common trees finder
+ *
+ * Node-tearing finder entry point: both the blocks are torn apart and solved
+ * on their own (the yref block and the gref block).
+ *
+ * \param crep %circuit reference
+ * \param yrefchain pointer to be used to store the first %list
+ * \param grefchain pointer to be used to store the second %list
+ * \result zero if some error occurs, a positive value otherwise
+ */
+int
+tearing (const circ_t* crep, list_t** yrefchain, list_t** grefchain)
+{
+  int ret;
+  if(crep != NULL) {
+    ret = 1;
+    if(crep->gref != NULL) tr_block(crep, crep->gref, crep->yref, grefchain, "numerator");
+    if(crep->yref != NULL) tr_block(crep, crep->yref, crep->gref, yrefchain, "denominator");
+  } else {
+    warning("Null pointer!");
+    ret = 0;
+  }
+  return ret;
+}
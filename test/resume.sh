@@ -0,0 +1,20 @@
+#!/bin/sh
+#
+# Checkpoint and resume test: a run stopped by the common trees budget and
+# resumed (many times) has to give the same results of a fresh run.
+#
+# Usage: resume.sh SAPEC-NG NETLIST
+
+bin=$1
+net=$2
+dir=`mktemp -d` || exit 1
+trap 'rm -rf "$dir"' 0
+cp "$net" "$dir/fresh" && cp "$net" "$dir/resumed" || exit 1
+"$bin" "$dir/fresh" || exit 1
+"$bin" -N 500 "$dir/resumed" 2> /dev/null || exit 1
+for step in 1 2 3; do
+  "$bin" -r -N 500 "$dir/resumed" 2> /dev/null || exit 1
+done
+"$bin" -r "$dir/resumed" 2> /dev/null || exit 1
+cmp "$dir/fresh.out" "$dir/resumed.out" || exit 1
+cmp "$dir/fresh.fdt" "$dir/resumed.fdt" || exit 1